@@ -0,0 +1,226 @@
+#
+# Copyright 2021 NVIDIA Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Starting from Python 3.8 DLL search policy has changed.
+# We need to add path to CUDA DLLs explicitly.
+import sys
+import os
+
+if os.name == 'nt':
+    # Add CUDA_PATH env variable
+    cuda_path = os.environ["CUDA_PATH"]
+    if cuda_path:
+        os.add_dll_directory(cuda_path)
+    else:
+        print("CUDA_PATH environment variable is not set.", file = sys.stderr)
+        print("Can't set CUDA DLLs search path.", file = sys.stderr)
+        exit(1)
+
+    # Add PATH as well for minor CUDA releases
+    sys_path = os.environ["PATH"]
+    if sys_path:
+        paths = sys_path.split(';')
+        for path in paths:
+            if os.path.isdir(path):
+                os.add_dll_directory(path)
+    else:
+        print("PATH environment variable is not set.", file = sys.stderr)
+        exit(1)
+
+import PyNvCodec as nvc
+import numpy as np
+import argparse
+import glob
+import json
+import re
+import statistics
+import threading
+import time
+
+# Same batching and median as C++ harness in Benchmarks/inc/BenchmarkUtils.hpp;
+def run_benchmark(args, name, func, items_per_iter=1):
+    start = time.perf_counter_ns()
+    func()
+    warmup_ns = time.perf_counter_ns() - start
+
+    batch_ns = args.min_time * 1e9 / args.batches
+    iters_per_batch = max(1, int(batch_ns / max(warmup_ns, 1)))
+
+    batch_times = []
+    for batch in range(0, args.batches):
+        start = time.perf_counter_ns()
+        for i in range(0, iters_per_batch):
+            func()
+        batch_times.append((time.perf_counter_ns() - start) / iters_per_batch)
+
+    ns_per_iter = statistics.median_low(batch_times)
+    return {"name": name,
+            "iterations": iters_per_batch * args.batches,
+            "ns_per_iter": round(ns_per_iter, 1),
+            "bytes_per_iter": 0,
+            "items_per_sec": round(items_per_iter * 1e9 / ns_per_iter, 2),
+            "gbytes_per_sec": 0.0}
+
+def get_clip_label(path):
+    # Clips made by BenchDemuxDecode are named like h264_1280x720_90f_gop30.mp4;
+    base = os.path.splitext(os.path.basename(path))[0]
+    match = re.match(r"([a-z0-9]+)_\d+x(\d+)_", base)
+    return "{}/{}p".format(match.group(1), match.group(2)) if match else base
+
+def count_packets(path):
+    nvDmx = nvc.PyFFmpegDemuxer(path)
+    packet = np.ndarray(shape=(0), dtype=np.uint8)
+    num_packets = 0
+    while nvDmx.DemuxSinglePacket(packet):
+        num_packets += 1
+    return num_packets
+
+def bench_clip(args, path, results):
+    label = get_clip_label(path)
+    num_packets = count_packets(path)
+    num_frames = min(num_packets, args.num_frames)
+    if not num_frames:
+        print("Skipping", path, ": no packets", file=sys.stderr)
+        return
+
+    # Every pass opens file, so it never hits end of stream like C++ Demux;
+    def demux():
+        nvDmx = nvc.PyFFmpegDemuxer(path)
+        packet = np.ndarray(shape=(0), dtype=np.uint8)
+        for i in range(0, num_packets):
+            nvDmx.DemuxSinglePacket(packet)
+
+    def demux_no_copy():
+        nvDmx = nvc.PyFFmpegDemuxer(path)
+        for i in range(0, num_packets):
+            nvDmx.DemuxSinglePacketNoCopy()
+
+    # Single thread decoder matches C++ Decode/.../threads_1;
+    def decode():
+        nvDec = nvc.PyFfmpegDecoder(path, {}, 1)
+        frame = np.ndarray(shape=(0), dtype=np.uint8)
+        for i in range(0, num_frames):
+            nvDec.DecodeSingleFrame(frame)
+
+    def decode_no_copy():
+        nvDec = nvc.PyFfmpegDecoder(path, {}, 1)
+        for i in range(0, num_frames):
+            nvDec.DecodeSingleFrameNoCopy()
+
+    # Stream iterators cross bindings once per chunk;
+    def demux_stream():
+        nvDmx = nvc.PyFFmpegDemuxer(path)
+        num_left = num_packets
+        for packets in nvDmx.Stream(args.chunk_size):
+            num_left -= len(packets)
+            if num_left <= 0:
+                break
+
+    def decode_stream():
+        nvDec = nvc.PyFfmpegDecoder(path, {}, 1)
+        num_left = num_frames
+        for frames in nvDec.Stream(args.chunk_size):
+            num_left -= len(frames)
+            if num_left <= 0:
+                break
+
+    # Bare call cost, lower bound for every binding;
+    nvDmx = nvc.PyFFmpegDemuxer(path)
+    def call():
+        nvDmx.Width()
+
+    benchmarks = [("PyCall/" + label, call, 1),
+                  ("PyDemux/" + label, demux, num_packets),
+                  ("PyDemuxNoCopy/" + label, demux_no_copy, num_packets),
+                  ("PyDemuxStream/" + label, demux_stream, num_packets),
+                  ("PyDecode/" + label + "/threads_1", decode, num_frames),
+                  ("PyDecodeNoCopy/" + label + "/threads_1", decode_no_copy,
+                   num_frames),
+                  ("PyDecodeStream/" + label + "/threads_1", decode_stream,
+                   num_frames)]
+
+    # Every thread has its own demuxer / decoder like SampleDecodeMultiThread;
+    # Bindings release GIL, so items/s should grow about linearly with threads;
+    def in_threads(func, num_threads):
+        def run():
+            workers = [threading.Thread(target=func) for i in range(0, num_threads)]
+            for worker in workers:
+                worker.start()
+            for worker in workers:
+                worker.join()
+        return run
+
+    for num_threads in args.threads:
+        suffix = "/py_threads_{}".format(num_threads)
+        benchmarks.append(("PyDemux/" + label + suffix,
+                           in_threads(demux, num_threads),
+                           num_packets * num_threads))
+        benchmarks.append(("PyDecode/" + label + "/threads_1" + suffix,
+                           in_threads(decode, num_threads),
+                           num_frames * num_threads))
+
+    for name, func, items_per_iter in benchmarks:
+        if args.filter in name:
+            results.append(run_benchmark(args, name, func, items_per_iter))
+
+def print_results(args, results):
+    if args.json:
+        print(json.dumps({"benchmarks": results}, indent=2))
+        return
+
+    print("{:<48}{:>14}{:>14}".format("Benchmark", "ns/iter", "items/s"))
+    for r in results:
+        print("{:<48}{:>14.1f}{:>14.1f}".format(
+            r["name"], r["ns_per_iter"], r["items_per_sec"]))
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(
+        description="Measures Python bindings overhead of demuxer and CPU-based decoder "
+        "and how they scale with number of Python threads. "
+        "Compare items/s with Demux and Decode results of BenchDemuxDecode.")
+    parser.add_argument("clips", nargs="*", help="input files")
+    parser.add_argument("--clip_dir", default=None,
+                        help="folder with clips generated by BenchDemuxDecode")
+    parser.add_argument("--json", action="store_true",
+                        help="output results as JSON instead of table")
+    parser.add_argument("--min_time", type=float, default=0.5)
+    parser.add_argument("--batches", type=int, default=7)
+    parser.add_argument("--filter", default="",
+                        help="only run benchmarks which names contain this substring")
+    parser.add_argument("--num_frames", type=int, default=90,
+                        help="number of frames decoded by single iteration")
+    parser.add_argument("--chunk_size", type=int, default=8,
+                        help="number of items in chunk for stream benchmarks")
+    parser.add_argument("--threads", default="1,2,4",
+                        help="comma separated numbers of Python threads for scaling benchmarks")
+    args = parser.parse_args()
+    args.batches = max(1, args.batches)
+    args.threads = [max(1, int(n)) for n in args.threads.split(",") if n]
+
+    clips = list(args.clips)
+    if args.clip_dir:
+        clips.extend(sorted(glob.glob(os.path.join(args.clip_dir, "*.mp4"))))
+    if not clips:
+        parser.print_usage(sys.stderr)
+        print("Provide input files or --clip_dir", file=sys.stderr)
+        exit(1)
+
+    results = []
+    for clip in clips:
+        bench_clip(args, clip, results)
+
+    print_results(args, results)
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Minimalistic benchmarking harness;
+ * Every benchmark is run in batches until minimal time is elapsed,
+ * median batch time is reported to filter out scheduler noise;
+ */
+namespace VPF {
+namespace Bench {
+
+struct BenchResult {
+  std::string name;
+  // Number of timed iterations;
+  uint64_t iterations = 0U;
+  // Median time of single iteration;
+  double ns_per_iter = 0.0;
+  // Amount of data processed by single iteration, 0 if not applicable;
+  uint64_t bytes_per_iter = 0U;
+  // Number of items (frames, packets) processed by single iteration;
+  uint64_t items_per_iter = 1U;
+
+  double GBytesPerSec() const {
+    return ns_per_iter > 0.0 ? bytes_per_iter / ns_per_iter : 0.0;
+  }
+
+  double ItemsPerSec() const {
+    return ns_per_iter > 0.0 ? items_per_iter * 1e9 / ns_per_iter : 0.0;
+  }
+};
+
+struct BenchOptions {
+  // Minimal accumulated time of all batches;
+  double min_time_sec = 0.5;
+  // Number of batches to take median from;
+  uint32_t num_batches = 7U;
+  // Output results as JSON instead of table;
+  bool json = false;
+  // Only run benchmarks which names contain this substring;
+  std::string filter;
+  // Folder for generated test clips, they are reused by later runs;
+  std::string clip_dir = ".";
+  // Only check results against references, nothing is timed;
+  bool verify_only = false;
+};
+
+inline BenchOptions ParseOptions(int argc, char **argv) {
+  BenchOptions opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if ("--json" == arg) {
+      opts.json = true;
+    } else if ("--min_time" == arg && i + 1 < argc) {
+      opts.min_time_sec = std::stod(argv[++i]);
+    } else if ("--batches" == arg && i + 1 < argc) {
+      opts.num_batches = std::max(1, std::stoi(argv[++i]));
+    } else if ("--filter" == arg && i + 1 < argc) {
+      opts.filter = argv[++i];
+    } else if ("--clip_dir" == arg && i + 1 < argc) {
+      opts.clip_dir = argv[++i];
+    } else if ("--verify_only" == arg) {
+      opts.verify_only = true;
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--json] [--min_time sec] [--batches num]"
+                << " [--filter substring] [--clip_dir path] [--verify_only]"
+                << std::endl;
+      exit(1);
+    }
+  }
+  return opts;
+}
+
+inline bool IsFilteredOut(const BenchOptions &opts, const std::string &name) {
+  return !opts.filter.empty() && std::string::npos == name.find(opts.filter);
+}
+
+// Prevents compiler from optimizing away unused results;
+template <typename T> inline void DoNotOptimize(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile char sink;
+  sink = *reinterpret_cast<const volatile char *>(&value);
+#endif
+}
+
+template <typename Func>
+inline BenchResult RunBenchmark(const BenchOptions &opts,
+                                const std::string &name,
+                                uint64_t bytes_per_iter, Func &&func,
+                                uint64_t items_per_iter = 1U) {
+  using clock = std::chrono::steady_clock;
+
+  BenchResult result;
+  result.name = name;
+  result.bytes_per_iter = bytes_per_iter;
+  result.items_per_iter = items_per_iter;
+
+  // Warm up caches & estimate single iteration time;
+  auto start = clock::now();
+  func();
+  auto warmup_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+  auto const batch_ns = opts.min_time_sec * 1e9 / opts.num_batches;
+  auto const iters_per_batch = std::max<uint64_t>(
+      1U, (uint64_t)(batch_ns / std::max(warmup_ns, 1.0)));
+
+  std::vector<double> batch_times;
+  for (uint32_t batch = 0; batch < opts.num_batches; batch++) {
+    start = clock::now();
+    for (uint64_t i = 0; i < iters_per_batch; i++) {
+      func();
+    }
+    auto elapsed =
+        std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    batch_times.push_back(elapsed / iters_per_batch);
+  }
+
+  std::sort(batch_times.begin(), batch_times.end());
+  result.ns_per_iter = batch_times[batch_times.size() / 2];
+  result.iterations = iters_per_batch * opts.num_batches;
+  return result;
+}
+
+inline void PrintResults(const BenchOptions &opts,
+                         const std::vector<BenchResult> &results) {
+  if (opts.json) {
+    std::cout << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      auto const &r = results[i];
+      std::cout << "    {\"name\": \"" << r.name << "\", "
+                << "\"iterations\": " << r.iterations << ", "
+                << "\"ns_per_iter\": " << std::fixed << std::setprecision(1)
+                << r.ns_per_iter << ", "
+                << "\"bytes_per_iter\": " << r.bytes_per_iter << ", "
+                << "\"items_per_sec\": " << std::setprecision(2)
+                << r.ItemsPerSec() << ", "
+                << "\"gbytes_per_sec\": " << std::setprecision(3)
+                << r.GBytesPerSec() << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n}" << std::endl;
+    return;
+  }
+
+  std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+            << std::setw(14) << "ns/iter" << std::setw(14) << "items/s"
+            << std::setw(10) << "GB/s" << std::endl;
+  for (auto const &r : results) {
+    std::cout << std::left << std::setw(48) << r.name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(1)
+              << r.ns_per_iter << std::setw(14) << std::setprecision(1)
+              << r.ItemsPerSec() << std::setw(10) << std::setprecision(2)
+              << r.GBytesPerSec() << std::endl;
+  }
+}
+
+} // namespace Bench
+} // namespace VPF
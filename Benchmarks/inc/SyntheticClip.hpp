@@ -0,0 +1,216 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+}
+
+/* Encodes test clips with libavcodec, so benchmarks don't depend on
+ * sample files; Clips are cached in given folder and encoded only once;
+ */
+namespace VPF {
+namespace Bench {
+
+struct ClipParams {
+  AVCodecID codec_id = AV_CODEC_ID_H264;
+  uint32_t width = 1280U;
+  uint32_t height = 720U;
+  uint32_t num_frames = 120U;
+  uint32_t gop_size = 30U;
+  uint32_t fps = 30U;
+  // B-frames make decode order differ from display order like in real clips;
+  uint32_t max_b_frames = 2U;
+};
+
+inline std::string AvErrorString(int err) {
+  char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+  av_strerror(err, buf, sizeof(buf));
+  return std::string(buf);
+}
+
+inline std::string GetClipName(const ClipParams &params) {
+  std::stringstream ss;
+  ss << avcodec_get_name(params.codec_id) << "_" << params.width << "x"
+     << params.height << "_" << params.num_frames << "f_gop"
+     << params.gop_size << ".mp4";
+  return ss.str();
+}
+
+inline bool IsEncoderAvailable(AVCodecID codec_id) {
+  return nullptr != avcodec_find_encoder(codec_id);
+}
+
+/* Moving gradient with noise; Noise keeps encoder from making tiny
+ * packets, motion gives P and B frames some work;
+ */
+inline void FillFrame(AVFrame *frame, uint32_t frame_num) {
+  uint32_t state = 2166136261U ^ frame_num;
+  for (int plane = 0; plane < 3; plane++) {
+    auto const width = plane ? (frame->width + 1) / 2 : frame->width;
+    auto const height = plane ? (frame->height + 1) / 2 : frame->height;
+    for (int y = 0; y < height; y++) {
+      auto row = frame->data[plane] + (size_t)y * frame->linesize[plane];
+      for (int x = 0; x < width; x++) {
+        state = state * 1664525U + 1013904223U;
+        auto const value = (plane ? 128 + x / 8 - y / 8 : x + y) +
+                           (int)(frame_num * 4U) + (int)(state >> 29);
+        row[x] = (uint8_t)value;
+      }
+    }
+  }
+}
+
+namespace detail {
+struct ClipEncoder {
+  AVFormatContext *fmt_ctx = nullptr;
+  AVCodecContext *enc_ctx = nullptr;
+  AVStream *stream = nullptr;
+  AVFrame *frame = nullptr;
+  AVPacket *packet = nullptr;
+
+  ~ClipEncoder() {
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&enc_ctx);
+    if (fmt_ctx) {
+      avio_closep(&fmt_ctx->pb);
+      avformat_free_context(fmt_ctx);
+    }
+  }
+
+  static void Check(int res, const char *what) {
+    if (res < 0) {
+      throw std::runtime_error(std::string(what) + ": " + AvErrorString(res));
+    }
+  }
+
+  void Encode(AVFrame *input) {
+    Check(avcodec_send_frame(enc_ctx, input), "avcodec_send_frame");
+    while (true) {
+      auto res = avcodec_receive_packet(enc_ctx, packet);
+      if (AVERROR(EAGAIN) == res || AVERROR_EOF == res) {
+        return;
+      }
+      Check(res, "avcodec_receive_packet");
+
+      av_packet_rescale_ts(packet, enc_ctx->time_base, stream->time_base);
+      packet->stream_index = stream->index;
+      Check(av_interleaved_write_frame(fmt_ctx, packet),
+            "av_interleaved_write_frame");
+    }
+  }
+
+  void Run(const ClipParams &params, const std::string &path) {
+    auto codec = avcodec_find_encoder(params.codec_id);
+    if (!codec) {
+      throw std::runtime_error(std::string("No encoder for ") +
+                               avcodec_get_name(params.codec_id));
+    }
+
+    Check(avformat_alloc_output_context2(&fmt_ctx, nullptr, "mp4",
+                                         path.c_str()),
+          "avformat_alloc_output_context2");
+    stream = avformat_new_stream(fmt_ctx, nullptr);
+    enc_ctx = avcodec_alloc_context3(codec);
+    if (!stream || !enc_ctx) {
+      throw std::runtime_error("Can't allocate encoder");
+    }
+
+    enc_ctx->width = (int)params.width;
+    enc_ctx->height = (int)params.height;
+    enc_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc_ctx->time_base = {1, (int)params.fps};
+    enc_ctx->framerate = {(int)params.fps, 1};
+    enc_ctx->gop_size = (int)params.gop_size;
+    enc_ctx->max_b_frames = (int)params.max_b_frames;
+    // About 0.1 bit per pixel, typical for surveillance streams;
+    enc_ctx->bit_rate = (int64_t)params.width * params.height * params.fps / 10;
+    if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+      enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    Check(avcodec_open2(enc_ctx, codec, nullptr), "avcodec_open2");
+    Check(avcodec_parameters_from_context(stream->codecpar, enc_ctx),
+          "avcodec_parameters_from_context");
+    stream->time_base = enc_ctx->time_base;
+
+    Check(avio_open(&fmt_ctx->pb, path.c_str(), AVIO_FLAG_WRITE), "avio_open");
+    Check(avformat_write_header(fmt_ctx, nullptr), "avformat_write_header");
+
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+    if (!frame || !packet) {
+      throw std::runtime_error("Can't allocate frame");
+    }
+    frame->format = enc_ctx->pix_fmt;
+    frame->width = enc_ctx->width;
+    frame->height = enc_ctx->height;
+    Check(av_frame_get_buffer(frame, 0), "av_frame_get_buffer");
+
+    for (auto i = 0U; i < params.num_frames; i++) {
+      Check(av_frame_make_writable(frame), "av_frame_make_writable");
+      FillFrame(frame, i);
+      frame->pts = i;
+      Encode(frame);
+    }
+
+    // Flush delayed frames;
+    Encode(nullptr);
+    Check(av_write_trailer(fmt_ctx), "av_write_trailer");
+  }
+};
+} // namespace detail
+
+/* Returns path of clip with given params, encodes it if it isn't cached
+ * in dir yet; Throws if there's no encoder for codec or clip can't be
+ * written;
+ */
+inline std::string MakeSyntheticClip(const ClipParams &params,
+                                     const std::string &dir) {
+  auto const path = dir + "/" + GetClipName(params);
+  if (std::ifstream(path).good()) {
+    return path;
+  }
+
+  // Interrupted run mustn't leave truncated clip in cache;
+  auto const tmp_path = path + ".tmp";
+  {
+    detail::ClipEncoder encoder;
+    try {
+      encoder.Run(params, tmp_path);
+    } catch (...) {
+      std::remove(tmp_path.c_str());
+      throw;
+    }
+  }
+
+  if (0 != std::rename(tmp_path.c_str(), path.c_str())) {
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error("Can't write " + path);
+  }
+  return path;
+}
+
+} // namespace Bench
+} // namespace VPF
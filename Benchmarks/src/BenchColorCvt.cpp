@@ -0,0 +1,448 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BenchmarkUtils.hpp"
+#include "HostColorCvt.hpp"
+#include "MemoryInterfaces.hpp"
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(VPF_BENCH_SWSCALE)
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+using namespace VPF;
+using namespace VPF::Bench;
+using namespace std;
+
+/* Largest allowed differences of scalar kernel output, in LSB;
+ * Reference is exact math in double precision, fixed point kernels may
+ * be 1 off after rounding; libswscale does its own fixed point math, so
+ * both may be 1 off in opposite directions; Pixel shuffles must be exact;
+ */
+struct Conversion {
+  const char *name;
+  Pixel_Format in;
+  Pixel_Format out;
+  int ref_tolerance;
+  int sws_tolerance;
+};
+
+// Same pairs as ConvertSurface supports;
+static const Conversion conversions[] = {
+    {"nv12_yuv420", NV12, YUV420, 0, 0}, {"yuv420_nv12", YUV420, NV12, 0, 0},
+    {"nv12_rgb", NV12, RGB, 1, 2},       {"nv12_bgr", NV12, BGR, 1, 2},
+    {"yuv420_rgb", YUV420, RGB, 1, 2},   {"rgb_yuv420", RGB, YUV420, 1, 2},
+    {"bgr_ycbcr", BGR, YCBCR, 1, 2},     {"rgb_planar", RGB, RGB_PLANAR, 0, 0},
+    {"rgb_bgr", RGB, BGR, 0, 0}};
+
+struct ColorParams {
+  const char *name;
+  ColorspaceConversionContext ctx;
+};
+
+static const ColorParams color_params[] = {
+    {"bt601_mpeg", ColorspaceConversionContext(BT_601, MPEG)},
+    {"bt601_jpeg", ColorspaceConversionContext(BT_601, JPEG)},
+    {"bt709_mpeg", ColorspaceConversionContext(BT_709, MPEG)},
+    {"bt709_jpeg", ColorspaceConversionContext(BT_709, JPEG)}};
+
+typedef unique_ptr<Surface> SurfacePtr;
+
+static SurfacePtr MakeHostSurface(Pixel_Format format, uint32_t width,
+                                  uint32_t height) {
+  SurfacePtr surface(Surface::Make(format, width, height, MEM_HOST));
+  if (!surface || surface->Empty()) {
+    throw runtime_error("Can't allocate host Surface");
+  }
+  return surface;
+}
+
+/* Smooth gradients with some noise, like camera picture;
+ * Flat picture would hide rounding errors, pure noise exaggerates
+ * chroma subsampling differences;
+ */
+static void FillSurface(Surface *surface) {
+  uint32_t state = 12345U;
+  for (auto plane = 0U; plane < surface->NumPlanes(); plane++) {
+    auto ptr = (uint8_t *)surface->PlanePtr(plane);
+    for (auto y = 0U; y < surface->Height(plane); y++) {
+      auto row = ptr + (size_t)y * surface->Pitch(plane);
+      for (auto x = 0U; x < surface->WidthInBytes(plane); x++) {
+        state = state * 1664525U + 1013904223U;
+        row[x] = (uint8_t)((x / 4 + y / 2 + plane * 64) + (state >> 30));
+      }
+    }
+  }
+}
+
+/* Picture of flat 8x8 tiles with random colors;
+ * Libswscale places chroma samples differently, which may shift chroma
+ * by one sample; That only matters within 2 pixels from tile edges, so
+ * they are left out of comparison;
+ */
+static const uint32_t tile_size = 8U;
+
+#if defined(VPF_BENCH_SWSCALE)
+static void FillTiles(Surface *surface) {
+  uint32_t state = 12345U;
+  for (auto plane = 0U; plane < surface->NumPlanes(); plane++) {
+    auto const tile = tile_size * surface->Height(plane) / surface->Height();
+    auto const channels = surface->WidthInBytes(plane) /
+                          (surface->Width() * tile / tile_size);
+    auto ptr = (uint8_t *)surface->PlanePtr(plane);
+    for (auto y = 0U; y < surface->Height(plane); y += tile) {
+      for (auto x = 0U; x < surface->WidthInBytes(plane); x += tile * channels) {
+        for (auto ch = 0U; ch < channels; ch++) {
+          state = state * 1664525U + 1013904223U;
+          for (auto ty = y; ty < min(y + tile, surface->Height(plane)); ty++) {
+            auto row = ptr + (size_t)ty * surface->Pitch(plane);
+            for (auto tx = x + ch;
+                 tx < min(x + tile * channels, surface->WidthInBytes(plane));
+                 tx += channels) {
+              row[tx] = (uint8_t)(state >> 24);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+#endif
+
+// Compares whole Surfaces or just tile interiors;
+static int GetMaxDifference(Surface *a, Surface *b, bool skip_edges = false) {
+  auto max_diff = 0;
+  for (auto plane = 0U; plane < a->NumPlanes(); plane++) {
+    auto const tile = tile_size * a->Height(plane) / a->Height();
+    auto const channels =
+        a->WidthInBytes(plane) / (a->Width() * tile / tile_size);
+    auto is_edge = [&](uint32_t pos) {
+      return skip_edges &&
+             (pos % tile < tile / 4U || pos % tile >= tile - tile / 4U);
+    };
+
+    auto pa = (const uint8_t *)a->PlanePtr(plane);
+    auto pb = (const uint8_t *)b->PlanePtr(plane);
+    for (auto y = 0U; y < a->Height(plane); y++) {
+      if (is_edge(y)) {
+        continue;
+      }
+      auto ra = pa + (size_t)y * a->Pitch(plane);
+      auto rb = pb + (size_t)y * b->Pitch(plane);
+      for (auto x = 0U; x < a->WidthInBytes(plane); x++) {
+        if (!is_edge(x / channels)) {
+          max_diff = max(max_diff, abs((int)ra[x] - (int)rb[x]));
+        }
+      }
+    }
+  }
+  return max_diff;
+}
+
+static bool IsYuv(Pixel_Format format) {
+  return NV12 == format || YUV420 == format || YCBCR == format;
+}
+
+// Reads and writes pixels of every format conversions use;
+struct PixelAccess {
+  Surface *surface;
+
+  uint8_t *At(uint32_t plane, uint32_t x, uint32_t y) const {
+    return (uint8_t *)surface->PlanePtr(plane) +
+           (size_t)y * surface->Pitch(plane) + x;
+  }
+
+  // Y, U, V or R, G, B channel of given pixel, chroma is shared by 2x2;
+  uint8_t *Channel(uint32_t ch, uint32_t x, uint32_t y) const {
+    switch (surface->PixelFormat()) {
+    case NV12:
+      return ch ? At(1U, x / 2 * 2 + ch - 1U, y / 2) : At(0U, x, y);
+    case YUV420:
+    case YCBCR:
+      return ch ? At(ch, x / 2, y / 2) : At(0U, x, y);
+    case RGB:
+      return At(0U, 3 * x + ch, y);
+    case BGR:
+      return At(0U, 3 * x + 2 - ch, y);
+    case RGB_PLANAR:
+      return At(ch, x, y);
+    default:
+      throw runtime_error("Unexpected pixel format");
+    }
+  }
+};
+
+static uint8_t ToU8(double value) {
+  return (uint8_t)lround(min(255.0, max(0.0, value)));
+}
+
+/* Straightforward double precision conversion;
+ * Chroma is duplicated to 2x2 pixels and taken from 2x2 average, same as
+ * host kernels do;
+ */
+static void ConvertReference(Surface *src, Surface *dst,
+                             const ColorspaceConversionContext &cc) {
+  auto const kr = BT_709 == cc.color_space ? 0.2126 : 0.299;
+  auto const kb = BT_709 == cc.color_space ? 0.0722 : 0.114;
+  auto const kg = 1.0 - kr - kb;
+  auto const is_full = JPEG == cc.color_range;
+  auto const y_range = is_full ? 255.0 : 219.0;
+  auto const c_range = is_full ? 255.0 : 224.0;
+  auto const y_offset = is_full ? 0.0 : 16.0;
+
+  PixelAccess in = {src}, out = {dst};
+  for (auto y = 0U; y < src->Height(); y++) {
+    for (auto x = 0U; x < src->Width(); x++) {
+      if (IsYuv(src->PixelFormat()) == IsYuv(dst->PixelFormat())) {
+        for (auto ch = 0U; ch < 3U; ch++) {
+          *out.Channel(ch, x, y) = *in.Channel(ch, x, y);
+        }
+      } else if (IsYuv(src->PixelFormat())) {
+        auto const luma = (*in.Channel(0U, x, y) - y_offset) * 255.0 / y_range;
+        auto const cb = (*in.Channel(1U, x, y) - 128.0) * 255.0 / c_range;
+        auto const cr = (*in.Channel(2U, x, y) - 128.0) * 255.0 / c_range;
+        *out.Channel(0U, x, y) = ToU8(luma + 2.0 * (1.0 - kr) * cr);
+        *out.Channel(1U, x, y) =
+            ToU8(luma - 2.0 * kb * (1.0 - kb) / kg * cb -
+                 2.0 * kr * (1.0 - kr) / kg * cr);
+        *out.Channel(2U, x, y) = ToU8(luma + 2.0 * (1.0 - kb) * cb);
+      } else {
+        auto luma = [&](uint32_t px, uint32_t py) {
+          return kr * *in.Channel(0U, px, py) +
+                 kg * *in.Channel(1U, px, py) + kb * *in.Channel(2U, px, py);
+        };
+        *out.Channel(0U, x, y) = ToU8(y_offset + luma(x, y) * y_range / 255.0);
+        if (x % 2 || y % 2) {
+          continue;
+        }
+
+        double r = 0.0, b = 0.0, l = 0.0;
+        for (auto py = y; py < y + 2U; py++) {
+          for (auto px = x; px < x + 2U; px++) {
+            r += *in.Channel(0U, px, py) / 4.0;
+            b += *in.Channel(2U, px, py) / 4.0;
+            l += luma(px, py) / 4.0;
+          }
+        }
+        *out.Channel(1U, x, y) =
+            ToU8(128.0 + (b - l) / (2.0 * (1.0 - kb)) * c_range / 255.0);
+        *out.Channel(2U, x, y) =
+            ToU8(128.0 + (r - l) / (2.0 * (1.0 - kr)) * c_range / 255.0);
+      }
+    }
+  }
+}
+
+#if defined(VPF_BENCH_SWSCALE)
+static AVPixelFormat GetAvFormat(Pixel_Format format) {
+  switch (format) {
+  case NV12:
+    return AV_PIX_FMT_NV12;
+  case YUV420:
+  case YCBCR:
+    return AV_PIX_FMT_YUV420P;
+  case RGB:
+    return AV_PIX_FMT_RGB24;
+  case BGR:
+    return AV_PIX_FMT_BGR24;
+  case RGB_PLANAR:
+    return AV_PIX_FMT_GBRP;
+  default:
+    return AV_PIX_FMT_NONE;
+  }
+}
+
+// Does the same conversion as ConvertSurfaceHost with libswscale;
+struct SwsConverter {
+  SwsContext *ctx = nullptr;
+  uint8_t *src_data[4] = {nullptr};
+  int src_linesize[4] = {0};
+  uint8_t *dst_data[4] = {nullptr};
+  int dst_linesize[4] = {0};
+  int height = 0;
+
+  static void GetPlanes(Surface *surface, uint8_t **data, int *linesize) {
+    for (auto plane = 0U; plane < surface->NumPlanes(); plane++) {
+      data[plane] = (uint8_t *)surface->PlanePtr(plane);
+      linesize[plane] = (int)surface->Pitch(plane);
+    }
+
+    // GBRP plane order;
+    if (RGB_PLANAR == surface->PixelFormat()) {
+      swap(data[0], data[1]);
+      swap(data[1], data[2]);
+    }
+  }
+
+  SwsConverter(Surface *src, Surface *dst,
+               const ColorspaceConversionContext &cc)
+      : height((int)src->Height()) {
+    ctx = sws_getContext(src->Width(), src->Height(),
+                         GetAvFormat(src->PixelFormat()), dst->Width(),
+                         dst->Height(), GetAvFormat(dst->PixelFormat()),
+                         SWS_POINT | SWS_ACCURATE_RND, nullptr, nullptr,
+                         nullptr);
+    if (!ctx) {
+      throw runtime_error("Can't create swscale context");
+    }
+
+    auto const coeffs =
+        sws_getCoefficients(BT_709 == cc.color_space ? SWS_CS_ITU709
+                                                     : SWS_CS_ITU601);
+    auto const is_full = JPEG == cc.color_range;
+    sws_setColorspaceDetails(ctx, coeffs,
+                             IsYuv(src->PixelFormat()) ? is_full : 1, coeffs,
+                             IsYuv(dst->PixelFormat()) ? is_full : 1, 0,
+                             1 << 16, 1 << 16);
+
+    GetPlanes(src, src_data, src_linesize);
+    GetPlanes(dst, dst_data, dst_linesize);
+  }
+
+  ~SwsConverter() { sws_freeContext(ctx); }
+
+  void Run() {
+    sws_scale(ctx, src_data, src_linesize, 0, height, dst_data, dst_linesize);
+  }
+};
+#endif
+
+/* SIMD kernels must match scalar one bit to bit, scalar one must be
+ * within tolerance of double precision reference and libswscale;
+ * Throws if any of them doesn't match;
+ */
+static void Verify(const Conversion &cvt, uint32_t width, uint32_t height) {
+  auto src = MakeHostSurface(cvt.in, width, height);
+  auto ref = MakeHostSurface(cvt.out, width, height);
+  auto dst = MakeHostSurface(cvt.out, width, height);
+
+  auto check = [&](const ColorParams &params, const char *ref_name,
+                   int tolerance, bool skip_edges) {
+    auto const diff = GetMaxDifference(ref.get(), dst.get(), skip_edges);
+    if (diff > tolerance) {
+      stringstream msg;
+      msg << cvt.name << "/" << params.name << ": max difference from "
+          << ref_name << " is " << diff << ", tolerance is " << tolerance;
+      throw runtime_error(msg.str());
+    }
+  };
+
+  for (auto const &params : color_params) {
+    FillSurface(src.get());
+    if (!ConvertSurfaceHost(src.get(), ref.get(), &params.ctx,
+                            HOST_CVT_SCALAR) ||
+        !ConvertSurfaceHost(src.get(), dst.get(), &params.ctx)) {
+      throw runtime_error(string("Can't convert ") + cvt.name);
+    }
+    check(params, GetHostCvtKernelName(GetHostCvtKernel()), 0, false);
+
+    ConvertReference(src.get(), ref.get(), params.ctx);
+    check(params, "reference", cvt.ref_tolerance, false);
+
+#if defined(VPF_BENCH_SWSCALE)
+    FillTiles(src.get());
+    ConvertSurfaceHost(src.get(), dst.get(), &params.ctx, HOST_CVT_SCALAR);
+    SwsConverter sws(src.get(), ref.get(), params.ctx);
+    sws.Run();
+    check(params, "swscale", cvt.sws_tolerance, true);
+#endif
+  }
+}
+
+int main(int argc, char **argv) {
+  auto opts = ParseOptions(argc, argv);
+
+  struct Resolution {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  const Resolution resolutions[] = {
+      {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+
+  vector<HostCvtKernel> kernels = {HOST_CVT_SCALAR};
+  if (HOST_CVT_SCALAR != GetHostCvtKernel()) {
+    kernels.push_back(GetHostCvtKernel());
+  }
+
+  vector<BenchResult> results;
+  for (auto const &cvt : conversions) {
+    auto is_used = false;
+    for (auto const &res : resolutions) {
+      is_used = is_used || !IsFilteredOut(opts, string("ColorCvt/") +
+                                                    cvt.name + "/" + res.name);
+    }
+    if (!is_used) {
+      continue;
+    }
+
+    // Width isn't multiple of SIMD width, so row tails are checked too;
+    try {
+      Verify(cvt, 1920U - 2U, 36U);
+    } catch (exception &e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+    if (opts.verify_only) {
+      continue;
+    }
+
+    for (auto const &res : resolutions) {
+      auto src = MakeHostSurface(cvt.in, res.width, res.height);
+      auto dst = MakeHostSurface(cvt.out, res.width, res.height);
+      FillSurface(src.get());
+
+      // Throughput doesn't depend on color space;
+      auto const &cc = color_params[0].ctx;
+      auto const bytes = (uint64_t)src->HostMemSize() + dst->HostMemSize();
+
+      for (auto kernel : kernels) {
+        stringstream name;
+        name << "ColorCvt/" << cvt.name << "/" << res.name << "/"
+             << GetHostCvtKernelName(kernel);
+        if (IsFilteredOut(opts, name.str())) {
+          continue;
+        }
+
+        results.push_back(RunBenchmark(opts, name.str(), bytes, [&]() {
+          ConvertSurfaceHost(src.get(), dst.get(), &cc, kernel);
+          DoNotOptimize(dst->PlanePtr());
+        }));
+      }
+
+#if defined(VPF_BENCH_SWSCALE)
+      auto const name =
+          string("ColorCvt/") + cvt.name + "/" + res.name + "/swscale";
+      if (!IsFilteredOut(opts, name)) {
+        SwsConverter sws(src.get(), dst.get(), cc);
+        results.push_back(RunBenchmark(opts, name, bytes, [&]() {
+          sws.Run();
+          DoNotOptimize(dst->PlanePtr());
+        }));
+      }
+#endif
+    }
+  }
+
+  if (!opts.verify_only) {
+    PrintResults(opts, results);
+  }
+  return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BenchmarkUtils.hpp"
+#include "FFmpegDemuxer.h"
+#include "MemoryInterfaces.hpp"
+#include "NvCodecCLIOptions.h"
+#include "SyntheticClip.hpp"
+#include "Tasks.hpp"
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+using namespace VPF;
+using namespace VPF::Bench;
+using namespace std;
+
+struct ClipInfo {
+  string path;
+  // Benchmark name part, e.g. h264/720p;
+  string label;
+  uint64_t file_size = 0U;
+  uint32_t num_packets = 0U;
+  uint32_t num_frames = 0U;
+};
+
+static const map<string, string> no_options;
+
+static string GetDemuxOpenName(const ClipInfo &clip) {
+  return "DemuxOpen/" + clip.label;
+}
+
+static string GetDemuxName(const ClipInfo &clip) {
+  return "Demux/" + clip.label;
+}
+
+static string GetSeekName(const ClipInfo &clip, bool use_index) {
+  return "Seek/" + clip.label + (use_index ? "/index" : "/container");
+}
+
+static string GetDecodeName(const ClipInfo &clip, uint32_t num_threads) {
+  return "Decode/" + clip.label +
+         (num_threads ? "/threads_1" : "/threads_auto");
+}
+
+static uint64_t GetFileSize(const string &path) {
+  ifstream file(path, ios::binary | ios::ate);
+  return file ? (uint64_t)file.tellg() : 0U;
+}
+
+static uint32_t CountPackets(const string &path) {
+  FFmpegDemuxer demuxer(path.c_str(), no_options);
+  uint8_t *data = nullptr;
+  size_t size = 0U;
+  PacketData pkt_data;
+
+  uint32_t num_packets = 0U;
+  while (demuxer.Demux(data, size, pkt_data)) {
+    num_packets++;
+  }
+  return num_packets;
+}
+
+/* Demuxes given number of packets from freshly opened file, so it never
+ * hits end of stream;
+ */
+static void DemuxPackets(const ClipInfo &clip) {
+  FFmpegDemuxer demuxer(clip.path.c_str(), no_options);
+  uint8_t *data = nullptr;
+  size_t size = 0U;
+  PacketData pkt_data;
+
+  for (auto i = 0U; i < clip.num_packets; i++) {
+    if (!demuxer.Demux(data, size, pkt_data)) {
+      throw runtime_error("Can't demux " + clip.path);
+    }
+    DoNotOptimize(data);
+  }
+}
+
+static void BenchDemux(const BenchOptions &opts, const ClipInfo &clip,
+                       vector<BenchResult> &results) {
+  auto name = GetDemuxOpenName(clip);
+  if (!IsFilteredOut(opts, name)) {
+    results.push_back(RunBenchmark(opts, name, 0U, [&]() {
+      FFmpegDemuxer demuxer(clip.path.c_str(), no_options);
+      DoNotOptimize(demuxer.GetWidth());
+    }));
+  }
+
+  // Includes file open, see DemuxOpen for its cost;
+  name = GetDemuxName(clip);
+  if (!IsFilteredOut(opts, name)) {
+    results.push_back(RunBenchmark(opts, name, clip.file_size,
+                                   [&]() { DemuxPackets(clip); },
+                                   clip.num_packets));
+  }
+
+  for (auto use_index : {false, true}) {
+    name = GetSeekName(clip, use_index);
+    if (IsFilteredOut(opts, name)) {
+      continue;
+    }
+
+    FFmpegDemuxer demuxer(clip.path.c_str(), no_options);
+    if (use_index && !demuxer.BuildSeekIndex(false)) {
+      cerr << "Can't build seek index for " << clip.path << endl;
+      continue;
+    }
+
+    uint8_t *data = nullptr;
+    size_t size = 0U;
+    PacketData pkt_data;
+    uint32_t state = 12345U;
+    results.push_back(RunBenchmark(opts, name, 0U, [&]() {
+      // Random access pattern like in dataset sampling;
+      state = state * 1103515245U + 12345U;
+      SeekContext seek_ctx((int64_t)((state >> 8) % clip.num_frames),
+                           PREV_KEY_FRAME);
+      if (!demuxer.Seek(seek_ctx, data, size, pkt_data)) {
+        throw runtime_error("Can't seek in " + clip.path);
+      }
+      DoNotOptimize(data);
+    }));
+  }
+}
+
+static void BenchDecode(const BenchOptions &opts, const ClipInfo &clip,
+                        vector<BenchResult> &results) {
+  for (auto num_threads : {1U, 0U}) {
+    auto name = GetDecodeName(clip, num_threads);
+    if (IsFilteredOut(opts, name)) {
+      continue;
+    }
+
+    size_t frame_size = 0U;
+    {
+      NvDecoderClInterface cli_iface(no_options);
+      unique_ptr<FfmpegDecodeFrame> decoder(
+          FfmpegDecodeFrame::Make(clip.path.c_str(), cli_iface, num_threads));
+      frame_size = decoder->GetFrameSize();
+    }
+
+    // Fresh decoder every pass, so it never hits end of stream;
+    results.push_back(RunBenchmark(
+        opts, name, (uint64_t)frame_size * clip.num_frames,
+        [&]() {
+          NvDecoderClInterface cli_iface(no_options);
+          unique_ptr<FfmpegDecodeFrame> decoder(FfmpegDecodeFrame::Make(
+              clip.path.c_str(), cli_iface, num_threads));
+          for (auto i = 0U; i < clip.num_frames; i++) {
+            if (TaskExecStatus::TASK_EXEC_SUCCESS != decoder->Run()) {
+              throw runtime_error("Can't decode " + clip.path);
+            }
+            DoNotOptimize(decoder->GetOutput(0U));
+          }
+        },
+        clip.num_frames));
+  }
+}
+
+static void BenchBuffer(const BenchOptions &opts,
+                        vector<BenchResult> &results) {
+  struct BufferSize {
+    const char *name;
+    size_t size;
+  };
+
+  // Packet sizes & 360p, 1080p NV12 frame sizes;
+  const BufferSize sizes[] = {{"4KB", 4U * 1024U},
+                              {"64KB", 64U * 1024U},
+                              {"345KB", 640U * 360U * 3U / 2U},
+                              {"3MB", 1920U * 1080U * 3U / 2U}};
+
+  for (auto const &size : sizes) {
+    vector<uint8_t> src(size.size, 0xAB);
+
+    auto name = string("Buffer/MakeOwnMem/") + size.name;
+    if (!IsFilteredOut(opts, name)) {
+      results.push_back(RunBenchmark(opts, name, 0U, [&]() {
+        unique_ptr<Buffer> buffer(Buffer::MakeOwnMem(size.size));
+        DoNotOptimize(buffer->GetRawMemPtr());
+      }));
+    }
+
+    name = string("Buffer/MakeOwnMemCopy/") + size.name;
+    if (!IsFilteredOut(opts, name)) {
+      results.push_back(RunBenchmark(opts, name, size.size, [&]() {
+        unique_ptr<Buffer> buffer(Buffer::MakeOwnMem(size.size, src.data()));
+        DoNotOptimize(buffer->GetRawMemPtr());
+      }));
+    }
+
+    name = string("Buffer/Update/") + size.name;
+    if (!IsFilteredOut(opts, name)) {
+      unique_ptr<Buffer> buffer(Buffer::MakeOwnMem(size.size));
+      results.push_back(RunBenchmark(opts, name, size.size, [&]() {
+        buffer->Update(size.size, src.data());
+        DoNotOptimize(buffer->GetRawMemPtr());
+      }));
+    }
+
+    // Packet sizes vary a lot between I and P frames;
+    name = string("Buffer/UpdateVarSize/") + size.name;
+    if (!IsFilteredOut(opts, name)) {
+      unique_ptr<Buffer> buffer(Buffer::MakeOwnMem(size.size));
+      auto is_small = false;
+      results.push_back(RunBenchmark(opts, name, size.size * 3U / 4U, [&]() {
+        is_small = !is_small;
+        buffer->Update(is_small ? size.size / 2U : size.size, src.data());
+        DoNotOptimize(buffer->GetRawMemPtr());
+      }));
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  auto opts = ParseOptions(argc, argv);
+
+  struct Resolution {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  const Resolution resolutions[] = {
+      {"360p", 640U, 360U}, {"720p", 1280U, 720U}, {"1080p", 1920U, 1080U}};
+  const AVCodecID codecs[] = {AV_CODEC_ID_H264, AV_CODEC_ID_HEVC,
+                              AV_CODEC_ID_MPEG4};
+
+  vector<BenchResult> results;
+  BenchBuffer(opts, results);
+
+  for (auto codec_id : codecs) {
+    if (!IsEncoderAvailable(codec_id)) {
+      cerr << "Skipping " << avcodec_get_name(codec_id)
+           << " clips, FFmpeg has no encoder for it" << endl;
+      continue;
+    }
+
+    for (auto const &res : resolutions) {
+      ClipParams params;
+      params.codec_id = codec_id;
+      params.width = res.width;
+      params.height = res.height;
+      params.num_frames = 90U;
+      params.gop_size = 30U;
+
+      ClipInfo clip;
+      clip.label = string(avcodec_get_name(codec_id)) + "/" + res.name;
+      // Don't encode clips nobody is going to use;
+      const string names[] = {GetDemuxOpenName(clip), GetDemuxName(clip),
+                              GetSeekName(clip, false),
+                              GetSeekName(clip, true),
+                              GetDecodeName(clip, 1U),
+                              GetDecodeName(clip, 0U)};
+      auto is_used = false;
+      for (auto const &name : names) {
+        is_used = is_used || !IsFilteredOut(opts, name);
+      }
+      if (!is_used) {
+        continue;
+      }
+
+      try {
+        clip.path = MakeSyntheticClip(params, opts.clip_dir);
+      } catch (exception &e) {
+        cerr << "Skipping " << clip.label << ": " << e.what() << endl;
+        continue;
+      }
+
+      clip.file_size = GetFileSize(clip.path);
+      clip.num_packets = CountPackets(clip.path);
+      clip.num_frames = min(clip.num_packets, params.num_frames);
+
+      BenchDemux(opts, clip, results);
+      BenchDecode(opts, clip, results);
+    }
+  }
+
+  PrintResults(opts, results);
+  return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BenchmarkUtils.hpp"
+#include "HostPlaneCopy.hpp"
+#include <sstream>
+
+using namespace VPF;
+using namespace VPF::Bench;
+using namespace std;
+
+/* Packs YUV420 frame with decoder-like padded linesizes into contiguous
+ * buffer, the same way software decoder does for every output frame;
+ */
+struct Yuv420Frame {
+  uint32_t width;
+  uint32_t height;
+  // Source plane pitches, padded like libavcodec does;
+  uint32_t pitch[3];
+  uint32_t plane_width[3];
+  uint32_t plane_height[3];
+  vector<uint8_t> src[3];
+  vector<uint8_t> dst;
+
+  Yuv420Frame(uint32_t w, uint32_t h, bool padded) : width(w), height(h) {
+    size_t dst_size = 0U;
+    for (int plane = 0; plane < 3; plane++) {
+      plane_width[plane] = plane ? (w + 1) / 2 : w;
+      plane_height[plane] = plane ? (h + 1) / 2 : h;
+      pitch[plane] =
+          padded ? (plane_width[plane] + 32 + 63) & ~63U : plane_width[plane];
+
+      src[plane].resize((size_t)pitch[plane] * plane_height[plane]);
+      for (size_t i = 0; i < src[plane].size(); i++) {
+        src[plane][i] = (uint8_t)(i * 7 + plane);
+      }
+      dst_size += (size_t)plane_width[plane] * plane_height[plane];
+    }
+    dst.resize(dst_size);
+  }
+
+  size_t PackedSize() const { return dst.size(); }
+
+  // Row by row memcpy, how it was done before;
+  void PackRowByRow() {
+    auto *p_dst = dst.data();
+    for (int plane = 0; plane < 3; plane++) {
+      auto *p_src = src[plane].data();
+      for (uint32_t i = 0; i < plane_height[plane]; i++) {
+        memcpy(p_dst, p_src, plane_width[plane]);
+        p_dst += plane_width[plane];
+        p_src += pitch[plane];
+      }
+    }
+    DoNotOptimize(dst[0]);
+  }
+
+  void Pack(HostCopyKernel kernel) {
+    auto *p_dst = dst.data();
+    for (int plane = 0; plane < 3; plane++) {
+      CopyPlaneHost(p_dst, plane_width[plane], src[plane].data(), pitch[plane],
+                    plane_width[plane], plane_height[plane], kernel);
+      p_dst += (size_t)plane_width[plane] * plane_height[plane];
+    }
+    DoNotOptimize(dst[0]);
+  }
+};
+
+int main(int argc, char **argv) {
+  auto opts = ParseOptions(argc, argv);
+
+  struct Resolution {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  const Resolution resolutions[] = {{"480p", 854, 480},    {"720p", 1280, 720},
+                                    {"1080p", 1920, 1080}, {"1440p", 2560, 1440},
+                                    {"4K", 3840, 2160},    {"8K", 7680, 4320}};
+
+  vector<HostCopyKernel> kernels = {HOST_COPY_SCALAR};
+  auto const best = GetHostCopyKernel();
+  if (HOST_COPY_AVX2 == best) {
+    kernels.push_back(HOST_COPY_SSE2);
+  }
+  if (HOST_COPY_SCALAR != best) {
+    kernels.push_back(best);
+  }
+
+  vector<BenchResult> results;
+  for (auto const &res : resolutions) {
+    for (auto padded : {true, false}) {
+      Yuv420Frame frame(res.width, res.height, padded);
+      auto const layout = padded ? "padded" : "contiguous";
+
+      stringstream name;
+      name << "PackYUV420/" << res.name << "/" << layout << "/rowwise_memcpy";
+      if (!IsFilteredOut(opts, name.str())) {
+        results.push_back(RunBenchmark(opts, name.str(), frame.PackedSize(),
+                                       [&]() { frame.PackRowByRow(); }));
+      }
+
+      for (auto kernel : kernels) {
+        name.str("");
+        name << "PackYUV420/" << res.name << "/" << layout << "/"
+             << GetHostCopyKernelName(kernel);
+        if (!IsFilteredOut(opts, name.str())) {
+          results.push_back(RunBenchmark(opts, name.str(), frame.PackedSize(),
+                                         [&]() { frame.Pack(kernel); }));
+        }
+      }
+    }
+  }
+
+  PrintResults(opts, results);
+  return 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BenchmarkUtils.hpp"
+#include "HostResize.hpp"
+#include "MemoryInterfaces.hpp"
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace VPF::Bench;
+using namespace std;
+
+typedef unique_ptr<Surface> SurfacePtr;
+
+static SurfacePtr MakeHostSurface(Pixel_Format format, uint32_t width,
+                                  uint32_t height) {
+  SurfacePtr surface(Surface::Make(format, width, height, MEM_HOST));
+  if (!surface || surface->Empty()) {
+    throw runtime_error("Can't allocate host Surface");
+  }
+  return surface;
+}
+
+// Smooth gradients with some noise, like camera picture;
+static void FillSurface(Surface *surface) {
+  uint32_t state = 12345U;
+  for (auto plane = 0U; plane < surface->NumPlanes(); plane++) {
+    auto ptr = (uint8_t *)surface->PlanePtr(plane);
+    for (auto y = 0U; y < surface->Height(plane); y++) {
+      auto row = ptr + (size_t)y * surface->Pitch(plane);
+      for (auto x = 0U; x < surface->WidthInBytes(plane); x++) {
+        state = state * 1664525U + 1013904223U;
+        row[x] = (uint8_t)((x / 4 + y / 2 + plane * 64) + (state >> 30));
+      }
+    }
+  }
+}
+
+static bool IsEqual(Surface *a, Surface *b) {
+  for (auto plane = 0U; plane < a->NumPlanes(); plane++) {
+    auto pa = (const uint8_t *)a->PlanePtr(plane);
+    auto pb = (const uint8_t *)b->PlanePtr(plane);
+    for (auto y = 0U; y < a->Height(plane); y++) {
+      if (memcmp(pa + (size_t)y * a->Pitch(plane),
+                 pb + (size_t)y * b->Pitch(plane), a->WidthInBytes(plane))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/* SIMD kernels and multi-threaded runs must match single-threaded scalar
+ * kernel bit to bit; Sizes aren't multiple of SIMD width, so row tails
+ * are checked too;
+ */
+static void Verify(Pixel_Format format, ResizeFilter filter) {
+  const uint32_t sizes[][4] = {
+      {1918U, 36U, 638U, 20U}, {638U, 36U, 1918U, 98U}, {402U, 300U, 22U, 14U}};
+
+  for (auto const &size : sizes) {
+    auto src = MakeHostSurface(format, size[0], size[1]);
+    auto ref = MakeHostSurface(format, size[2], size[3]);
+    auto dst = MakeHostSurface(format, size[2], size[3]);
+    FillSurface(src.get());
+
+    if (!ResizeSurfaceHost(src.get(), ref.get(), filter, 1U,
+                           HOST_CVT_SCALAR) ||
+        !ResizeSurfaceHost(src.get(), dst.get(), filter)) {
+      throw runtime_error("Can't resize Surface");
+    }
+
+    if (!IsEqual(ref.get(), dst.get())) {
+      throw runtime_error(string(GetResizeFilterName(filter)) + ": " +
+                          GetHostCvtKernelName(GetHostCvtKernel()) +
+                          " kernel doesn't match scalar one");
+    }
+  }
+}
+
+/* Detector boxes of different sizes spread over the frame;
+ * Coordinates are even, so 4:2:0 chroma of crop can be copied exactly;
+ */
+static vector<SurfaceRect> MakeRects(uint32_t num_rects, uint32_t width,
+                                     uint32_t height) {
+  vector<SurfaceRect> rects(num_rects);
+  uint32_t state = 12345U;
+  for (auto &rect : rects) {
+    state = state * 1664525U + 1013904223U;
+    rect.width = (48U + (state >> 8) % 352U) & ~1U;
+    rect.height = (48U + (state >> 16) % 352U) & ~1U;
+    state = state * 1664525U + 1013904223U;
+    rect.x = ((state >> 8) % (width - rect.width)) & ~1U;
+    rect.y = ((state >> 16) % (height - rect.height)) & ~1U;
+  }
+  return rects;
+}
+
+// What detector pipeline does without batched API: copy crop, resize it;
+struct UnbatchedCropResizer {
+  vector<SurfacePtr> crops;
+
+  UnbatchedCropResizer(Pixel_Format format, const vector<SurfaceRect> &rects) {
+    for (auto const &rect : rects) {
+      crops.push_back(MakeHostSurface(format, rect.width, rect.height));
+    }
+  }
+
+  void Run(Surface *src, const vector<SurfaceRect> &rects,
+           const vector<Surface *> &dst, ResizeFilter filter) {
+    for (size_t i = 0U; i < rects.size(); i++) {
+      auto crop = crops[i].get();
+      for (auto plane = 0U; plane < src->NumPlanes(); plane++) {
+        auto const x = (size_t)rects[i].x * src->WidthInBytes(plane) /
+                       src->Width();
+        auto const y = (size_t)rects[i].y * src->Height(plane) / src->Height();
+        auto in = (const uint8_t *)src->PlanePtr(plane) +
+                  y * src->Pitch(plane) + x;
+        auto out = (uint8_t *)crop->PlanePtr(plane);
+        for (auto y = 0U; y < crop->Height(plane); y++) {
+          memcpy(out + (size_t)y * crop->Pitch(plane),
+                 in + (size_t)y * src->Pitch(plane),
+                 crop->WidthInBytes(plane));
+        }
+      }
+      ResizeSurfaceHost(crop, dst[i], filter);
+    }
+  }
+};
+
+static void VerifyCrops(Pixel_Format format, ResizeFilter filter) {
+  auto src = MakeHostSurface(format, 1920U, 1080U);
+  FillSurface(src.get());
+  auto const rects = MakeRects(16U, src->Width(), src->Height());
+
+  vector<SurfacePtr> ref, dst;
+  vector<Surface *> ref_ptrs, dst_ptrs;
+  for (auto i = 0U; i < rects.size(); i++) {
+    ref.push_back(MakeHostSurface(format, 30U + 2U * i, 98U - 4U * i));
+    dst.push_back(MakeHostSurface(format, 30U + 2U * i, 98U - 4U * i));
+    ref_ptrs.push_back(ref.back().get());
+    dst_ptrs.push_back(dst.back().get());
+  }
+
+  UnbatchedCropResizer unbatched(format, rects);
+  unbatched.Run(src.get(), rects, ref_ptrs, filter);
+  if (!CropResizeSurfaceHost(src.get(), rects.data(), dst_ptrs.data(),
+                             rects.size(), filter)) {
+    throw runtime_error("Can't crop and resize Surface");
+  }
+
+  for (auto i = 0U; i < rects.size(); i++) {
+    if (!IsEqual(ref[i].get(), dst[i].get())) {
+      throw runtime_error(string(GetResizeFilterName(filter)) +
+                          ": batched crops don't match unbatched ones");
+    }
+  }
+}
+
+static void BenchCrops(const BenchOptions &opts,
+                       const vector<HostCvtKernel> &kernels,
+                       vector<BenchResult> &results) {
+  struct Batch {
+    const char *name;
+    uint32_t num_crops;
+    uint32_t size;
+  };
+
+  // Classifier inputs cut out of 1080p frame;
+  const Batch batches[] = {{"32x224", 32U, 224U}, {"64x112", 64U, 112U}};
+
+  struct Input {
+    const char *name;
+    Pixel_Format format;
+  };
+
+  const Input inputs[] = {{"nv12", NV12}, {"rgb", RGB}};
+
+  const ResizeFilter filters[] = {RESIZE_BILINEAR, RESIZE_AREA};
+
+  for (auto const &input : inputs) {
+    for (auto filter : filters) {
+      auto const prefix = string("CropResize/") + input.name + "/";
+      auto const suffix = string("/") + GetResizeFilterName(filter);
+      auto is_used = false;
+      for (auto const &batch : batches) {
+        is_used = is_used ||
+                  !IsFilteredOut(opts, prefix + batch.name + suffix);
+      }
+      if (!is_used) {
+        continue;
+      }
+
+      VerifyCrops(input.format, filter);
+
+      auto src = MakeHostSurface(input.format, 1920U, 1080U);
+      FillSurface(src.get());
+
+      for (auto const &batch : batches) {
+        auto const rects =
+            MakeRects(batch.num_crops, src->Width(), src->Height());
+        vector<SurfacePtr> dst;
+        vector<Surface *> dst_ptrs;
+        uint64_t bytes = 0U;
+        for (auto const &rect : rects) {
+          dst.push_back(MakeHostSurface(input.format, batch.size, batch.size));
+          dst_ptrs.push_back(dst.back().get());
+          // Only crop itself is read;
+          bytes += (uint64_t)src->HostMemSize() * rect.width * rect.height /
+                       ((uint64_t)src->Width() * src->Height()) +
+                   dst.back()->HostMemSize();
+        }
+
+        for (auto kernel : kernels) {
+          for (auto num_threads : {1U, 0U}) {
+            if (!num_threads && GetHostCvtKernel() != kernel) {
+              continue;
+            }
+
+            stringstream name;
+            name << prefix << batch.name << suffix << "/"
+                 << GetHostCvtKernelName(kernel) << (num_threads ? "" : "_mt");
+            if (IsFilteredOut(opts, name.str())) {
+              continue;
+            }
+
+            auto result = RunBenchmark(opts, name.str(), bytes, [&]() {
+              CropResizeSurfaceHost(src.get(), rects.data(), dst_ptrs.data(),
+                                    rects.size(), filter, num_threads,
+                                    kernel);
+              DoNotOptimize(dst_ptrs.data());
+            });
+            result.items_per_iter = batch.num_crops;
+            results.push_back(result);
+          }
+        }
+
+        auto const name = prefix + batch.name + suffix + "/unbatched";
+        if (!IsFilteredOut(opts, name)) {
+          UnbatchedCropResizer unbatched(input.format, rects);
+          auto result = RunBenchmark(opts, name, bytes, [&]() {
+            unbatched.Run(src.get(), rects, dst_ptrs, filter);
+            DoNotOptimize(dst_ptrs.data());
+          });
+          result.items_per_iter = batch.num_crops;
+          results.push_back(result);
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  auto opts = ParseOptions(argc, argv);
+
+  struct Scale {
+    const char *name;
+    uint32_t in_width;
+    uint32_t in_height;
+    uint32_t out_width;
+    uint32_t out_height;
+  };
+
+  const Scale scales[] = {{"1080p_360p", 1920, 1080, 640, 360},
+                          {"1080p_224x224", 1920, 1080, 224, 224},
+                          {"4K_1080p", 3840, 2160, 1920, 1080},
+                          {"720p_1080p", 1280, 720, 1920, 1080}};
+
+  struct Input {
+    const char *name;
+    Pixel_Format format;
+  };
+
+  const Input inputs[] = {{"nv12", NV12}, {"yuv420", YUV420}, {"rgb", RGB}};
+
+  const ResizeFilter filters[] = {RESIZE_NEAREST, RESIZE_BILINEAR,
+                                  RESIZE_AREA, RESIZE_LANCZOS};
+
+  vector<HostCvtKernel> kernels = {HOST_CVT_SCALAR};
+  if (HOST_CVT_SCALAR != GetHostCvtKernel()) {
+    kernels.push_back(GetHostCvtKernel());
+  }
+
+  vector<BenchResult> results;
+  for (auto const &input : inputs) {
+    for (auto filter : filters) {
+      auto const prefix = string("Resize/") + input.name + "/";
+      auto const suffix = string("/") + GetResizeFilterName(filter);
+      auto is_used = false;
+      for (auto const &scale : scales) {
+        is_used = is_used ||
+                  !IsFilteredOut(opts, prefix + scale.name + suffix);
+      }
+      if (!is_used) {
+        continue;
+      }
+
+      Verify(input.format, filter);
+
+      for (auto const &scale : scales) {
+        auto src =
+            MakeHostSurface(input.format, scale.in_width, scale.in_height);
+        auto dst =
+            MakeHostSurface(input.format, scale.out_width, scale.out_height);
+        FillSurface(src.get());
+        auto const bytes = (uint64_t)src->HostMemSize() + dst->HostMemSize();
+
+        /* Every kernel runs on single thread, the best one also runs on
+         * all CPU cores;
+         */
+        for (auto kernel : kernels) {
+          for (auto num_threads : {1U, 0U}) {
+            if (!num_threads && GetHostCvtKernel() != kernel) {
+              continue;
+            }
+
+            stringstream name;
+            name << prefix << scale.name << suffix << "/"
+                 << GetHostCvtKernelName(kernel) << (num_threads ? "" : "_mt");
+            if (IsFilteredOut(opts, name.str())) {
+              continue;
+            }
+
+            results.push_back(RunBenchmark(opts, name.str(), bytes, [&]() {
+              ResizeSurfaceHost(src.get(), dst.get(), filter, num_threads,
+                                kernel);
+              DoNotOptimize(dst->PlanePtr());
+            }));
+          }
+        }
+      }
+    }
+  }
+
+  BenchCrops(opts, kernels, results);
+
+  PrintResults(opts, results);
+  return 0;
+}
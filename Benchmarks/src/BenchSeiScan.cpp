@@ -0,0 +1,193 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BenchmarkUtils.hpp"
+#include "NalScanner.hpp"
+#include <sstream>
+#include <stdexcept>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+using namespace VPF;
+using namespace VPF::Bench;
+using namespace std;
+
+/* Synthetic H.264 access unit: AUD, optional user data SEI and a slice
+ * of given size; Slice payload has no start code emulation, just like
+ * real bitstream after emulation prevention;
+ */
+static vector<uint8_t> MakeAccessUnit(size_t slice_size, bool with_sei,
+                                      bool length_prefixed) {
+  vector<vector<uint8_t>> nal_units;
+  nal_units.push_back({0x09, 0xF0});
+
+  if (with_sei) {
+    vector<uint8_t> sei = {0x06, 0x05, 0x18};
+    for (uint8_t i = 0U; i < 24U; i++) {
+      sei.push_back(0x10 + i);
+    }
+    sei.push_back(0x80);
+    nal_units.push_back(sei);
+  }
+
+  vector<uint8_t> slice = {0x41};
+  uint32_t state = 12345U;
+  for (size_t i = 0U; i < slice_size; i++) {
+    state = state * 1103515245U + 12345U;
+    auto byte = (uint8_t)(state >> 16);
+    // Avoid 00 00 0x sequences;
+    slice.push_back((!byte && !slice.back()) ? 0xFF : byte);
+  }
+  slice.push_back(0x80);
+  nal_units.push_back(slice);
+
+  vector<uint8_t> au;
+  for (auto const &nal : nal_units) {
+    if (length_prefixed) {
+      auto const size = (uint32_t)nal.size();
+      au.push_back((uint8_t)(size >> 24));
+      au.push_back((uint8_t)(size >> 16));
+      au.push_back((uint8_t)(size >> 8));
+      au.push_back((uint8_t)(size));
+    } else {
+      au.insert(au.end(), {0x00, 0x00, 0x00, 0x01});
+    }
+    au.insert(au.end(), nal.begin(), nal.end());
+  }
+  return au;
+}
+
+/* What demuxer did for every packet before: clone packet and run it
+ * through filter_units BSF;
+ */
+class SeiFilter {
+  AVBSFContext *bsfc = nullptr;
+  AVPacket *pkt = nullptr;
+  AVPacket *out = nullptr;
+
+public:
+  explicit SeiFilter(const vector<uint8_t> &au) {
+    if (0 > av_bsf_list_parse_str("filter_units=pass_types=6", &bsfc)) {
+      throw runtime_error("Can't create filter_units BSF");
+    }
+    bsfc->par_in->codec_id = AV_CODEC_ID_H264;
+    if (0 > av_bsf_init(bsfc)) {
+      throw runtime_error("Can't init filter_units BSF");
+    }
+
+    pkt = av_packet_alloc();
+    out = av_packet_alloc();
+    av_new_packet(pkt, (int)au.size());
+    memcpy(pkt->data, au.data(), au.size());
+  }
+
+  ~SeiFilter() {
+    av_packet_free(&pkt);
+    av_packet_free(&out);
+    av_bsf_free(&bsfc);
+  }
+
+  void Run(vector<uint8_t> &sei) {
+    sei.clear();
+    auto copy = av_packet_clone(pkt);
+    av_bsf_send_packet(bsfc, copy);
+    if (0 == av_bsf_receive_packet(bsfc, out)) {
+      sei.insert(sei.end(), out->data, out->data + out->size);
+      av_packet_unref(out);
+    }
+    av_packet_free(&copy);
+    DoNotOptimize(sei.size());
+  }
+};
+
+static size_t CountStartCodes(const vector<uint8_t> &au, bool use_simd) {
+  size_t count = 0U;
+  auto const end = au.data() + au.size();
+  for (auto p = FindStartCode(au.data(), end, use_simd); p < end;
+       p = FindStartCode(p + 3, end, use_simd)) {
+    count++;
+  }
+  return count;
+}
+
+int main(int argc, char **argv) {
+  auto opts = ParseOptions(argc, argv);
+
+  struct PacketSize {
+    const char *name;
+    size_t size;
+  };
+
+  // Typical P-frame, I-frame and high bitrate I-frame sizes;
+  const PacketSize sizes[] = {
+      {"4KB", 4U * 1024U}, {"64KB", 64U * 1024U}, {"512KB", 512U * 1024U}};
+
+  vector<BenchResult> results;
+  vector<uint8_t> sei;
+  sei.reserve(1024U);
+
+  for (auto const &size : sizes) {
+    for (auto with_sei : {true, false}) {
+      auto const annexb = MakeAccessUnit(size.size, with_sei, false);
+      auto const avcc = MakeAccessUnit(size.size, with_sei, true);
+
+      stringstream prefix;
+      prefix << "SeiExtract/" << size.name << "/"
+             << (with_sei ? "sei" : "no_sei") << "/";
+
+      auto name = prefix.str() + "filter_units_bsf";
+      if (!IsFilteredOut(opts, name)) {
+        SeiFilter filter(annexb);
+        results.push_back(RunBenchmark(opts, name, annexb.size(),
+                                       [&]() { filter.Run(sei); }));
+      }
+
+      NalScanParams params;
+      name = prefix.str() + "scan_annexb";
+      if (!IsFilteredOut(opts, name)) {
+        results.push_back(
+            RunBenchmark(opts, name, annexb.size(), [&]() {
+              sei.clear();
+              ExtractSeiNalUnits(annexb.data(), annexb.size(), params, sei);
+              DoNotOptimize(sei.size());
+            }));
+      }
+
+      params.format = NAL_FORMAT_LENGTH_PREFIXED;
+      name = prefix.str() + "scan_length_prefixed";
+      if (!IsFilteredOut(opts, name)) {
+        results.push_back(RunBenchmark(opts, name, avcc.size(), [&]() {
+          sei.clear();
+          ExtractSeiNalUnits(avcc.data(), avcc.size(), params, sei);
+          DoNotOptimize(sei.size());
+        }));
+      }
+    }
+
+    auto const annexb = MakeAccessUnit(size.size, false, false);
+    for (auto use_simd : {false, true}) {
+      auto name = string("FindStartCode/") + size.name + "/" +
+                  (use_simd ? "simd" : "scalar");
+      if (!IsFilteredOut(opts, name)) {
+        results.push_back(RunBenchmark(opts, name, annexb.size(), [&]() {
+          DoNotOptimize(CountStartCodes(annexb, use_simd));
+        }));
+      }
+    }
+  }
+
+  PrintResults(opts, results);
+  return 0;
+}
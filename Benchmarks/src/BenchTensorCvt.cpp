@@ -0,0 +1,243 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BenchmarkUtils.hpp"
+#include "HostColorCvt.hpp"
+#include "HostTensorCvt.hpp"
+#include "MemoryInterfaces.hpp"
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace VPF::Bench;
+using namespace std;
+
+typedef unique_ptr<Surface> SurfacePtr;
+
+static SurfacePtr MakeHostSurface(Pixel_Format format, uint32_t width,
+                                  uint32_t height) {
+  SurfacePtr surface(Surface::Make(format, width, height, MEM_HOST));
+  if (!surface || surface->Empty()) {
+    throw runtime_error("Can't allocate host Surface");
+  }
+  return surface;
+}
+
+// Smooth gradients with some noise, like camera picture;
+static void FillSurface(Surface *surface) {
+  uint32_t state = 12345U;
+  for (auto plane = 0U; plane < surface->NumPlanes(); plane++) {
+    auto ptr = (uint8_t *)surface->PlanePtr(plane);
+    for (auto y = 0U; y < surface->Height(plane); y++) {
+      auto row = ptr + (size_t)y * surface->Pitch(plane);
+      for (auto x = 0U; x < surface->WidthInBytes(plane); x++) {
+        state = state * 1664525U + 1013904223U;
+        row[x] = (uint8_t)((x / 4 + y / 2 + plane * 64) + (state >> 30));
+      }
+    }
+  }
+}
+
+static float HalfToFloat(uint16_t value) {
+  auto const exponent = (value >> 10) & 0x1F;
+  auto const mantissa = value & 0x3FF;
+  float result;
+  if (!exponent) {
+    result = ldexpf((float)mantissa, -24);
+  } else if (0x1F == exponent) {
+    result = mantissa ? NAN : INFINITY;
+  } else {
+    result = ldexpf((float)(mantissa | 0x400), exponent - 25);
+  }
+  return (value & 0x8000) ? -result : result;
+}
+
+static float GetValue(const vector<uint8_t> &tensor, size_t i,
+                      TensorDataType type) {
+  if (TENSOR_FLOAT16 == type) {
+    return HalfToFloat(((const uint16_t *)tensor.data())[i]);
+  }
+  return ((const float *)tensor.data())[i];
+}
+
+/* Every kernel does the same float operations, so only compiler may make
+ * results differ a bit by fusing multiplications and additions;
+ */
+static void Verify(Pixel_Format format, const TensorParams &params) {
+  auto src = MakeHostSurface(format, 1920U - 2U, 36U);
+  FillSurface(src.get());
+
+  auto const size = GetTensorSize(params, src->Width(), src->Height());
+  vector<uint8_t> ref(size), dst(size);
+  const ColorspaceConversionContext cc(BT_709, MPEG);
+  if (!ConvertSurfaceToTensorHost(src.get(), ref.data(), size, params, &cc,
+                                  HOST_CVT_SCALAR) ||
+      !ConvertSurfaceToTensorHost(src.get(), dst.data(), size, params, &cc)) {
+    throw runtime_error("Can't convert Surface to tensor");
+  }
+
+  auto const elem_size =
+      TENSOR_FLOAT16 == params.type ? sizeof(uint16_t) : sizeof(float);
+  for (size_t i = 0U; i < size / elem_size; i++) {
+    auto const a = GetValue(ref, i, params.type);
+    auto const b = GetValue(dst, i, params.type);
+    if (fabsf(a - b) > 1e-3f * max(1.0f, fabsf(a))) {
+      throw runtime_error(string(GetHostCvtKernelName(
+                              GetHostTensorCvtKernel())) +
+                          " kernel doesn't match scalar one");
+    }
+  }
+}
+
+/* What inference preprocessing does without fused kernel:
+ * NV12 to RGB, deinterleave, then normalize in separate pass;
+ */
+struct UnfusedConverter {
+  SurfacePtr rgb;
+  SurfacePtr planar;
+  float gain[3];
+  float bias[3];
+
+  UnfusedConverter(uint32_t width, uint32_t height,
+                   const TensorParams &params)
+      : rgb(MakeHostSurface(RGB, width, height)),
+        planar(MakeHostSurface(RGB_PLANAR, width, height)) {
+    for (int i = 0; i < 3; i++) {
+      gain[i] = params.scale / params.std[i];
+      bias[i] = -params.mean[i] / params.std[i];
+    }
+  }
+
+  void Run(Surface *src, float *dst) {
+    ConvertSurfaceHost(src, rgb.get(), nullptr);
+    ConvertSurfaceHost(rgb.get(), planar.get(), nullptr);
+
+    auto const width = planar->Width(), height = planar->Height();
+    for (auto ch = 0U; ch < 3U; ch++) {
+      auto plane = (const uint8_t *)planar->PlanePtr(ch);
+      for (auto y = 0U; y < height; y++) {
+        auto row = plane + (size_t)y * planar->Pitch(ch);
+        for (auto x = 0U; x < width; x++) {
+          *dst++ = row[x] * gain[ch] + bias[ch];
+        }
+      }
+    }
+  }
+};
+
+int main(int argc, char **argv) {
+  auto opts = ParseOptions(argc, argv);
+
+  struct Resolution {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  const Resolution resolutions[] = {{"1080p", 1920, 1080},
+                                    {"4K", 3840, 2160}};
+
+  struct Target {
+    const char *name;
+    uint32_t width;
+    uint32_t height;
+    TensorDataType type;
+  };
+
+  // Zero size means tensor is as big as input;
+  const Target targets[] = {{"f32", 0U, 0U, TENSOR_FLOAT32},
+                            {"f16", 0U, 0U, TENSOR_FLOAT16},
+                            {"640x640_f32", 640U, 640U, TENSOR_FLOAT32},
+                            {"224x224_f16", 224U, 224U, TENSOR_FLOAT16}};
+
+  struct Input {
+    const char *name;
+    Pixel_Format format;
+  };
+
+  const Input inputs[] = {{"nv12", NV12}, {"yuv420", YUV420}};
+
+  vector<HostCvtKernel> kernels = {HOST_CVT_SCALAR};
+  if (HOST_CVT_SCALAR != GetHostTensorCvtKernel()) {
+    kernels.push_back(GetHostTensorCvtKernel());
+  }
+
+  vector<BenchResult> results;
+  for (auto const &input : inputs) {
+    for (auto const &target : targets) {
+      // ImageNet mean and std;
+      TensorParams params;
+      params.width = target.width;
+      params.height = target.height;
+      params.type = target.type;
+      const float mean[] = {0.485f, 0.456f, 0.406f};
+      const float stddev[] = {0.229f, 0.224f, 0.225f};
+      for (int i = 0; i < 3; i++) {
+        params.mean[i] = mean[i];
+        params.std[i] = stddev[i];
+      }
+
+      auto const prefix = string("Tensor/") + input.name + "/";
+      auto is_used = false;
+      for (auto const &res : resolutions) {
+        is_used = is_used || !IsFilteredOut(opts, prefix + res.name + "/" +
+                                                      target.name);
+      }
+      if (!is_used) {
+        continue;
+      }
+
+      Verify(input.format, params);
+
+      for (auto const &res : resolutions) {
+        auto src = MakeHostSurface(input.format, res.width, res.height);
+        FillSurface(src.get());
+
+        auto const size = GetTensorSize(params, res.width, res.height);
+        vector<uint8_t> tensor(size);
+        auto const bytes = (uint64_t)src->HostMemSize() + size;
+
+        for (auto kernel : kernels) {
+          stringstream name;
+          name << prefix << res.name << "/" << target.name << "/"
+               << GetHostCvtKernelName(kernel);
+          if (IsFilteredOut(opts, name.str())) {
+            continue;
+          }
+
+          results.push_back(RunBenchmark(opts, name.str(), bytes, [&]() {
+            ConvertSurfaceToTensorHost(src.get(), tensor.data(), size,
+                                       params, nullptr, kernel);
+            DoNotOptimize(tensor.data());
+          }));
+        }
+
+        // Baseline only makes sense for full size RGB float tensor;
+        auto const name = prefix + res.name + "/" + target.name + "/unfused";
+        if (NV12 == input.format && TENSOR_FLOAT32 == target.type &&
+            !target.width && !IsFilteredOut(opts, name)) {
+          UnfusedConverter unfused(res.width, res.height, params);
+          results.push_back(RunBenchmark(opts, name, bytes, [&]() {
+            unfused.Run(src.get(), (float *)tensor.data());
+            DoNotOptimize(tensor.data());
+          }));
+        }
+      }
+    }
+  }
+
+  PrintResults(opts, results);
+  return 0;
+}
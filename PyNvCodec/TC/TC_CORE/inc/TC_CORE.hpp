@@ -14,7 +14,11 @@
 #pragma once
 
 #include "Version.hpp"
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <utility>
 
 #if defined(_WIN32)
@@ -25,6 +29,8 @@
 
 namespace VPF {
 
+class TokenRecycler;
+
 /* Interface for data exchange;
  * It represents memory object (CPU- or GPU-side memory etc.);
  */
@@ -35,8 +41,78 @@ public:
 
   virtual ~Token();
 
+  /* Size of data which token represents, 0 if unknown;
+   * Used by task metrics;
+   */
+  virtual size_t GetByteSize() const;
+
+  /* Intrusive reference counting;
+   * Token which has recycler is given back to it once last reference is
+   * released; Tokens without recycler stay owned by whoever made them and
+   * are never deleted this way;
+   */
+  void AddRef();
+  void Release();
+  uint32_t GetRefCount() const;
+
+  void SetRecycler(TokenRecycler *recycler);
+  TokenRecycler *GetRecycler() const;
+
 protected:
   Token();
+
+private:
+  std::atomic<uint32_t> ref_count;
+  TokenRecycler *recycler = nullptr;
+};
+
+/* Takes back tokens nobody refers to, e. g. to reuse them later;
+ */
+class DllExport TokenRecycler {
+public:
+  virtual ~TokenRecycler();
+
+  /* Called on thread which released last reference;
+   */
+  virtual void Recycle(Token *token) = 0;
+};
+
+/* Handle which holds reference to token;
+ */
+template <typename T> class TokenRef final {
+public:
+  TokenRef() = default;
+
+  explicit TokenRef(T *token) : ptr(token) {
+    if (ptr) {
+      ptr->AddRef();
+    }
+  }
+
+  TokenRef(const TokenRef &other) : TokenRef(other.ptr) {}
+
+  TokenRef(TokenRef &&other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+
+  TokenRef &operator=(TokenRef other) {
+    std::swap(ptr, other.ptr);
+    return *this;
+  }
+
+  ~TokenRef() { Reset(); }
+
+  void Reset() {
+    if (ptr) {
+      ptr->Release();
+      ptr = nullptr;
+    }
+  }
+
+  T *Get() const { return ptr; }
+  T *operator->() const { return ptr; }
+  explicit operator bool() const { return nullptr != ptr; }
+
+private:
+  T *ptr = nullptr;
 };
 
 enum class TaskExecStatus { TASK_EXEC_SUCCESS, TASK_EXEC_FAIL };
@@ -45,6 +121,13 @@ enum class TaskExecStatus { TASK_EXEC_SUCCESS, TASK_EXEC_FAIL };
  */
 typedef void (*p_sync_call)(void *p_args);
 
+/* Called on worker thread once asynchronous run is done;
+ */
+typedef std::function<void(TaskExecStatus)> TaskCompletionCallback;
+
+class TaskExecutor;
+struct TaskStats;
+
 /* Task is unit of processing; Inherit from this class to add user-defined
  * processing stage;
  */
@@ -64,6 +147,16 @@ public:
    */
   virtual TaskExecStatus Execute();
 
+  /* Runs the task on given executor, process-wide one by default;
+   * Task must not be touched until future is ready; Callback is called
+   * right before that, task outputs are valid until next run;
+   * Exception thrown by the task is passed to future, callback gets
+   * TASK_EXEC_FAIL then;
+   */
+  std::future<TaskExecStatus>
+  ExecuteAsync(TaskCompletionCallback callback = nullptr,
+               TaskExecutor *executor = nullptr);
+
   /* Sets given token as input;
    * Doesn't take ownership of object passed by pointer, only stores it
    * within inplementation;
@@ -100,6 +193,15 @@ public:
    */
   uint64_t GetNumInputs() const;
 
+  /* Returns task name;
+   */
+  const char *GetName() const;
+
+  /* Counters collected by Execute while TaskMetrics are enabled;
+   */
+  void GetStats(TaskStats &stats) const;
+  void ResetStats();
+
 protected:
   Task(const char *str_name, uint32_t num_inputs, uint32_t num_outputs,
        p_sync_call sync_call = nullptr, void *p_args = nullptr);
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <chrono>
+#include <exception>
+#include <functional>
+
+namespace VPF {
+
+enum class TaskPriority {
+  TASK_PRIORITY_LOW = 0,
+  TASK_PRIORITY_NORMAL = 1,
+  TASK_PRIORITY_HIGH = 2,
+};
+
+enum class TaskJobStatus {
+  JOB_SUCCESS,
+  JOB_FAIL,
+  // Job didn't start before its deadline and was dropped;
+  JOB_EXPIRED,
+  // Executor was stopped before job started;
+  JOB_CANCELLED,
+};
+
+struct DllExport TaskJobParams {
+  TaskPriority priority = TaskPriority::TASK_PRIORITY_NORMAL;
+  // Default value means there's no deadline;
+  std::chrono::steady_clock::time_point deadline;
+};
+
+/* Called on worker thread once job is done, must not throw;
+ * Task outputs are valid until callback returns;
+ */
+typedef std::function<void(Task *, TaskJobStatus)> TaskJobCallback;
+
+/* Runs Task::Execute calls on fixed size thread pool;
+ * Every worker has its own job queues and takes work from other workers
+ * once it runs out of it;
+ * Jobs of single task are run one at a time in submission order, next one
+ * is queued after jobs of other tasks, so every task gets its turn;
+ * Jobs with higher priority are picked first;
+ */
+class DllExport TaskExecutor final {
+public:
+  TaskExecutor() = delete;
+  TaskExecutor(const TaskExecutor &other) = delete;
+  TaskExecutor &operator=(const TaskExecutor &other) = delete;
+
+  // Zero means number of hardware threads;
+  static TaskExecutor *Make(uint32_t num_threads = 0U);
+
+  // Process-wide executor;
+  static TaskExecutor &Instance();
+
+  // Cancels queued jobs and waits for running ones;
+  ~TaskExecutor();
+
+  /* Queues single Task::Execute call;
+   * Doesn't take ownership of task, it has to outlive the job;
+   * Returns false if task is nullptr;
+   */
+  bool Submit(Task *task, TaskJobCallback callback = nullptr,
+              const TaskJobParams &params = TaskJobParams());
+
+  /* Blocks until all submitted jobs are done;
+   * Must not be called from job callback;
+   */
+  void Wait();
+
+  uint32_t GetNumThreads() const;
+
+  /* Exception thrown by Task::Execute of the job which callback is being
+   * run; Such jobs are reported as failed; Null outside of callbacks;
+   */
+  static std::exception_ptr GetJobException();
+
+  /* Waits for submitted jobs and restarts pool with given number of
+   * threads; Zero means number of hardware threads;
+   */
+  void SetNumThreads(uint32_t num_threads);
+
+private:
+  explicit TaskExecutor(uint32_t num_threads);
+  struct TaskExecutor_Impl *pImpl = nullptr;
+};
+} // namespace VPF
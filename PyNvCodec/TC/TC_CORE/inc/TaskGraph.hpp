@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <functional>
+
+namespace VPF {
+
+/* Makes copy of token which stays valid after producer runs again;
+ * Tasks reuse their output tokens, so without copy producer has to wait
+ * until consumer is done with them; Returns nullptr on failure;
+ * Graph takes ownership of the copy and deletes it once consumed;
+ * Not needed for ref-counted outputs taken from TokenPool, consumers hold
+ * reference to them instead;
+ */
+typedef std::function<Token *(Token *)> TokenCopier;
+
+/* Called on task worker thread after every run which produced outputs;
+ * Outputs are valid until callback returns;
+ * Return false to stop the graph;
+ */
+typedef std::function<bool(Task *)> TaskSink;
+
+/* Runs connected tasks as pipeline, every task on its own worker thread;
+ * Tasks without connected inputs are sources, they are run until they
+ * fail which is treated as end of stream;
+ * Other tasks are run as soon as their inputs arrive; Their failure stops
+ * the whole graph;
+ * Stages are linked with bounded queues, so fast producer blocks once
+ * consumer falls behind by queue depth;
+ * Every task has at most one upstream task, but may feed many;
+ * Outputs which are neither taken from TokenPool nor copied are lent:
+ * producer doesn't run again until consumers are done with them, so such
+ * stages take turns instead of running in parallel; Use pooled outputs or
+ * TokenCopier to let producer run ahead;
+ */
+class DllExport TaskGraph final {
+public:
+  TaskGraph() = delete;
+  TaskGraph(const TaskGraph &other) = delete;
+  TaskGraph &operator=(const TaskGraph &other) = delete;
+
+  static TaskGraph *Make(uint32_t queue_depth = 4U);
+  ~TaskGraph();
+
+  /* Adds task to graph and returns its node number;
+   * Doesn't take ownership of task;
+   * Task inputs which aren't connected keep values set by user;
+   * With flush_on_eos set task is run with empty connected inputs after
+   * end of stream until it fails or stops producing outputs; That's how
+   * decoders give away buffered frames;
+   */
+  uint32_t AddTask(Task *task, bool flush_on_eos = false);
+
+  /* Connects output of one task to input of another;
+   * Returns false if node or slot numbers are wrong or input is taken;
+   */
+  bool Connect(uint32_t src_node, uint32_t src_output, uint32_t dst_node,
+               uint32_t dst_input, TokenCopier copier = nullptr);
+
+  bool SetSink(uint32_t node, TaskSink sink);
+
+  /* Runs graph until end of stream reaches every task, graph is stopped or
+   * any task fails; Returns TASK_EXEC_FAIL in the latter case only;
+   */
+  TaskExecStatus Run();
+
+  /* Makes Run return as soon as tasks which are running now are done;
+   * Thread-safe, may be called from sink callback;
+   */
+  void Stop();
+
+  // Node number of task which failed during last Run, -1 if there's none;
+  int64_t GetFailedNode() const;
+
+private:
+  explicit TaskGraph(uint32_t queue_depth);
+  struct TaskGraph_Impl *pImpl = nullptr;
+};
+} // namespace VPF
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+/* Snapshot of Task::Execute counters;
+ */
+struct DllExport TaskStats {
+  std::string name;
+  // Unique among all tasks made by process;
+  uint64_t id = 0U;
+  uint64_t num_runs = 0U;
+  uint64_t num_failures = 0U;
+  uint64_t total_run_ns = 0U;
+  uint64_t max_run_ns = 0U;
+  /* Number of runs which took up to GetLatencyBound(i) nanoseconds,
+   * last bucket has no bound; Buckets aren't cumulative;
+   */
+  std::vector<uint64_t> latency_buckets;
+  // Sum of Token::GetByteSize of inputs before and outputs after run;
+  uint64_t bytes_in = 0U;
+  uint64_t bytes_out = 0U;
+};
+
+/* Per-Task counters collected by Task::Execute;
+ * Collection is off by default, then it costs single relaxed atomic load
+ * per run;
+ */
+class DllExport TaskMetrics final {
+public:
+  TaskMetrics() = delete;
+
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled();
+
+  static uint32_t GetNumLatencyBuckets();
+
+  // Upper bound of latency bucket, UINT64_MAX for the last one;
+  static uint64_t GetLatencyBound(uint32_t bucket);
+
+  // Stats of all existing tasks;
+  static std::vector<TaskStats> GetAll();
+
+  // Zeroes counters of all existing tasks;
+  static void ResetAll();
+
+  // Prometheus text exposition format;
+  static std::string ExportPrometheus();
+
+  static std::string ExportJson();
+
+private:
+  friend class Task;
+  static uint32_t FindLatencyBucket(uint64_t run_ns);
+  static void Register(Task *task);
+  static void Unregister(Task *task);
+};
+} // namespace VPF
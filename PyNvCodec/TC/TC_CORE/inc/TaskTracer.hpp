@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <string>
+
+namespace VPF {
+
+/* In-process timeline recorder, works without Nsight or any other tool;
+ * Every thread writes events to its own ring buffer without locks, oldest
+ * events are overwritten once buffer is full;
+ * Timeline is exported in Chrome trace format, which is opened by
+ * chrome://tracing and Perfetto UI;
+ * Recording is off by default, then it costs single relaxed atomic load
+ * per event;
+ */
+class DllExport TaskTracer final {
+public:
+  TaskTracer() = delete;
+
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled();
+
+  /* Number of events kept per thread;
+   * Applies to threads which record their first event afterwards;
+   */
+  static void SetBufferSize(uint32_t num_events);
+  static uint32_t GetBufferSize();
+
+  // Monotonic clock used for event timestamps;
+  static uint64_t GetTimeNs();
+
+  /* Records complete event for calling thread;
+   * Name isn't copied, it has to be string literal or come from Intern;
+   */
+  static void AddEvent(const char *name, uint64_t begin_ns, uint64_t end_ns);
+
+  // Returns copy of name which lives till process exit;
+  static const char *Intern(const std::string &name);
+
+  // Drops events recorded so far;
+  static void Clear();
+
+  static std::string ExportChromeTrace();
+
+  // Returns false if file can't be written;
+  static bool DumpChromeTrace(const char *path);
+};
+
+/* Records single event from construction till destruction;
+ * Name requirements are the same as for TaskTracer::AddEvent;
+ */
+class DllExport TraceScope final {
+public:
+  TraceScope() = delete;
+  TraceScope(const TraceScope &other) = delete;
+  TraceScope &operator=(const TraceScope &other) = delete;
+
+  explicit TraceScope(const char *event_name)
+      : name(TaskTracer::IsEnabled() ? event_name : nullptr),
+        begin_ns(name ? TaskTracer::GetTimeNs() : 0U) {}
+
+  ~TraceScope() {
+    if (name) {
+      TaskTracer::AddEvent(name, begin_ns, TaskTracer::GetTimeNs());
+    }
+  }
+
+private:
+  const char *name;
+  uint64_t begin_ns;
+};
+} // namespace VPF
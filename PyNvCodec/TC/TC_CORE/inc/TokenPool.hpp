@@ -0,0 +1,61 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <cstddef>
+#include <functional>
+
+namespace VPF {
+
+typedef std::function<Token *()> TokenFactory;
+
+/* Pool of ref-counted tokens made by factory;
+ * Producer takes new token for every output while consumers still hold
+ * previous ones; Tokens come back to pool once last reference to them is
+ * released, so they are reused instead of copied or allocated;
+ */
+class DllExport TokenPool final {
+public:
+  TokenPool() = delete;
+  TokenPool(const TokenPool &other) = delete;
+  TokenPool &operator=(const TokenPool &other) = delete;
+
+  /* Up to max_cached free tokens are kept in pool, the rest is deleted;
+   * Zero means there's no limit;
+   */
+  static TokenPool *Make(TokenFactory factory, uint32_t max_cached = 0U);
+
+  /* Tokens which are still referenced are deleted once released;
+   */
+  ~TokenPool();
+
+  /* Returns free token or makes new one, nullptr if factory failed;
+   */
+  template <typename T> TokenRef<T> Acquire() {
+    return TokenRef<T>(static_cast<T *>(AcquireToken()));
+  }
+
+  // Number of free tokens kept in pool;
+  size_t GetNumCached() const;
+
+  // Number of tokens which are referenced outside of pool;
+  size_t GetNumInUse() const;
+
+private:
+  TokenPool(TokenFactory factory, uint32_t max_cached);
+  Token *AcquireToken();
+  struct TokenPool_Impl *pImpl = nullptr;
+};
+} // namespace VPF
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <chrono>
+#include <cstddef>
+
+namespace VPF {
+
+struct DllExport TokenQueueStats {
+  size_t capacity = 0U;
+  size_t size = 0U;
+  // Largest size queue ever had;
+  size_t high_water_mark = 0U;
+  uint64_t num_pushed = 0U;
+  uint64_t num_popped = 0U;
+  // Number of blocking calls which had to wait for space or token;
+  uint64_t num_push_waits = 0U;
+  uint64_t num_pop_waits = 0U;
+};
+
+/* Bounded queue of token pointers for passing them between threads;
+ * Queue doesn't own tokens;
+ * Try* calls never block and take no locks; Blocking calls take lock only
+ * when they have to wait, the other side takes it only if somebody waits;
+ */
+class DllExport TokenQueue {
+public:
+  TokenQueue(const TokenQueue &other) = delete;
+  TokenQueue &operator=(const TokenQueue &other) = delete;
+  virtual ~TokenQueue();
+
+  // Returns false if queue is full or closed;
+  virtual bool TryPush(Token *token) = 0;
+
+  // Returns false if queue is empty;
+  virtual bool TryPop(Token *&token) = 0;
+
+  // Block until there's space or queue is closed;
+  bool Push(Token *token);
+  bool PushFor(Token *token, std::chrono::microseconds timeout);
+
+  /* Block until there's token or queue is closed and empty;
+   * Tokens pushed before queue was closed can still be popped;
+   */
+  bool Pop(Token *&token);
+  bool PopFor(Token *&token, std::chrono::microseconds timeout);
+
+  // Wakes all blocked calls, pushes fail afterwards;
+  void Close();
+  bool IsClosed() const;
+
+  size_t GetCapacity() const;
+
+  // Approximate if other threads use queue meanwhile;
+  size_t GetSize() const;
+
+  TokenQueueStats GetStats() const;
+
+protected:
+  explicit TokenQueue(size_t capacity);
+
+  // Total number of pushes and pops done so far;
+  virtual uint64_t GetNumPushed() const = 0;
+  virtual uint64_t GetNumPopped() const = 0;
+
+  /* To be called by TryPush and TryPop after they succeed;
+   * Size is the one queue had right after push;
+   */
+  void OnPushed(size_t size);
+  void OnPopped();
+
+  const size_t capacity;
+
+private:
+  struct TokenQueue_Impl *pImpl = nullptr;
+};
+
+/* Single producer, single consumer queue;
+ * Only one thread may push and only one thread may pop at a time;
+ */
+class DllExport SpscTokenQueue final : public TokenQueue {
+public:
+  SpscTokenQueue() = delete;
+
+  static SpscTokenQueue *Make(size_t capacity);
+  ~SpscTokenQueue() final;
+
+  bool TryPush(Token *token) final;
+  bool TryPop(Token *&token) final;
+
+private:
+  explicit SpscTokenQueue(size_t capacity);
+  uint64_t GetNumPushed() const final;
+  uint64_t GetNumPopped() const final;
+  struct SpscTokenQueue_Impl *pImpl = nullptr;
+};
+
+/* Multiple producers, multiple consumers queue;
+ * Capacity is rounded up to power of two;
+ */
+class DllExport MpmcTokenQueue final : public TokenQueue {
+public:
+  MpmcTokenQueue() = delete;
+
+  static MpmcTokenQueue *Make(size_t capacity);
+  ~MpmcTokenQueue() final;
+
+  bool TryPush(Token *token) final;
+  bool TryPop(Token *&token) final;
+
+private:
+  explicit MpmcTokenQueue(size_t capacity);
+  uint64_t GetNumPushed() const final;
+  uint64_t GetNumPopped() const final;
+  struct MpmcTokenQueue_Impl *pImpl = nullptr;
+};
+} // namespace VPF
@@ -12,16 +12,53 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 
 #include "TC_CORE.hpp"
+#include "TaskExecutor.hpp"
+#include "TaskMetrics.hpp"
+#include "TaskTracer.hpp"
 
 using namespace std;
 using namespace VPF;
 
+static atomic<uint64_t> next_task_id(1U);
+
 namespace VPF {
+/* Task is run by one thread at a time, but counters may be read by any,
+ * hence relaxed atomics;
+ */
+struct TaskCounters {
+  atomic<uint64_t> num_runs;
+  atomic<uint64_t> num_failures;
+  atomic<uint64_t> total_run_ns;
+  atomic<uint64_t> max_run_ns;
+  atomic<uint64_t> bytes_in;
+  atomic<uint64_t> bytes_out;
+  vector<atomic<uint64_t>> latency_buckets;
+
+  TaskCounters() : latency_buckets(TaskMetrics::GetNumLatencyBuckets()) {
+    Reset();
+  }
+
+  void Reset() {
+    num_runs = 0U;
+    num_failures = 0U;
+    total_run_ns = 0U;
+    max_run_ns = 0U;
+    bytes_in = 0U;
+    bytes_out = 0U;
+    for (auto &bucket : latency_buckets) {
+      bucket = 0U;
+    }
+  }
+};
+
 struct TaskImpl {
   string name;
   vector<Token *> inputs;
@@ -30,6 +67,12 @@ struct TaskImpl {
   p_sync_call call;
   void *args;
 
+  uint64_t id;
+  TaskCounters counters;
+
+  // Tracer keeps event names till process exit, task may not live so long;
+  const char *trace_name;
+
   TaskImpl() = delete;
   TaskImpl(const TaskImpl &other) = delete;
   TaskImpl &operator=(const TaskImpl &other) = delete;
@@ -37,25 +80,104 @@ struct TaskImpl {
   TaskImpl(const char *str_name, uint32_t num_inputs, uint32_t num_outputs,
            p_sync_call sync_call, void *p_args)
       : name(str_name), inputs(num_inputs), outputs(num_outputs),
-        call(sync_call), args(p_args) {}
+        call(sync_call), args(p_args), id(next_task_id++),
+        trace_name(TaskTracer::Intern(name)) {}
+
+  static uint64_t GetByteSize(const vector<Token *> &tokens) {
+    uint64_t size = 0U;
+    for (auto token : tokens) {
+      size += token ? token->GetByteSize() : 0U;
+    }
+    return size;
+  }
 };
 } // namespace VPF
 
 Task::Task(const char *str_name, uint32_t num_inputs, uint32_t num_outputs,
            p_sync_call sync_call, void *p_args)
-    : p_impl(new TaskImpl(str_name, num_inputs, num_outputs, sync_call, p_args)) {}
+    : p_impl(new TaskImpl(str_name, num_inputs, num_outputs, sync_call, p_args)) {
+  TaskMetrics::Register(this);
+}
 
 TaskExecStatus Task::Run() { return TaskExecStatus::TASK_EXEC_SUCCESS; }
 
 TaskExecStatus Task::Execute() {
-  auto const ret = Run();
-  if (p_impl->call && p_impl->args) {
-    p_impl->call(p_impl->args);
+  TraceScope trace(p_impl->trace_name);
+
+  if (!TaskMetrics::IsEnabled()) {
+    auto const ret = Run();
+    if (p_impl->call && p_impl->args) {
+      p_impl->call(p_impl->args);
+    }
+
+    return ret;
+  }
+
+  auto &counters = p_impl->counters;
+  auto const bytes_in = TaskImpl::GetByteSize(p_impl->inputs);
+  auto const start = chrono::steady_clock::now();
+
+  auto ret = TaskExecStatus::TASK_EXEC_FAIL;
+  try {
+    ret = Run();
+    if (p_impl->call && p_impl->args) {
+      p_impl->call(p_impl->args);
+    }
+  } catch (...) {
+    counters.num_runs.fetch_add(1U, memory_order_relaxed);
+    counters.num_failures.fetch_add(1U, memory_order_relaxed);
+    throw;
+  }
+
+  auto const run_ns = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+                          chrono::steady_clock::now() - start)
+                          .count();
+  auto const bucket = TaskMetrics::FindLatencyBucket(run_ns);
+
+  counters.num_runs.fetch_add(1U, memory_order_relaxed);
+  if (TaskExecStatus::TASK_EXEC_SUCCESS != ret) {
+    counters.num_failures.fetch_add(1U, memory_order_relaxed);
+  }
+  counters.total_run_ns.fetch_add(run_ns, memory_order_relaxed);
+  counters.latency_buckets[bucket].fetch_add(1U, memory_order_relaxed);
+  counters.bytes_in.fetch_add(bytes_in, memory_order_relaxed);
+  counters.bytes_out.fetch_add(TaskImpl::GetByteSize(p_impl->outputs),
+                               memory_order_relaxed);
+
+  auto max_ns = counters.max_run_ns.load(memory_order_relaxed);
+  while (run_ns > max_ns && !counters.max_run_ns.compare_exchange_weak(
+                                max_ns, run_ns, memory_order_relaxed)) {
   }
 
   return ret;
 }
 
+future<TaskExecStatus> Task::ExecuteAsync(TaskCompletionCallback callback,
+                                          TaskExecutor *executor) {
+  auto promise = make_shared<std::promise<TaskExecStatus>>();
+  auto result = promise->get_future();
+
+  auto on_done = [promise, callback](Task *, TaskJobStatus job_status) {
+    auto const status = (TaskJobStatus::JOB_SUCCESS == job_status)
+                            ? TaskExecStatus::TASK_EXEC_SUCCESS
+                            : TaskExecStatus::TASK_EXEC_FAIL;
+    if (callback) {
+      callback(status);
+    }
+
+    auto exception = TaskExecutor::GetJobException();
+    if (exception) {
+      promise->set_exception(exception);
+    } else {
+      promise->set_value(status);
+    }
+  };
+
+  auto &pool = executor ? *executor : TaskExecutor::Instance();
+  pool.Submit(this, on_done);
+  return result;
+}
+
 bool Task::SetInput(Token *p_input, uint32_t num_input) {
   if (num_input < p_impl->inputs.size()) {
     p_impl->inputs[num_input] = p_input;
@@ -101,7 +223,31 @@ Token *Task::GetOutput(uint32_t num_output) {
   return nullptr;
 }
 
-Task::~Task() { delete p_impl; }
+Task::~Task() {
+  TaskMetrics::Unregister(this);
+  delete p_impl;
+}
+
+const char *Task::GetName() const { return p_impl->name.c_str(); }
+
+void Task::GetStats(TaskStats &stats) const {
+  auto const &counters = p_impl->counters;
+  stats.name = p_impl->name;
+  stats.id = p_impl->id;
+  stats.num_runs = counters.num_runs.load(memory_order_relaxed);
+  stats.num_failures = counters.num_failures.load(memory_order_relaxed);
+  stats.total_run_ns = counters.total_run_ns.load(memory_order_relaxed);
+  stats.max_run_ns = counters.max_run_ns.load(memory_order_relaxed);
+  stats.bytes_in = counters.bytes_in.load(memory_order_relaxed);
+  stats.bytes_out = counters.bytes_out.load(memory_order_relaxed);
+
+  stats.latency_buckets.clear();
+  for (auto const &bucket : counters.latency_buckets) {
+    stats.latency_buckets.push_back(bucket.load(memory_order_relaxed));
+  }
+}
+
+void Task::ResetStats() { p_impl->counters.Reset(); }
 
 size_t Task::GetNumOutputs() const { return p_impl->outputs.size(); }
 
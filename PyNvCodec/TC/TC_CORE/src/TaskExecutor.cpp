@@ -0,0 +1,318 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskExecutor.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace VPF;
+
+namespace VPF {
+struct TaskState;
+
+struct ExecJob {
+  TaskState *state = nullptr;
+  TaskJobCallback callback;
+  TaskJobParams params;
+};
+
+struct TaskState {
+  Task *task = nullptr;
+  // Jobs waiting for the one which is queued or running now;
+  deque<ExecJob> backlog;
+};
+
+static const int num_priorities = 3;
+
+struct ExecWorker {
+  mutex lock;
+  deque<ExecJob> queues[num_priorities];
+  thread worker;
+};
+
+struct TaskExecutor_Impl;
+
+// Lets jobs submitted from callbacks stay on the same worker;
+static thread_local TaskExecutor_Impl *current_pool = nullptr;
+static thread_local uint32_t current_worker = 0U;
+static thread_local exception_ptr current_exception_ptr;
+
+struct TaskExecutor_Impl {
+  vector<unique_ptr<ExecWorker>> workers;
+  atomic<uint32_t> next_worker;
+  atomic<bool> is_stopped;
+
+  // Tasks which have jobs queued or running;
+  mutex tasks_lock;
+  unordered_map<Task *, unique_ptr<TaskState>> tasks;
+
+  // Jobs in worker queues;
+  mutex idle_lock;
+  condition_variable idle_cv;
+  atomic<uint32_t> num_ready;
+
+  // Jobs submitted but not done yet;
+  mutex done_lock;
+  condition_variable done_cv;
+  uint64_t num_pending = 0U;
+
+  // Serializes pool restarts;
+  mutex config_lock;
+
+  TaskExecutor_Impl() : next_worker(0U), is_stopped(false), num_ready(0U) {}
+
+  static uint32_t GetHwThreads() {
+    return max(thread::hardware_concurrency(), 1U);
+  }
+
+  void Start(uint32_t num_threads) {
+    is_stopped = false;
+    workers.clear();
+    for (auto i = 0U; i < num_threads; i++) {
+      workers.emplace_back(new ExecWorker);
+    }
+
+    for (auto i = 0U; i < num_threads; i++) {
+      workers[i]->worker = thread([this, i]() { WorkerLoop(i); });
+    }
+  }
+
+  // Queued jobs are cancelled by workers before they exit;
+  void Stop() {
+    {
+      lock_guard<mutex> lock(idle_lock);
+      is_stopped = true;
+      idle_cv.notify_all();
+    }
+
+    for (auto &worker : workers) {
+      worker->worker.join();
+    }
+    workers.clear();
+  }
+
+  void Enqueue(ExecJob &&job) {
+    auto const num_workers = (uint32_t)workers.size();
+    auto const idx = (this == current_pool) ? current_worker
+                                            : next_worker++ % num_workers;
+    auto const prio = (int)job.params.priority;
+    {
+      lock_guard<mutex> lock(workers[idx]->lock);
+      workers[idx]->queues[prio].push_back(move(job));
+    }
+
+    lock_guard<mutex> lock(idle_lock);
+    num_ready++;
+    idle_cv.notify_one();
+  }
+
+  /* Own queue is served from the front, so jobs are run in FIFO order;
+   * Other queues are robbed from the back;
+   */
+  bool TryPop(uint32_t idx, ExecJob &job) {
+    auto const num_workers = (uint32_t)workers.size();
+    for (int prio = num_priorities - 1; prio >= 0; prio--) {
+      for (auto i = 0U; i < num_workers; i++) {
+        auto &worker = *workers[(idx + i) % num_workers];
+        lock_guard<mutex> lock(worker.lock);
+        auto &queue = worker.queues[prio];
+        if (queue.empty()) {
+          continue;
+        }
+
+        if (0U == i) {
+          job = move(queue.front());
+          queue.pop_front();
+        } else {
+          job = move(queue.back());
+          queue.pop_back();
+        }
+        num_ready--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void RunJob(ExecJob &job) {
+    auto status = TaskJobStatus::JOB_CANCELLED;
+    auto const &deadline = job.params.deadline;
+    auto const has_deadline = chrono::steady_clock::time_point() != deadline;
+
+    if (is_stopped) {
+      // Callback is still called, so nothing waits for the job forever;
+    } else if (has_deadline && chrono::steady_clock::now() > deadline) {
+      status = TaskJobStatus::JOB_EXPIRED;
+    } else {
+      try {
+        auto const ret = job.state->task->Execute();
+        status = (TaskExecStatus::TASK_EXEC_SUCCESS == ret)
+                     ? TaskJobStatus::JOB_SUCCESS
+                     : TaskJobStatus::JOB_FAIL;
+      } catch (...) {
+        // Would terminate the worker otherwise;
+        current_exception_ptr = current_exception();
+        status = TaskJobStatus::JOB_FAIL;
+      }
+    }
+
+    if (job.callback) {
+      job.callback(job.state->task, status);
+    }
+    current_exception_ptr = nullptr;
+
+    // Let next job of the same task wait behind other tasks;
+    ExecJob next;
+    bool has_next = false;
+    {
+      lock_guard<mutex> lock(tasks_lock);
+      auto state = job.state;
+      if (state->backlog.empty()) {
+        tasks.erase(state->task);
+      } else {
+        next = move(state->backlog.front());
+        state->backlog.pop_front();
+        has_next = true;
+      }
+    }
+
+    if (has_next) {
+      Enqueue(move(next));
+    }
+
+    lock_guard<mutex> lock(done_lock);
+    num_pending--;
+    done_cv.notify_all();
+  }
+
+  void WorkerLoop(uint32_t idx) {
+    current_pool = this;
+    current_worker = idx;
+
+    while (true) {
+      ExecJob job;
+      if (TryPop(idx, job)) {
+        RunJob(job);
+        continue;
+      }
+
+      unique_lock<mutex> lock(idle_lock);
+      idle_cv.wait(lock, [&]() { return is_stopped || num_ready > 0U; });
+      if (is_stopped && 0U == num_ready) {
+        break;
+      }
+    }
+
+    current_pool = nullptr;
+  }
+
+  bool Submit(Task *task, TaskJobCallback &callback,
+              const TaskJobParams &params) {
+    ExecJob job;
+    job.callback = callback;
+    job.params = params;
+
+    {
+      lock_guard<mutex> lock(done_lock);
+      num_pending++;
+    }
+
+    {
+      lock_guard<mutex> lock(tasks_lock);
+      auto &state = tasks[task];
+      if (state) {
+        job.state = state.get();
+        state->backlog.push_back(move(job));
+        return true;
+      }
+
+      state.reset(new TaskState);
+      state->task = task;
+      job.state = state.get();
+    }
+
+    Enqueue(move(job));
+    return true;
+  }
+
+  void Wait() {
+    unique_lock<mutex> lock(done_lock);
+    done_cv.wait(lock, [&]() { return 0U == num_pending; });
+  }
+};
+} // namespace VPF
+
+TaskExecutor *TaskExecutor::Make(uint32_t num_threads) {
+  return new TaskExecutor(num_threads);
+}
+
+TaskExecutor &TaskExecutor::Instance() {
+  // Never destroyed on purpose, tasks may be run during static destruction;
+  static TaskExecutor *instance = new TaskExecutor(0U);
+  return *instance;
+}
+
+TaskExecutor::TaskExecutor(uint32_t num_threads)
+    : pImpl(new TaskExecutor_Impl()) {
+  pImpl->Start(num_threads ? num_threads : TaskExecutor_Impl::GetHwThreads());
+}
+
+TaskExecutor::~TaskExecutor() {
+  pImpl->Stop();
+  delete pImpl;
+}
+
+bool TaskExecutor::Submit(Task *task, TaskJobCallback callback,
+                          const TaskJobParams &params) {
+  if (!task) {
+    return false;
+  }
+
+  /* Pool can't be restarted while job is running, so callbacks don't take
+   * the lock; SetNumThreads would wait for them otherwise;
+   */
+  if (pImpl == current_pool) {
+    return pImpl->Submit(task, callback, params);
+  }
+
+  lock_guard<mutex> lock(pImpl->config_lock);
+  return pImpl->Submit(task, callback, params);
+}
+
+void TaskExecutor::Wait() { pImpl->Wait(); }
+
+uint32_t TaskExecutor::GetNumThreads() const {
+  lock_guard<mutex> lock(pImpl->config_lock);
+  return (uint32_t)pImpl->workers.size();
+}
+
+void TaskExecutor::SetNumThreads(uint32_t num_threads) {
+  lock_guard<mutex> lock(pImpl->config_lock);
+  num_threads = num_threads ? num_threads : TaskExecutor_Impl::GetHwThreads();
+  if (num_threads == pImpl->workers.size()) {
+    return;
+  }
+
+  pImpl->Wait();
+  pImpl->Stop();
+  pImpl->Start(num_threads);
+}
+
+exception_ptr TaskExecutor::GetJobException() { return current_exception_ptr; }
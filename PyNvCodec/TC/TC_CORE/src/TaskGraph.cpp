@@ -0,0 +1,457 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskGraph.hpp"
+#include "TokenQueue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace VPF;
+
+namespace VPF {
+struct GraphNode;
+
+/* Set of tokens for task inputs, one per input slot;
+ * Slots which aren't connected stay nullptr;
+ * It's token itself, so it can be passed through TokenQueue;
+ */
+struct TokenSet final : public Token {
+  vector<Token *> tokens;
+  // Copies made by TokenCopier, deleted after use;
+  vector<bool> owned;
+  // Ref-counted tokens, released after use;
+  vector<bool> referenced;
+  // Node which lends its outputs until set is released;
+  GraphNode *lender = nullptr;
+  bool eos = false;
+
+  TokenSet() = default;
+  ~TokenSet() final;
+};
+
+struct GraphEdge {
+  uint32_t src_output;
+  uint32_t dst_node;
+  uint32_t dst_input;
+  TokenCopier copier;
+};
+
+struct GraphNode {
+  Task *task = nullptr;
+  bool flush_on_eos = false;
+  int64_t parent = -1;
+  vector<GraphEdge> edges;
+  TaskSink sink;
+
+  /* Input queue, only used by nodes which have upstream node;
+   * Upstream node thread is the only producer;
+   */
+  unique_ptr<SpscTokenQueue> queue;
+
+  // Number of token sets which refer to this node outputs;
+  mutex lend_lock;
+  condition_variable lend_cv;
+  uint32_t num_lent = 0U;
+};
+
+struct TaskGraph_Impl {
+  uint32_t queue_depth;
+  vector<unique_ptr<GraphNode>> nodes;
+
+  atomic<bool> is_running;
+  atomic<bool> is_stopped;
+  atomic<int64_t> failed_node;
+
+  explicit TaskGraph_Impl(uint32_t depth)
+      : queue_depth(max(depth, 1U)), is_running(false), is_stopped(false),
+        failed_node(-1) {}
+
+  /* Blocks while queue is full, returns false if graph was stopped;
+   * Takes ownership of set;
+   */
+  bool Push(GraphNode &node, TokenSet *set) {
+    if (!node.queue->Push(set)) {
+      delete set;
+      return false;
+    }
+    return true;
+  }
+
+  // Blocks while queue is empty, returns false if graph was stopped;
+  bool Pop(GraphNode &node, TokenSet *&set) {
+    Token *token = nullptr;
+    if (!node.queue->Pop(token)) {
+      return false;
+    }
+
+    set = static_cast<TokenSet *>(token);
+    if (is_stopped) {
+      delete set;
+      set = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  // Deletes sets left in queue, must not be called while graph runs;
+  static void Drain(GraphNode &node) {
+    Token *token = nullptr;
+    while (node.queue->TryPop(token)) {
+      delete static_cast<TokenSet *>(token);
+    }
+  }
+
+  void Close(GraphNode &node) {
+    node.queue->Close();
+    lock_guard<mutex> lock(node.lend_lock);
+    node.lend_cv.notify_all();
+  }
+
+  void Stop() {
+    is_stopped = true;
+    for (auto &node : nodes) {
+      Close(*node);
+    }
+  }
+
+  void Fail(uint32_t node_num) {
+    int64_t none = -1;
+    failed_node.compare_exchange_strong(none, node_num);
+    Stop();
+  }
+
+  /* Outputs are reused by task, so it can't run again until consumers
+   * are done with them;
+   */
+  void WaitForLentOutputs(GraphNode &node) {
+    unique_lock<mutex> lock(node.lend_lock);
+    node.lend_cv.wait(lock,
+                      [&]() { return is_stopped || 0U == node.num_lent; });
+  }
+
+  bool HasOutputs(GraphNode &node) {
+    for (auto i = 0U; i < node.task->GetNumOutputs(); i++) {
+      if (node.task->GetOutput(i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Passes task outputs to sink and downstream nodes;
+  bool Emit(uint32_t node_num) {
+    auto &node = *nodes[node_num];
+    if (!HasOutputs(node)) {
+      return true;
+    }
+
+    if (node.sink && !node.sink(node.task)) {
+      Stop();
+      return false;
+    }
+
+    for (auto child = 0U; child < nodes.size(); child++) {
+      auto &dst = *nodes[child];
+      if (dst.parent != (int64_t)node_num) {
+        continue;
+      }
+
+      auto set = new TokenSet();
+      set->tokens.resize(dst.task->GetNumInputs(), nullptr);
+      set->owned.resize(set->tokens.size(), false);
+      set->referenced.resize(set->tokens.size(), false);
+
+      bool has_tokens = false, is_lent = false;
+      for (auto const &edge : node.edges) {
+        if (edge.dst_node != child) {
+          continue;
+        }
+
+        auto token = node.task->GetOutput(edge.src_output);
+        if (!token) {
+          continue;
+        }
+
+        if (token->GetRecycler()) {
+          // Producer takes new token from its pool every run;
+          token->AddRef();
+          set->referenced[edge.dst_input] = true;
+        } else if (edge.copier) {
+          token = edge.copier(token);
+          if (!token) {
+            delete set;
+            Fail(node_num);
+            return false;
+          }
+          set->owned[edge.dst_input] = true;
+        } else {
+          is_lent = true;
+        }
+
+        set->tokens[edge.dst_input] = token;
+        has_tokens = true;
+      }
+
+      if (!has_tokens) {
+        delete set;
+        continue;
+      }
+
+      if (is_lent) {
+        lock_guard<mutex> lock(node.lend_lock);
+        node.num_lent++;
+        set->lender = &node;
+      }
+
+      if (!Push(dst, set)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  void SendEos(uint32_t node_num) {
+    for (auto &dst : nodes) {
+      if (dst->parent == (int64_t)node_num) {
+        auto set = new TokenSet();
+        set->eos = true;
+        Push(*dst, set);
+      }
+    }
+  }
+
+  void ClearConnectedInputs(GraphNode &node) {
+    auto &parent = *nodes[node.parent];
+    for (auto const &edge : parent.edges) {
+      if (nodes[edge.dst_node].get() == &node) {
+        node.task->SetInput(nullptr, edge.dst_input);
+      }
+    }
+  }
+
+  void RunSource(uint32_t node_num) {
+    auto &node = *nodes[node_num];
+    while (!is_stopped) {
+      WaitForLentOutputs(node);
+      if (is_stopped ||
+          TaskExecStatus::TASK_EXEC_SUCCESS != node.task->Execute()) {
+        break;
+      }
+
+      if (!Emit(node_num)) {
+        break;
+      }
+    }
+  }
+
+  void RunFilter(uint32_t node_num) {
+    auto &node = *nodes[node_num];
+    bool is_eos = false;
+
+    while (!is_stopped) {
+      TokenSet *set = nullptr;
+      if (!Pop(node, set)) {
+        break;
+      }
+
+      if (set->eos) {
+        delete set;
+        is_eos = true;
+        break;
+      }
+
+      WaitForLentOutputs(node);
+      for (auto i = 0U; i < set->tokens.size(); i++) {
+        if (set->tokens[i]) {
+          node.task->SetInput(set->tokens[i], i);
+        }
+      }
+
+      auto const ret = node.task->Execute();
+      auto const res =
+          (TaskExecStatus::TASK_EXEC_SUCCESS == ret) && Emit(node_num);
+
+      // Outputs may refer to inputs, so they are released after Emit;
+      ClearConnectedInputs(node);
+      delete set;
+
+      if (TaskExecStatus::TASK_EXEC_SUCCESS != ret) {
+        Fail(node_num);
+        break;
+      } else if (!res) {
+        break;
+      }
+    }
+
+    if (is_eos && node.flush_on_eos) {
+      while (!is_stopped) {
+        WaitForLentOutputs(node);
+        auto const ret = node.task->Execute();
+        if (TaskExecStatus::TASK_EXEC_SUCCESS != ret || !HasOutputs(node) ||
+            !Emit(node_num)) {
+          break;
+        }
+      }
+    }
+  }
+
+  void RunNode(uint32_t node_num) {
+    if (nodes[node_num]->parent < 0) {
+      RunSource(node_num);
+    } else {
+      RunFilter(node_num);
+    }
+
+    if (!is_stopped) {
+      SendEos(node_num);
+    }
+  }
+
+  // Every node must have source among its ancestors;
+  bool HasCycles() const {
+    for (auto const &node : nodes) {
+      auto parent = node->parent;
+      for (size_t i = 0U; parent >= 0; i++) {
+        if (i >= nodes.size()) {
+          return true;
+        }
+        parent = nodes[parent]->parent;
+      }
+    }
+    return false;
+  }
+};
+} // namespace VPF
+
+TokenSet::~TokenSet() {
+  for (size_t i = 0U; i < tokens.size(); i++) {
+    if (owned[i]) {
+      delete tokens[i];
+    } else if (referenced[i]) {
+      tokens[i]->Release();
+    }
+  }
+
+  if (lender) {
+    lock_guard<mutex> lock(lender->lend_lock);
+    lender->num_lent--;
+    lender->lend_cv.notify_all();
+  }
+}
+
+TaskGraph *TaskGraph::Make(uint32_t queue_depth) {
+  return new TaskGraph(queue_depth);
+}
+
+TaskGraph::TaskGraph(uint32_t queue_depth)
+    : pImpl(new TaskGraph_Impl(queue_depth)) {}
+
+TaskGraph::~TaskGraph() { delete pImpl; }
+
+uint32_t TaskGraph::AddTask(Task *task, bool flush_on_eos) {
+  pImpl->nodes.emplace_back(new GraphNode);
+  pImpl->nodes.back()->task = task;
+  pImpl->nodes.back()->queue.reset(SpscTokenQueue::Make(pImpl->queue_depth));
+  pImpl->nodes.back()->flush_on_eos = flush_on_eos;
+  return (uint32_t)pImpl->nodes.size() - 1U;
+}
+
+bool TaskGraph::Connect(uint32_t src_node, uint32_t src_output,
+                        uint32_t dst_node, uint32_t dst_input,
+                        TokenCopier copier) {
+  auto &nodes = pImpl->nodes;
+  if (pImpl->is_running || src_node >= nodes.size() ||
+      dst_node >= nodes.size() || src_node == dst_node) {
+    return false;
+  }
+
+  auto &src = *nodes[src_node];
+  auto &dst = *nodes[dst_node];
+  if (src_output >= src.task->GetNumOutputs() ||
+      dst_input >= dst.task->GetNumInputs()) {
+    return false;
+  }
+
+  // Only one upstream node is supported;
+  if (dst.parent >= 0 && dst.parent != (int64_t)src_node) {
+    return false;
+  }
+
+  for (auto const &edge : src.edges) {
+    if (edge.dst_node == dst_node && edge.dst_input == dst_input) {
+      return false;
+    }
+  }
+
+  src.edges.push_back({src_output, dst_node, dst_input, copier});
+  dst.parent = src_node;
+  return true;
+}
+
+bool TaskGraph::SetSink(uint32_t node, TaskSink sink) {
+  if (pImpl->is_running || node >= pImpl->nodes.size()) {
+    return false;
+  }
+
+  pImpl->nodes[node]->sink = sink;
+  return true;
+}
+
+TaskExecStatus TaskGraph::Run() {
+  bool expected = false;
+  if (!pImpl->is_running.compare_exchange_strong(expected, true)) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (pImpl->nodes.empty() || pImpl->HasCycles()) {
+    pImpl->is_running = false;
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  pImpl->is_stopped = false;
+  pImpl->failed_node = -1;
+  for (auto &node : pImpl->nodes) {
+    // Queue stays closed after Stop, so every run gets new one;
+    if (node->queue->IsClosed()) {
+      node->queue.reset(SpscTokenQueue::Make(pImpl->queue_depth));
+    }
+    node->num_lent = 0U;
+  }
+
+  vector<thread> workers;
+  for (auto i = 0U; i < pImpl->nodes.size(); i++) {
+    workers.emplace_back([this, i]() { pImpl->RunNode(i); });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (auto &node : pImpl->nodes) {
+    TaskGraph_Impl::Drain(*node);
+  }
+
+  pImpl->is_running = false;
+  return pImpl->failed_node < 0 ? TaskExecStatus::TASK_EXEC_SUCCESS
+                                : TaskExecStatus::TASK_EXEC_FAIL;
+}
+
+void TaskGraph::Stop() { pImpl->Stop(); }
+
+int64_t TaskGraph::GetFailedNode() const { return pImpl->failed_node; }
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskMetrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace VPF;
+
+// Run latency bucket bounds in nanoseconds, from 10 us to 500 ms;
+static const uint64_t latency_bounds[] = {
+    10000ULL,   50000ULL,    100000ULL,   500000ULL,    1000000ULL,
+    2000000ULL, 5000000ULL,  10000000ULL, 20000000ULL,  50000000ULL,
+    100000000ULL, 500000000ULL};
+
+static const uint32_t num_buckets =
+    sizeof(latency_bounds) / sizeof(latency_bounds[0]) + 1U;
+
+static atomic<bool> metrics_enabled(false);
+
+namespace {
+struct TaskRegistry {
+  mutex lock;
+  set<Task *> tasks;
+
+  static TaskRegistry &Instance() {
+    // Never destroyed on purpose, static tasks may outlive it otherwise;
+    static TaskRegistry *instance = new TaskRegistry();
+    return *instance;
+  }
+};
+
+string EscapeLabel(const string &value) {
+  string escaped;
+  for (auto c : value) {
+    if ('\\' == c || '"' == c) {
+      escaped += '\\';
+      escaped += c;
+    } else if ('\n' == c) {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+void WriteCounter(stringstream &ss, const vector<TaskStats> &all_stats,
+                  const char *name, const char *help,
+                  uint64_t TaskStats::*field) {
+  ss << "# HELP " << name << " " << help << "\n";
+  ss << "# TYPE " << name << " counter\n";
+  for (auto const &stats : all_stats) {
+    ss << name << "{task=\"" << EscapeLabel(stats.name) << "\",id=\""
+       << stats.id << "\"} " << stats.*field << "\n";
+  }
+}
+} // namespace
+
+void TaskMetrics::SetEnabled(bool enabled) { metrics_enabled = enabled; }
+
+bool TaskMetrics::IsEnabled() {
+  return metrics_enabled.load(memory_order_relaxed);
+}
+
+uint32_t TaskMetrics::GetNumLatencyBuckets() { return num_buckets; }
+
+uint64_t TaskMetrics::GetLatencyBound(uint32_t bucket) {
+  return (bucket + 1U < num_buckets) ? latency_bounds[bucket]
+                                     : numeric_limits<uint64_t>::max();
+}
+
+uint32_t TaskMetrics::FindLatencyBucket(uint64_t run_ns) {
+  for (auto i = 0U; i + 1U < num_buckets; i++) {
+    if (run_ns <= latency_bounds[i]) {
+      return i;
+    }
+  }
+  return num_buckets - 1U;
+}
+
+void TaskMetrics::Register(Task *task) {
+  auto &registry = TaskRegistry::Instance();
+  lock_guard<mutex> lock(registry.lock);
+  registry.tasks.insert(task);
+}
+
+void TaskMetrics::Unregister(Task *task) {
+  auto &registry = TaskRegistry::Instance();
+  lock_guard<mutex> lock(registry.lock);
+  registry.tasks.erase(task);
+}
+
+vector<TaskStats> TaskMetrics::GetAll() {
+  auto &registry = TaskRegistry::Instance();
+  lock_guard<mutex> lock(registry.lock);
+
+  vector<TaskStats> all_stats(registry.tasks.size());
+  auto it = all_stats.begin();
+  for (auto task : registry.tasks) {
+    task->GetStats(*it++);
+  }
+
+  sort(all_stats.begin(), all_stats.end(),
+       [](const TaskStats &a, const TaskStats &b) { return a.id < b.id; });
+  return all_stats;
+}
+
+void TaskMetrics::ResetAll() {
+  auto &registry = TaskRegistry::Instance();
+  lock_guard<mutex> lock(registry.lock);
+  for (auto task : registry.tasks) {
+    task->ResetStats();
+  }
+}
+
+string TaskMetrics::ExportPrometheus() {
+  auto const all_stats = GetAll();
+  stringstream ss;
+
+  WriteCounter(ss, all_stats, "vpf_task_runs_total",
+               "Number of Task::Execute calls.", &TaskStats::num_runs);
+  WriteCounter(ss, all_stats, "vpf_task_failures_total",
+               "Number of failed Task::Execute calls.",
+               &TaskStats::num_failures);
+  WriteCounter(ss, all_stats, "vpf_task_bytes_in_total",
+               "Size of task inputs.", &TaskStats::bytes_in);
+  WriteCounter(ss, all_stats, "vpf_task_bytes_out_total",
+               "Size of task outputs.", &TaskStats::bytes_out);
+
+  auto const name = "vpf_task_run_seconds";
+  ss << "# HELP " << name << " Task::Execute latency.\n";
+  ss << "# TYPE " << name << " histogram\n";
+  for (auto const &stats : all_stats) {
+    stringstream labels;
+    labels << "task=\"" << EscapeLabel(stats.name) << "\",id=\"" << stats.id
+           << "\"";
+
+    uint64_t count = 0U;
+    for (auto i = 0U; i < stats.latency_buckets.size(); i++) {
+      count += stats.latency_buckets[i];
+      ss << name << "_bucket{" << labels.str() << ",le=\"";
+      if (i + 1U < stats.latency_buckets.size()) {
+        ss << GetLatencyBound(i) / 1e9;
+      } else {
+        ss << "+Inf";
+      }
+      ss << "\"} " << count << "\n";
+    }
+
+    ss << name << "_sum{" << labels.str() << "} " << stats.total_run_ns / 1e9
+       << "\n";
+    ss << name << "_count{" << labels.str() << "} " << count << "\n";
+  }
+
+  return ss.str();
+}
+
+string TaskMetrics::ExportJson() {
+  auto const all_stats = GetAll();
+  stringstream ss;
+
+  // Last bucket has no bound, so there's one bound less than buckets;
+  ss << "{\"latency_bounds_ns\":[";
+  for (auto i = 0U; i + 1U < num_buckets; i++) {
+    ss << (i ? "," : "") << latency_bounds[i];
+  }
+  ss << "],\"tasks\":[";
+
+  for (auto it = all_stats.begin(); it != all_stats.end(); it++) {
+    ss << (all_stats.begin() == it ? "" : ",");
+    ss << "{\"name\":\"" << EscapeLabel(it->name) << "\"";
+    ss << ",\"id\":" << it->id;
+    ss << ",\"num_runs\":" << it->num_runs;
+    ss << ",\"num_failures\":" << it->num_failures;
+    ss << ",\"total_run_ns\":" << it->total_run_ns;
+    ss << ",\"max_run_ns\":" << it->max_run_ns;
+    ss << ",\"bytes_in\":" << it->bytes_in;
+    ss << ",\"bytes_out\":" << it->bytes_out;
+    ss << ",\"latency_buckets\":[";
+    for (auto i = 0U; i < it->latency_buckets.size(); i++) {
+      ss << (i ? "," : "") << it->latency_buckets[i];
+    }
+    ss << "]}";
+  }
+  ss << "]}";
+
+  return ss.str();
+}
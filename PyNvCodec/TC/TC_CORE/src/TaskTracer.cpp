@@ -0,0 +1,284 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskTracer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define GET_PID _getpid
+#else
+#include <unistd.h>
+#define GET_PID getpid
+#endif
+
+using namespace std;
+using namespace VPF;
+
+static atomic<bool> tracer_enabled(false);
+static atomic<uint32_t> buffer_size(1U << 16);
+// Events which began before this moment are dropped by export;
+static atomic<uint64_t> cleared_ns(0U);
+
+namespace {
+/* Fields are atomic because exporting thread reads them while owner may
+ * overwrite them;
+ */
+struct TraceEvent {
+  atomic<const char *> name;
+  atomic<uint64_t> begin_ns;
+  atomic<uint64_t> end_ns;
+};
+
+struct ThreadTrace {
+  vector<TraceEvent> events;
+  atomic<uint64_t> num_written;
+
+  // Below fields are guarded by registry lock;
+  uint32_t tid = 0U;
+  // Events before this one belong to thread which used buffer previously;
+  uint64_t first_valid = 0U;
+  bool in_use = false;
+
+  explicit ThreadTrace(uint32_t size) : events(size), num_written(0U) {}
+};
+
+struct TraceRegistry {
+  mutex lock;
+  vector<ThreadTrace *> traces;
+  set<string> names;
+  uint32_t next_tid = 1U;
+
+  static TraceRegistry &Instance() {
+    // Never destroyed on purpose, threads may record events at exit;
+    static TraceRegistry *instance = new TraceRegistry();
+    return *instance;
+  }
+
+  /* Buffers of exited threads are given to new ones, so thread churn
+   * doesn't grow memory usage;
+   */
+  ThreadTrace *Acquire() {
+    lock_guard<mutex> guard(lock);
+    ThreadTrace *trace = nullptr;
+    for (auto free_trace : traces) {
+      if (!free_trace->in_use) {
+        trace = free_trace;
+        break;
+      }
+    }
+
+    if (!trace) {
+      trace = new ThreadTrace(max(buffer_size.load(), 1U));
+      traces.push_back(trace);
+    }
+
+    trace->in_use = true;
+    trace->tid = next_tid++;
+    trace->first_valid = trace->num_written.load();
+    return trace;
+  }
+
+  void Release(ThreadTrace *trace) {
+    lock_guard<mutex> guard(lock);
+    trace->in_use = false;
+  }
+};
+
+struct ThreadTraceHolder {
+  ThreadTrace *trace = nullptr;
+
+  ~ThreadTraceHolder() {
+    if (trace) {
+      TraceRegistry::Instance().Release(trace);
+    }
+  }
+};
+
+thread_local ThreadTraceHolder current_trace;
+
+struct TraceEventCopy {
+  const char *name;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+  uint32_t tid;
+};
+
+void WriteJsonString(stringstream &ss, const char *str) {
+  ss << '"';
+  for (; *str; str++) {
+    auto const c = *str;
+    if ('\\' == c || '"' == c) {
+      ss << '\\' << c;
+    } else if ((unsigned char)c < 0x20) {
+      ss << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec;
+    } else {
+      ss << c;
+    }
+  }
+  ss << '"';
+}
+
+// Chrome trace timestamps are microseconds;
+void WriteMicroseconds(stringstream &ss, uint64_t ns) {
+  ss << ns / 1000U << '.' << setw(3) << setfill('0') << ns % 1000U;
+}
+} // namespace
+
+void TaskTracer::SetEnabled(bool enabled) { tracer_enabled = enabled; }
+
+bool TaskTracer::IsEnabled() {
+  return tracer_enabled.load(memory_order_relaxed);
+}
+
+void TaskTracer::SetBufferSize(uint32_t num_events) {
+  buffer_size = num_events;
+}
+
+uint32_t TaskTracer::GetBufferSize() { return buffer_size; }
+
+uint64_t TaskTracer::GetTimeNs() {
+  return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+             chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void TaskTracer::AddEvent(const char *name, uint64_t begin_ns,
+                          uint64_t end_ns) {
+  auto trace = current_trace.trace;
+  if (!trace) {
+    trace = TraceRegistry::Instance().Acquire();
+    current_trace.trace = trace;
+  }
+
+  /* Exporter may read slot while it's overwritten; Fence makes it see
+   * counter value which tells such slot apart;
+   */
+  auto const idx = trace->num_written.load(memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  auto &event = trace->events[idx % trace->events.size()];
+  event.name.store(name, memory_order_relaxed);
+  event.begin_ns.store(begin_ns, memory_order_relaxed);
+  event.end_ns.store(end_ns, memory_order_relaxed);
+  trace->num_written.store(idx + 1U, memory_order_release);
+}
+
+const char *TaskTracer::Intern(const string &name) {
+  auto &registry = TraceRegistry::Instance();
+  lock_guard<mutex> guard(registry.lock);
+  return registry.names.insert(name).first->c_str();
+}
+
+void TaskTracer::Clear() { cleared_ns = GetTimeNs(); }
+
+string TaskTracer::ExportChromeTrace() {
+  vector<TraceEventCopy> copies;
+  auto const since_ns = cleared_ns.load();
+
+  {
+    auto &registry = TraceRegistry::Instance();
+    lock_guard<mutex> guard(registry.lock);
+
+    for (auto trace : registry.traces) {
+      auto const size = (uint64_t)trace->events.size();
+      auto const num_written = trace->num_written.load(memory_order_acquire);
+      auto first = max(trace->first_valid,
+                       num_written > size ? num_written - size : 0U);
+
+      vector<TraceEventCopy> trace_copies;
+      for (auto idx = first; idx < num_written; idx++) {
+        auto const &event = trace->events[idx % size];
+        TraceEventCopy copy;
+        copy.name = event.name.load(memory_order_relaxed);
+        copy.begin_ns = event.begin_ns.load(memory_order_relaxed);
+        copy.end_ns = event.end_ns.load(memory_order_relaxed);
+        copy.tid = trace->tid;
+        trace_copies.push_back(copy);
+      }
+
+      /* Slots which owner started to overwrite while they were copied
+       * may be torn, they are dropped;
+       */
+      atomic_thread_fence(memory_order_acquire);
+      auto const num_written_after =
+          trace->num_written.load(memory_order_relaxed);
+      auto const first_intact =
+          (num_written_after + 1U > size) ? num_written_after + 1U - size : 0U;
+      auto const num_torn =
+          (first_intact > first) ? min(first_intact - first,
+                                       (uint64_t)trace_copies.size())
+                                 : 0U;
+
+      for (auto it = trace_copies.begin() + num_torn; it != trace_copies.end();
+           it++) {
+        if (it->name && it->begin_ns >= since_ns) {
+          copies.push_back(*it);
+        }
+      }
+    }
+  }
+
+  /* Viewers expect events of thread sorted by start, enclosing event goes
+   * first if both start at the same time;
+   */
+  sort(copies.begin(), copies.end(),
+       [](const TraceEventCopy &a, const TraceEventCopy &b) {
+         if (a.begin_ns != b.begin_ns) {
+           return a.begin_ns < b.begin_ns;
+         }
+         return a.end_ns > b.end_ns;
+       });
+
+  stringstream ss;
+  auto const pid = (int)GET_PID();
+  ss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (auto it = copies.begin(); it != copies.end(); it++) {
+    ss << (copies.begin() == it ? "" : ",") << "\n{\"name\":";
+    WriteJsonString(ss, it->name);
+    ss << ",\"cat\":\"vpf\",\"ph\":\"X\",\"ts\":";
+    WriteMicroseconds(ss, it->begin_ns);
+    ss << ",\"dur\":";
+    WriteMicroseconds(ss, it->end_ns - it->begin_ns);
+    ss << ",\"pid\":" << pid << ",\"tid\":" << it->tid << "}";
+  }
+  ss << "\n]}\n";
+
+  return ss.str();
+}
+
+bool TaskTracer::DumpChromeTrace(const char *path) {
+  ofstream file(path, ios::out | ios::trunc);
+  if (!file) {
+    cerr << "Can't open " << path << " for writing." << endl;
+    return false;
+  }
+
+  file << ExportChromeTrace();
+  file.close();
+  if (!file) {
+    cerr << "Can't write trace to " << path << endl;
+    return false;
+  }
+
+  return true;
+}
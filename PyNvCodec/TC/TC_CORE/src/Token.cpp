@@ -14,6 +14,29 @@
 #include "TC_CORE.hpp"
 using namespace VPF;
 
-Token::Token() = default;
+Token::Token() : ref_count(0U) {}
 
-Token::~Token() = default;
\ No newline at end of file
+Token::~Token() = default;
+
+size_t Token::GetByteSize() const { return 0U; }
+
+void Token::AddRef() { ref_count.fetch_add(1U, std::memory_order_relaxed); }
+
+void Token::Release() {
+  auto const prev_count = ref_count.fetch_sub(1U, std::memory_order_acq_rel);
+  if (1U == prev_count && recycler) {
+    recycler->Recycle(this);
+  }
+}
+
+uint32_t Token::GetRefCount() const {
+  return ref_count.load(std::memory_order_acquire);
+}
+
+void Token::SetRecycler(TokenRecycler *new_recycler) {
+  recycler = new_recycler;
+}
+
+TokenRecycler *Token::GetRecycler() const { return recycler; }
+
+TokenRecycler::~TokenRecycler() = default;
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TokenPool.hpp"
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace VPF;
+
+namespace VPF {
+/* Outlives pool if some tokens are still referenced when pool is
+ * destroyed, deletes itself after last of them is recycled;
+ */
+struct TokenPool_Impl final : public TokenRecycler {
+  TokenFactory factory;
+  uint32_t max_cached;
+
+  mutable mutex lock;
+  vector<Token *> free_tokens;
+  size_t num_in_use = 0U;
+  bool is_detached = false;
+
+  TokenPool_Impl(TokenFactory token_factory, uint32_t max_free)
+      : factory(token_factory), max_cached(max_free) {}
+
+  ~TokenPool_Impl() {
+    for (auto token : free_tokens) {
+      delete token;
+    }
+  }
+
+  Token *Acquire() {
+    {
+      lock_guard<mutex> guard(lock);
+      if (!free_tokens.empty()) {
+        auto token = free_tokens.back();
+        free_tokens.pop_back();
+        num_in_use++;
+        return token;
+      }
+    }
+
+    auto token = factory ? factory() : nullptr;
+    if (token) {
+      token->SetRecycler(this);
+      lock_guard<mutex> guard(lock);
+      num_in_use++;
+    }
+    return token;
+  }
+
+  void Recycle(Token *token) override {
+    bool delete_self = false;
+    {
+      lock_guard<mutex> guard(lock);
+      num_in_use--;
+
+      auto const is_full = max_cached && free_tokens.size() >= max_cached;
+      if (!is_detached && !is_full) {
+        free_tokens.push_back(token);
+        return;
+      }
+
+      delete_self = is_detached && !num_in_use;
+    }
+
+    delete token;
+    if (delete_self) {
+      delete this;
+    }
+  }
+
+  void Detach() {
+    {
+      lock_guard<mutex> guard(lock);
+      is_detached = true;
+      if (num_in_use) {
+        return;
+      }
+    }
+    delete this;
+  }
+};
+} // namespace VPF
+
+TokenPool *TokenPool::Make(TokenFactory factory, uint32_t max_cached) {
+  return new TokenPool(factory, max_cached);
+}
+
+TokenPool::TokenPool(TokenFactory factory, uint32_t max_cached)
+    : pImpl(new TokenPool_Impl(factory, max_cached)) {}
+
+TokenPool::~TokenPool() { pImpl->Detach(); }
+
+Token *TokenPool::AcquireToken() { return pImpl->Acquire(); }
+
+size_t TokenPool::GetNumCached() const {
+  lock_guard<mutex> guard(pImpl->lock);
+  return pImpl->free_tokens.size();
+}
+
+size_t TokenPool::GetNumInUse() const {
+  lock_guard<mutex> guard(pImpl->lock);
+  return pImpl->num_in_use;
+}
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TokenQueue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace VPF;
+
+// Padding which keeps fields written by different threads apart;
+#define CACHE_LINE_SIZE 64
+
+/* Number of attempts blocking calls make before they go to sleep;
+ * Thread yields between them, so other side can run even if there's
+ * single core;
+ */
+static const uint32_t num_spins = 64U;
+
+static size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1U;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+namespace VPF {
+struct TokenQueue_Impl {
+  mutex lock;
+  condition_variable cv;
+  atomic<uint32_t> num_waiting;
+  atomic<bool> is_closed;
+
+  atomic<uint64_t> high_water_mark;
+  atomic<uint64_t> num_push_waits;
+  atomic<uint64_t> num_pop_waits;
+
+  TokenQueue_Impl()
+      : num_waiting(0U), is_closed(false), high_water_mark(0U),
+        num_push_waits(0U), num_pop_waits(0U) {}
+
+  void Notify() {
+    /* Pairs with num_waiting increment; Either waiter sees queue change or
+     * this thread sees the waiter;
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (num_waiting.load(memory_order_relaxed)) {
+      lock_guard<mutex> guard(lock);
+      cv.notify_all();
+    }
+  }
+
+  /* Repeats operation until it succeeds, queue is closed or deadline is
+   * reached; Default deadline value means there's none;
+   */
+  template <typename Op, typename Ready>
+  bool Wait(Op try_op, Ready is_ready, atomic<uint64_t> &num_waits,
+            chrono::steady_clock::time_point deadline) {
+    for (auto i = 0U; i < num_spins; i++) {
+      if (try_op()) {
+        return true;
+      } else if (is_closed.load(memory_order_relaxed)) {
+        // Pops still get tokens pushed before queue was closed;
+        return try_op();
+      }
+      this_thread::yield();
+    }
+
+    num_waits.fetch_add(1U, memory_order_relaxed);
+    num_waiting.fetch_add(1U);
+
+    auto res = false;
+    auto const has_deadline = chrono::steady_clock::time_point() != deadline;
+    while (true) {
+      if (try_op()) {
+        res = true;
+        break;
+      } else if (is_closed.load()) {
+        res = try_op();
+        break;
+      }
+
+      // Operation isn't retried under lock, it may call Notify;
+      unique_lock<mutex> guard(lock);
+      auto predicate = [&]() { return is_closed.load() || is_ready(); };
+      if (!has_deadline) {
+        cv.wait(guard, predicate);
+      } else if (!cv.wait_until(guard, deadline, predicate)) {
+        guard.unlock();
+        res = try_op();
+        break;
+      }
+    }
+
+    num_waiting.fetch_sub(1U);
+    return res;
+  }
+};
+
+struct SpscTokenQueue_Impl {
+  vector<Token *> slots;
+  uint64_t mask;
+
+  char pad0[CACHE_LINE_SIZE];
+  // Written by consumer;
+  atomic<uint64_t> head;
+  uint64_t cached_tail = 0U;
+
+  char pad1[CACHE_LINE_SIZE];
+  // Written by producer;
+  atomic<uint64_t> tail;
+  uint64_t cached_head = 0U;
+
+  char pad2[CACHE_LINE_SIZE];
+
+  explicit SpscTokenQueue_Impl(size_t capacity)
+      : slots(RoundUpToPowerOfTwo(capacity), nullptr),
+        mask(slots.size() - 1U), head(0U), tail(0U) {}
+};
+
+/* Bounded queue by D. Vyukov; Every cell has sequence number which tells
+ * whether it's free for push or holds token for pop on current lap;
+ */
+struct MpmcCell {
+  atomic<uint64_t> seq;
+  Token *token = nullptr;
+};
+
+struct MpmcTokenQueue_Impl {
+  vector<MpmcCell> cells;
+  uint64_t mask;
+
+  char pad0[CACHE_LINE_SIZE];
+  atomic<uint64_t> enqueue_pos;
+
+  char pad1[CACHE_LINE_SIZE];
+  atomic<uint64_t> dequeue_pos;
+
+  char pad2[CACHE_LINE_SIZE];
+
+  explicit MpmcTokenQueue_Impl(size_t capacity)
+      : cells(capacity), mask(capacity - 1U), enqueue_pos(0U),
+        dequeue_pos(0U) {
+    for (size_t i = 0U; i < cells.size(); i++) {
+      cells[i].seq.store(i, memory_order_relaxed);
+    }
+  }
+};
+} // namespace VPF
+
+TokenQueue::TokenQueue(size_t capacity)
+    : capacity(max(capacity, (size_t)1U)), pImpl(new TokenQueue_Impl()) {}
+
+TokenQueue::~TokenQueue() { delete pImpl; }
+
+bool TokenQueue::Push(Token *token) {
+  return pImpl->Wait([&]() { return TryPush(token); },
+                     [&]() { return GetSize() < capacity; },
+                     pImpl->num_push_waits, chrono::steady_clock::time_point());
+}
+
+bool TokenQueue::PushFor(Token *token, chrono::microseconds timeout) {
+  return pImpl->Wait([&]() { return TryPush(token); },
+                     [&]() { return GetSize() < capacity; },
+                     pImpl->num_push_waits,
+                     chrono::steady_clock::now() + timeout);
+}
+
+bool TokenQueue::Pop(Token *&token) {
+  return pImpl->Wait([&]() { return TryPop(token); },
+                     [&]() { return GetSize() > 0U; }, pImpl->num_pop_waits,
+                     chrono::steady_clock::time_point());
+}
+
+bool TokenQueue::PopFor(Token *&token, chrono::microseconds timeout) {
+  return pImpl->Wait([&]() { return TryPop(token); },
+                     [&]() { return GetSize() > 0U; }, pImpl->num_pop_waits,
+                     chrono::steady_clock::now() + timeout);
+}
+
+void TokenQueue::Close() {
+  pImpl->is_closed = true;
+  lock_guard<mutex> guard(pImpl->lock);
+  pImpl->cv.notify_all();
+}
+
+bool TokenQueue::IsClosed() const {
+  return pImpl->is_closed.load(memory_order_relaxed);
+}
+
+size_t TokenQueue::GetCapacity() const { return capacity; }
+
+size_t TokenQueue::GetSize() const {
+  // Pop counter is read first, so size can't come out negative;
+  auto const num_popped = GetNumPopped();
+  auto const num_pushed = GetNumPushed();
+  return (size_t)min(num_pushed - num_popped, (uint64_t)capacity);
+}
+
+TokenQueueStats TokenQueue::GetStats() const {
+  TokenQueueStats stats;
+  stats.capacity = capacity;
+  stats.num_popped = GetNumPopped();
+  stats.num_pushed = max(GetNumPushed(), stats.num_popped);
+  stats.size = (size_t)(stats.num_pushed - stats.num_popped);
+  stats.high_water_mark = pImpl->high_water_mark.load();
+  stats.num_push_waits = pImpl->num_push_waits.load();
+  stats.num_pop_waits = pImpl->num_pop_waits.load();
+  return stats;
+}
+
+void TokenQueue::OnPushed(size_t size) {
+  auto &hwm = pImpl->high_water_mark;
+  auto max_size = hwm.load(memory_order_relaxed);
+  while (size > max_size &&
+         !hwm.compare_exchange_weak(max_size, size, memory_order_relaxed)) {
+  }
+
+  pImpl->Notify();
+}
+
+void TokenQueue::OnPopped() { pImpl->Notify(); }
+
+SpscTokenQueue *SpscTokenQueue::Make(size_t capacity) {
+  return new SpscTokenQueue(capacity);
+}
+
+SpscTokenQueue::SpscTokenQueue(size_t capacity)
+    : TokenQueue(capacity), pImpl(new SpscTokenQueue_Impl(this->capacity)) {}
+
+SpscTokenQueue::~SpscTokenQueue() { delete pImpl; }
+
+bool SpscTokenQueue::TryPush(Token *token) {
+  if (IsClosed()) {
+    return false;
+  }
+
+  // Head is read only when cached value says queue is full;
+  auto const tail = pImpl->tail.load(memory_order_relaxed);
+  if (tail - pImpl->cached_head >= capacity) {
+    pImpl->cached_head = pImpl->head.load(memory_order_acquire);
+    if (tail - pImpl->cached_head >= capacity) {
+      return false;
+    }
+  }
+
+  pImpl->slots[tail & pImpl->mask] = token;
+  pImpl->tail.store(tail + 1U, memory_order_release);
+
+  OnPushed(tail + 1U - pImpl->head.load(memory_order_relaxed));
+  return true;
+}
+
+bool SpscTokenQueue::TryPop(Token *&token) {
+  auto const head = pImpl->head.load(memory_order_relaxed);
+  if (head == pImpl->cached_tail) {
+    pImpl->cached_tail = pImpl->tail.load(memory_order_acquire);
+    if (head == pImpl->cached_tail) {
+      return false;
+    }
+  }
+
+  token = pImpl->slots[head & pImpl->mask];
+  pImpl->head.store(head + 1U, memory_order_release);
+
+  OnPopped();
+  return true;
+}
+
+uint64_t SpscTokenQueue::GetNumPushed() const {
+  return pImpl->tail.load(memory_order_acquire);
+}
+
+uint64_t SpscTokenQueue::GetNumPopped() const {
+  return pImpl->head.load(memory_order_acquire);
+}
+
+MpmcTokenQueue *MpmcTokenQueue::Make(size_t capacity) {
+  return new MpmcTokenQueue(capacity);
+}
+
+MpmcTokenQueue::MpmcTokenQueue(size_t capacity)
+    : TokenQueue(RoundUpToPowerOfTwo(capacity)),
+      pImpl(new MpmcTokenQueue_Impl(this->capacity)) {}
+
+MpmcTokenQueue::~MpmcTokenQueue() { delete pImpl; }
+
+bool MpmcTokenQueue::TryPush(Token *token) {
+  if (IsClosed()) {
+    return false;
+  }
+
+  MpmcCell *cell = nullptr;
+  auto pos = pImpl->enqueue_pos.load(memory_order_relaxed);
+  while (true) {
+    cell = &pImpl->cells[pos & pImpl->mask];
+    auto const seq = cell->seq.load(memory_order_acquire);
+    auto const diff = (int64_t)seq - (int64_t)pos;
+    if (0 == diff) {
+      if (pImpl->enqueue_pos.compare_exchange_weak(pos, pos + 1U,
+                                                   memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Cell still holds token from previous lap;
+      return false;
+    } else {
+      pos = pImpl->enqueue_pos.load(memory_order_relaxed);
+    }
+  }
+
+  cell->token = token;
+  cell->seq.store(pos + 1U, memory_order_release);
+
+  auto const num_popped = pImpl->dequeue_pos.load(memory_order_relaxed);
+  OnPushed(pos + 1U > num_popped ? pos + 1U - num_popped : 0U);
+  return true;
+}
+
+bool MpmcTokenQueue::TryPop(Token *&token) {
+  MpmcCell *cell = nullptr;
+  auto pos = pImpl->dequeue_pos.load(memory_order_relaxed);
+  while (true) {
+    cell = &pImpl->cells[pos & pImpl->mask];
+    auto const seq = cell->seq.load(memory_order_acquire);
+    auto const diff = (int64_t)seq - (int64_t)(pos + 1U);
+    if (0 == diff) {
+      if (pImpl->dequeue_pos.compare_exchange_weak(pos, pos + 1U,
+                                                   memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Cell wasn't written on current lap yet;
+      return false;
+    } else {
+      pos = pImpl->dequeue_pos.load(memory_order_relaxed);
+    }
+  }
+
+  token = cell->token;
+  cell->seq.store(pos + pImpl->mask + 1U, memory_order_release);
+
+  OnPopped();
+  return true;
+}
+
+uint64_t MpmcTokenQueue::GetNumPushed() const {
+  return pImpl->enqueue_pos.load(memory_order_acquire);
+}
+
+uint64_t MpmcTokenQueue::GetNumPopped() const {
+  return pImpl->dequeue_pos.load(memory_order_acquire);
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskGraph.hpp"
+#include "TestUtils.hpp"
+#include <memory>
+#include <vector>
+
+using namespace VPF;
+using namespace VPF::Test;
+using namespace std;
+
+/* Gives numbers from 0 to limit - 1 and fails afterwards, which is end of
+ * stream for graph; Output token is reused, so graph lends it;
+ */
+class CounterSource final : public Task {
+public:
+  explicit CounterSource(uint64_t max_count)
+      : Task("CounterSource", 0U, 1U), limit(max_count) {}
+
+  TaskExecStatus Run() final {
+    ClearOutputs();
+    if (count >= limit) {
+      return TaskExecStatus::TASK_EXEC_FAIL;
+    }
+
+    output.value = count++;
+    SetOutput(&output, 0U);
+    return TaskExecStatus::TASK_EXEC_SUCCESS;
+  }
+
+private:
+  uint64_t limit;
+  uint64_t count = 0U;
+  TestToken output;
+};
+
+// Doubles input number, fails once it gets given one;
+class Doubler final : public Task {
+public:
+  explicit Doubler(int64_t value_to_fail = -1)
+      : Task("Doubler", 1U, 1U), fail_on(value_to_fail) {}
+
+  TaskExecStatus Run() final {
+    ClearOutputs();
+    auto input = static_cast<TestToken *>(GetInput(0U));
+    if (!input || (int64_t)input->value == fail_on) {
+      return TaskExecStatus::TASK_EXEC_FAIL;
+    }
+
+    output.value = input->value * 2U;
+    SetOutput(&output, 0U);
+    return TaskExecStatus::TASK_EXEC_SUCCESS;
+  }
+
+private:
+  int64_t fail_on;
+  TestToken output;
+};
+
+/* Outputs previous input, like decoder with one frame delay;
+ * Run without input gives away the last one;
+ */
+class Delay final : public Task {
+public:
+  Delay() : Task("Delay", 1U, 1U) {}
+
+  TaskExecStatus Run() final {
+    ClearOutputs();
+    auto input = static_cast<TestToken *>(GetInput(0U));
+    if (has_held) {
+      output.value = held;
+      SetOutput(&output, 0U);
+    }
+
+    has_held = nullptr != input;
+    held = input ? input->value : 0U;
+    return input || GetOutput(0U) ? TaskExecStatus::TASK_EXEC_SUCCESS
+                                  : TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+private:
+  bool has_held = false;
+  uint64_t held = 0U;
+  TestToken output;
+};
+
+// Collects numbers which node outputs;
+static TaskSink Collect(vector<uint64_t> &values) {
+  return [&values](Task *task) {
+    values.push_back(static_cast<TestToken *>(task->GetOutput(0U))->value);
+    return true;
+  };
+}
+
+static bool IsSequence(const vector<uint64_t> &values, uint64_t count,
+                       uint64_t step) {
+  if (values.size() != count) {
+    return false;
+  }
+  for (auto i = 0U; i < count; i++) {
+    if (values[i] != i * step) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Every number source gives must reach sink once and in order;
+static void TestEndOfStream() {
+  const uint64_t count = 10000U;
+  CounterSource source(count);
+  Doubler doubler;
+  unique_ptr<TaskGraph> graph(TaskGraph::Make(2U));
+
+  auto const src = graph->AddTask(&source);
+  auto const dbl = graph->AddTask(&doubler);
+  TEST_CHECK(graph->Connect(src, 0U, dbl, 0U));
+
+  vector<uint64_t> values;
+  TEST_CHECK(graph->SetSink(dbl, Collect(values)));
+  TEST_CHECK(TaskExecStatus::TASK_EXEC_SUCCESS == graph->Run());
+  TEST_CHECK(-1 == graph->GetFailedNode());
+  TEST_CHECK(IsSequence(values, count, 2U));
+}
+
+// Buffered output is only given away if task is flushed at end of stream;
+static void TestFlushOnEos() {
+  const uint64_t count = 100U;
+  for (auto flush : {false, true}) {
+    CounterSource source(count);
+    Delay delay;
+    unique_ptr<TaskGraph> graph(TaskGraph::Make());
+
+    auto const src = graph->AddTask(&source);
+    auto const dly = graph->AddTask(&delay, flush);
+    TEST_CHECK(graph->Connect(src, 0U, dly, 0U));
+
+    vector<uint64_t> values;
+    graph->SetSink(dly, Collect(values));
+    TEST_CHECK(TaskExecStatus::TASK_EXEC_SUCCESS == graph->Run());
+    TEST_CHECK(IsSequence(values, flush ? count : count - 1U, 1U));
+  }
+}
+
+/* Failure of downstream task stops the whole graph, including source
+ * which is blocked on full queue;
+ */
+static void TestFailure() {
+  const uint64_t fail_on = 100U;
+  CounterSource source(1U << 30);
+  Doubler failing(fail_on);
+  Doubler doubler;
+  unique_ptr<TaskGraph> graph(TaskGraph::Make(1U));
+
+  auto const src = graph->AddTask(&source);
+  auto const bad = graph->AddTask(&failing);
+  auto const dbl = graph->AddTask(&doubler);
+  TEST_CHECK(graph->Connect(src, 0U, bad, 0U));
+  TEST_CHECK(graph->Connect(bad, 0U, dbl, 0U));
+
+  vector<uint64_t> values;
+  graph->SetSink(dbl, Collect(values));
+  TEST_CHECK(TaskExecStatus::TASK_EXEC_FAIL == graph->Run());
+  TEST_CHECK((int64_t)bad == graph->GetFailedNode());
+
+  // Numbers which made it through are still in order;
+  TEST_CHECK(values.size() <= fail_on);
+  TEST_CHECK(IsSequence(values, values.size(), 4U));
+}
+
+// Sink which returns false stops graph without failure;
+static void TestStopFromSink() {
+  const uint64_t num_wanted = 10U;
+  CounterSource source(1U << 30);
+  Doubler doubler;
+  unique_ptr<TaskGraph> graph(TaskGraph::Make());
+
+  auto const src = graph->AddTask(&source);
+  auto const dbl = graph->AddTask(&doubler);
+  TEST_CHECK(graph->Connect(src, 0U, dbl, 0U));
+
+  vector<uint64_t> values;
+  graph->SetSink(dbl, [&](Task *task) {
+    values.push_back(static_cast<TestToken *>(task->GetOutput(0U))->value);
+    return values.size() < num_wanted;
+  });
+  TEST_CHECK(TaskExecStatus::TASK_EXEC_SUCCESS == graph->Run());
+  TEST_CHECK(-1 == graph->GetFailedNode());
+  TEST_CHECK(IsSequence(values, num_wanted, 2U));
+}
+
+// Wrong connections are rejected;
+static void TestConnect() {
+  CounterSource source(1U);
+  Doubler a, b;
+  unique_ptr<TaskGraph> graph(TaskGraph::Make());
+
+  auto const src = graph->AddTask(&source);
+  auto const n_a = graph->AddTask(&a);
+  auto const n_b = graph->AddTask(&b);
+  TEST_CHECK(!graph->Connect(src, 1U, n_a, 0U));
+  TEST_CHECK(!graph->Connect(src, 0U, n_a, 1U));
+  TEST_CHECK(!graph->Connect(n_a, 0U, n_a, 0U));
+  TEST_CHECK(!graph->Connect(src, 0U, 3U, 0U));
+  TEST_CHECK(graph->Connect(src, 0U, n_a, 0U));
+  TEST_CHECK(!graph->Connect(src, 0U, n_a, 0U));
+  // Only one upstream node is supported;
+  TEST_CHECK(!graph->Connect(n_b, 0U, n_a, 0U));
+
+  // Cycle without source;
+  unique_ptr<TaskGraph> cycle(TaskGraph::Make());
+  auto const c_a = cycle->AddTask(&a);
+  auto const c_b = cycle->AddTask(&b);
+  TEST_CHECK(cycle->Connect(c_a, 0U, c_b, 0U));
+  TEST_CHECK(cycle->Connect(c_b, 0U, c_a, 0U));
+  TEST_CHECK(TaskExecStatus::TASK_EXEC_FAIL == cycle->Run());
+}
+
+int main() {
+  const TestCase tests[] = {{"EndOfStream", TestEndOfStream},
+                            {"FlushOnEos", TestFlushOnEos},
+                            {"Failure", TestFailure},
+                            {"StopFromSink", TestStopFromSink},
+                            {"Connect", TestConnect}};
+  return RunTests(tests);
+}
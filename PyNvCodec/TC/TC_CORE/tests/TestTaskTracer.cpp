@@ -0,0 +1,136 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskTracer.hpp"
+#include "TestUtils.hpp"
+#include <atomic>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace VPF;
+using namespace VPF::Test;
+using namespace std;
+
+static const uint32_t ring_size = 8U;
+
+// Exported event names and thread ids, one event per line;
+static map<string, set<uint32_t>> GetExportedEvents() {
+  map<string, set<uint32_t>> events;
+  stringstream ss(TaskTracer::ExportChromeTrace());
+  string line;
+  while (getline(ss, line)) {
+    auto const name_pos = line.find("\"name\":\"");
+    auto const tid_pos = line.find("\"tid\":");
+    if (string::npos == name_pos || string::npos == tid_pos) {
+      continue;
+    }
+
+    auto const name_begin = name_pos + 8U;
+    auto const name = line.substr(name_begin, line.find('"', name_begin) -
+                                                  name_begin);
+    events[name].insert((uint32_t)stoul(line.substr(tid_pos + 6U)));
+  }
+  return events;
+}
+
+static void AddEvents(const string &prefix, uint32_t num_events) {
+  for (auto i = 0U; i < num_events; i++) {
+    auto const now = TaskTracer::GetTimeNs();
+    TaskTracer::AddEvent(TaskTracer::Intern(prefix + to_string(i)), now,
+                         now + 1000U);
+  }
+}
+
+/* Thread keeps only as many latest events as buffer fits; Oldest one may
+ * be overwritten while it's exported, so export drops it;
+ */
+static void TestRingOverwrite() {
+  TaskTracer::Clear();
+  thread([]() { AddEvents("ring_", 3U * ring_size); }).join();
+
+  auto const events = GetExportedEvents();
+  for (auto i = 0U; i < 3U * ring_size; i++) {
+    auto const is_kept = i > 2U * ring_size;
+    TEST_CHECK(is_kept == (events.count("ring_" + to_string(i)) > 0U));
+  }
+}
+
+/* Every thread records to its own buffer and has its own id;
+ * Buffer of exited thread is given to next new one, so both threads are
+ * kept alive until both are done;
+ */
+static void TestPerThreadBuffers() {
+  TaskTracer::Clear();
+  const uint32_t num_events = ring_size / 2U;
+  atomic<uint32_t> num_done(0U);
+  auto record = [&](const char *prefix) {
+    AddEvents(prefix, num_events);
+    num_done++;
+    while (num_done < 2U) {
+      this_thread::yield();
+    }
+  };
+
+  thread first(record, "first_");
+  thread second(record, "second_");
+  first.join();
+  second.join();
+
+  auto const events = GetExportedEvents();
+  set<uint32_t> first_tids, second_tids;
+  for (auto i = 0U; i < num_events; i++) {
+    auto const first_it = events.find("first_" + to_string(i));
+    auto const second_it = events.find("second_" + to_string(i));
+    if (TEST_CHECK(events.end() != first_it) &&
+        TEST_CHECK(events.end() != second_it)) {
+      first_tids.insert(first_it->second.begin(), first_it->second.end());
+      second_tids.insert(second_it->second.begin(), second_it->second.end());
+    }
+  }
+
+  TEST_CHECK(1U == first_tids.size());
+  TEST_CHECK(1U == second_tids.size());
+  TEST_CHECK(first_tids != second_tids);
+}
+
+// Events recorded before Clear or while tracer is off aren't exported;
+static void TestClearAndDisable() {
+  AddEvents("old_", 1U);
+  TaskTracer::Clear();
+  TEST_CHECK(GetExportedEvents().empty());
+
+  TaskTracer::SetEnabled(false);
+  { TraceScope scope("disabled"); }
+  TaskTracer::SetEnabled(true);
+  { TraceScope scope("enabled"); }
+
+  auto const events = GetExportedEvents();
+  TEST_CHECK(0U == events.count("old_0"));
+  TEST_CHECK(0U == events.count("disabled"));
+  TEST_CHECK(1U == events.count("enabled"));
+}
+
+int main() {
+  // Applies to threads which didn't record anything yet;
+  TaskTracer::SetBufferSize(ring_size);
+  TaskTracer::SetEnabled(true);
+  TEST_CHECK(ring_size == TaskTracer::GetBufferSize());
+
+  const TestCase tests[] = {{"RingOverwrite", TestRingOverwrite},
+                            {"PerThreadBuffers", TestPerThreadBuffers},
+                            {"ClearAndDisable", TestClearAndDisable}};
+  return RunTests(tests);
+}
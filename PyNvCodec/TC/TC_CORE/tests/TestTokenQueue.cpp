@@ -0,0 +1,278 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TestUtils.hpp"
+#include "TokenQueue.hpp"
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace VPF;
+using namespace VPF::Test;
+using namespace std;
+using namespace std::chrono;
+
+typedef unique_ptr<TokenQueue> QueuePtr;
+
+static void TestSpscOrder() {
+  const uint64_t num_tokens = 100000U;
+  vector<TestToken> tokens(num_tokens);
+  QueuePtr queue(SpscTokenQueue::Make(8U));
+
+  thread producer([&]() {
+    for (auto i = 0U; i < num_tokens; i++) {
+      tokens[i].value = i;
+      queue->Push(&tokens[i]);
+    }
+  });
+
+  uint64_t num_popped = 0U, num_out_of_order = 0U;
+  Token *token = nullptr;
+  while (num_popped < num_tokens && queue->Pop(token)) {
+    num_out_of_order += static_cast<TestToken *>(token)->value != num_popped;
+    num_popped++;
+  }
+  producer.join();
+
+  TEST_CHECK(num_tokens == num_popped);
+  TEST_CHECK(0U == num_out_of_order);
+  TEST_CHECK(!queue->TryPop(token));
+
+  auto const stats = queue->GetStats();
+  TEST_CHECK(num_tokens == stats.num_pushed);
+  TEST_CHECK(num_tokens == stats.num_popped);
+  TEST_CHECK(stats.high_water_mark >= 1U && stats.high_water_mark <= 8U);
+}
+
+/* Every token must be popped exactly once; Tokens of single producer
+ * must come to every consumer in the order they were pushed;
+ */
+static void TestMpmcNoLossNoDuplicates() {
+  const uint32_t num_producers = 4U, num_consumers = 3U;
+  const uint64_t tokens_per_producer = 50000U;
+  const uint64_t num_tokens = num_producers * tokens_per_producer;
+
+  vector<TestToken> tokens(num_tokens);
+  for (auto i = 0U; i < num_tokens; i++) {
+    tokens[i].value = i;
+  }
+
+  // Capacity is rounded up to power of two;
+  QueuePtr queue(MpmcTokenQueue::Make(6U));
+  TEST_CHECK(8U == queue->GetCapacity());
+
+  vector<vector<uint64_t>> popped(num_consumers);
+  vector<thread> consumers;
+  for (auto c = 0U; c < num_consumers; c++) {
+    consumers.emplace_back([&, c]() {
+      Token *token = nullptr;
+      while (queue->Pop(token)) {
+        popped[c].push_back(static_cast<TestToken *>(token)->value);
+      }
+    });
+  }
+
+  vector<thread> producers;
+  for (auto p = 0U; p < num_producers; p++) {
+    producers.emplace_back([&, p]() {
+      for (auto i = 0U; i < tokens_per_producer; i++) {
+        auto const idx = p * tokens_per_producer + i;
+        // Mix blocking and non-blocking pushes;
+        if (i % 2 || !queue->TryPush(&tokens[idx])) {
+          queue->Push(&tokens[idx]);
+        }
+      }
+    });
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  // Consumers drain the queue and quit;
+  queue->Close();
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+
+  vector<uint32_t> num_seen(num_tokens, 0U);
+  uint64_t num_out_of_order = 0U;
+  for (auto const &values : popped) {
+    vector<int64_t> last(num_producers, -1);
+    for (auto value : values) {
+      num_seen[value]++;
+      auto const p = value / tokens_per_producer;
+      num_out_of_order += (int64_t)value <= last[p];
+      last[p] = (int64_t)value;
+    }
+  }
+
+  uint64_t num_lost = 0U, num_duplicates = 0U;
+  for (auto count : num_seen) {
+    num_lost += 0U == count;
+    num_duplicates += count > 1U;
+  }
+  TEST_CHECK(0U == num_lost);
+  TEST_CHECK(0U == num_duplicates);
+  TEST_CHECK(0U == num_out_of_order);
+
+  auto const stats = queue->GetStats();
+  TEST_CHECK(num_tokens == stats.num_pushed);
+  TEST_CHECK(num_tokens == stats.num_popped);
+  TEST_CHECK(0U == stats.size);
+}
+
+static void TestTimeouts(TokenQueue *queue) {
+  const auto timeout = milliseconds(20);
+  TestToken a, b;
+  Token *token = nullptr;
+
+  auto start = steady_clock::now();
+  TEST_CHECK(!queue->PopFor(token, timeout));
+  TEST_CHECK(steady_clock::now() - start >= timeout);
+
+  while (queue->TryPush(&a)) {
+  }
+  start = steady_clock::now();
+  TEST_CHECK(!queue->PushFor(&b, timeout));
+  TEST_CHECK(steady_clock::now() - start >= timeout);
+
+  // Space which appears before timeout is taken;
+  thread consumer([&]() {
+    this_thread::sleep_for(milliseconds(10));
+    Token *popped = nullptr;
+    queue->TryPop(popped);
+  });
+  TEST_CHECK(queue->PushFor(&b, seconds(10)));
+  consumer.join();
+
+  while (queue->TryPop(token)) {
+  }
+  thread producer([&]() {
+    this_thread::sleep_for(milliseconds(10));
+    queue->Push(&b);
+  });
+  TEST_CHECK(queue->PopFor(token, seconds(10)));
+  TEST_CHECK(&b == token);
+  producer.join();
+
+  auto const stats = queue->GetStats();
+  TEST_CHECK(stats.num_push_waits >= 2U);
+  TEST_CHECK(stats.num_pop_waits >= 2U);
+}
+
+static void TestSpscTimeouts() {
+  QueuePtr queue(SpscTokenQueue::Make(2U));
+  TestTimeouts(queue.get());
+}
+
+static void TestMpmcTimeouts() {
+  QueuePtr queue(MpmcTokenQueue::Make(2U));
+  TestTimeouts(queue.get());
+}
+
+/* Close must wake callers blocked on both empty and full queue;
+ * Tokens pushed before that can still be popped;
+ */
+static void TestCloseWakesBlocked(TokenQueue *empty, TokenQueue *full) {
+  TestToken a, b;
+  while (full->TryPush(&a)) {
+  }
+
+  bool pop_res = true, push_res = true;
+  thread consumer([&]() {
+    Token *token = nullptr;
+    pop_res = empty->Pop(token);
+  });
+  thread producer([&]() { push_res = full->Push(&b); });
+
+  // Let both of them block;
+  while (empty->GetStats().num_pop_waits < 1U ||
+         full->GetStats().num_push_waits < 1U) {
+    this_thread::sleep_for(milliseconds(1));
+  }
+  empty->Close();
+  full->Close();
+  consumer.join();
+  producer.join();
+
+  TEST_CHECK(!pop_res);
+  TEST_CHECK(!push_res);
+  TEST_CHECK(empty->IsClosed() && full->IsClosed());
+  TEST_CHECK(!full->TryPush(&b));
+  TEST_CHECK(!full->PushFor(&b, milliseconds(1)));
+
+  Token *token = nullptr;
+  size_t num_left = 0U;
+  while (full->Pop(token)) {
+    TEST_CHECK(&a == token);
+    num_left++;
+  }
+  TEST_CHECK(full->GetCapacity() == num_left);
+  TEST_CHECK(!full->PopFor(token, milliseconds(1)));
+}
+
+static void TestSpscClose() {
+  QueuePtr empty(SpscTokenQueue::Make(4U)), full(SpscTokenQueue::Make(4U));
+  TestCloseWakesBlocked(empty.get(), full.get());
+}
+
+static void TestMpmcClose() {
+  QueuePtr empty(MpmcTokenQueue::Make(4U)), full(MpmcTokenQueue::Make(4U));
+  TestCloseWakesBlocked(empty.get(), full.get());
+}
+
+static void TestHighWaterMark(TokenQueue *queue) {
+  TestToken tokens[3];
+  Token *token = nullptr;
+
+  for (auto &t : tokens) {
+    TEST_CHECK(queue->TryPush(&t));
+  }
+  for (auto i = 0; i < 3; i++) {
+    TEST_CHECK(queue->TryPop(token));
+  }
+  TEST_CHECK(queue->TryPush(&tokens[0]));
+
+  auto const stats = queue->GetStats();
+  TEST_CHECK(4U == stats.capacity);
+  TEST_CHECK(1U == stats.size);
+  TEST_CHECK(3U == stats.high_water_mark);
+  TEST_CHECK(4U == stats.num_pushed);
+  TEST_CHECK(3U == stats.num_popped);
+  TEST_CHECK(0U == stats.num_push_waits);
+  TEST_CHECK(0U == stats.num_pop_waits);
+}
+
+static void TestSpscHighWaterMark() {
+  QueuePtr queue(SpscTokenQueue::Make(4U));
+  TestHighWaterMark(queue.get());
+}
+
+static void TestMpmcHighWaterMark() {
+  QueuePtr queue(MpmcTokenQueue::Make(4U));
+  TestHighWaterMark(queue.get());
+}
+
+int main() {
+  const TestCase tests[] = {
+      {"SpscOrder", TestSpscOrder},
+      {"MpmcNoLossNoDuplicates", TestMpmcNoLossNoDuplicates},
+      {"SpscTimeouts", TestSpscTimeouts},
+      {"MpmcTimeouts", TestMpmcTimeouts},
+      {"SpscClose", TestSpscClose},
+      {"MpmcClose", TestMpmcClose},
+      {"SpscHighWaterMark", TestSpscHighWaterMark},
+      {"MpmcHighWaterMark", TestMpmcHighWaterMark}};
+  return RunTests(tests);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+/* Minimalistic test harness;
+ * Failed check is reported and test goes on, process exit code tells
+ * if any check failed; Hangs are caught by ctest timeout;
+ */
+namespace VPF {
+namespace Test {
+
+inline uint32_t &NumFailures() {
+  static uint32_t num_failures = 0U;
+  return num_failures;
+}
+
+inline bool Check(bool is_ok, const char *expr, const char *file, int line) {
+  if (!is_ok) {
+    std::cerr << file << ":" << line << ": check failed: " << expr
+              << std::endl;
+    NumFailures()++;
+  }
+  return is_ok;
+}
+
+struct TestCase {
+  const char *name;
+  void (*func)();
+};
+
+template <size_t N> inline int RunTests(const TestCase (&tests)[N]) {
+  for (auto const &test : tests) {
+    auto const num_failures = NumFailures();
+    test.func();
+    std::cout << (num_failures == NumFailures() ? "[  OK  ] " : "[FAILED] ")
+              << test.name << std::endl;
+  }
+  return NumFailures() ? 1 : 0;
+}
+
+// Token which carries single number;
+class TestToken final : public Token {
+public:
+  explicit TestToken(uint64_t token_value = 0U) : value(token_value) {}
+  uint64_t value;
+};
+} // namespace Test
+} // namespace VPF
+
+#define TEST_CHECK(expr) VPF::Test::Check((expr), #expr, __FILE__, __LINE__)
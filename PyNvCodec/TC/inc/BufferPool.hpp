@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cuda.h>
+
+namespace VPF {
+
+struct DllExport BufferPoolStats {
+  // Number of allocation requests;
+  uint64_t num_allocs = 0U;
+  // Number of requests served from cached blocks;
+  uint64_t num_hits = 0U;
+  // Number of requests which went to system allocator;
+  uint64_t num_sys_allocs = 0U;
+  // Number of blocks returned to system allocator;
+  uint64_t num_sys_frees = 0U;
+  // Size of blocks given away and not yet returned;
+  uint64_t bytes_in_use = 0U;
+  // Size of blocks kept for reuse;
+  uint64_t bytes_cached = 0U;
+  // Size of pinned blocks among both of above;
+  uint64_t bytes_pinned = 0U;
+};
+
+/* Size-class pool behind Buffer memory allocations;
+ * Requests are rounded up to power of two, freed blocks are kept in
+ * per-class free lists and reused by following allocations;
+ * Free lists are sharded across threads to avoid lock contention;
+ * Pinned blocks are cached per CUDA context;
+ * Blocks bigger than largest size class bypass the pool;
+ */
+class DllExport BufferPool final {
+public:
+  BufferPool(const BufferPool &other) = delete;
+  BufferPool &operator=(const BufferPool &other) = delete;
+
+  static BufferPool &Instance();
+
+  /* Returns block of at least size bytes or nullptr;
+   * Actual block size is written to capacity;
+   * Pinned host memory is allocated if ctx is not nullptr;
+   * Memory is not initialized;
+   */
+  void *Allocate(size_t size, size_t &capacity, CUcontext ctx = nullptr);
+
+  /* Returns block to pool;
+   * Capacity and context must be the same as given by Allocate;
+   */
+  void Release(void *ptr, size_t capacity, CUcontext ctx = nullptr);
+
+  // Size of block which would be given for request of given size;
+  size_t GetAllocationSize(size_t size) const;
+
+  // Returns all cached blocks to system allocator;
+  void Trim();
+
+  /* Returns cached pinned blocks of given context to CUDA driver;
+   * Must be called by context owner before context is destroyed, cached
+   * blocks would outlive their memory otherwise;
+   */
+  void Trim(CUcontext ctx);
+
+  /* Upper limit for cached blocks total size;
+   * Blocks released above this limit go back to system allocator;
+   */
+  void SetMaxCachedBytes(size_t max_bytes);
+  size_t GetMaxCachedBytes() const;
+
+  BufferPoolStats GetStats() const;
+
+  ~BufferPool();
+
+private:
+  BufferPool();
+  struct BufferPool_Impl *pImpl = nullptr;
+};
+} // namespace VPF
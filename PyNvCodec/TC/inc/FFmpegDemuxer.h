@@ -26,10 +26,16 @@ extern "C" {
 }
 
 #include "CodecsSupport.hpp"
+#include "NalScanner.hpp"
 #include "NvCodecUtils.h"
+#include "SeekIndex.hpp"
 #include "cuviddec.h"
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <stdexcept>
 
@@ -132,9 +138,41 @@ class DllExport FFmpegDemuxer {
 
   PacketData last_packet_data;
 
-  std::vector<uint8_t> annexbBytes;
   std::vector<uint8_t> seiBytes;
 
+  /* SEI NAL units are looked up by scanning NAL headers, filter_units BSF
+   * is only used for bitstreams which scanner can't parse;
+   */
+  VPF::NalScanParams sei_scan_params;
+
+  // Appends SEI NAL units of pktSrc to seiBytes with filter_units BSF;
+  void ExtractSeiBsf();
+
+  // Only set for inputs opened by file path, seek index needs them;
+  std::string file_path;
+  std::map<std::string, std::string> format_options;
+
+  /* Index is published once it's built, so that Seek can run concurrently
+   * with background scan;
+   */
+  mutable std::mutex seek_index_lock;
+  std::shared_ptr<const VPF::SeekIndex> seek_index;
+  std::thread seek_index_thread;
+  std::atomic<bool> stop_index_scan;
+  // Set by background scan which found no index, reported by next build;
+  std::atomic<bool> index_scan_failed;
+  // Serializes BuildSeekIndex calls, seek_index_thread is only set under it;
+  std::mutex build_index_lock;
+
+  std::shared_ptr<const VPF::SeekIndex> GetSeekIndex() const;
+
+  // Reads all video packets with separate format context;
+  std::shared_ptr<VPF::SeekIndex> ScanSeekIndex();
+
+  bool SeekWithIndex(const VPF::SeekIndex &index, VPF::SeekContext &seek_ctx,
+                     uint8_t *&pVideo, size_t &rVideoBytes,
+                     PacketData &pktData, uint8_t **ppSEI, size_t *pSEIBytes);
+
   explicit FFmpegDemuxer(AVFormatContext *fmtcx);
 
   AVFormatContext *
@@ -183,6 +221,23 @@ public:
             size_t &rVideoBytes, PacketData &pktData, uint8_t **ppSEI = nullptr,
             size_t *pSEIBytes = nullptr);
 
+  /* Packet which data was returned by last Demux or Seek call;
+   * Demuxer doesn't copy packet data, so it stays valid until next call;
+   */
+  const AVPacket *GetLastPacket() const;
+
+  /* Builds frame number to timestamp index which makes seek to exact frame
+   * take single container seek; Index is stored next to input file and
+   * reused while file size and modification time stay the same;
+   * Only inputs opened by file path are supported;
+   * In background mode returns true if index is loaded or scan has started
+   * or is still running; Failed background scan makes next call return
+   * false, the call after that starts new scan;
+   */
+  bool BuildSeekIndex(bool in_background = true);
+
+  bool IsSeekIndexReady() const;
+
   void Flush();
 
   static int ReadPacket(void *opaque, uint8_t *pBuf, int nBuf);
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryInterfaces.hpp"
+
+namespace VPF {
+
+/* SIMD kernels available for host color conversion;
+ * Best one supported by CPU is picked at runtime;
+ * All kernels give bit-exact results;
+ */
+enum HostCvtKernel {
+  HOST_CVT_SCALAR = 0,
+  HOST_CVT_AVX2 = 1,
+  HOST_CVT_NEON = 2
+};
+
+/* Tells if there's CPU implementation for given conversion;
+ * Same conversions as ConvertSurface does on GPU are supported;
+ */
+DllExport bool IsHostCvtSupported(Pixel_Format inFormat,
+                                  Pixel_Format outFormat);
+
+/* Converts host memory Surface into another host memory Surface of the
+ * same size; 4:2:0 formats must have even width and height;
+ * Color space and range are taken from context, BT.601 and MPEG range are
+ * used if it's nullptr or values are unspecified;
+ * Returns false if conversion isn't supported or Surfaces don't match;
+ */
+DllExport bool ConvertSurfaceHost(Surface *pSrc, Surface *pDst,
+                                  const ColorspaceConversionContext *pCtx);
+
+/* Converts with given kernel instead of the fastest one, so BenchColorCvt
+ * can compare SIMD kernels to scalar one; Kernel which CPU can't run is
+ * replaced by scalar one;
+ */
+DllExport bool ConvertSurfaceHost(Surface *pSrc, Surface *pDst,
+                                  const ColorspaceConversionContext *pCtx,
+                                  HostCvtKernel kernel);
+
+/* CPU features which host kernels are picked by;
+ * Detected once and shared by all host engines, so they agree on what
+ * CPU can run;
+ */
+struct HostCpuFeatures {
+  bool sse2 = false;
+  bool avx2 = false;
+  // Half precision conversions, only used along with AVX2;
+  bool f16c = false;
+  bool neon = false;
+};
+
+DllExport const HostCpuFeatures &GetHostCpuFeatures();
+
+// Fastest kernel supported by CPU;
+DllExport HostCvtKernel GetHostCvtKernel();
+
+DllExport const char *GetHostCvtKernelName(HostCvtKernel kernel);
+} // namespace VPF
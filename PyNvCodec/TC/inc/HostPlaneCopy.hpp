@@ -0,0 +1,54 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace VPF {
+
+/* SIMD kernels available for host plane copy;
+ * Best one supported by CPU is picked at runtime;
+ */
+enum HostCopyKernel {
+  HOST_COPY_SCALAR = 0,
+  HOST_COPY_SSE2 = 1,
+  HOST_COPY_AVX2 = 2,
+  HOST_COPY_NEON = 3
+};
+
+/* Copies 2D plane between host memory regions;
+ * Pitches are in bytes and may be negative for bottom-up images;
+ * Whole plane is copied at once if both pitches are equal to row width;
+ * Large planes are written with non-temporal stores to avoid cache
+ * pollution;
+ */
+DllExport void CopyPlaneHost(uint8_t *dst, ptrdiff_t dst_pitch,
+                             const uint8_t *src, ptrdiff_t src_pitch,
+                             size_t width_in_bytes, size_t height);
+
+/* Copies with given kernel, e.g. to measure SSE2 one on AVX2 machine;
+ * Scalar copy is done if CPU can't run given kernel;
+ */
+DllExport void CopyPlaneHost(uint8_t *dst, ptrdiff_t dst_pitch,
+                             const uint8_t *src, ptrdiff_t src_pitch,
+                             size_t width_in_bytes, size_t height,
+                             HostCopyKernel kernel);
+
+// Fastest kernel supported by CPU;
+DllExport HostCopyKernel GetHostCopyKernel();
+
+DllExport const char *GetHostCopyKernelName(HostCopyKernel kernel);
+} // namespace VPF
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "HostColorCvt.hpp"
+#include "MemoryInterfaces.hpp"
+
+namespace VPF {
+
+/* Interpolation filters for Surface resize, from the cheapest one to the
+ * most expensive one;
+ */
+enum ResizeFilter {
+  RESIZE_NEAREST = 0,
+  RESIZE_BILINEAR = 1,
+  /* Averages all covered pixels when downscaling, best choice for
+   * thumbnails; Same as bilinear when upscaling;
+   */
+  RESIZE_AREA = 2,
+  // 3-lobed Lanczos, sharpest one;
+  RESIZE_LANCZOS = 3,
+};
+
+DllExport const char *GetResizeFilterName(ResizeFilter filter);
+
+// Rectangle in pixels of the first Surface plane;
+struct SurfaceRect {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+/* Resizes host memory Surface into another host memory Surface of the
+ * same pixel format; Every Pixel_Format is supported, planes are resized
+ * independently, NV12 chroma is resized as 2-channel plane;
+ * NV12 Surfaces must have even width and height;
+ * Work is split into bands of rows which run on calling thread and
+ * process-wide TaskExecutor, so its size caps resize threads as well;
+ * Returns false if Surfaces don't match;
+ */
+DllExport bool ResizeSurfaceHost(Surface *pSrc, Surface *pDst,
+                                 ResizeFilter filter);
+
+/* Resizes on given number of threads, 0 means all TaskExecutor threads
+ * plus calling one, with given kernel; Output doesn't depend on either,
+ * so BenchResize checks SIMD kernels against single-threaded scalar one
+ * bit to bit; Kernel which CPU can't run is replaced by scalar one;
+ */
+DllExport bool ResizeSurfaceHost(Surface *pSrc, Surface *pDst,
+                                 ResizeFilter filter, uint32_t numThreads,
+                                 HostCvtKernel kernel);
+
+/* Crops given rectangles out of host memory Surface and resizes every one
+ * to size of its output Surface, which must have the same pixel format;
+ * Crop is never copied, it's filtered straight from input; All crops run
+ * as single batch of row bands, so dozens of small crops keep all CPU
+ * cores busy as well;
+ * Filter doesn't look beyond rectangle, just like it would after crop;
+ * Returns false if any rectangle isn't inside input Surface or Surfaces
+ * don't match, nothing is resized then;
+ */
+DllExport bool CropResizeSurfaceHost(Surface *pSrc, const SurfaceRect *pRects,
+                                     Surface *const *ppDst, size_t numCrops,
+                                     ResizeFilter filter);
+
+/* Batched crop with given number of threads and kernel, which have the
+ * same meaning as for ResizeSurfaceHost(); Lets BenchResize compare
+ * batched crops against separate ones;
+ */
+DllExport bool CropResizeSurfaceHost(Surface *pSrc, const SurfaceRect *pRects,
+                                     Surface *const *ppDst, size_t numCrops,
+                                     ResizeFilter filter, uint32_t numThreads,
+                                     HostCvtKernel kernel);
+} // namespace VPF
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "HostColorCvt.hpp"
+#include "MemoryInterfaces.hpp"
+
+namespace VPF {
+
+enum TensorDataType {
+  TENSOR_FLOAT32 = 0,
+  /* IEEE 754 half precision; */
+  TENSOR_FLOAT16 = 1,
+};
+
+/* Describes planar CHW tensor made out of YUV Surface;
+ * Every channel value is (clamp(rgb, 0, 255) * scale - mean) / std;
+ * Default values give RGB in [0;1] range;
+ */
+struct TensorParams {
+  // Tensor size, zero means the same as input Surface;
+  uint32_t width;
+  uint32_t height;
+  TensorDataType type;
+  float scale;
+  // Per-channel values in order of output channels;
+  float mean[3];
+  float std[3];
+  // Channels go in B, G, R order if set;
+  bool is_bgr;
+
+  TensorParams()
+      : width(0U), height(0U), type(TENSOR_FLOAT32), scale(1.0f / 255.0f),
+        mean{0.0f, 0.0f, 0.0f}, std{1.0f, 1.0f, 1.0f}, is_bgr(false) {}
+};
+
+// Formats which can be converted to tensor;
+DllExport bool IsHostTensorCvtSupported(Pixel_Format inFormat);
+
+/* Size of CHW tensor in bytes;
+ * Input size is needed if tensor size isn't given in params;
+ */
+DllExport size_t GetTensorSize(const TensorParams &params, uint32_t inWidth,
+                               uint32_t inHeight);
+
+/* Converts host memory NV12 or YUV420 Surface to normalized planar RGB
+ * tensor in one pass; Tensor is written into caller-supplied memory which
+ * must be at least GetTensorSize() bytes;
+ * Surface is resized with bilinear filter if tensor size differs;
+ * Color space and range are taken from context, BT.601 and MPEG range are
+ * used if it's nullptr or values are unspecified;
+ * Returns false if input isn't supported or output memory is too small;
+ */
+DllExport bool ConvertSurfaceToTensorHost(
+    Surface *pSrc, void *pDst, size_t dstSize, const TensorParams &params,
+    const ColorspaceConversionContext *pCtx);
+
+/* Converts with given kernel instead of GetHostTensorCvtKernel() one;
+ * AVX2 kernel needs F16C as well, scalar one runs on CPUs without it;
+ */
+DllExport bool ConvertSurfaceToTensorHost(
+    Surface *pSrc, void *pDst, size_t dstSize, const TensorParams &params,
+    const ColorspaceConversionContext *pCtx, HostCvtKernel kernel);
+
+// Fastest kernel supported by CPU;
+DllExport HostCvtKernel GetHostTensorCvtKernel();
+} // namespace VPF
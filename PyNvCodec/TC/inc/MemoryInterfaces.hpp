@@ -45,6 +45,15 @@ enum ColorRange {
   UDEF = 2,
 };
 
+/* Where Surface planes are allocated;
+ * Host planes are pitched like device ones, so Width, Pitch and PlanePtr
+ * have the same meaning for both; PlanePtr is host address then;
+ */
+enum MemoryType {
+  MEM_DEVICE = 0,
+  MEM_HOST = 1,
+};
+
 struct ColorspaceConversionContext {
   ColorSpace color_space;
   ColorRange color_range;
@@ -57,6 +66,7 @@ struct ColorspaceConversionContext {
 
 /* Represents CPU-side memory.
  * May own the memory or be a wrapper around existing ponter;
+ * Owned memory comes from BufferPool and may be bigger than buffer size;
  */
 class DllExport Buffer final : public Token {
 public:
@@ -65,10 +75,29 @@ public:
   Buffer &operator=(Buffer &other) = delete;
 
   ~Buffer() final;
+  size_t GetByteSize() const final;
   void *GetRawMemPtr();
   const void *GetRawMemPtr() const;
   size_t GetRawMemSize() const;
+  size_t GetCapacity() const;
   void Update(size_t newSize, void *newPtr = nullptr);
+
+  /* Grows capacity to at least given size, keeps content;
+   * Has no effect on Buffers which don't own memory;
+   */
+  bool Reserve(size_t newCapacity);
+
+  /* Releases memory beyond buffer size, keeps content;
+   * Has no effect on Buffers which don't own memory;
+   */
+  bool ShrinkToFit();
+
+  /* Update() shrinks Buffer after numUpdates consecutive calls which need
+   * less than 1/ratio of its capacity; Pass 0 as ratio to never shrink;
+   * Applies to all Buffers;
+   */
+  static void SetShrinkPolicy(uint32_t ratio, uint32_t numUpdates);
+  static void GetShrinkPolicy(uint32_t &ratio, uint32_t &numUpdates);
   bool CopyFrom(size_t size, void const *ptr);
   template <typename T> T *GetDataAs() { return (T *)GetRawMemPtr(); }
   template <typename T> T const *GetDataAs() const {
@@ -78,6 +107,7 @@ public:
   static Buffer *Make(size_t bufferSize);
   static Buffer *Make(size_t bufferSize, void *pCopyFrom);
 
+  // Host memory is zero-filled, pinned one is not;
   static Buffer *MakeOwnMem(size_t bufferSize, CUcontext ctx = nullptr);
   static Buffer *MakeOwnMem(size_t bufferSize, const void *pCopyFrom,
                             CUcontext ctx = nullptr);
@@ -90,9 +120,13 @@ private:
   Buffer(size_t bufferSize, const void *pCopyFrom, CUcontext ctx = nullptr);
   bool Allocate();
   void Deallocate();
+  bool Reallocate(size_t newCapacity, bool keepContent);
+  bool IsShrinkNeeded(size_t newSize);
 
   bool own_memory = true;
   size_t mem_size = 0UL;
+  size_t capacity = 0UL;
+  uint32_t num_small_updates = 0U;
   void *pRawData = nullptr;
   CUcontext context = nullptr;
 #ifdef TRACK_TOKEN_ALLOCATIONS
@@ -117,8 +151,17 @@ public:
   ~CudaStrSync() { cuStreamSynchronize(str); }
 };
 
+/* Copies 2D region between host and / or device memory;
+ * Copies which involve device memory are asynchronous, synchronize stream
+ * afterwards; Host to host copy doesn't use CUDA and is done right away;
+ */
+void DllExport CopyMem2D(CUdeviceptr src, MemoryType srcType, uint32_t srcPitch,
+                         CUdeviceptr dst, MemoryType dstType, uint32_t dstPitch,
+                         uint32_t widthInBytes, uint32_t height, CUcontext ctx,
+                         CUstream str);
+
 /* Surface plane class;
- * 2-dimensional GPU memory;
+ * 2-dimensional GPU or host memory;
  * Doesn't have any format, just storafe for bytes;
  * Size in pixels are raw sizes.
  * E. g. RGB image will have single SurfacePlane which is 3x wide.
@@ -133,6 +176,16 @@ struct DllExport SurfacePlane {
   uint32_t elemSize = 0U;
 
   bool ownMem = false;
+  MemoryType memType = MEM_DEVICE;
+
+  // Host memory block which aligned gpuMem points into;
+  void *hostBlock = nullptr;
+  size_t hostCapacity = 0U;
+
+  /* Host planes rows start at this alignment, so SIMD kernels can use
+   * aligned loads;
+   */
+  static const uint32_t hostAlignment = 64U;
 
   /* Blank plane, zero size;
    */
@@ -149,12 +202,14 @@ struct DllExport SurfacePlane {
   /* Construct from ptr & dimensions, don't own memory;
    */
   SurfacePlane(uint32_t newWidth, uint32_t newHeight, uint32_t newPitch,
-               uint32_t newElemSize, CUdeviceptr pNewPtr);
+               uint32_t newElemSize, CUdeviceptr pNewPtr,
+               MemoryType newMemType = MEM_DEVICE);
 
   /* Construct & own memory;
+   * Host memory is pinned if context is given;
    */
   SurfacePlane(uint32_t newWidth, uint32_t newHeight, uint32_t newElemSize,
-               CUcontext context);
+               CUcontext context, MemoryType newMemType = MEM_DEVICE);
 
   /* Construct & own memory. Copy from given pointer.
    */
@@ -175,11 +230,13 @@ struct DllExport SurfacePlane {
 
   /* Copy from SurfacePlane memory to given pointer.
    * User must check that memory allocation referenced by ptr is enough.
+   * Pointer is treated as device memory;
    */
   void Export(CUdeviceptr dst, uint32_t dst_pitch, CUcontext ctx, CUstream str);
 
   /* Copy to SurfacePlane memory from given pointer.
    * User must check that memory allocation referenced by ptr is enough.
+   * Pointer is treated as device memory;
    */
   void Import(CUdeviceptr src, uint32_t src_pitch, CUcontext ctx, CUstream str);
 
@@ -196,9 +253,20 @@ struct DllExport SurfacePlane {
   inline bool OwnMemory() const { return ownMem; }
 
   /* Returns pointer to GPU memory object;
+   * Host address for host planes;
    */
   inline CUdeviceptr GpuMem() const { return gpuMem; }
 
+  /* Returns type of memory plane is in;
+   */
+  inline MemoryType MemType() const { return memType; }
+
+  /* Returns host address of plane or nullptr for device planes;
+   */
+  inline uint8_t *HostMem() const {
+    return MEM_HOST == memType ? (uint8_t *)gpuMem : nullptr;
+  }
+
   /* Get plane width in pixels;
    */
   inline uint32_t Width() const { return width; }
@@ -224,7 +292,7 @@ struct DllExport SurfacePlane {
 #endif
 };
 
-/* Represents GPU-side memory.
+/* Represents GPU-side or host-side memory, see MemoryType.
  * Pure interface class, see ancestors;
  */
 class DllExport Surface : public Token {
@@ -256,6 +324,8 @@ public:
    */
   virtual uint32_t HostMemSize() const = 0;
 
+  size_t GetByteSize() const override;
+
   /* Returns number of image planes;
    */
   virtual uint32_t NumPlanes() const = 0;
@@ -272,6 +342,10 @@ public:
    */
   virtual bool Update(SurfacePlane *pPlanes, size_t planesNum) = 0;
 
+  /* Returns type of memory planes are in;
+   */
+  MemoryType MemType();
+
   /* Virtual copy constructor;
    */
   virtual Surface *Clone() = 0;
@@ -289,6 +363,22 @@ public:
   static Surface *Make(Pixel_Format format, uint32_t newWidth,
                        uint32_t newHeight, CUcontext context);
 
+  /* Make & own memory of given type;
+   * Host memory is pinned if context is given;
+   */
+  static Surface *Make(Pixel_Format format, uint32_t newWidth,
+                       uint32_t newHeight, MemoryType memType,
+                       CUcontext context = nullptr);
+
+  /* Returns given Surface if it has requested format, size and memory
+   * type; Deletes it and makes new one otherwise, so task keeps its output
+   * Surface between runs and only reallocates it when input changes;
+   */
+  static Surface *MakeOrReuse(Surface *pSurface, Pixel_Format format,
+                              uint32_t newWidth, uint32_t newHeight,
+                              MemoryType memType,
+                              CUcontext context = nullptr);
+
 protected:
   Surface();
 };
@@ -301,7 +391,8 @@ public:
 
   SurfaceY();
   SurfaceY(const SurfaceY &other);
-  SurfaceY(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceY(uint32_t width, uint32_t height, CUcontext context,
+            MemoryType memType = MEM_DEVICE);
   SurfaceY &operator=(const SurfaceY &other);
 
   Surface *Clone() override;
@@ -335,7 +426,8 @@ public:
 
   SurfaceNV12();
   SurfaceNV12(const SurfaceNV12 &other);
-  SurfaceNV12(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceNV12(uint32_t width, uint32_t height, CUcontext context,
+               MemoryType memType = MEM_DEVICE);
   SurfaceNV12 &operator=(const SurfaceNV12 &other);
 
   Surface *Clone() override;
@@ -370,7 +462,8 @@ public:
 
   SurfaceYUV420();
   SurfaceYUV420(const SurfaceYUV420 &other);
-  SurfaceYUV420(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceYUV420(uint32_t width, uint32_t height, CUcontext context,
+                 MemoryType memType = MEM_DEVICE);
   SurfaceYUV420 &operator=(const SurfaceYUV420 &other);
 
   virtual Surface *Clone() override;
@@ -408,7 +501,8 @@ public:
 
   SurfaceYCbCr();
   SurfaceYCbCr(const SurfaceYCbCr &other);
-  SurfaceYCbCr(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceYCbCr(uint32_t width, uint32_t height, CUcontext context,
+                MemoryType memType = MEM_DEVICE);
 
   Surface *Clone() override;
   Surface *Create() override;
@@ -422,7 +516,8 @@ public:
 
   SurfaceRGB();
   SurfaceRGB(const SurfaceRGB &other);
-  SurfaceRGB(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceRGB(uint32_t width, uint32_t height, CUcontext context,
+              MemoryType memType = MEM_DEVICE);
   SurfaceRGB &operator=(const SurfaceRGB &other);
 
   Surface *Clone() override;
@@ -456,7 +551,8 @@ public:
 
   SurfaceBGR();
   SurfaceBGR(const SurfaceBGR &other);
-  SurfaceBGR(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceBGR(uint32_t width, uint32_t height, CUcontext context,
+              MemoryType memType = MEM_DEVICE);
   SurfaceBGR &operator=(const SurfaceBGR &other);
 
   Surface *Clone() override;
@@ -489,7 +585,8 @@ public:
 
   SurfaceRGBPlanar();
   SurfaceRGBPlanar(const SurfaceRGBPlanar &other);
-  SurfaceRGBPlanar(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceRGBPlanar(uint32_t width, uint32_t height, CUcontext context,
+                    MemoryType memType = MEM_DEVICE);
   SurfaceRGBPlanar &operator=(const SurfaceRGBPlanar &other);
 
   virtual Surface *Clone() override;
@@ -521,7 +618,8 @@ public:
 
   SurfaceYUV444();
   SurfaceYUV444(const SurfaceYUV444 &other);
-  SurfaceYUV444(uint32_t width, uint32_t height, CUcontext context);
+  SurfaceYUV444(uint32_t width, uint32_t height, CUcontext context,
+                 MemoryType memType = MEM_DEVICE);
   SurfaceYUV444 &operator=(const SurfaceYUV444 &other);
 
   Surface *Clone() override;
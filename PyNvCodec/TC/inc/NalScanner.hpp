@@ -0,0 +1,61 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VPF {
+
+enum NalStreamFormat {
+  // NAL units are separated by 00 00 01 start codes;
+  NAL_FORMAT_ANNEXB = 0,
+  // Every NAL unit is preceded by its size (AVCC / HVCC in mp4, mkv);
+  NAL_FORMAT_LENGTH_PREFIXED = 1
+};
+
+struct DllExport NalScanParams {
+  NalStreamFormat format = NAL_FORMAT_ANNEXB;
+  // Size of NAL unit length field, 1 to 4 bytes;
+  uint32_t nal_length_size = 4U;
+  // H.265 NAL unit header differs from H.264 one;
+  bool is_hevc = false;
+};
+
+/* Guesses bitstream format from codec extradata;
+ * AVCDecoderConfigurationRecord or HEVCDecoderConfigurationRecord means
+ * length-prefixed NAL units, anything else is treated as Annex.B;
+ */
+DllExport NalScanParams GetNalScanParams(const uint8_t *extradata,
+                                         size_t extradata_size, bool is_hevc);
+
+/* Returns pointer to first 00 00 01 start code in [begin, end) or end if
+ * there's none;
+ * SIMD is used when supported, use_simd = false is for benchmarking;
+ */
+DllExport const uint8_t *FindStartCode(const uint8_t *begin,
+                                       const uint8_t *end,
+                                       bool use_simd = true);
+
+/* Appends SEI NAL units found in packet to sei as Annex.B bitstream;
+ * That's what filter_units BSF gives for pass_types=6 (H.264) or
+ * pass_types=39-40 (H.265);
+ * Returns false if packet doesn't match given format, sei is untouched then;
+ */
+DllExport bool ExtractSeiNalUnits(const uint8_t *data, size_t size,
+                                  const NalScanParams &params,
+                                  std::vector<uint8_t> &sei);
+} // namespace VPF
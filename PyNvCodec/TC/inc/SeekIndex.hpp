@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct AVDictionary;
+struct AVFormatContext;
+
+namespace VPF {
+
+struct DllExport SeekIndexEntry {
+  // Timestamps are in video stream time base units;
+  int64_t pts = 0;
+  int64_t dts = 0;
+  // Byte position in file, -1 if unknown;
+  int64_t pos = -1;
+  bool is_key = false;
+};
+
+/* Frame number to packet timestamps table for video stream;
+ * Frames are numbered in presentation order, so frame number is the rank
+ * of packet pts among all packets in stream;
+ */
+class DllExport SeekIndex final {
+public:
+  SeekIndex() = default;
+
+  // Packets are added in demuxing order;
+  void Add(const SeekIndexEntry &entry);
+
+  // Sorts entries by pts, must be called after last packet is added;
+  void Finalize();
+
+  size_t GetNumFrames() const;
+
+  bool GetFrame(int64_t frame_num, SeekIndexEntry &entry) const;
+
+  // Closest key frame at or before given frame in presentation order;
+  bool GetPrevKeyFrame(int64_t frame_num, SeekIndexEntry &entry) const;
+
+  // Number of frame with given pts or -1 if there's no such frame;
+  int64_t GetFrameNum(int64_t pts) const;
+
+  /* Index file is keyed by video file size and modification time,
+   * it's considered stale if any of them differs;
+   */
+  bool Save(const std::string &index_path, uint64_t file_size,
+            int64_t file_mtime, int32_t stream_idx) const;
+
+  bool Load(const std::string &index_path, uint64_t file_size,
+            int64_t file_mtime, int32_t stream_idx);
+
+  // Index file is stored next to video file;
+  static std::string GetIndexPath(const std::string &video_path);
+
+  /* Loads index of given video file if there's one and it's up to date,
+   * returns nullptr otherwise;
+   */
+  static std::shared_ptr<SeekIndex> LoadForFile(const std::string &video_path,
+                                                int32_t stream_idx);
+
+  // Saves index next to given video file;
+  bool SaveForFile(const std::string &video_path, int32_t stream_idx) const;
+
+  /* Reads all packets of given stream till the end of input; Context read
+   * position is changed, so caller has to seek afterwards;
+   * Returns nullptr if packets have no timestamps or stop flag was raised;
+   */
+  static std::shared_ptr<SeekIndex>
+  Scan(AVFormatContext *fmt_ctx, int32_t stream_idx,
+       const std::atomic<bool> *stop = nullptr);
+
+  /* Opens given input with own format context and scans its stream, so
+   * that caller's read position and buffered frames stay untouched;
+   * Options are copied, caller keeps them;
+   */
+  static std::shared_ptr<SeekIndex>
+  ScanFile(const std::string &url, const AVDictionary *options,
+           int32_t stream_idx, const std::atomic<bool> *stop = nullptr);
+
+  // Returns false if file can't be accessed;
+  static bool GetFileStats(const std::string &path, uint64_t &file_size,
+                           int64_t &file_mtime);
+
+private:
+  // Sorted by pts after Finalize;
+  std::vector<SeekIndexEntry> frames;
+  // Frame numbers of key frames, ascending;
+  std::vector<int64_t> key_frames;
+};
+} // namespace VPF
@@ -13,13 +13,19 @@
 
 #pragma once
 #include "CodecsSupport.hpp"
+#include "HostResize.hpp"
+#include "HostTensorCvt.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NvCodecCLIOptions.h"
 #include "TC_CORE.hpp"
+#include "TaskTracer.hpp"
 #include "cuviddec.h"
+#include <vector>
 
 extern "C" {
+  #include <libavcodec/avcodec.h>
   #include <libavutil/frame.h>
+  #include <libavutil/pixfmt.h>
 }
 
 #ifdef USE_NVTX
@@ -41,10 +47,16 @@ using namespace VPF;
 
 // VPF stands for Video Processing Framework;
 namespace VPF {
+/* Marks range for Nsight if built with NVTX and for TaskTracer;
+ * Name has to be string literal, see TaskTracer::AddEvent;
+ */
 class DllExport NvtxMark {
 public:
-  NvtxMark(const char *fname) { NVTX_PUSH(fname) }
+  NvtxMark(const char *fname) : trace(fname) { NVTX_PUSH(fname) }
   ~NvtxMark() { NVTX_POP }
+
+private:
+  TraceScope trace;
 };
 
 class DllExport NvencEncodeFrame final : public Task {
@@ -100,6 +112,16 @@ private:
                    Pixel_Format format);
 };
 
+/* Software decoder threading mode;
+ * Values match libavcodec FF_THREAD_FRAME & FF_THREAD_SLICE bit flags;
+ */
+enum SwDecodeThreadType {
+  THREAD_NONE = 0,
+  THREAD_FRAME = 1,
+  THREAD_SLICE = 2,
+  THREAD_FRAME_SLICE = 3
+};
+
 class DllExport FfmpegDecodeFrame final : public Task {
 public:
   FfmpegDecodeFrame() = delete;
@@ -109,9 +131,59 @@ public:
   TaskExecStatus Run() final;
   TaskExecStatus GetSideData(AVFrameSideDataType);
 
+  /* Decodes next frame without copying pixels to output Buffer;
+   * Returns new reference to decoded frame or nullptr on EOS / error;
+   * Frame data is shared with decoder and must not be modified;
+   * Caller owns the reference and releases it with av_frame_free;
+   */
+  AVFrame *DecodeFrameRef();
+
+  /* Properties of last decoded frame; Output Buffer holds all planes of
+   * given pixel format packed one after another without row padding;
+   */
+  uint32_t GetWidth() const;
+  uint32_t GetHeight() const;
+  AVPixelFormat GetPixelFormat() const;
+
+  /* Size of single frame in Run output layout and size of its first row;
+   * Stream parameters are used before first frame is decoded;
+   */
+  size_t GetFrameSize() const;
+  size_t GetFrameRowSize() const;
+
+  /* Decodes frames with given numbers and packs them to dst one after
+   * another in Run output layout; Frames are numbered in presentation
+   * order, numbers may go in any order and repeat;
+   * Requests are grouped by GOP, so every GOP is decoded at most once and
+   * frames which weren't requested are dropped without being copied;
+   * Frame index is built upon first call, see FFmpegDemuxer::BuildSeekIndex;
+   * Decoder position changes, next Run returns frame after last decoded one;
+   */
+  bool DecodeFrames(const std::vector<int64_t> &frame_nums, uint8_t *dst,
+                    size_t frame_size);
+
+  /* Number of frames in stream; Once frame index is built it's exact,
+   * before that it's taken from container and may be 0 if unknown;
+   * If exact is true, index is built first: whole file is read by separate
+   * demuxer and index is saved next to it, decoder position is kept;
+   */
+  uint32_t GetNumFrames(bool exact = false);
+
+  /* Number of threads and threading type actually used by libavcodec;
+   * Decoder may pick a subset of requested threading types;
+   */
+  uint32_t GetNumThreads() const;
+  SwDecodeThreadType GetThreadType() const;
+
   ~FfmpegDecodeFrame() final;
-  static FfmpegDecodeFrame *Make(const char *URL,
-                                 NvDecoderClInterface &cli_iface);
+
+  /* Pass 0 as num_threads to use all available CPU cores;
+   * Explicit "threads" option in cli_iface takes precedence;
+   */
+  static FfmpegDecodeFrame *
+  Make(const char *URL, NvDecoderClInterface &cli_iface,
+       uint32_t num_threads = 0U,
+       SwDecodeThreadType thread_type = THREAD_FRAME_SLICE);
 
 private:
   static const uint32_t num_inputs = 0U;
@@ -119,7 +191,8 @@ private:
   static const uint32_t num_outputs = 2U;
   struct FfmpegDecodeFrame_Impl *pImpl = nullptr;
 
-  FfmpegDecodeFrame(const char *URL, NvDecoderClInterface &cli_iface);
+  FfmpegDecodeFrame(const char *URL, NvDecoderClInterface &cli_iface,
+                    uint32_t num_threads, SwDecodeThreadType thread_type);
 };
 
 class DllExport CudaUploadFrame final : public Task {
@@ -171,6 +244,40 @@ public:
 
   void GetParams(struct MuxingParams &params) const;
   void Flush();
+
+  /* Elementary video packet buffer capacity management;
+   * Reserve ahead to avoid reallocations on high bitrate streams;
+   */
+  bool ReservePacketBuffer(size_t size);
+  bool ShrinkPacketBuffer();
+  size_t GetPacketBufferCapacity() const;
+
+  /* Output packet without copy;
+   * Output Buffer then doesn't own memory, it points to demuxed packet data
+   * and stays valid until next Run; Packet buffer capacity isn't used;
+   */
+  void SetPacketByReference(bool by_reference);
+  bool IsPacketByReference() const;
+
+  /* Output every packet in new ref-counted Buffer taken from pool;
+   * Consumers may hold reference to it after next Run, e. g. in TaskGraph
+   * queues, and it's reused once released; Packet buffer capacity isn't
+   * used; Packet by reference mode takes precedence;
+   * Without seek Run demuxes until it gets non-empty packet, so packet
+   * comes along with every PacketData output;
+   */
+  void SetPacketPooling(bool use_pool);
+  bool IsPacketPooling() const;
+
+  /* New reference to packet demuxed by last Run or nullptr;
+   * Caller owns the reference and releases it with av_packet_free;
+   */
+  AVPacket *GetPacketRef();
+
+  /* Frame index for fast exact seek, see FFmpegDemuxer::BuildSeekIndex;
+   */
+  bool BuildSeekIndex(bool in_background);
+  bool IsSeekIndexReady() const;
   TaskExecStatus Run() final;
   ~DemuxFrame() final;
   static DemuxFrame *Make(const char *url, const char **ffmpeg_options,
@@ -189,6 +296,9 @@ public:
   ConvertSurface(const ConvertSurface &other) = delete;
   ConvertSurface &operator=(const ConvertSurface &other) = delete;
 
+  /* Host memory input Surfaces are converted on CPU, output is in host
+   * memory then; Pass nullptr CUDA context to convert host Surfaces only;
+   */
   static ConvertSurface *Make(uint32_t width, uint32_t height,
                               Pixel_Format inFormat, Pixel_Format outFormat,
                               CUcontext ctx, CUstream str);
@@ -201,20 +311,55 @@ private:
   static const uint32_t numInputs = 2U;
   static const uint32_t numOutputs = 1U;
 
-  struct NppConvertSurface_Impl *pImpl;
+  struct NppConvertSurface_Impl *pImpl = nullptr;
+  struct HostConvertSurface_Impl *pHostImpl = nullptr;
 
   ConvertSurface(uint32_t width, uint32_t height, Pixel_Format inFormat,
                  Pixel_Format outFormat, CUcontext ctx, CUstream str);
 };
 
+/* Converts host memory YUV Surface to normalized planar float tensor in
+ * single pass, see ConvertSurfaceToTensorHost();
+ * Inputs are Surface, optional ColorspaceConversionContext Buffer and
+ * optional Buffer to write tensor into; Output is Buffer with tensor;
+ * Task allocates and reuses its own Buffer if there's no 3rd input;
+ */
+class DllExport ConvertSurfaceToTensor final : public Task {
+public:
+  ConvertSurfaceToTensor() = delete;
+  ConvertSurfaceToTensor(const ConvertSurfaceToTensor &other) = delete;
+  ConvertSurfaceToTensor &
+  operator=(const ConvertSurfaceToTensor &other) = delete;
+
+  static ConvertSurfaceToTensor *Make(Pixel_Format inFormat,
+                                      const TensorParams &params);
+
+  ~ConvertSurfaceToTensor();
+
+  TaskExecStatus Run() final;
+
+private:
+  static const uint32_t numInputs = 3U;
+  static const uint32_t numOutputs = 1U;
+
+  struct HostSurfaceToTensor_Impl *pImpl = nullptr;
+
+  ConvertSurfaceToTensor(Pixel_Format inFormat, const TensorParams &params);
+};
+
 class DllExport ResizeSurface final : public Task {
 public:
   ResizeSurface() = delete;
   ResizeSurface(const ResizeSurface &other) = delete;
   ResizeSurface &operator=(const ResizeSurface &other) = delete;
 
+  /* Host memory input Surfaces are resized on CPU, output is in host
+   * memory then; Pass nullptr CUDA context to resize host Surfaces only;
+   * Device NV12 Surfaces aren't supported;
+   */
   static ResizeSurface *Make(uint32_t width, uint32_t height,
-                             Pixel_Format format, CUcontext ctx, CUstream str);
+                             Pixel_Format format, CUcontext ctx, CUstream str,
+                             ResizeFilter filter = RESIZE_LANCZOS);
 
   ~ResizeSurface();
 
@@ -224,8 +369,47 @@ private:
   static const uint32_t numInputs = 1U;
   static const uint32_t numOutputs = 1U;
 
-  struct ResizeSurface_Impl *pImpl;
+  struct ResizeSurface_Impl *pImpl = nullptr;
+  struct HostResizeSurface_Impl *pHostImpl = nullptr;
   ResizeSurface(uint32_t width, uint32_t height, Pixel_Format format,
-                CUcontext ctx, CUstream str);
+                CUcontext ctx, CUstream str, ResizeFilter filter);
+};
+
+// Source rectangle of single crop and size it's resized to;
+struct CropResizeParams {
+  SurfaceRect rect;
+  uint32_t width;
+  uint32_t height;
+};
+
+/* Crops many rectangles out of host memory Surface and resizes them in
+ * single batched pass, see CropResizeSurfaceHost();
+ * Inputs are Surface, Buffer with array of CropResizeParams, at least one
+ * crop is needed, and optional Buffer with array of Surface pointers to
+ * resize crops into; Output is Buffer with array of Surface pointers, one
+ * per crop;
+ * Destination Surfaces stay with the caller and must match crop sizes;
+ * Without them task uses its own Surfaces, which are overwritten by next
+ * run and reallocated if crop sizes change;
+ */
+class DllExport CropResizeSurface final : public Task {
+public:
+  CropResizeSurface() = delete;
+  CropResizeSurface(const CropResizeSurface &other) = delete;
+  CropResizeSurface &operator=(const CropResizeSurface &other) = delete;
+
+  static CropResizeSurface *Make(Pixel_Format format, ResizeFilter filter);
+
+  ~CropResizeSurface();
+
+  TaskExecStatus Run() final;
+
+private:
+  static const uint32_t numInputs = 3U;
+  static const uint32_t numOutputs = 1U;
+
+  struct HostCropResizeSurface_Impl *pImpl = nullptr;
+
+  CropResizeSurface(Pixel_Format format, ResizeFilter filter);
 };
 } // namespace VPF
\ No newline at end of file
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BufferPool.hpp"
+#include "MemoryInterfaces.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+// Smallest size class is 64 bytes, biggest one is 64 MiB;
+static const size_t min_class_size = 64U;
+static const size_t num_classes = 21U;
+static const size_t max_class_size = min_class_size << (num_classes - 1U);
+
+// Number of free lists for every size class;
+static const size_t num_shards = 8U;
+
+static size_t GetClassIndex(size_t size) {
+  size_t idx = 0U, class_size = min_class_size;
+  while (class_size < size) {
+    class_size <<= 1;
+    idx++;
+  }
+  return idx;
+}
+
+static size_t GetShardIndex() {
+  // Threads are spread across shards to reduce lock contention;
+  static thread_local size_t shard =
+      hash<thread::id>()(this_thread::get_id()) % num_shards;
+  return shard;
+}
+
+static void *SysAllocate(size_t size, CUcontext ctx) {
+  void *ptr = nullptr;
+  if (ctx) {
+    CudaCtxPush lock(ctx);
+    if (CUDA_SUCCESS != cuMemAllocHost(&ptr, size)) {
+      return nullptr;
+    }
+  } else {
+    ptr = malloc(size);
+  }
+  return ptr;
+}
+
+static void SysFree(void *ptr, CUcontext ctx) {
+  if (ctx) {
+    // Context may be destroyed already at exit, nothing to do then;
+    cuMemFreeHost(ptr);
+  } else {
+    free(ptr);
+  }
+}
+
+namespace VPF {
+struct FreeList {
+  mutex guard;
+  vector<void *> blocks;
+};
+
+struct SizeClasses {
+  FreeList lists[num_shards][num_classes];
+};
+
+struct BufferPool_Impl {
+  SizeClasses host;
+
+  mutex pinned_guard;
+  map<CUcontext, unique_ptr<SizeClasses>> pinned;
+
+  atomic<uint64_t> num_allocs;
+  atomic<uint64_t> num_hits;
+  atomic<uint64_t> num_sys_allocs;
+  atomic<uint64_t> num_sys_frees;
+  atomic<uint64_t> bytes_in_use;
+  atomic<uint64_t> bytes_cached;
+  atomic<uint64_t> bytes_pinned;
+  atomic<size_t> max_cached_bytes;
+
+  BufferPool_Impl()
+      : num_allocs(0U), num_hits(0U), num_sys_allocs(0U), num_sys_frees(0U),
+        bytes_in_use(0U), bytes_cached(0U), bytes_pinned(0U),
+        max_cached_bytes(256U * 1024U * 1024U) {}
+
+  SizeClasses &GetClasses(CUcontext ctx) {
+    if (!ctx) {
+      return host;
+    }
+
+    lock_guard<mutex> lock(pinned_guard);
+    auto &classes = pinned[ctx];
+    if (!classes) {
+      classes.reset(new SizeClasses);
+    }
+    return *classes;
+  }
+
+  void *NewBlock(size_t size, CUcontext ctx) {
+    auto ptr = SysAllocate(size, ctx);
+    if (ptr) {
+      num_sys_allocs++;
+      bytes_in_use += size;
+      if (ctx) {
+        bytes_pinned += size;
+      }
+    }
+    return ptr;
+  }
+
+  void FreeBlock(void *ptr, size_t size, CUcontext ctx) {
+    SysFree(ptr, ctx);
+    num_sys_frees++;
+    if (ctx) {
+      bytes_pinned -= size;
+    }
+  }
+
+  void *TakeCached(SizeClasses &classes, size_t idx) {
+    auto const own_shard = GetShardIndex();
+
+    // Look in own shard first, then steal from others without waiting;
+    for (size_t i = 0U; i < num_shards; i++) {
+      auto &list = classes.lists[(own_shard + i) % num_shards][idx];
+      unique_lock<mutex> lock(list.guard, defer_lock);
+      if (0U == i) {
+        lock.lock();
+      } else if (!lock.try_lock()) {
+        continue;
+      }
+
+      if (!list.blocks.empty()) {
+        auto ptr = list.blocks.back();
+        list.blocks.pop_back();
+        return ptr;
+      }
+    }
+
+    return nullptr;
+  }
+
+  void TrimClasses(SizeClasses &classes, CUcontext ctx) {
+    for (size_t shard = 0U; shard < num_shards; shard++) {
+      for (size_t idx = 0U; idx < num_classes; idx++) {
+        auto &list = classes.lists[shard][idx];
+        lock_guard<mutex> lock(list.guard);
+        auto const class_size = min_class_size << idx;
+        for (auto ptr : list.blocks) {
+          FreeBlock(ptr, class_size, ctx);
+          bytes_cached -= class_size;
+        }
+        list.blocks.clear();
+      }
+    }
+  }
+};
+} // namespace VPF
+
+BufferPool &BufferPool::Instance() {
+  /* Never destroyed on purpose, Buffers owned by other static objects may
+   * be released after it otherwise;
+   */
+  static BufferPool *instance = new BufferPool();
+  return *instance;
+}
+
+BufferPool::BufferPool() { pImpl = new BufferPool_Impl(); }
+
+BufferPool::~BufferPool() {
+  Trim();
+  delete pImpl;
+}
+
+void *BufferPool::Allocate(size_t size, size_t &capacity, CUcontext ctx) {
+  capacity = 0U;
+  if (!size) {
+    return nullptr;
+  }
+
+  pImpl->num_allocs++;
+
+  if (size > max_class_size) {
+    // Too big to be cached;
+    auto ptr = pImpl->NewBlock(size, ctx);
+    capacity = ptr ? size : 0U;
+    return ptr;
+  }
+
+  auto const idx = GetClassIndex(size);
+  auto const class_size = min_class_size << idx;
+
+  auto ptr = pImpl->TakeCached(pImpl->GetClasses(ctx), idx);
+  if (ptr) {
+    pImpl->num_hits++;
+    pImpl->bytes_cached -= class_size;
+    pImpl->bytes_in_use += class_size;
+  } else {
+    ptr = pImpl->NewBlock(class_size, ctx);
+  }
+
+  capacity = ptr ? class_size : 0U;
+  return ptr;
+}
+
+void BufferPool::Release(void *ptr, size_t capacity, CUcontext ctx) {
+  if (!ptr) {
+    return;
+  }
+
+  pImpl->bytes_in_use -= capacity;
+
+  auto const idx = GetClassIndex(min(capacity, max_class_size));
+  auto const is_class_size = (capacity == (min_class_size << idx));
+  auto const is_over_limit =
+      pImpl->bytes_cached + capacity > pImpl->max_cached_bytes;
+
+  if (!is_class_size || is_over_limit) {
+    pImpl->FreeBlock(ptr, capacity, ctx);
+    return;
+  }
+
+  auto &list = pImpl->GetClasses(ctx).lists[GetShardIndex()][idx];
+  lock_guard<mutex> lock(list.guard);
+  list.blocks.push_back(ptr);
+  pImpl->bytes_cached += capacity;
+}
+
+size_t BufferPool::GetAllocationSize(size_t size) const {
+  if (!size || size > max_class_size) {
+    return size;
+  }
+
+  return min_class_size << GetClassIndex(size);
+}
+
+void BufferPool::Trim() {
+  pImpl->TrimClasses(pImpl->host, nullptr);
+
+  lock_guard<mutex> lock(pImpl->pinned_guard);
+  for (auto &it : pImpl->pinned) {
+    pImpl->TrimClasses(*it.second, it.first);
+  }
+}
+
+void BufferPool::Trim(CUcontext ctx) {
+  if (!ctx) {
+    pImpl->TrimClasses(pImpl->host, nullptr);
+    return;
+  }
+
+  lock_guard<mutex> lock(pImpl->pinned_guard);
+  auto it = pImpl->pinned.find(ctx);
+  if (it != pImpl->pinned.end()) {
+    pImpl->TrimClasses(*it->second, ctx);
+  }
+}
+
+void BufferPool::SetMaxCachedBytes(size_t max_bytes) {
+  pImpl->max_cached_bytes = max_bytes;
+}
+
+size_t BufferPool::GetMaxCachedBytes() const {
+  return pImpl->max_cached_bytes;
+}
+
+BufferPoolStats BufferPool::GetStats() const {
+  BufferPoolStats stats;
+  stats.num_allocs = pImpl->num_allocs;
+  stats.num_hits = pImpl->num_hits;
+  stats.num_sys_allocs = pImpl->num_sys_allocs;
+  stats.num_sys_frees = pImpl->num_sys_frees;
+  stats.bytes_in_use = pImpl->bytes_in_use;
+  stats.bytes_cached = pImpl->bytes_cached;
+  stats.bytes_pinned = pImpl->bytes_pinned;
+  return stats;
+}
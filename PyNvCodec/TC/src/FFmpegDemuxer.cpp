@@ -13,6 +13,7 @@
 
 #include "FFmpegDemuxer.h"
 #include "NvCodecUtils.h"
+#include "Tasks.hpp"
 #include "libavutil/avstring.h"
 #include "libavutil/avutil.h"
 #include <iostream>
@@ -20,6 +21,7 @@
 #include <sstream>
 
 using namespace std;
+using namespace VPF;
 
 static string AvErrorToString(int av_error_code) {
   const auto buf_size = 1024U;
@@ -48,7 +50,10 @@ public:
 
 FFmpegDemuxer::FFmpegDemuxer(const char *szFilePath,
                              const map<string, string> &ffmpeg_options)
-    : FFmpegDemuxer(CreateFormatContext(szFilePath, ffmpeg_options)) {}
+    : FFmpegDemuxer(CreateFormatContext(szFilePath, ffmpeg_options)) {
+  file_path = szFilePath;
+  format_options = ffmpeg_options;
+}
 
 FFmpegDemuxer::FFmpegDemuxer(DataProvider *pDataProvider,
                              const map<string, string> &ffmpeg_options)
@@ -62,7 +67,11 @@ uint32_t FFmpegDemuxer::GetHeight() const { return height; }
 
 uint32_t FFmpegDemuxer::GetGopSize() const { return gop_size; }
 
-uint32_t FFmpegDemuxer::GetNumFrames() const {return nb_frames;}
+uint32_t FFmpegDemuxer::GetNumFrames() const {
+  // Container may not know number of frames, index always does;
+  auto index = GetSeekIndex();
+  return index ? index->GetNumFrames() : nb_frames;
+}
 
 double FFmpegDemuxer::GetFramerate() const { return framerate; }
 
@@ -79,6 +88,7 @@ AVColorRange FFmpegDemuxer::GetColorRange() const { return color_range; }
 bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
                           PacketData &pktData, uint8_t **ppSEI,
                           size_t *pSEIBytes) {
+  NvtxMark tick(__FUNCTION__);
   if (!fmtc) {
     return false;
   }
@@ -87,83 +97,32 @@ bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
     av_packet_unref(&pktSrc);
   }
 
-  if (!annexbBytes.empty()) {
-    annexbBytes.clear();
-  }
-
   if (!seiBytes.empty()) {
     seiBytes.clear();
   }
 
-  auto appendBytes = [](vector<uint8_t> &elementaryBytes, AVPacket &avPacket,
-                        AVPacket &avPacketOut, AVBSFContext *pAvbsfContext,
-                        int streamId, bool isFilteringNeeded) {
-    if (avPacket.stream_index != streamId) {
-      return;
-    }
-
-    if (isFilteringNeeded) {
-      if (avPacketOut.data) {
-        av_packet_unref(&avPacketOut);
-      }
-
-      av_bsf_send_packet(pAvbsfContext, &avPacket);
-      av_bsf_receive_packet(pAvbsfContext, &avPacketOut);
-
-      if (avPacketOut.data && avPacketOut.size) {
-        elementaryBytes.insert(elementaryBytes.end(), avPacketOut.data,
-                               avPacketOut.data + avPacketOut.size);
-      }
-    } else if (avPacket.data && avPacket.size) {
-      elementaryBytes.insert(elementaryBytes.end(), avPacket.data,
-                             avPacket.data + avPacket.size);
-    }
-  };
-
   int ret = 0;
   bool isDone = false, gotVideo = false;
 
   while (!isDone) {
-    ret = av_read_frame(fmtc, &pktSrc);
+    {
+      NvtxMark read_tick("av_read_frame");
+      ret = av_read_frame(fmtc, &pktSrc);
+    }
     gotVideo = (pktSrc.stream_index == videoStream);
     isDone = (ret < 0) || gotVideo;
 
-    if (pSEIBytes && ppSEI) {
-      // Bitstream filter lazy init;
-      // We don't do this in constructor as user may not be needing SEI
-      // extraction at all;
-      if (!bsfc_sei) {
-        cout << "Initializing SEI filter;" << endl;
-
-        // SEI has NAL type 6 for H.264 and NAL type 39 & 40 for H.265;
-        const string sei_filter =
-            is_mp4H264
-                ? "filter_units=pass_types=6"
-                : is_mp4HEVC ? "filter_units=pass_types=39-40" : "unknown";
-        ret = av_bsf_list_parse_str(sei_filter.c_str(), &bsfc_sei);
-        if (0 > ret) {
-          throw runtime_error("Error initializing " + sei_filter +
-                              " bitstream filter: " + AvErrorToString(ret));
-        }
-
-        ret = avcodec_parameters_copy(bsfc_sei->par_in,
-                                      fmtc->streams[videoStream]->codecpar);
-        if (0 != ret) {
-          throw runtime_error("Error copying codec parameters: " +
-                              AvErrorToString(ret));
-        }
-
-        ret = av_bsf_init(bsfc_sei);
-        if (0 != ret) {
-          throw runtime_error("Error initializing " + sei_filter +
-                              " bitstream filter: " + AvErrorToString(ret));
-        }
+    if (pSEIBytes && ppSEI && gotVideo) {
+      /* Most packets have no SEI at all, so NAL headers are scanned first
+       * instead of running every packet through filter;
+       */
+      const bool is_scanned =
+          (is_mp4H264 || is_mp4HEVC) &&
+          VPF::ExtractSeiNalUnits(pktSrc.data, pktSrc.size,
+                                  sei_scan_params, seiBytes);
+      if (!is_scanned) {
+        ExtractSeiBsf();
       }
-
-      // Extract SEI NAL units from packet;
-      auto pCopyPacket = av_packet_clone(&pktSrc);
-      appendBytes(seiBytes, *pCopyPacket, pktSei, bsfc_sei, videoStream, true);
-      av_packet_free(&pCopyPacket);
     }
 
     /* Unref non-desired packets as we don't support them yet;
@@ -180,11 +139,19 @@ bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
   }
 
   const bool bsf_needed = is_mp4H264 || is_mp4HEVC;
-  appendBytes(annexbBytes, pktSrc, pktDst, bsfc_annexb, videoStream,
-              bsf_needed);
+  av_packet_unref(&pktDst);
+
+  if (bsf_needed) {
+    NvtxMark bsf_tick("annexb_bsf");
+    av_bsf_send_packet(bsfc_annexb, &pktSrc);
+    av_bsf_receive_packet(bsfc_annexb, &pktDst);
+  }
 
-  pVideo = annexbBytes.data();
-  rVideoBytes = annexbBytes.size();
+  /* Packet data isn't copied, it's owned by packet until next call;
+   */
+  auto const pktOut = GetLastPacket();
+  pVideo = pktOut->data;
+  rVideoBytes = pktOut->data ? pktOut->size : 0U;
 
   /* Save packet props to PacketData, decoder will use it later.
    * If no BSF filters were applied, copy input packet props.
@@ -208,6 +175,11 @@ bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
   return true;
 }
 
+const AVPacket *FFmpegDemuxer::GetLastPacket() const {
+  // Annex.B filter output goes to pktDst;
+  return (is_mp4H264 || is_mp4HEVC) ? &pktDst : &pktSrc;
+}
+
 void FFmpegDemuxer::Flush() {
   avio_flush(fmtc->pb);
   avformat_flush(fmtc);
@@ -216,11 +188,18 @@ void FFmpegDemuxer::Flush() {
 bool FFmpegDemuxer::Seek(SeekContext &seekCtx, uint8_t *&pVideo,
                          size_t &rVideoBytes, PacketData &pktData,
                          uint8_t **ppSEI, size_t *pSEIBytes) {
+  NvtxMark tick(__FUNCTION__);
   if (!is_seekable) {
     cerr << "Seek isn't supported for this input." << endl;
     return false;
   }
 
+  auto index = GetSeekIndex();
+  if (index && SeekWithIndex(*index, seekCtx, pVideo, rVideoBytes, pktData,
+                             ppSEI, pSEIBytes)) {
+    return true;
+  }
+
   // Convert frame number to timestamp;
   auto frame_ts = [&](int64_t frame_num) {
     auto const ts_sec = (double)seekCtx.seek_frame / GetFramerate();
@@ -312,6 +291,175 @@ bool FFmpegDemuxer::Seek(SeekContext &seekCtx, uint8_t *&pVideo,
   return true;
 }
 
+bool FFmpegDemuxer::SeekWithIndex(const SeekIndex &index,
+                                  SeekContext &seekCtx, uint8_t *&pVideo,
+                                  size_t &rVideoBytes, PacketData &pktData,
+                                  uint8_t **ppSEI, size_t *pSEIBytes) {
+  SeekIndexEntry target, key;
+  if (!index.GetFrame(seekCtx.seek_frame, target) ||
+      !index.GetPrevKeyFrame(seekCtx.seek_frame, key)) {
+    return false;
+  }
+
+  if (EXACT_FRAME != seekCtx.mode && PREV_KEY_FRAME != seekCtx.mode) {
+    return false;
+  }
+  auto const &wanted = (EXACT_FRAME == seekCtx.mode) ? target : key;
+
+  // Container seek tables are indexed by dts;
+  auto ret = av_seek_frame(fmtc, videoStream, key.dts, AVSEEK_FLAG_BACKWARD);
+  if (ret < 0) {
+    return false;
+  }
+
+  /* Seek lands on key frame, wanted packet is within the same GOP,
+   * so it's found by reading packets without decoding;
+   */
+  do {
+    if (!Demux(pVideo, rVideoBytes, pktData, ppSEI, pSEIBytes)) {
+      return false;
+    }
+
+    auto const is_past_wanted =
+        AV_NOPTS_VALUE != pktData.dts && pktData.dts > wanted.dts;
+    if (is_past_wanted) {
+      return false;
+    }
+  } while (pktData.pts != wanted.pts);
+
+  seekCtx.out_frame_pts = pktData.pts;
+  seekCtx.out_frame_duration = pktData.duration;
+  return true;
+}
+
+shared_ptr<const SeekIndex> FFmpegDemuxer::GetSeekIndex() const {
+  lock_guard<mutex> lock(seek_index_lock);
+  return seek_index;
+}
+
+bool FFmpegDemuxer::IsSeekIndexReady() const {
+  return nullptr != GetSeekIndex();
+}
+
+shared_ptr<SeekIndex> FFmpegDemuxer::ScanSeekIndex() {
+  NvtxMark tick(__FUNCTION__);
+  AVDictionary *options = nullptr;
+  for (auto &pair : format_options) {
+    av_dict_set(&options, pair.first.c_str(), pair.second.c_str(), 0);
+  }
+
+  // Own format context, so that scan doesn't change demuxer position;
+  auto index = SeekIndex::ScanFile(file_path, options, videoStream,
+                                   &stop_index_scan);
+  av_dict_free(&options);
+
+  // Index is still usable if it can't be saved, e.g. for read-only dirs;
+  if (index) {
+    index->SaveForFile(file_path, videoStream);
+  }
+
+  return index;
+}
+
+bool FFmpegDemuxer::BuildSeekIndex(bool in_background) {
+  if (file_path.empty()) {
+    cerr << "Seek index is only supported for inputs opened by path." << endl;
+    return false;
+  }
+
+  lock_guard<mutex> build_lock(build_index_lock);
+  if (IsSeekIndexReady()) {
+    return true;
+  }
+
+  if (seek_index_thread.joinable()) {
+    if (!index_scan_failed) {
+      // Scan is still running;
+      return true;
+    }
+
+    seek_index_thread.join();
+    index_scan_failed = false;
+    cerr << "Can't build seek index for " << file_path << endl;
+    return false;
+  }
+
+  shared_ptr<SeekIndex> index = SeekIndex::LoadForFile(file_path, videoStream);
+  if (!index && !in_background) {
+    index = ScanSeekIndex();
+  }
+
+  if (index) {
+    lock_guard<mutex> lock(seek_index_lock);
+    seek_index = index;
+    return true;
+  } else if (!in_background) {
+    return false;
+  }
+
+  seek_index_thread = thread([this]() {
+    auto index = ScanSeekIndex();
+    if (index) {
+      lock_guard<mutex> lock(seek_index_lock);
+      seek_index = index;
+    } else {
+      index_scan_failed = true;
+    }
+  });
+
+  return true;
+}
+
+void FFmpegDemuxer::ExtractSeiBsf() {
+  NvtxMark tick(__FUNCTION__);
+  int ret = 0;
+
+  // Bitstream filter lazy init;
+  // We don't do this in constructor as user may not be needing SEI
+  // extraction at all;
+  if (!bsfc_sei) {
+    cout << "Initializing SEI filter;" << endl;
+
+    // SEI has NAL type 6 for H.264 and NAL type 39 & 40 for H.265;
+    const string sei_filter =
+        is_mp4H264
+            ? "filter_units=pass_types=6"
+            : is_mp4HEVC ? "filter_units=pass_types=39-40" : "unknown";
+    ret = av_bsf_list_parse_str(sei_filter.c_str(), &bsfc_sei);
+    if (0 > ret) {
+      throw runtime_error("Error initializing " + sei_filter +
+                          " bitstream filter: " + AvErrorToString(ret));
+    }
+
+    ret = avcodec_parameters_copy(bsfc_sei->par_in,
+                                  fmtc->streams[videoStream]->codecpar);
+    if (0 != ret) {
+      throw runtime_error("Error copying codec parameters: " +
+                          AvErrorToString(ret));
+    }
+
+    ret = av_bsf_init(bsfc_sei);
+    if (0 != ret) {
+      throw runtime_error("Error initializing " + sei_filter +
+                          " bitstream filter: " + AvErrorToString(ret));
+    }
+  }
+
+  // Extract SEI NAL units from packet;
+  if (pktSei.data) {
+    av_packet_unref(&pktSei);
+  }
+
+  auto pCopyPacket = av_packet_clone(&pktSrc);
+  av_bsf_send_packet(bsfc_sei, pCopyPacket);
+  av_bsf_receive_packet(bsfc_sei, &pktSei);
+  av_packet_free(&pCopyPacket);
+
+  if (pktSei.data && pktSei.size) {
+    seiBytes.insert(seiBytes.end(), pktSei.data, pktSei.data + pktSei.size);
+  }
+}
+
 int FFmpegDemuxer::ReadPacket(void *opaque, uint8_t *pBuf, int nBuf) {
   return ((DataProvider *)opaque)->GetData(pBuf, nBuf);
 }
@@ -319,6 +467,11 @@ int FFmpegDemuxer::ReadPacket(void *opaque, uint8_t *pBuf, int nBuf) {
 AVCodecID FFmpegDemuxer::GetVideoCodec() const { return eVideoCodec; }
 
 FFmpegDemuxer::~FFmpegDemuxer() {
+  stop_index_scan = true;
+  if (seek_index_thread.joinable()) {
+    seek_index_thread.join();
+  }
+
   if (pktSrc.data) {
     av_packet_unref(&pktSrc);
   }
@@ -330,7 +483,11 @@ FFmpegDemuxer::~FFmpegDemuxer() {
     av_bsf_free(&bsfc_annexb);
   }
 
-  if (bsfc_annexb) {
+  if (pktSei.data) {
+    av_packet_unref(&pktSei);
+  }
+
+  if (bsfc_sei) {
     av_bsf_free(&bsfc_sei);
   }
 
@@ -417,7 +574,8 @@ FFmpegDemuxer::CreateFormatContext(const char *szFilePath,
   return ctx;
 }
 
-FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
+FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx)
+    : fmtc(fmtcx), stop_index_scan(false), index_scan_failed(false) {
   pktSrc = {};
   pktDst = {};
 
@@ -503,6 +661,9 @@ FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
 
   // SEI extraction filter has lazy init as this feature is optional;
   bsfc_sei = nullptr;
+  auto const codecpar = fmtc->streams[videoStream]->codecpar;
+  sei_scan_params = VPF::GetNalScanParams(
+      codecpar->extradata, codecpar->extradata_size, is_mp4HEVC);
 
   /* Some inputs doesn't allow seek functionality.
    * Check this ahead of time. */
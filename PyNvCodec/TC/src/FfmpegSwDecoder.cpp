@@ -11,17 +11,24 @@
  * limitations under the License.
  */
 
+#include "HostPlaneCopy.hpp"
+#include "SeekIndex.hpp"
 #include "Tasks.hpp"
+#include <cstring>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/error.h>
+#include <libavutil/imgutils.h>
 #include <libavutil/motion_vector.h>
+#include <libavutil/pixdesc.h>
 }
 
 using namespace VPF;
@@ -50,6 +57,20 @@ namespace VPF {
 
 enum DECODE_STATUS { DEC_SUCCESS, DEC_ERROR, DEC_MORE, DEC_EOS };
 
+// Turns off pixels copy and brings it back even if decoding throws;
+class NoPixelsCopyGuard final {
+public:
+  explicit NoPixelsCopyGuard(bool &flag)
+      : copy_pixels(flag), was_copying(flag) {
+    copy_pixels = false;
+  }
+  ~NoPixelsCopyGuard() { copy_pixels = was_copying; }
+
+private:
+  bool &copy_pixels;
+  bool was_copying;
+};
+
 struct FfmpegDecodeFrame_Impl {
   AVFormatContext *fmt_ctx = nullptr;
   AVCodecContext *avctx = nullptr;
@@ -58,16 +79,33 @@ struct FfmpegDecodeFrame_Impl {
   AVCodec *p_codec = nullptr;
   AVPacket pktSrc = {0};
 
+  // Needed to load, scan and save frame index;
+  string url;
+  AVDictionary *format_options = nullptr;
+  shared_ptr<SeekIndex> seek_index;
+
   Buffer *dec_frame = nullptr;
   map<AVFrameSideDataType, Buffer *> side_data;
 
   int video_stream_idx = -1;
   bool end_encode = false;
+  // Set to false when pixels are accessed by reference to decoded frame;
+  bool copy_pixels = true;
+
+  // Properties of last decoded frame;
+  int width = 0;
+  int height = 0;
+  AVPixelFormat format = AV_PIX_FMT_NONE;
 
-  FfmpegDecodeFrame_Impl(const char *URL, AVDictionary *pOptions) {
+  FfmpegDecodeFrame_Impl(const char *URL, AVDictionary *pOptions,
+                         uint32_t num_threads, SwDecodeThreadType thread_type)
+      : url(URL) {
 
     av_register_all();
 
+    // Open consumes options, so keep own copy for index scan;
+    av_dict_copy(&format_options, pOptions, 0);
+
     auto res = avformat_open_input(&fmt_ctx, URL, NULL, &pOptions);
     if (res < 0) {
       stringstream ss;
@@ -114,6 +152,11 @@ struct FfmpegDecodeFrame_Impl {
       throw runtime_error(ss.str());
     }
 
+    // Options passed in pOptions are applied by avcodec_open2 afterwards,
+    // so explicit "threads" & "thread_type" options will override these;
+    avctx->thread_count = GetThreadCount(num_threads);
+    avctx->thread_type = (int)thread_type;
+
     res = avcodec_open2(avctx, p_codec, &pOptions);
     if (res < 0) {
       stringstream ss;
@@ -131,54 +174,261 @@ struct FfmpegDecodeFrame_Impl {
     }
   }
 
-  bool SaveYUV420(AVFrame *pframe) {
+  static int GetThreadCount(uint32_t num_threads) {
+    if (num_threads) {
+      return (int)num_threads;
+    }
+
+    /* Same upper limit as libavcodec uses for automatic thread count;
+     * Frame threading adds one frame of latency per thread and gives
+     * diminishing returns beyond that;
+     */
+    const uint32_t max_auto_threads = 16U;
+    auto num_cores = thread::hardware_concurrency();
+    if (!num_cores) {
+      // Let libavcodec detect it;
+      return 0;
+    }
+
+    return (int)min(num_cores, max_auto_threads);
+  }
+
+  /* Returns number of planes and fills plane width in bytes & height in
+   * lines for every plane; Returns 0 for formats which can't be packed;
+   */
+  static int GetPlanesLayout(AVPixelFormat format, int width, int height,
+                             int widths[4], int heights[4]) {
+    auto desc = av_pix_fmt_desc_get(format);
+    if (!desc) {
+      return 0;
+    }
+
+    // Hardware surfaces, palettes & bitstream formats aren't raw pixels;
+    auto const unsupported =
+        AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM;
+    if (desc->flags & unsupported) {
+      return 0;
+    }
+
+    auto num_planes = av_pix_fmt_count_planes(format);
+    for (auto plane = 0; plane < num_planes; plane++) {
+      widths[plane] = av_image_get_linesize(format, width, plane);
+      if (widths[plane] <= 0) {
+        return 0;
+      }
+
+      // Only chroma planes are subsampled, alpha plane is not;
+      auto const is_chroma = (1 == plane) || (2 == plane);
+      heights[plane] =
+          is_chroma ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+    }
+
+    return num_planes;
+  }
+
+  // Size of packed frame, 0 for formats which can't be packed;
+  static size_t GetPackedSize(AVPixelFormat format, int width, int height) {
+    int widths[4] = {0}, heights[4] = {0};
+    auto num_planes = GetPlanesLayout(format, width, height, widths, heights);
+
+    size_t size = 0U;
+    for (auto plane = 0; plane < num_planes; plane++) {
+      size += (size_t)widths[plane] * heights[plane];
+    }
+    return size;
+  }
+
+  // Packs planes one after another without padding;
+  static bool PackPlanes(const AVFrame *pframe, uint8_t *dst, size_t size) {
+    auto const format = (AVPixelFormat)pframe->format;
+    int widths[4] = {0}, heights[4] = {0};
+    auto num_planes =
+        GetPlanesLayout(format, pframe->width, pframe->height, widths, heights);
+    if (!num_planes ||
+        size != GetPackedSize(format, pframe->width, pframe->height)) {
+      return false;
+    }
+
+    for (auto plane = 0; plane < num_planes; plane++) {
+      CopyPlaneHost(dst, widths[plane], pframe->data[plane],
+                    pframe->linesize[plane], widths[plane], heights[plane]);
+      dst += (size_t)widths[plane] * heights[plane];
+    }
+
+    return true;
+  }
+
+  bool SavePlanes(AVFrame *pframe) {
+    NvtxMark tick(__FUNCTION__);
     // Detect frame size & allocate memory if necessary;
-    size_t size = frame->width * frame->height * 3 / 2;
+    auto const size = GetPackedSize((AVPixelFormat)pframe->format,
+                                    pframe->width, pframe->height);
+    if (!size) {
+      return false;
+    }
 
     if (!dec_frame) {
       dec_frame = Buffer::MakeOwnMem(size);
     } else if (size != dec_frame->GetRawMemSize()) {
-      delete dec_frame;
-      dec_frame = Buffer::MakeOwnMem(size);
+      // Keeps capacity, so resolution changes don't reallocate every time;
+      dec_frame->Update(size);
     }
 
-    // Copy pixels;
-    auto plane = 0U;
-    auto *dst = dec_frame->GetDataAs<uint8_t>();
+    return PackPlanes(pframe, dec_frame->GetDataAs<uint8_t>(), size);
+  }
 
-    for (plane = 0; plane < 3; plane++) {
-      auto *src = frame->data[plane];
-      auto width = (0 == plane) ? frame->width : frame->width / 2;
-      auto height = (0 == plane) ? frame->height : frame->height / 2;
+  bool BuildSeekIndex() {
+    if (seek_index) {
+      return true;
+    }
 
-      for (int i = 0; i < height; i++) {
-        memcpy(dst, src, width);
-        dst += width;
-        src += frame->linesize[plane];
-      }
+    seek_index = SeekIndex::LoadForFile(url, video_stream_idx);
+    if (seek_index) {
+      return true;
+    }
+
+    /* Scan has own format context, so decoder read position and frames
+     * buffered in it stay untouched;
+     */
+    seek_index = SeekIndex::ScanFile(url, format_options, video_stream_idx);
+    if (!seek_index) {
+      cerr << "Can't build frame index for " << url << endl;
+      return false;
     }
 
+    // Index is still usable if it can't be saved, e.g. for read-only dirs;
+    seek_index->SaveForFile(url, video_stream_idx);
     return true;
   }
 
+  bool SeekToKeyFrame(const SeekIndexEntry &key) {
+    NvtxMark tick(__FUNCTION__);
+    // Container seek tables are indexed by dts;
+    auto res = av_seek_frame(fmt_ctx, video_stream_idx, key.dts,
+                             AVSEEK_FLAG_BACKWARD);
+    if (res < 0) {
+      cerr << "Error seeking for frame: " << AvErrorToString(res) << endl;
+      return false;
+    }
+
+    avcodec_flush_buffers(avctx);
+    end_encode = false;
+    return true;
+  }
+
+  /* Decodes till frame with given number, frames before it are dropped;
+   * Returns false if there's no such frame;
+   */
+  bool DecodeTillFrame(int64_t frame_num, int64_t &last_frame_num) {
+    while (DecodeSingleFrame()) {
+      auto const num = seek_index->GetFrameNum(frame->best_effort_timestamp);
+      if (num < 0) {
+        continue;
+      }
+
+      last_frame_num = num;
+      if (num == frame_num) {
+        return true;
+      } else if (num > frame_num) {
+        cerr << "Frame " << frame_num << " wasn't found in stream" << endl;
+        return false;
+      }
+    }
+
+    return false;
+  }
+
+  bool DecodeFrames(const vector<int64_t> &frame_nums, uint8_t *dst,
+                    size_t frame_size) {
+    NvtxMark tick(__FUNCTION__);
+    if (frame_nums.empty()) {
+      return true;
+    }
+
+    if (!BuildSeekIndex()) {
+      return false;
+    }
+
+    // Unique frame numbers in ascending order & their places in output;
+    map<int64_t, vector<size_t>> wanted;
+    for (size_t i = 0U; i < frame_nums.size(); i++) {
+      wanted[frame_nums[i]].push_back(i);
+    }
+
+    // Only requested frames are copied;
+    NoPixelsCopyGuard no_copy(copy_pixels);
+
+    auto res = true;
+    int64_t last_frame_num = -1;
+    for (auto const &it : wanted) {
+      SeekIndexEntry key;
+      if (!seek_index->GetPrevKeyFrame(it.first, key)) {
+        cerr << "Frame " << it.first << " is out of range" << endl;
+        res = false;
+        break;
+      }
+
+      /* Seek only if frame belongs to GOP after the one being decoded,
+       * frames of current GOP are reached by decoding further;
+       */
+      auto const key_frame_num = seek_index->GetFrameNum(key.pts);
+      auto const need_seek =
+          (last_frame_num < 0) || (key_frame_num > last_frame_num + 1);
+      if (need_seek && !SeekToKeyFrame(key)) {
+        res = false;
+        break;
+      }
+
+      if (!DecodeTillFrame(it.first, last_frame_num)) {
+        res = false;
+        break;
+      }
+
+      auto frame_dst = dst + it.second[0] * frame_size;
+      if (!PackPlanes(frame, frame_dst, frame_size)) {
+        cerr << "Frame " << it.first << " doesn't fit into " << frame_size
+             << " bytes" << endl;
+        res = false;
+        break;
+      }
+
+      // Same frame may be requested more than once;
+      for (size_t i = 1U; i < it.second.size(); i++) {
+        memcpy(dst + it.second[i] * frame_size, frame_dst, frame_size);
+      }
+    }
+
+    return res;
+  }
+
   bool DecodeSingleFrame() {
+    NvtxMark tick(__FUNCTION__);
     if (end_encode) {
-      return false;
+      /* Decoder is in draining mode; With frame threading enabled it holds
+       * up to thread_count frames, collect them one by one;
+       */
+      return DEC_SUCCESS == ReceiveSingleFrame();
     }
 
     // Send packets to decoder until it outputs frame;
     do {
       // Read packets from stream until we find a video packet;
       do {
-        auto ret = av_read_frame(fmt_ctx, &pktSrc);
+        av_packet_unref(&pktSrc);
+        auto ret = 0;
+        {
+          NvtxMark read_tick("av_read_frame");
+          ret = av_read_frame(fmt_ctx, &pktSrc);
+        }
         if (ret < 0) {
           // Flush decoder;
           end_encode = true;
-          return DecodeSinglePacket(nullptr);
+          return DEC_SUCCESS == DecodeSinglePacket(nullptr);
         }
       } while (pktSrc.stream_index != video_stream_idx);
 
       auto status = DecodeSinglePacket(&pktSrc);
+      av_packet_unref(&pktSrc);
 
       switch (status) {
       case DEC_SUCCESS:
@@ -196,12 +446,14 @@ struct FfmpegDecodeFrame_Impl {
   }
 
   bool SaveVideoFrame(AVFrame *frame) {
-    // Only YUV420P is supported so far;
-    if (AV_PIX_FMT_YUV420P != frame->format) {
+    if (!SavePlanes(frame)) {
+      cerr << "Can't save frame in "
+           << av_get_pix_fmt_name((AVPixelFormat)frame->format)
+           << " pixel format" << endl;
       return false;
     }
 
-    return SaveYUV420(frame);
+    return true;
   }
 
   void SaveMotionVectors(AVFrame *frame) {
@@ -228,36 +480,52 @@ struct FfmpegDecodeFrame_Impl {
   }
 
   DECODE_STATUS DecodeSinglePacket(const AVPacket *pktSrc) {
-    auto res = avcodec_send_packet(avctx, pktSrc);
+    auto res = 0;
+    {
+      NvtxMark send_tick("avcodec_send_packet");
+      res = avcodec_send_packet(avctx, pktSrc);
+    }
     if (res < 0) {
       cerr << "Error while sending a packet to the decoder" << endl;
       cerr << "Error description: " << AvErrorToString(res) << endl;
       return DEC_ERROR;
     }
 
-    while (res >= 0) {
-      res = avcodec_receive_frame(avctx, frame);
-      if (res == AVERROR_EOF) {
-        cerr << "Input file is over" << endl;
-        return DEC_EOS;
-      } else if (res == AVERROR(EAGAIN)) {
-        return DEC_MORE;
-      } else if (res < 0) {
-        cerr << "Error while receiving a frame from the decoder" << endl;
-        cerr << "Error description: " << AvErrorToString(res) << endl;
-        return DEC_ERROR;
-      }
+    return ReceiveSingleFrame();
+  }
 
-      SaveVideoFrame(frame);
-      SaveSideData(frame);
-      return DEC_SUCCESS;
+  DECODE_STATUS ReceiveSingleFrame() {
+    auto res = 0;
+    {
+      NvtxMark receive_tick("avcodec_receive_frame");
+      res = avcodec_receive_frame(avctx, frame);
+    }
+    if (res == AVERROR_EOF) {
+      cerr << "Input file is over" << endl;
+      return DEC_EOS;
+    } else if (res == AVERROR(EAGAIN)) {
+      return DEC_MORE;
+    } else if (res < 0) {
+      cerr << "Error while receiving a frame from the decoder" << endl;
+      cerr << "Error description: " << AvErrorToString(res) << endl;
+      return DEC_ERROR;
     }
 
+    width = frame->width;
+    height = frame->height;
+    format = (AVPixelFormat)frame->format;
+
+    if (copy_pixels && !SaveVideoFrame(frame)) {
+      return DEC_ERROR;
+    }
+    SaveSideData(frame);
     return DEC_SUCCESS;
   }
 
   ~FfmpegDecodeFrame_Impl() {
+    av_packet_unref(&pktSrc);
     avformat_close_input(&fmt_ctx);
+    av_dict_free(&format_options);
     av_frame_free(&frame);
 
     for (auto &output : side_data) {
@@ -275,6 +543,7 @@ struct FfmpegDecodeFrame_Impl {
 } // namespace VPF
 
 TaskExecStatus FfmpegDecodeFrame::Run() {
+  NvtxMark tick(__FUNCTION__);
   ClearOutputs();
 
   if (pImpl->DecodeSingleFrame()) {
@@ -296,16 +565,90 @@ TaskExecStatus FfmpegDecodeFrame::GetSideData(AVFrameSideDataType data_type) {
   return TaskExecStatus::TASK_EXEC_FAIL;
 }
 
+AVFrame *FfmpegDecodeFrame::DecodeFrameRef() {
+  ClearOutputs();
+
+  NoPixelsCopyGuard no_copy(pImpl->copy_pixels);
+  auto res = pImpl->DecodeSingleFrame();
+
+  /* Decoder unreferences frame on next receive call, so cloned reference
+   * keeps frame buffers alive until caller releases them;
+   */
+  return res ? av_frame_clone(pImpl->frame) : nullptr;
+}
+
+uint32_t FfmpegDecodeFrame::GetWidth() const {
+  return (uint32_t)pImpl->width;
+}
+
+uint32_t FfmpegDecodeFrame::GetHeight() const {
+  return (uint32_t)pImpl->height;
+}
+
+AVPixelFormat FfmpegDecodeFrame::GetPixelFormat() const {
+  return pImpl->format;
+}
+
+size_t FfmpegDecodeFrame::GetFrameSize() const {
+  // Stream parameters are used until first frame is decoded;
+  if (AV_PIX_FMT_NONE == pImpl->format) {
+    return FfmpegDecodeFrame_Impl::GetPackedSize(
+        pImpl->avctx->pix_fmt, pImpl->avctx->width, pImpl->avctx->height);
+  }
+
+  return FfmpegDecodeFrame_Impl::GetPackedSize(pImpl->format, pImpl->width,
+                                               pImpl->height);
+}
+
+size_t FfmpegDecodeFrame::GetFrameRowSize() const {
+  auto const format = (AV_PIX_FMT_NONE == pImpl->format) ? pImpl->avctx->pix_fmt
+                                                         : pImpl->format;
+  auto const width = (AV_PIX_FMT_NONE == pImpl->format) ? pImpl->avctx->width
+                                                        : pImpl->width;
+  auto const row_size = av_image_get_linesize(format, width, 0);
+  return row_size > 0 ? (size_t)row_size : 0U;
+}
+
+bool FfmpegDecodeFrame::DecodeFrames(const vector<int64_t> &frame_nums,
+                                     uint8_t *dst, size_t frame_size) {
+  ClearOutputs();
+  return pImpl->DecodeFrames(frame_nums, dst, frame_size);
+}
+
+uint32_t FfmpegDecodeFrame::GetNumFrames(bool exact) {
+  if (!pImpl->seek_index && !exact) {
+    // Cheap guess, container may not know it;
+    auto const nb_frames = pImpl->video_stream->nb_frames;
+    return nb_frames > 0 ? (uint32_t)nb_frames : 0U;
+  }
+
+  return pImpl->BuildSeekIndex() ? pImpl->seek_index->GetNumFrames() : 0U;
+}
+
+uint32_t FfmpegDecodeFrame::GetNumThreads() const {
+  return (uint32_t)pImpl->avctx->thread_count;
+}
+
+SwDecodeThreadType FfmpegDecodeFrame::GetThreadType() const {
+  // Type which codec actually uses, not the requested one;
+  return (SwDecodeThreadType)pImpl->avctx->active_thread_type;
+}
+
 FfmpegDecodeFrame *FfmpegDecodeFrame::Make(const char *URL,
-                                           NvDecoderClInterface &cli_iface) {
-  return new FfmpegDecodeFrame(URL, cli_iface);
+                                           NvDecoderClInterface &cli_iface,
+                                           uint32_t num_threads,
+                                           SwDecodeThreadType thread_type) {
+  return new FfmpegDecodeFrame(URL, cli_iface, num_threads, thread_type);
 }
 
 FfmpegDecodeFrame::FfmpegDecodeFrame(const char *URL,
-                                     NvDecoderClInterface &cli_iface)
+                                     NvDecoderClInterface &cli_iface,
+                                     uint32_t num_threads,
+                                     SwDecodeThreadType thread_type)
     : Task("FfmpegDecodeFrame", FfmpegDecodeFrame::num_inputs,
            FfmpegDecodeFrame::num_outputs) {
-  pImpl = new FfmpegDecodeFrame_Impl(URL, cli_iface.GetOptions());
+  pImpl = new FfmpegDecodeFrame_Impl(URL, cli_iface.GetOptions(), num_threads,
+                                     thread_type);
 }
 
 FfmpegDecodeFrame::~FfmpegDecodeFrame() { delete pImpl; }
\ No newline at end of file
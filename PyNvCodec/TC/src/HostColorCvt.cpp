@@ -0,0 +1,1023 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostColorCvt.hpp"
+#include "HostPlaneCopy.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||          \
+    defined(_M_IX86)
+#define VPF_HOST_CVT_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define VPF_HOST_CVT_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace VPF;
+using namespace std;
+
+/* All kernels do fixed point math in 16 bit lanes the same way, so SIMD
+ * and scalar results are bit-exact; Scalar code mimics saturating adds
+ * and rounding multiplies of SIMD instructions;
+ */
+struct YuvToRgbCoeffs {
+  // Luma gain applied to Y * 257 as high half of product, result is Q6;
+  uint16_t y_gain;
+  // Q6 luma offset with rounding term;
+  int16_t y_bias;
+  // Q13 chroma gains, green ones are subtracted;
+  int16_t r_cr;
+  int16_t g_cb;
+  int16_t g_cr;
+  int16_t b_cb;
+};
+
+struct RgbToYuvCoeffs {
+  // Q15 gains in order of input channels;
+  int16_t y[3];
+  int16_t u[3];
+  int16_t v[3];
+  // Q7 offsets with rounding term;
+  int16_t y_bias;
+  int16_t uv_bias;
+};
+
+static void GetLumaWeights(const ColorspaceConversionContext *pCtx,
+                           double &kr, double &kb) {
+  if (pCtx && BT_709 == pCtx->color_space) {
+    kr = 0.2126;
+    kb = 0.0722;
+  } else {
+    kr = 0.299;
+    kb = 0.114;
+  }
+}
+
+static bool IsFullRange(const ColorspaceConversionContext *pCtx) {
+  return pCtx && JPEG == pCtx->color_range;
+}
+
+static int16_t ToFixed(double value, int frac_bits) {
+  return (int16_t)lround(value * (1 << frac_bits));
+}
+
+static YuvToRgbCoeffs
+MakeYuvToRgbCoeffs(const ColorspaceConversionContext *pCtx) {
+  double kr, kb;
+  GetLumaWeights(pCtx, kr, kb);
+  auto const kg = 1.0 - kr - kb;
+
+  auto const is_full = IsFullRange(pCtx);
+  auto const y_scale = is_full ? 1.0 : 255.0 / 219.0;
+  auto const c_scale = is_full ? 1.0 : 255.0 / 224.0;
+  auto const y_offset = is_full ? 0.0 : 16.0;
+
+  YuvToRgbCoeffs c;
+  c.y_gain = (uint16_t)lround(y_scale * 64.0 * 65536.0 / 257.0);
+  c.y_bias = (int16_t)(lround(-y_offset * y_scale * 64.0) + 32);
+  c.r_cr = ToFixed(2.0 * (1.0 - kr) * c_scale, 13);
+  c.g_cb = ToFixed(2.0 * kb * (1.0 - kb) / kg * c_scale, 13);
+  c.g_cr = ToFixed(2.0 * kr * (1.0 - kr) / kg * c_scale, 13);
+  c.b_cb = ToFixed(2.0 * (1.0 - kb) * c_scale, 13);
+  return c;
+}
+
+// BGR input is handled by swapping red and blue gains;
+static RgbToYuvCoeffs
+MakeRgbToYuvCoeffs(const ColorspaceConversionContext *pCtx, bool is_bgr) {
+  double kr, kb;
+  GetLumaWeights(pCtx, kr, kb);
+  auto const kg = 1.0 - kr - kb;
+
+  auto const is_full = IsFullRange(pCtx);
+  auto const y_scale = is_full ? 1.0 : 219.0 / 255.0;
+  auto const c_scale = is_full ? 1.0 : 224.0 / 255.0;
+  auto const y_offset = is_full ? 0 : 16;
+
+  const double y[] = {kr, kg, kb};
+  const double u[] = {-kr / (2.0 * (1.0 - kb)), -kg / (2.0 * (1.0 - kb)), 0.5};
+  const double v[] = {0.5, -kg / (2.0 * (1.0 - kr)), -kb / (2.0 * (1.0 - kr))};
+
+  RgbToYuvCoeffs c;
+  for (int i = 0; i < 3; i++) {
+    auto const ch = is_bgr ? 2 - i : i;
+    c.y[i] = ToFixed(y[ch] * y_scale, 15);
+    c.u[i] = ToFixed(u[ch] * c_scale, 15);
+    c.v[i] = ToFixed(v[ch] * c_scale, 15);
+  }
+  c.y_bias = (int16_t)(y_offset * 128 + 64);
+  c.uv_bias = (int16_t)(128 * 128 + 64);
+  return c;
+}
+
+static inline int SatS16(int value) {
+  return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+static inline uint8_t SatU8(int value) {
+  return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Same as _mm_mulhrs_epi16 and vqrdmulhq_s16;
+static inline int MulHrs(int a, int b) { return (a * b + 0x4000) >> 15; }
+
+static inline void YuvToRgbPixel(uint8_t y, uint8_t u, uint8_t v,
+                                 const YuvToRgbCoeffs &c, uint8_t *rgb,
+                                 bool is_bgr) {
+  auto const luma = (int)(((uint32_t)y * 257U * c.y_gain) >> 16) + c.y_bias;
+  auto const cb = ((int)u - 128) * 256;
+  auto const cr = ((int)v - 128) * 256;
+
+  auto const r = SatS16(luma + MulHrs(cr, c.r_cr));
+  auto const g =
+      SatS16(SatS16(luma - MulHrs(cb, c.g_cb)) - MulHrs(cr, c.g_cr));
+  auto const b = SatS16(luma + MulHrs(cb, c.b_cb));
+
+  rgb[is_bgr ? 2 : 0] = SatU8(r >> 6);
+  rgb[1] = SatU8(g >> 6);
+  rgb[is_bgr ? 0 : 2] = SatU8(b >> 6);
+}
+
+static inline uint8_t Dot3(const int (&x)[3], const int16_t (&k)[3],
+                           int16_t bias) {
+  auto sum = SatS16(bias + MulHrs(x[0] << 7, k[0]));
+  sum = SatS16(sum + MulHrs(x[1] << 7, k[1]));
+  sum = SatS16(sum + MulHrs(x[2] << 7, k[2]));
+  return SatU8(sum >> 7);
+}
+
+static void I420ToRgbRowScalar(const uint8_t *y, const uint8_t *u,
+                               const uint8_t *v, uint8_t *rgb, uint32_t width,
+                               const YuvToRgbCoeffs &c, bool is_bgr) {
+  for (uint32_t x = 0; x < width; x++) {
+    YuvToRgbPixel(y[x], u[x / 2], v[x / 2], c, rgb + 3 * x, is_bgr);
+  }
+}
+
+static void Nv12ToRgbRowScalar(const uint8_t *y, const uint8_t *uv,
+                               uint8_t *rgb, uint32_t width,
+                               const YuvToRgbCoeffs &c, bool is_bgr) {
+  for (uint32_t x = 0; x < width; x++) {
+    auto const pair = uv + (x & ~1U);
+    YuvToRgbPixel(y[x], pair[0], pair[1], c, rgb + 3 * x, is_bgr);
+  }
+}
+
+static void RgbToYRowScalar(const uint8_t *rgb, uint8_t *y, uint32_t width,
+                            const RgbToYuvCoeffs &c) {
+  for (uint32_t x = 0; x < width; x++, rgb += 3) {
+    const int px[] = {rgb[0], rgb[1], rgb[2]};
+    y[x] = Dot3(px, c.y, c.y_bias);
+  }
+}
+
+// Chroma is taken from 2x2 average of input pixels;
+static void RgbToUvRowScalar(const uint8_t *rgb0, const uint8_t *rgb1,
+                             uint8_t *u, uint8_t *v, uint32_t width,
+                             const RgbToYuvCoeffs &c) {
+  for (uint32_t x = 0; x < width / 2; x++, rgb0 += 6, rgb1 += 6) {
+    int avg[3];
+    for (int ch = 0; ch < 3; ch++) {
+      avg[ch] = (rgb0[ch] + rgb0[ch + 3] + rgb1[ch] + rgb1[ch + 3] + 2) >> 2;
+    }
+    u[x] = Dot3(avg, c.u, c.uv_bias);
+    v[x] = Dot3(avg, c.v, c.uv_bias);
+  }
+}
+
+static void SplitUvRowScalar(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                             uint32_t num_pairs) {
+  for (uint32_t i = 0; i < num_pairs; i++) {
+    u[i] = uv[2 * i];
+    v[i] = uv[2 * i + 1];
+  }
+}
+
+static void MergeUvRowScalar(const uint8_t *u, const uint8_t *v, uint8_t *uv,
+                             uint32_t num_pairs) {
+  for (uint32_t i = 0; i < num_pairs; i++) {
+    uv[2 * i] = u[i];
+    uv[2 * i + 1] = v[i];
+  }
+}
+
+static void SplitRgbRowScalar(const uint8_t *rgb, uint8_t *r, uint8_t *g,
+                              uint8_t *b, uint32_t width) {
+  for (uint32_t x = 0; x < width; x++, rgb += 3) {
+    r[x] = rgb[0];
+    g[x] = rgb[1];
+    b[x] = rgb[2];
+  }
+}
+
+static void SwapRbRowScalar(const uint8_t *src, uint8_t *dst, uint32_t width) {
+  for (uint32_t x = 0; x < width; x++, src += 3, dst += 3) {
+    // Source and destination may be the same;
+    auto const r = src[0];
+    dst[0] = src[2];
+    dst[1] = src[1];
+    dst[2] = r;
+  }
+}
+
+#if defined(VPF_HOST_CVT_X86)
+/* pshufb masks for 16 packed 3 channel pixels which take 3 vectors;
+ * Every output vector is OR of 3 shuffled input vectors;
+ */
+struct Rgb3Masks {
+  // [input block][channel], gather channel bytes from block;
+  uint8_t load[3][3][16];
+  // [output block][channel], place channel bytes into block;
+  uint8_t store[3][3][16];
+
+  Rgb3Masks() {
+    for (int block = 0; block < 3; block++) {
+      for (int ch = 0; ch < 3; ch++) {
+        for (int i = 0; i < 16; i++) {
+          auto const src_byte = 3 * i + ch;
+          load[block][ch][i] =
+              src_byte / 16 == block ? (uint8_t)(src_byte % 16) : 0x80;
+
+          auto const dst_byte = 16 * block + i;
+          store[block][ch][i] =
+              dst_byte % 3 == ch ? (uint8_t)(dst_byte / 3) : 0x80;
+        }
+      }
+    }
+  }
+};
+
+static const Rgb3Masks rgb3_masks;
+
+typedef __m128i Rgb3Shuffle[3][3];
+
+TARGET_AVX2 static inline void LoadMasks(const uint8_t (&src)[3][3][16],
+                                         Rgb3Shuffle &dst) {
+  for (int block = 0; block < 3; block++) {
+    for (int ch = 0; ch < 3; ch++) {
+      dst[block][ch] = _mm_loadu_si128((const __m128i *)src[block][ch]);
+    }
+  }
+}
+
+TARGET_AVX2 static inline void LoadRgb16(const uint8_t *src,
+                                         const Rgb3Shuffle &m, __m128i &r,
+                                         __m128i &g, __m128i &b) {
+  const __m128i in[] = {_mm_loadu_si128((const __m128i *)src + 0),
+                        _mm_loadu_si128((const __m128i *)src + 1),
+                        _mm_loadu_si128((const __m128i *)src + 2)};
+  __m128i *out[] = {&r, &g, &b};
+  for (int ch = 0; ch < 3; ch++) {
+    *out[ch] = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(in[0], m[0][ch]),
+                     _mm_shuffle_epi8(in[1], m[1][ch])),
+        _mm_shuffle_epi8(in[2], m[2][ch]));
+  }
+}
+
+TARGET_AVX2 static inline void StoreRgb16(uint8_t *dst, const Rgb3Shuffle &m,
+                                          __m128i r, __m128i g, __m128i b) {
+  for (int block = 0; block < 3; block++) {
+    auto const out =
+        _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, m[block][0]),
+                                  _mm_shuffle_epi8(g, m[block][1])),
+                     _mm_shuffle_epi8(b, m[block][2]));
+    _mm_storeu_si128((__m128i *)dst + block, out);
+  }
+}
+
+// Arithmetic shift and saturating pack of 16 lanes into 16 bytes;
+TARGET_AVX2 static inline __m128i PackQ6(__m256i value) {
+  value = _mm256_srai_epi16(value, 6);
+  return _mm_packus_epi16(_mm256_castsi256_si128(value),
+                          _mm256_extracti128_si256(value, 1));
+}
+
+TARGET_AVX2 static inline __m128i PackQ7(__m256i value) {
+  value = _mm256_srai_epi16(value, 7);
+  return _mm_packus_epi16(_mm256_castsi256_si128(value),
+                          _mm256_extracti128_si256(value, 1));
+}
+
+struct YuvToRgbAvx2 {
+  __m256i y_gain;
+  __m256i y_bias;
+  __m256i r_cr;
+  __m256i g_cb;
+  __m256i g_cr;
+  __m256i b_cb;
+  __m256i c_offset;
+  Rgb3Shuffle store;
+};
+
+TARGET_AVX2 static inline void InitYuvToRgbAvx2(const YuvToRgbCoeffs &c,
+                                                YuvToRgbAvx2 &k) {
+  k.y_gain = _mm256_set1_epi16((short)c.y_gain);
+  k.y_bias = _mm256_set1_epi16(c.y_bias);
+  k.r_cr = _mm256_set1_epi16(c.r_cr);
+  k.g_cb = _mm256_set1_epi16(c.g_cb);
+  k.g_cr = _mm256_set1_epi16(c.g_cr);
+  k.b_cb = _mm256_set1_epi16(c.b_cb);
+  k.c_offset = _mm256_set1_epi16(128);
+  LoadMasks(rgb3_masks.store, k.store);
+}
+
+// Converts 16 pixels, chroma samples are already duplicated;
+TARGET_AVX2 static inline void YuvToRgb16(const uint8_t *y, __m128i u,
+                                          __m128i v, uint8_t *rgb,
+                                          const YuvToRgbAvx2 &k, bool is_bgr) {
+  auto luma = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)y));
+  luma = _mm256_or_si256(luma, _mm256_slli_epi16(luma, 8));
+  luma = _mm256_add_epi16(_mm256_mulhi_epu16(luma, k.y_gain), k.y_bias);
+
+  auto const cb = _mm256_slli_epi16(
+      _mm256_sub_epi16(_mm256_cvtepu8_epi16(u), k.c_offset), 8);
+  auto const cr = _mm256_slli_epi16(
+      _mm256_sub_epi16(_mm256_cvtepu8_epi16(v), k.c_offset), 8);
+
+  auto const r = _mm256_adds_epi16(luma, _mm256_mulhrs_epi16(cr, k.r_cr));
+  auto const g = _mm256_subs_epi16(
+      _mm256_subs_epi16(luma, _mm256_mulhrs_epi16(cb, k.g_cb)),
+      _mm256_mulhrs_epi16(cr, k.g_cr));
+  auto const b = _mm256_adds_epi16(luma, _mm256_mulhrs_epi16(cb, k.b_cb));
+
+  if (is_bgr) {
+    StoreRgb16(rgb, k.store, PackQ6(b), PackQ6(g), PackQ6(r));
+  } else {
+    StoreRgb16(rgb, k.store, PackQ6(r), PackQ6(g), PackQ6(b));
+  }
+}
+
+TARGET_AVX2 static void I420ToRgbRowAvx2(const uint8_t *y, const uint8_t *u,
+                                         const uint8_t *v, uint8_t *rgb,
+                                         uint32_t width,
+                                         const YuvToRgbCoeffs &c,
+                                         bool is_bgr) {
+  YuvToRgbAvx2 k;
+  InitYuvToRgbAvx2(c, k);
+
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const u8 = _mm_loadl_epi64((const __m128i *)(u + x / 2));
+    auto const v8 = _mm_loadl_epi64((const __m128i *)(v + x / 2));
+    YuvToRgb16(y + x, _mm_unpacklo_epi8(u8, u8), _mm_unpacklo_epi8(v8, v8),
+               rgb + 3 * x, k, is_bgr);
+  }
+
+  I420ToRgbRowScalar(y + x, u + x / 2, v + x / 2, rgb + 3 * x, width - x, c,
+                     is_bgr);
+}
+
+TARGET_AVX2 static void Nv12ToRgbRowAvx2(const uint8_t *y, const uint8_t *uv,
+                                         uint8_t *rgb, uint32_t width,
+                                         const YuvToRgbCoeffs &c,
+                                         bool is_bgr) {
+  YuvToRgbAvx2 k;
+  InitYuvToRgbAvx2(c, k);
+  auto const dup_u =
+      _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+  auto const dup_v =
+      _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const pairs = _mm_loadu_si128((const __m128i *)(uv + x));
+    YuvToRgb16(y + x, _mm_shuffle_epi8(pairs, dup_u),
+               _mm_shuffle_epi8(pairs, dup_v), rgb + 3 * x, k, is_bgr);
+  }
+
+  Nv12ToRgbRowScalar(y + x, uv + x, rgb + 3 * x, width - x, c, is_bgr);
+}
+
+TARGET_AVX2 static inline __m256i WidenQ7(__m128i value) {
+  return _mm256_slli_epi16(_mm256_cvtepu8_epi16(value), 7);
+}
+
+TARGET_AVX2 static void RgbToYRowAvx2(const uint8_t *rgb, uint8_t *y,
+                                      uint32_t width,
+                                      const RgbToYuvCoeffs &c) {
+  Rgb3Shuffle load;
+  LoadMasks(rgb3_masks.load, load);
+  auto const k0 = _mm256_set1_epi16(c.y[0]);
+  auto const k1 = _mm256_set1_epi16(c.y[1]);
+  auto const k2 = _mm256_set1_epi16(c.y[2]);
+  auto const bias = _mm256_set1_epi16(c.y_bias);
+
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    __m128i r, g, b;
+    LoadRgb16(rgb + 3 * x, load, r, g, b);
+
+    auto sum = _mm256_adds_epi16(bias, _mm256_mulhrs_epi16(WidenQ7(r), k0));
+    sum = _mm256_adds_epi16(sum, _mm256_mulhrs_epi16(WidenQ7(g), k1));
+    sum = _mm256_adds_epi16(sum, _mm256_mulhrs_epi16(WidenQ7(b), k2));
+    _mm_storeu_si128((__m128i *)(y + x), PackQ7(sum));
+  }
+
+  RgbToYRowScalar(rgb + 3 * x, y + x, width - x, c);
+}
+
+// 2x2 average of 16 pixels from two rows, scaled to Q7;
+TARGET_AVX2 static inline __m128i Average2x2Q7(__m128i row0, __m128i row1) {
+  auto const ones = _mm_set1_epi8(1);
+  auto const sum = _mm_add_epi16(_mm_maddubs_epi16(row0, ones),
+                                 _mm_maddubs_epi16(row1, ones));
+  auto const avg = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+  return _mm_slli_epi16(avg, 7);
+}
+
+TARGET_AVX2 static inline __m128i Dot3Q7(__m128i r, __m128i g, __m128i b,
+                                         const int16_t (&k)[3], int16_t bias) {
+  auto sum = _mm_adds_epi16(_mm_set1_epi16(bias),
+                            _mm_mulhrs_epi16(r, _mm_set1_epi16(k[0])));
+  sum = _mm_adds_epi16(sum, _mm_mulhrs_epi16(g, _mm_set1_epi16(k[1])));
+  sum = _mm_adds_epi16(sum, _mm_mulhrs_epi16(b, _mm_set1_epi16(k[2])));
+  sum = _mm_srai_epi16(sum, 7);
+  return _mm_packus_epi16(sum, sum);
+}
+
+TARGET_AVX2 static void RgbToUvRowAvx2(const uint8_t *rgb0,
+                                       const uint8_t *rgb1, uint8_t *u,
+                                       uint8_t *v, uint32_t width,
+                                       const RgbToYuvCoeffs &c) {
+  Rgb3Shuffle load;
+  LoadMasks(rgb3_masks.load, load);
+
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    __m128i r0, g0, b0, r1, g1, b1;
+    LoadRgb16(rgb0 + 3 * x, load, r0, g0, b0);
+    LoadRgb16(rgb1 + 3 * x, load, r1, g1, b1);
+
+    auto const r = Average2x2Q7(r0, r1);
+    auto const g = Average2x2Q7(g0, g1);
+    auto const b = Average2x2Q7(b0, b1);
+    _mm_storel_epi64((__m128i *)(u + x / 2), Dot3Q7(r, g, b, c.u, c.uv_bias));
+    _mm_storel_epi64((__m128i *)(v + x / 2), Dot3Q7(r, g, b, c.v, c.uv_bias));
+  }
+
+  RgbToUvRowScalar(rgb0 + 3 * x, rgb1 + 3 * x, u + x / 2, v + x / 2,
+                   width - x, c);
+}
+
+TARGET_AVX2 static void SplitUvRowAvx2(const uint8_t *uv, uint8_t *u,
+                                       uint8_t *v, uint32_t num_pairs) {
+  // Even bytes to low half of every lane, odd bytes to high half;
+  auto const mask = _mm256_setr_epi8(
+      0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15, 0, 2, 4, 6, 8, 10,
+      12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+  uint32_t i = 0U;
+  for (; i + 16U <= num_pairs; i += 16U) {
+    auto pairs = _mm256_loadu_si256((const __m256i *)(uv + 2 * i));
+    pairs = _mm256_shuffle_epi8(pairs, mask);
+    pairs = _mm256_permute4x64_epi64(pairs, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128((__m128i *)(u + i), _mm256_castsi256_si128(pairs));
+    _mm_storeu_si128((__m128i *)(v + i), _mm256_extracti128_si256(pairs, 1));
+  }
+
+  SplitUvRowScalar(uv + 2 * i, u + i, v + i, num_pairs - i);
+}
+
+TARGET_AVX2 static void MergeUvRowAvx2(const uint8_t *u, const uint8_t *v,
+                                       uint8_t *uv, uint32_t num_pairs) {
+  uint32_t i = 0U;
+  for (; i + 16U <= num_pairs; i += 16U) {
+    auto const u16 = _mm_loadu_si128((const __m128i *)(u + i));
+    auto const v16 = _mm_loadu_si128((const __m128i *)(v + i));
+    _mm_storeu_si128((__m128i *)(uv + 2 * i), _mm_unpacklo_epi8(u16, v16));
+    _mm_storeu_si128((__m128i *)(uv + 2 * i) + 1,
+                     _mm_unpackhi_epi8(u16, v16));
+  }
+
+  MergeUvRowScalar(u + i, v + i, uv + 2 * i, num_pairs - i);
+}
+
+TARGET_AVX2 static void SplitRgbRowAvx2(const uint8_t *rgb, uint8_t *r,
+                                        uint8_t *g, uint8_t *b,
+                                        uint32_t width) {
+  Rgb3Shuffle load;
+  LoadMasks(rgb3_masks.load, load);
+
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    __m128i r16, g16, b16;
+    LoadRgb16(rgb + 3 * x, load, r16, g16, b16);
+    _mm_storeu_si128((__m128i *)(r + x), r16);
+    _mm_storeu_si128((__m128i *)(g + x), g16);
+    _mm_storeu_si128((__m128i *)(b + x), b16);
+  }
+
+  SplitRgbRowScalar(rgb + 3 * x, r + x, g + x, b + x, width - x);
+}
+
+TARGET_AVX2 static void SwapRbRowAvx2(const uint8_t *src, uint8_t *dst,
+                                      uint32_t width) {
+  Rgb3Shuffle load, store;
+  LoadMasks(rgb3_masks.load, load);
+  LoadMasks(rgb3_masks.store, store);
+
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    __m128i r, g, b;
+    LoadRgb16(src + 3 * x, load, r, g, b);
+    StoreRgb16(dst + 3 * x, store, b, g, r);
+  }
+
+  SwapRbRowScalar(src + 3 * x, dst + 3 * x, width - x);
+}
+#endif
+
+#if defined(VPF_HOST_CVT_NEON)
+// Converts 8 pixels, chroma samples are already duplicated;
+static inline void YuvToRgb8(uint8x8_t y, uint8x8_t u, uint8x8_t v,
+                             const YuvToRgbCoeffs &c, uint8x8_t &r,
+                             uint8x8_t &g, uint8x8_t &b) {
+  auto const y16 = vmovl_u8(y);
+  auto const y257 = vorrq_u16(y16, vshlq_n_u16(y16, 8));
+  auto const gain = vdup_n_u16(c.y_gain);
+  auto const hi_lo = vshrn_n_u32(vmull_u16(vget_low_u16(y257), gain), 16);
+  auto const hi_hi = vshrn_n_u32(vmull_u16(vget_high_u16(y257), gain), 16);
+  auto const luma = vaddq_s16(vreinterpretq_s16_u16(vcombine_u16(hi_lo, hi_hi)),
+                              vdupq_n_s16(c.y_bias));
+
+  auto const offset = vdupq_n_s16(128);
+  auto const cb = vshlq_n_s16(
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), offset), 8);
+  auto const cr = vshlq_n_s16(
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), offset), 8);
+
+  auto const r16 = vqaddq_s16(luma, vqrdmulhq_n_s16(cr, c.r_cr));
+  auto const g16 = vqsubq_s16(vqsubq_s16(luma, vqrdmulhq_n_s16(cb, c.g_cb)),
+                              vqrdmulhq_n_s16(cr, c.g_cr));
+  auto const b16 = vqaddq_s16(luma, vqrdmulhq_n_s16(cb, c.b_cb));
+
+  r = vqshrun_n_s16(r16, 6);
+  g = vqshrun_n_s16(g16, 6);
+  b = vqshrun_n_s16(b16, 6);
+}
+
+static inline void YuvToRgb16(const uint8_t *y, uint8x8x2_t u, uint8x8x2_t v,
+                              uint8_t *rgb, const YuvToRgbCoeffs &c,
+                              bool is_bgr) {
+  auto const y16 = vld1q_u8(y);
+  uint8x8_t r[2], g[2], b[2];
+  YuvToRgb8(vget_low_u8(y16), u.val[0], v.val[0], c, r[0], g[0], b[0]);
+  YuvToRgb8(vget_high_u8(y16), u.val[1], v.val[1], c, r[1], g[1], b[1]);
+
+  uint8x16x3_t out;
+  out.val[is_bgr ? 2 : 0] = vcombine_u8(r[0], r[1]);
+  out.val[1] = vcombine_u8(g[0], g[1]);
+  out.val[is_bgr ? 0 : 2] = vcombine_u8(b[0], b[1]);
+  vst3q_u8(rgb, out);
+}
+
+static void I420ToRgbRowNeon(const uint8_t *y, const uint8_t *u,
+                             const uint8_t *v, uint8_t *rgb, uint32_t width,
+                             const YuvToRgbCoeffs &c, bool is_bgr) {
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const u8 = vld1_u8(u + x / 2);
+    auto const v8 = vld1_u8(v + x / 2);
+    YuvToRgb16(y + x, vzip_u8(u8, u8), vzip_u8(v8, v8), rgb + 3 * x, c,
+               is_bgr);
+  }
+
+  I420ToRgbRowScalar(y + x, u + x / 2, v + x / 2, rgb + 3 * x, width - x, c,
+                     is_bgr);
+}
+
+static void Nv12ToRgbRowNeon(const uint8_t *y, const uint8_t *uv,
+                             uint8_t *rgb, uint32_t width,
+                             const YuvToRgbCoeffs &c, bool is_bgr) {
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const pairs = vld2_u8(uv + x);
+    YuvToRgb16(y + x, vzip_u8(pairs.val[0], pairs.val[0]),
+               vzip_u8(pairs.val[1], pairs.val[1]), rgb + 3 * x, c, is_bgr);
+  }
+
+  Nv12ToRgbRowScalar(y + x, uv + x, rgb + 3 * x, width - x, c, is_bgr);
+}
+
+static inline int16x8_t Dot3Q7(int16x8_t r, int16x8_t g, int16x8_t b,
+                               const int16_t (&k)[3], int16_t bias) {
+  auto sum = vqaddq_s16(vdupq_n_s16(bias), vqrdmulhq_n_s16(r, k[0]));
+  sum = vqaddq_s16(sum, vqrdmulhq_n_s16(g, k[1]));
+  return vqaddq_s16(sum, vqrdmulhq_n_s16(b, k[2]));
+}
+
+static inline int16x8_t WidenQ7(uint8x8_t value) {
+  return vreinterpretq_s16_u16(vshll_n_u8(value, 7));
+}
+
+static void RgbToYRowNeon(const uint8_t *rgb, uint8_t *y, uint32_t width,
+                          const RgbToYuvCoeffs &c) {
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const px = vld3q_u8(rgb + 3 * x);
+    auto const lo =
+        Dot3Q7(WidenQ7(vget_low_u8(px.val[0])), WidenQ7(vget_low_u8(px.val[1])),
+               WidenQ7(vget_low_u8(px.val[2])), c.y, c.y_bias);
+    auto const hi = Dot3Q7(WidenQ7(vget_high_u8(px.val[0])),
+                           WidenQ7(vget_high_u8(px.val[1])),
+                           WidenQ7(vget_high_u8(px.val[2])), c.y, c.y_bias);
+    vst1q_u8(y + x, vcombine_u8(vqshrun_n_s16(lo, 7), vqshrun_n_s16(hi, 7)));
+  }
+
+  RgbToYRowScalar(rgb + 3 * x, y + x, width - x, c);
+}
+
+// 2x2 average of 16 pixels from two rows, scaled to Q7;
+static inline int16x8_t Average2x2Q7(uint8x16_t row0, uint8x16_t row1) {
+  auto const sum = vaddq_u16(vpaddlq_u8(row0), vpaddlq_u8(row1));
+  auto const avg = vshrq_n_u16(vaddq_u16(sum, vdupq_n_u16(2)), 2);
+  return vreinterpretq_s16_u16(vshlq_n_u16(avg, 7));
+}
+
+static void RgbToUvRowNeon(const uint8_t *rgb0, const uint8_t *rgb1,
+                           uint8_t *u, uint8_t *v, uint32_t width,
+                           const RgbToYuvCoeffs &c) {
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const px0 = vld3q_u8(rgb0 + 3 * x);
+    auto const px1 = vld3q_u8(rgb1 + 3 * x);
+
+    auto const r = Average2x2Q7(px0.val[0], px1.val[0]);
+    auto const g = Average2x2Q7(px0.val[1], px1.val[1]);
+    auto const b = Average2x2Q7(px0.val[2], px1.val[2]);
+    vst1_u8(u + x / 2, vqshrun_n_s16(Dot3Q7(r, g, b, c.u, c.uv_bias), 7));
+    vst1_u8(v + x / 2, vqshrun_n_s16(Dot3Q7(r, g, b, c.v, c.uv_bias), 7));
+  }
+
+  RgbToUvRowScalar(rgb0 + 3 * x, rgb1 + 3 * x, u + x / 2, v + x / 2,
+                   width - x, c);
+}
+
+static void SplitUvRowNeon(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                           uint32_t num_pairs) {
+  uint32_t i = 0U;
+  for (; i + 16U <= num_pairs; i += 16U) {
+    auto const pairs = vld2q_u8(uv + 2 * i);
+    vst1q_u8(u + i, pairs.val[0]);
+    vst1q_u8(v + i, pairs.val[1]);
+  }
+
+  SplitUvRowScalar(uv + 2 * i, u + i, v + i, num_pairs - i);
+}
+
+static void MergeUvRowNeon(const uint8_t *u, const uint8_t *v, uint8_t *uv,
+                           uint32_t num_pairs) {
+  uint32_t i = 0U;
+  for (; i + 16U <= num_pairs; i += 16U) {
+    uint8x16x2_t pairs;
+    pairs.val[0] = vld1q_u8(u + i);
+    pairs.val[1] = vld1q_u8(v + i);
+    vst2q_u8(uv + 2 * i, pairs);
+  }
+
+  MergeUvRowScalar(u + i, v + i, uv + 2 * i, num_pairs - i);
+}
+
+static void SplitRgbRowNeon(const uint8_t *rgb, uint8_t *r, uint8_t *g,
+                            uint8_t *b, uint32_t width) {
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto const px = vld3q_u8(rgb + 3 * x);
+    vst1q_u8(r + x, px.val[0]);
+    vst1q_u8(g + x, px.val[1]);
+    vst1q_u8(b + x, px.val[2]);
+  }
+
+  SplitRgbRowScalar(rgb + 3 * x, r + x, g + x, b + x, width - x);
+}
+
+static void SwapRbRowNeon(const uint8_t *src, uint8_t *dst, uint32_t width) {
+  uint32_t x = 0U;
+  for (; x + 16U <= width; x += 16U) {
+    auto px = vld3q_u8(src + 3 * x);
+    auto const r = px.val[0];
+    px.val[0] = px.val[2];
+    px.val[2] = r;
+    vst3q_u8(dst + 3 * x, px);
+  }
+
+  SwapRbRowScalar(src + 3 * x, dst + 3 * x, width - x);
+}
+#endif
+
+struct CvtRowFuncs {
+  void (*i420_to_rgb)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                      uint8_t *rgb, uint32_t width, const YuvToRgbCoeffs &c,
+                      bool is_bgr);
+  void (*nv12_to_rgb)(const uint8_t *y, const uint8_t *uv, uint8_t *rgb,
+                      uint32_t width, const YuvToRgbCoeffs &c, bool is_bgr);
+  void (*rgb_to_y)(const uint8_t *rgb, uint8_t *y, uint32_t width,
+                   const RgbToYuvCoeffs &c);
+  void (*rgb_to_uv)(const uint8_t *rgb0, const uint8_t *rgb1, uint8_t *u,
+                    uint8_t *v, uint32_t width, const RgbToYuvCoeffs &c);
+  void (*split_uv)(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                   uint32_t num_pairs);
+  void (*merge_uv)(const uint8_t *u, const uint8_t *v, uint8_t *uv,
+                   uint32_t num_pairs);
+  void (*split_rgb)(const uint8_t *rgb, uint8_t *r, uint8_t *g, uint8_t *b,
+                    uint32_t width);
+  void (*swap_rb)(const uint8_t *src, uint8_t *dst, uint32_t width);
+};
+
+static const CvtRowFuncs scalar_funcs = {
+    I420ToRgbRowScalar, Nv12ToRgbRowScalar, RgbToYRowScalar,
+    RgbToUvRowScalar,   SplitUvRowScalar,   MergeUvRowScalar,
+    SplitRgbRowScalar,  SwapRbRowScalar};
+
+#if defined(VPF_HOST_CVT_X86)
+static const CvtRowFuncs avx2_funcs = {
+    I420ToRgbRowAvx2, Nv12ToRgbRowAvx2, RgbToYRowAvx2,  RgbToUvRowAvx2,
+    SplitUvRowAvx2,   MergeUvRowAvx2,   SplitRgbRowAvx2, SwapRbRowAvx2};
+#endif
+
+#if defined(VPF_HOST_CVT_NEON)
+static const CvtRowFuncs neon_funcs = {
+    I420ToRgbRowNeon, Nv12ToRgbRowNeon, RgbToYRowNeon,  RgbToUvRowNeon,
+    SplitUvRowNeon,   MergeUvRowNeon,   SplitRgbRowNeon, SwapRbRowNeon};
+#endif
+
+static const CvtRowFuncs &GetRowFuncs(HostCvtKernel kernel) {
+  switch (kernel) {
+#if defined(VPF_HOST_CVT_X86)
+  case HOST_CVT_AVX2:
+    return avx2_funcs;
+#endif
+#if defined(VPF_HOST_CVT_NEON)
+  case HOST_CVT_NEON:
+    return neon_funcs;
+#endif
+  default:
+    return scalar_funcs;
+  }
+}
+
+static HostCpuFeatures DetectHostCpuFeatures() {
+  HostCpuFeatures features;
+#if defined(VPF_HOST_CVT_X86)
+#if defined(_MSC_VER)
+  int info[4] = {0};
+  __cpuid(info, 0);
+  auto const max_leaf = info[0];
+
+  __cpuid(info, 1);
+  features.sse2 = 0 != (info[3] & (1 << 26));
+  features.f16c = 0 != (info[2] & (1 << 29));
+  auto const has_osxsave = 0 != (info[2] & (1 << 27));
+  auto const has_avx = 0 != (info[2] & (1 << 28));
+
+  if (max_leaf >= 7 && has_osxsave && has_avx) {
+    // OS must save YMM registers upon context switch;
+    auto const ymm_enabled = 0x6 == (_xgetbv(0) & 0x6);
+    __cpuidex(info, 7, 0);
+    features.avx2 = ymm_enabled && (0 != (info[1] & (1 << 5)));
+  }
+#else
+  __builtin_cpu_init();
+  features.sse2 = 0 != __builtin_cpu_supports("sse2");
+  features.avx2 = 0 != __builtin_cpu_supports("avx2");
+
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  features.f16c =
+      __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (0 != (ecx & (1U << 29)));
+#endif
+#elif defined(VPF_HOST_CVT_NEON)
+  // NEON is mandatory on AArch64;
+  features.neon = true;
+#endif
+  return features;
+}
+
+static HostCvtKernel DetectHostCvtKernel() {
+  auto const &cpu = GetHostCpuFeatures();
+  if (cpu.avx2) {
+    return HOST_CVT_AVX2;
+  } else if (cpu.neon) {
+    return HOST_CVT_NEON;
+  }
+  return HOST_CVT_SCALAR;
+}
+
+static bool Is420(Pixel_Format format) {
+  return NV12 == format || YUV420 == format || YCBCR == format;
+}
+
+struct HostPlane {
+  uint8_t *ptr;
+  size_t pitch;
+
+  HostPlane(Surface *pSurface, uint32_t plane)
+      : ptr((uint8_t *)pSurface->PlanePtr(plane)),
+        pitch(pSurface->Pitch(plane)) {}
+
+  uint8_t *Row(uint32_t row) const { return ptr + row * pitch; }
+};
+
+static void ConvertYuvToRgb(const CvtRowFuncs &f, Surface *pSrc,
+                            Surface *pDst,
+                            const ColorspaceConversionContext *pCtx) {
+  auto const c = MakeYuvToRgbCoeffs(pCtx);
+  auto const is_bgr = BGR == pDst->PixelFormat();
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  HostPlane y(pSrc, 0U), dst(pDst, 0U);
+
+  if (NV12 == pSrc->PixelFormat()) {
+    HostPlane uv(pSrc, 1U);
+    for (uint32_t row = 0U; row < height; row++) {
+      f.nv12_to_rgb(y.Row(row), uv.Row(row / 2), dst.Row(row), width, c,
+                    is_bgr);
+    }
+  } else {
+    HostPlane u(pSrc, 1U), v(pSrc, 2U);
+    for (uint32_t row = 0U; row < height; row++) {
+      f.i420_to_rgb(y.Row(row), u.Row(row / 2), v.Row(row / 2),
+                    dst.Row(row), width, c, is_bgr);
+    }
+  }
+}
+
+static void ConvertRgbToYuv(const CvtRowFuncs &f, Surface *pSrc,
+                            Surface *pDst,
+                            const ColorspaceConversionContext *pCtx) {
+  auto const c = MakeRgbToYuvCoeffs(pCtx, BGR == pSrc->PixelFormat());
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  HostPlane src(pSrc, 0U), y(pDst, 0U), u(pDst, 1U), v(pDst, 2U);
+
+  for (uint32_t row = 0U; row < height; row += 2U) {
+    f.rgb_to_y(src.Row(row), y.Row(row), width, c);
+    f.rgb_to_y(src.Row(row + 1U), y.Row(row + 1U), width, c);
+    f.rgb_to_uv(src.Row(row), src.Row(row + 1U), u.Row(row / 2),
+                v.Row(row / 2), width, c);
+  }
+}
+
+static void ConvertNv12ToYuv420(const CvtRowFuncs &f, Surface *pSrc,
+                                Surface *pDst) {
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  HostPlane uv(pSrc, 1U), u(pDst, 1U), v(pDst, 2U);
+
+  CopyPlaneHost((uint8_t *)pDst->PlanePtr(0U), pDst->Pitch(0U),
+                (const uint8_t *)pSrc->PlanePtr(0U), pSrc->Pitch(0U), width,
+                height);
+  for (uint32_t row = 0U; row < height / 2; row++) {
+    f.split_uv(uv.Row(row), u.Row(row), v.Row(row), width / 2);
+  }
+}
+
+static void ConvertYuv420ToNv12(const CvtRowFuncs &f, Surface *pSrc,
+                                Surface *pDst) {
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  HostPlane u(pSrc, 1U), v(pSrc, 2U), uv(pDst, 1U);
+
+  CopyPlaneHost((uint8_t *)pDst->PlanePtr(0U), pDst->Pitch(0U),
+                (const uint8_t *)pSrc->PlanePtr(0U), pSrc->Pitch(0U), width,
+                height);
+  for (uint32_t row = 0U; row < height / 2; row++) {
+    f.merge_uv(u.Row(row), v.Row(row), uv.Row(row), width / 2);
+  }
+}
+
+static void ConvertRgbToPlanar(const CvtRowFuncs &f, Surface *pSrc,
+                               Surface *pDst) {
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  HostPlane src(pSrc, 0U), r(pDst, 0U), g(pDst, 1U), b(pDst, 2U);
+
+  for (uint32_t row = 0U; row < height; row++) {
+    f.split_rgb(src.Row(row), r.Row(row), g.Row(row), b.Row(row), width);
+  }
+}
+
+static void ConvertRgbToBgr(const CvtRowFuncs &f, Surface *pSrc,
+                            Surface *pDst) {
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  HostPlane src(pSrc, 0U), dst(pDst, 0U);
+
+  for (uint32_t row = 0U; row < height; row++) {
+    f.swap_rb(src.Row(row), dst.Row(row), width);
+  }
+}
+
+namespace VPF {
+const HostCpuFeatures &GetHostCpuFeatures() {
+  static const HostCpuFeatures features = DetectHostCpuFeatures();
+  return features;
+}
+
+HostCvtKernel GetHostCvtKernel() {
+  static const HostCvtKernel kernel = DetectHostCvtKernel();
+  return kernel;
+}
+
+const char *GetHostCvtKernelName(HostCvtKernel kernel) {
+  switch (kernel) {
+  case HOST_CVT_SCALAR:
+    return "scalar";
+  case HOST_CVT_AVX2:
+    return "avx2";
+  case HOST_CVT_NEON:
+    return "neon";
+  default:
+    return "unknown";
+  }
+}
+
+bool IsHostCvtSupported(Pixel_Format inFormat, Pixel_Format outFormat) {
+  switch (inFormat) {
+  case NV12:
+    return YUV420 == outFormat || RGB == outFormat || BGR == outFormat;
+  case YUV420:
+    return NV12 == outFormat || RGB == outFormat;
+  case RGB:
+    return YUV420 == outFormat || RGB_PLANAR == outFormat ||
+           BGR == outFormat;
+  case BGR:
+    return YCBCR == outFormat;
+  default:
+    return false;
+  }
+}
+
+bool ConvertSurfaceHost(Surface *pSrc, Surface *pDst,
+                        const ColorspaceConversionContext *pCtx,
+                        HostCvtKernel kernel) {
+  if (!pSrc || !pDst || pSrc->Empty() || pDst->Empty()) {
+    return false;
+  }
+
+  if (MEM_HOST != pSrc->MemType() || MEM_HOST != pDst->MemType()) {
+    return false;
+  }
+
+  auto const inFormat = pSrc->PixelFormat();
+  auto const outFormat = pDst->PixelFormat();
+  if (!IsHostCvtSupported(inFormat, outFormat)) {
+    return false;
+  }
+
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  if (width != pDst->Width() || height != pDst->Height()) {
+    return false;
+  }
+
+  if ((Is420(inFormat) || Is420(outFormat)) && ((width | height) & 1U)) {
+    return false;
+  }
+
+  if (GetHostCvtKernel() != kernel) {
+    kernel = HOST_CVT_SCALAR;
+  }
+  auto const &f = GetRowFuncs(kernel);
+
+  if (RGB == outFormat || BGR == outFormat) {
+    if (RGB == inFormat) {
+      ConvertRgbToBgr(f, pSrc, pDst);
+    } else {
+      ConvertYuvToRgb(f, pSrc, pDst, pCtx);
+    }
+  } else if (YUV420 == outFormat || YCBCR == outFormat) {
+    if (NV12 == inFormat) {
+      ConvertNv12ToYuv420(f, pSrc, pDst);
+    } else {
+      ConvertRgbToYuv(f, pSrc, pDst, pCtx);
+    }
+  } else if (NV12 == outFormat) {
+    ConvertYuv420ToNv12(f, pSrc, pDst);
+  } else if (RGB_PLANAR == outFormat) {
+    ConvertRgbToPlanar(f, pSrc, pDst);
+  }
+
+  return true;
+}
+
+bool ConvertSurfaceHost(Surface *pSrc, Surface *pDst,
+                        const ColorspaceConversionContext *pCtx) {
+  return ConvertSurfaceHost(pSrc, pDst, pCtx, GetHostCvtKernel());
+}
+} // namespace VPF
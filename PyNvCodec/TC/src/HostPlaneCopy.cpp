@@ -0,0 +1,284 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostPlaneCopy.hpp"
+#include "HostColorCvt.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||          \
+    defined(_M_IX86)
+#define VPF_HOST_COPY_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define VPF_HOST_COPY_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+using namespace VPF;
+using namespace std;
+
+/* Planes bigger than this are unlikely to stay in cache anyway,
+ * so they are written with non-temporal stores;
+ */
+static const size_t non_temporal_threshold = 4U * 1024U * 1024U;
+
+static void CopyRowScalar(uint8_t *dst, const uint8_t *src, size_t size,
+                          bool) {
+  memcpy(dst, src, size);
+}
+
+#if defined(VPF_HOST_COPY_X86)
+TARGET_SSE2 static void CopyRowSse2(uint8_t *dst, const uint8_t *src,
+                                    size_t size, bool non_temporal) {
+  const size_t vec = sizeof(__m128i);
+
+  if (non_temporal && size >= vec) {
+    // Streaming stores need aligned destination;
+    auto head = (vec - ((uintptr_t)dst & (vec - 1))) & (vec - 1);
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    for (; size >= 4 * vec; size -= 4 * vec, src += 4 * vec, dst += 4 * vec) {
+      auto a = _mm_loadu_si128((const __m128i *)src + 0);
+      auto b = _mm_loadu_si128((const __m128i *)src + 1);
+      auto c = _mm_loadu_si128((const __m128i *)src + 2);
+      auto d = _mm_loadu_si128((const __m128i *)src + 3);
+      _mm_stream_si128((__m128i *)dst + 0, a);
+      _mm_stream_si128((__m128i *)dst + 1, b);
+      _mm_stream_si128((__m128i *)dst + 2, c);
+      _mm_stream_si128((__m128i *)dst + 3, d);
+    }
+
+    for (; size >= vec; size -= vec, src += vec, dst += vec) {
+      _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+    }
+  } else {
+    for (; size >= 4 * vec; size -= 4 * vec, src += 4 * vec, dst += 4 * vec) {
+      auto a = _mm_loadu_si128((const __m128i *)src + 0);
+      auto b = _mm_loadu_si128((const __m128i *)src + 1);
+      auto c = _mm_loadu_si128((const __m128i *)src + 2);
+      auto d = _mm_loadu_si128((const __m128i *)src + 3);
+      _mm_storeu_si128((__m128i *)dst + 0, a);
+      _mm_storeu_si128((__m128i *)dst + 1, b);
+      _mm_storeu_si128((__m128i *)dst + 2, c);
+      _mm_storeu_si128((__m128i *)dst + 3, d);
+    }
+
+    for (; size >= vec; size -= vec, src += vec, dst += vec) {
+      _mm_storeu_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+    }
+  }
+
+  // Row tail;
+  memcpy(dst, src, size);
+}
+
+TARGET_AVX2 static void CopyRowAvx2(uint8_t *dst, const uint8_t *src,
+                                    size_t size, bool non_temporal) {
+  const size_t vec = sizeof(__m256i);
+
+  if (non_temporal && size >= vec) {
+    // Streaming stores need aligned destination;
+    auto head = (vec - ((uintptr_t)dst & (vec - 1))) & (vec - 1);
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    for (; size >= 4 * vec; size -= 4 * vec, src += 4 * vec, dst += 4 * vec) {
+      auto a = _mm256_loadu_si256((const __m256i *)src + 0);
+      auto b = _mm256_loadu_si256((const __m256i *)src + 1);
+      auto c = _mm256_loadu_si256((const __m256i *)src + 2);
+      auto d = _mm256_loadu_si256((const __m256i *)src + 3);
+      _mm256_stream_si256((__m256i *)dst + 0, a);
+      _mm256_stream_si256((__m256i *)dst + 1, b);
+      _mm256_stream_si256((__m256i *)dst + 2, c);
+      _mm256_stream_si256((__m256i *)dst + 3, d);
+    }
+
+    for (; size >= vec; size -= vec, src += vec, dst += vec) {
+      _mm256_stream_si256((__m256i *)dst,
+                          _mm256_loadu_si256((const __m256i *)src));
+    }
+  } else {
+    for (; size >= 4 * vec; size -= 4 * vec, src += 4 * vec, dst += 4 * vec) {
+      auto a = _mm256_loadu_si256((const __m256i *)src + 0);
+      auto b = _mm256_loadu_si256((const __m256i *)src + 1);
+      auto c = _mm256_loadu_si256((const __m256i *)src + 2);
+      auto d = _mm256_loadu_si256((const __m256i *)src + 3);
+      _mm256_storeu_si256((__m256i *)dst + 0, a);
+      _mm256_storeu_si256((__m256i *)dst + 1, b);
+      _mm256_storeu_si256((__m256i *)dst + 2, c);
+      _mm256_storeu_si256((__m256i *)dst + 3, d);
+    }
+
+    for (; size >= vec; size -= vec, src += vec, dst += vec) {
+      _mm256_storeu_si256((__m256i *)dst,
+                          _mm256_loadu_si256((const __m256i *)src));
+    }
+  }
+
+  // Row tail;
+  memcpy(dst, src, size);
+}
+#endif
+
+#if defined(VPF_HOST_COPY_NEON)
+static void CopyRowNeon(uint8_t *dst, const uint8_t *src, size_t size, bool) {
+  const size_t vec = sizeof(uint8x16_t);
+
+  for (; size >= 4 * vec; size -= 4 * vec, src += 4 * vec, dst += 4 * vec) {
+    auto a = vld1q_u8(src + 0 * vec);
+    auto b = vld1q_u8(src + 1 * vec);
+    auto c = vld1q_u8(src + 2 * vec);
+    auto d = vld1q_u8(src + 3 * vec);
+    vst1q_u8(dst + 0 * vec, a);
+    vst1q_u8(dst + 1 * vec, b);
+    vst1q_u8(dst + 2 * vec, c);
+    vst1q_u8(dst + 3 * vec, d);
+  }
+
+  for (; size >= vec; size -= vec, src += vec, dst += vec) {
+    vst1q_u8(dst, vld1q_u8(src));
+  }
+
+  // Row tail;
+  memcpy(dst, src, size);
+}
+#endif
+
+typedef void (*CopyRowFunc)(uint8_t *dst, const uint8_t *src, size_t size,
+                            bool non_temporal);
+
+static void CopyPlane(CopyRowFunc copy_row, uint8_t *dst, ptrdiff_t dst_pitch,
+                      const uint8_t *src, ptrdiff_t src_pitch,
+                      size_t width_in_bytes, size_t height) {
+  if (!dst || !src || !width_in_bytes || !height) {
+    return;
+  }
+
+  auto const plane_size = width_in_bytes * height;
+  auto const non_temporal = plane_size >= non_temporal_threshold;
+  auto const is_contiguous = (dst_pitch == (ptrdiff_t)width_in_bytes) &&
+                             (src_pitch == (ptrdiff_t)width_in_bytes);
+
+  if (is_contiguous) {
+    // No row padding on both sides, copy whole plane at once;
+    copy_row(dst, src, plane_size, non_temporal);
+  } else {
+    for (size_t i = 0; i < height; i++) {
+      copy_row(dst, src, width_in_bytes, non_temporal);
+      dst += dst_pitch;
+      src += src_pitch;
+    }
+  }
+
+#if defined(VPF_HOST_COPY_X86)
+  if (non_temporal && (copy_row != CopyRowScalar)) {
+    // Make streaming stores visible to other threads;
+    _mm_sfence();
+  }
+#endif
+}
+
+static HostCopyKernel DetectHostCopyKernel() {
+  auto const &cpu = GetHostCpuFeatures();
+  if (cpu.avx2) {
+    return HOST_COPY_AVX2;
+  } else if (cpu.sse2) {
+    return HOST_COPY_SSE2;
+  } else if (cpu.neon) {
+    return HOST_COPY_NEON;
+  }
+  return HOST_COPY_SCALAR;
+}
+
+static bool IsSupported(HostCopyKernel kernel) {
+  auto const best = GetHostCopyKernel();
+
+  switch (kernel) {
+  case HOST_COPY_SCALAR:
+    return true;
+  case HOST_COPY_SSE2:
+    return HOST_COPY_SSE2 == best || HOST_COPY_AVX2 == best;
+  case HOST_COPY_AVX2:
+    return HOST_COPY_AVX2 == best;
+  case HOST_COPY_NEON:
+    return HOST_COPY_NEON == best;
+  default:
+    return false;
+  }
+}
+
+static CopyRowFunc GetCopyRowFunc(HostCopyKernel kernel) {
+  switch (kernel) {
+#if defined(VPF_HOST_COPY_X86)
+  case HOST_COPY_SSE2:
+    return CopyRowSse2;
+  case HOST_COPY_AVX2:
+    return CopyRowAvx2;
+#endif
+#if defined(VPF_HOST_COPY_NEON)
+  case HOST_COPY_NEON:
+    return CopyRowNeon;
+#endif
+  default:
+    return CopyRowScalar;
+  }
+}
+
+namespace VPF {
+HostCopyKernel GetHostCopyKernel() {
+  static const HostCopyKernel kernel = DetectHostCopyKernel();
+  return kernel;
+}
+
+const char *GetHostCopyKernelName(HostCopyKernel kernel) {
+  switch (kernel) {
+  case HOST_COPY_SCALAR:
+    return "scalar";
+  case HOST_COPY_SSE2:
+    return "sse2";
+  case HOST_COPY_AVX2:
+    return "avx2";
+  case HOST_COPY_NEON:
+    return "neon";
+  default:
+    return "unknown";
+  }
+}
+
+void CopyPlaneHost(uint8_t *dst, ptrdiff_t dst_pitch, const uint8_t *src,
+                   ptrdiff_t src_pitch, size_t width_in_bytes, size_t height,
+                   HostCopyKernel kernel) {
+  auto copy_row =
+      GetCopyRowFunc(IsSupported(kernel) ? kernel : HOST_COPY_SCALAR);
+  CopyPlane(copy_row, dst, dst_pitch, src, src_pitch, width_in_bytes, height);
+}
+
+void CopyPlaneHost(uint8_t *dst, ptrdiff_t dst_pitch, const uint8_t *src,
+                   ptrdiff_t src_pitch, size_t width_in_bytes, size_t height) {
+  static const CopyRowFunc copy_row = GetCopyRowFunc(GetHostCopyKernel());
+  CopyPlane(copy_row, dst, dst_pitch, src, src_pitch, width_in_bytes, height);
+}
+} // namespace VPF
@@ -0,0 +1,792 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostResize.hpp"
+#include "TaskExecutor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||          \
+    defined(_M_IX86)
+#define VPF_HOST_RESIZE_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define VPF_HOST_RESIZE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace VPF;
+using namespace std;
+
+/* Filter weights are Q14 and sum up to exactly 1.0 for every output
+ * sample; Horizontal pass gives Q6 16 bit values which vertical pass turns
+ * back into 8 bit; Every kernel does the same integer math, so results
+ * are bit-exact;
+ */
+static const int weight_bits = 14;
+static const int mid_bits = 6;
+static const int h_shift = weight_bits - mid_bits;
+static const int v_shift = weight_bits + mid_bits;
+
+// Output bytes per band, smaller bands don't pay off thread wakeup;
+static const size_t min_band_size = 64U * 1024U;
+
+/* Filter taps for every output column or row;
+ * Every output sample takes the same number of adjacent input samples,
+ * unused taps have zero weight; Taps never go beyond input;
+ */
+struct FilterTable {
+  uint32_t size = 0U;
+  uint32_t taps = 0U;
+  // First input sample for every output one;
+  vector<int32_t> start;
+  // Tap-major, weight of tap t for output i is at [t * size + i];
+  vector<int32_t> weights;
+};
+
+static double Sinc(double x) {
+  if (fabs(x) < 1e-9) {
+    return 1.0;
+  }
+  x *= 3.14159265358979323846;
+  return sin(x) / x;
+}
+
+static double Lanczos3(double x) {
+  return fabs(x) < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+}
+
+/* Input span [offset; offset + length) is mapped onto output samples with
+ * pixel centers aligned; Taps are clamped to [lo; hi) input samples;
+ */
+static FilterTable MakeFilterTable(ResizeFilter filter, double offset,
+                                   double length, uint32_t lo, uint32_t hi,
+                                   uint32_t size) {
+  auto const scale = length / size;
+  if (RESIZE_AREA == filter && scale <= 1.0) {
+    filter = RESIZE_BILINEAR;
+  }
+
+  auto const support = 3.0 * max(scale, 1.0);
+  uint32_t max_taps;
+  switch (filter) {
+  case RESIZE_NEAREST:
+    max_taps = 1U;
+    break;
+  case RESIZE_BILINEAR:
+    max_taps = 2U;
+    break;
+  case RESIZE_AREA:
+    max_taps = (uint32_t)ceil(scale) + 1U;
+    break;
+  default:
+    max_taps = 2U * (uint32_t)ceil(support) + 1U;
+    break;
+  }
+
+  FilterTable table;
+  table.size = size;
+  table.taps = min(max_taps, hi - lo);
+  table.start.resize(size);
+  table.weights.resize((size_t)table.taps * size);
+
+  vector<int32_t> index;
+  vector<double> weight;
+  vector<double> taps(table.taps);
+  for (auto i = 0U; i < size; i++) {
+    index.clear();
+    weight.clear();
+
+    auto const center = offset + (i + 0.5) * scale;
+    switch (filter) {
+    case RESIZE_NEAREST:
+      index.push_back((int32_t)floor(center));
+      weight.push_back(1.0);
+      break;
+    case RESIZE_BILINEAR: {
+      auto const pos = center - 0.5;
+      auto const first = floor(pos);
+      index.push_back((int32_t)first);
+      weight.push_back(1.0 - (pos - first));
+      index.push_back((int32_t)first + 1);
+      weight.push_back(pos - first);
+    } break;
+    case RESIZE_AREA: {
+      auto const begin = offset + i * scale, end = begin + scale;
+      for (auto j = floor(begin); j < end; j += 1.0) {
+        index.push_back((int32_t)j);
+        weight.push_back(min(end, j + 1.0) - max(begin, j));
+      }
+    } break;
+    default: {
+      auto const pos = center - 0.5;
+      auto const filter_scale = max(scale, 1.0);
+      for (auto j = ceil(pos - support); j <= pos + support; j += 1.0) {
+        index.push_back((int32_t)j);
+        weight.push_back(Lanczos3((j - pos) / filter_scale));
+      }
+    } break;
+    }
+
+    // Samples beyond input edges are replaced by edge ones;
+    auto first = (int32_t)hi;
+    for (auto &j : index) {
+      j = min(max(j, (int32_t)lo), (int32_t)hi - 1);
+      first = min(first, j);
+    }
+    auto const start = min(first, (int32_t)(hi - table.taps));
+    table.start[i] = start;
+
+    fill(taps.begin(), taps.end(), 0.0);
+    auto sum = 0.0;
+    for (size_t k = 0U; k < index.size(); k++) {
+      taps[index[k] - start] += weight[k];
+      sum += weight[k];
+    }
+
+    // Normalized weights are rounded so that they sum up to exactly 1.0;
+    auto const one = 1 << weight_bits;
+    auto total = 0, biggest = 0;
+    for (auto t = 0U; t < table.taps; t++) {
+      auto const w = (int32_t)lround(taps[t] / sum * one);
+      table.weights[(size_t)t * size + i] = w;
+      total += w;
+      if (abs(w) > abs(table.weights[(size_t)biggest * size + i])) {
+        biggest = t;
+      }
+    }
+    table.weights[(size_t)biggest * size + i] += one - total;
+  }
+
+  return table;
+}
+
+static inline uint8_t ClampPixel(int32_t value) {
+  return (uint8_t)min(max(value, 0), 255);
+}
+
+/* Horizontal pass for outputs [begin; end) of single row;
+ * Output is interleaved the same way as input;
+ */
+static void HorizontalRange(const uint8_t *src, int16_t *dst,
+                            const FilterTable &t, uint32_t channels,
+                            uint32_t begin, uint32_t end) {
+  for (auto x = begin; x < end; x++) {
+    auto const in = src + (size_t)t.start[x] * channels;
+    for (auto c = 0U; c < channels; c++) {
+      int32_t acc = 1 << (h_shift - 1);
+      for (auto k = 0U; k < t.taps; k++) {
+        acc += t.weights[(size_t)k * t.size + x] * in[k * channels + c];
+      }
+      dst[x * channels + c] = (int16_t)(acc >> h_shift);
+    }
+  }
+}
+
+/* Last argument is number of bytes which may be read from row, SIMD
+ * kernels load few bytes past the last tap;
+ */
+static void HorizontalRowScalar(const uint8_t *src, int16_t *dst,
+                                const FilterTable &t, uint32_t channels,
+                                uint32_t) {
+  HorizontalRange(src, dst, t, channels, 0U, t.size);
+}
+
+static void VerticalRowScalar(const int16_t *const *rows,
+                              const int16_t *weights, uint32_t taps,
+                              uint8_t *dst, uint32_t length) {
+  for (auto x = 0U; x < length; x++) {
+    int32_t acc = 1 << (v_shift - 1);
+    for (auto k = 0U; k < taps; k++) {
+      acc += weights[k] * rows[k][x];
+    }
+    dst[x] = ClampPixel(acc >> v_shift);
+  }
+}
+
+#if defined(VPF_HOST_RESIZE_X86)
+/* Every tap of 8 adjacent outputs is fetched with one gather, 4 bytes are
+ * loaded at once, so all channels of input pixel come at once;
+ */
+template <uint32_t channels>
+TARGET_AVX2 static void HorizontalPixelsAvx2(const uint8_t *src,
+                                             int16_t *dst,
+                                             const FilterTable &t,
+                                             uint32_t src_size) {
+  auto simd_end = t.size;
+  while (simd_end &&
+         (t.start[simd_end - 1] + t.taps - 1U) * channels + 4U > src_size) {
+    simd_end--;
+  }
+  simd_end &= ~7U;
+
+  auto const mask = _mm256_set1_epi32(0xFF);
+  auto const round = _mm256_set1_epi32(1 << (h_shift - 1));
+  auto const step = _mm256_set1_epi32(channels);
+  for (auto x = 0U; x < simd_end; x += 8U) {
+    auto offsets =
+        _mm256_loadu_si256((const __m256i *)(t.start.data() + x));
+    if (channels > 1U) {
+      offsets = _mm256_mullo_epi32(offsets, step);
+    }
+
+    __m256i acc[channels];
+    for (auto c = 0U; c < channels; c++) {
+      acc[c] = round;
+    }
+
+    auto weights = t.weights.data() + x;
+    for (auto k = 0U; k < t.taps; k++, weights += t.size) {
+      auto const pixels =
+          _mm256_i32gather_epi32((const int *)src, offsets, 1);
+      auto const w = _mm256_loadu_si256((const __m256i *)weights);
+      for (auto c = 0U; c < channels; c++) {
+        auto const value =
+            _mm256_and_si256(_mm256_srli_epi32(pixels, 8 * c), mask);
+        acc[c] = _mm256_add_epi32(acc[c], _mm256_mullo_epi32(value, w));
+      }
+      offsets = _mm256_add_epi32(offsets, step);
+    }
+
+    if (1U == channels) {
+      auto const value = _mm256_srai_epi32(acc[0], h_shift);
+      auto const packed = _mm256_permute4x64_epi64(
+          _mm256_packs_epi32(value, value), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128((__m128i *)(dst + x),
+                       _mm256_castsi256_si128(packed));
+    } else {
+      alignas(32) int32_t values[channels][8];
+      for (auto c = 0U; c < channels; c++) {
+        _mm256_store_si256((__m256i *)values[c],
+                           _mm256_srai_epi32(acc[c], h_shift));
+      }
+      for (auto i = 0U; i < 8U; i++) {
+        for (auto c = 0U; c < channels; c++) {
+          dst[(x + i) * channels + c] = (int16_t)values[c][i];
+        }
+      }
+    }
+  }
+
+  HorizontalRange(src, dst, t, channels, simd_end, t.size);
+}
+
+TARGET_AVX2 static void HorizontalRowAvx2(const uint8_t *src, int16_t *dst,
+                                          const FilterTable &t,
+                                          uint32_t channels,
+                                          uint32_t src_size) {
+  switch (channels) {
+  case 1U:
+    HorizontalPixelsAvx2<1U>(src, dst, t, src_size);
+    break;
+  case 2U:
+    HorizontalPixelsAvx2<2U>(src, dst, t, src_size);
+    break;
+  case 3U:
+    HorizontalPixelsAvx2<3U>(src, dst, t, src_size);
+    break;
+  default:
+    HorizontalRange(src, dst, t, channels, 0U, t.size);
+    break;
+  }
+}
+
+/* Two input rows are interleaved, so each multiply-add applies two taps;
+ * Sum of products fits into 32 bits as weights are Q14 and inputs are Q6;
+ */
+TARGET_AVX2 static void VerticalRowAvx2(const int16_t *const *rows,
+                                        const int16_t *weights,
+                                        uint32_t taps, uint8_t *dst,
+                                        uint32_t length) {
+  auto const round = _mm256_set1_epi32(1 << (v_shift - 1));
+  auto x = 0U;
+  for (; x + 16U <= length; x += 16U) {
+    auto lo = round, hi = round;
+    for (auto k = 0U; k < taps; k += 2U) {
+      auto const a = _mm256_loadu_si256((const __m256i *)(rows[k] + x));
+      auto b = _mm256_setzero_si256();
+      auto w = (uint32_t)(uint16_t)weights[k];
+      if (k + 1U < taps) {
+        b = _mm256_loadu_si256((const __m256i *)(rows[k + 1U] + x));
+        w |= (uint32_t)(uint16_t)weights[k + 1U] << 16;
+      }
+      auto const pair = _mm256_set1_epi32((int32_t)w);
+      lo = _mm256_add_epi32(
+          lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), pair));
+      hi = _mm256_add_epi32(
+          hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), pair));
+    }
+
+    auto const words = _mm256_packs_epi32(_mm256_srai_epi32(lo, v_shift),
+                                          _mm256_srai_epi32(hi, v_shift));
+    auto const bytes = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(words, words), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128((__m128i *)(dst + x), _mm256_castsi256_si128(bytes));
+  }
+
+  for (; x < length; x++) {
+    int32_t acc = 1 << (v_shift - 1);
+    for (auto k = 0U; k < taps; k++) {
+      acc += weights[k] * rows[k][x];
+    }
+    dst[x] = ClampPixel(acc >> v_shift);
+  }
+}
+#endif
+
+#if defined(VPF_HOST_RESIZE_NEON)
+static void VerticalRowNeon(const int16_t *const *rows,
+                            const int16_t *weights, uint32_t taps,
+                            uint8_t *dst, uint32_t length) {
+  auto x = 0U;
+  for (; x + 8U <= length; x += 8U) {
+    auto lo = vdupq_n_s32(1 << (v_shift - 1)), hi = lo;
+    for (auto k = 0U; k < taps; k++) {
+      auto const row = vld1q_s16(rows[k] + x);
+      lo = vmlal_n_s16(lo, vget_low_s16(row), weights[k]);
+      hi = vmlal_n_s16(hi, vget_high_s16(row), weights[k]);
+    }
+
+    auto const words = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, v_shift)),
+                                    vqmovn_s32(vshrq_n_s32(hi, v_shift)));
+    vst1_u8(dst + x, vqmovun_s16(words));
+  }
+
+  for (; x < length; x++) {
+    int32_t acc = 1 << (v_shift - 1);
+    for (auto k = 0U; k < taps; k++) {
+      acc += weights[k] * rows[k][x];
+    }
+    dst[x] = ClampPixel(acc >> v_shift);
+  }
+}
+#endif
+
+struct ResizeRowFuncs {
+  void (*horizontal_row)(const uint8_t *src, int16_t *dst,
+                         const FilterTable &t, uint32_t channels,
+                         uint32_t src_size);
+  void (*vertical_row)(const int16_t *const *rows, const int16_t *weights,
+                       uint32_t taps, uint8_t *dst, uint32_t length);
+};
+
+static const ResizeRowFuncs scalar_funcs = {HorizontalRowScalar,
+                                            VerticalRowScalar};
+
+#if defined(VPF_HOST_RESIZE_X86)
+static const ResizeRowFuncs avx2_funcs = {HorizontalRowAvx2,
+                                          VerticalRowAvx2};
+#endif
+
+// NEON has no gather, so horizontal pass is scalar there;
+#if defined(VPF_HOST_RESIZE_NEON)
+static const ResizeRowFuncs neon_funcs = {HorizontalRowScalar,
+                                          VerticalRowNeon};
+#endif
+
+static const ResizeRowFuncs &GetRowFuncs(HostCvtKernel kernel) {
+  switch (kernel) {
+#if defined(VPF_HOST_RESIZE_X86)
+  case HOST_CVT_AVX2:
+    return avx2_funcs;
+#endif
+#if defined(VPF_HOST_RESIZE_NEON)
+  case HOST_CVT_NEON:
+    return neon_funcs;
+#endif
+  default:
+    return scalar_funcs;
+  }
+}
+
+/* Bands of single resize which are taken one by one by calling thread and
+ * helper jobs on TaskExecutor;
+ */
+struct BandJob {
+  const function<void(uint32_t)> &func;
+  const uint32_t num_bands;
+  atomic<uint32_t> next_band;
+  uint32_t num_done = 0U;
+  mutex done_lock;
+  condition_variable done_cv;
+
+  BandJob(const function<void(uint32_t)> &f, uint32_t n)
+      : func(f), num_bands(n), next_band(0U) {}
+
+  // Function isn't touched once all bands are taken;
+  void Work() {
+    for (auto band = next_band++; band < num_bands; band = next_band++) {
+      func(band);
+      lock_guard<mutex> lock(done_lock);
+      if (++num_done == num_bands) {
+        done_cv.notify_all();
+      }
+    }
+  }
+};
+
+/* Helper job of band resize; Executor runs jobs of one Task sequentially,
+ * so every helper needs own Task; They're kept for reuse and never
+ * destroyed, like executor itself;
+ */
+class BandTask final : public Task {
+public:
+  shared_ptr<BandJob> job;
+
+  BandTask() : Task("HostResizeBands", 0U, 0U) {}
+
+  TaskExecStatus Run() final {
+    job->Work();
+    return TaskExecStatus::TASK_EXEC_SUCCESS;
+  }
+
+  static BandTask *Take() {
+    lock_guard<mutex> lock(free_lock);
+    if (free_tasks.empty()) {
+      return new BandTask;
+    }
+    auto task = free_tasks.back();
+    free_tasks.pop_back();
+    return task;
+  }
+
+  static void Return(Task *task, TaskJobStatus) {
+    auto band_task = static_cast<BandTask *>(task);
+    band_task->job.reset();
+    lock_guard<mutex> lock(free_lock);
+    free_tasks.push_back(band_task);
+  }
+
+private:
+  static mutex free_lock;
+  static vector<BandTask *> free_tasks;
+};
+
+mutex BandTask::free_lock;
+vector<BandTask *> BandTask::free_tasks;
+
+/* Runs bands on process-wide TaskExecutor, so resize shares its threads
+ * with other tasks and never oversubscribes CPU; Calling thread processes
+ * bands as well, so call made from executor job or with all workers busy
+ * still makes progress; Helpers which start late find no bands and quit;
+ */
+static void RunBands(uint32_t numBands, uint32_t numThreads,
+                     const function<void(uint32_t)> &func) {
+  auto &executor = TaskExecutor::Instance();
+  auto const num_helpers =
+      min(min(numBands, numThreads), executor.GetNumThreads() + 1U) - 1U;
+  if (!num_helpers) {
+    for (auto band = 0U; band < numBands; band++) {
+      func(band);
+    }
+    return;
+  }
+
+  auto job = make_shared<BandJob>(func, numBands);
+  for (auto i = 0U; i < num_helpers; i++) {
+    auto task = BandTask::Take();
+    task->job = job;
+    executor.Submit(task, &BandTask::Return);
+  }
+
+  job->Work();
+  unique_lock<mutex> lock(job->done_lock);
+  job->done_cv.wait(lock, [&]() { return job->num_done == numBands; });
+}
+
+// Plane memory, width is in pixels;
+struct PlaneView {
+  uint8_t *ptr;
+  size_t pitch;
+  uint32_t width;
+  uint32_t height;
+};
+
+/* Resizes part of single plane; Filter taps hold absolute input positions,
+ * so crop offset is in tables, not in input pointer;
+ */
+struct PlaneResizer {
+  const ResizeRowFuncs *f;
+  ResizeFilter filter;
+  uint32_t channels;
+  PlaneView src;
+  PlaneView dst;
+  // Input isn't scaled, rows are just copied;
+  bool is_copy;
+  FilterTable h;
+  FilterTable v;
+
+  void CopyRows(uint32_t begin, uint32_t end) const {
+    for (auto y = begin; y < end; y++) {
+      memcpy(dst.ptr + (size_t)y * dst.pitch,
+             src.ptr + (size_t)v.start[y] * src.pitch +
+                 (size_t)h.start[0] * channels,
+             (size_t)dst.width * channels);
+    }
+  }
+
+  // Nearest neighbor just picks pixels, there's nothing to interpolate;
+  template <uint32_t n>
+  void NearestRows(uint32_t begin, uint32_t end) const {
+    for (auto y = begin; y < end; y++) {
+      auto const in = src.ptr + (size_t)v.start[y] * src.pitch;
+      auto out = dst.ptr + (size_t)y * dst.pitch;
+      for (auto x = 0U; x < dst.width; x++, out += n) {
+        auto const pixel = in + (size_t)h.start[x] * n;
+        for (auto c = 0U; c < n; c++) {
+          out[c] = pixel[c];
+        }
+      }
+    }
+  }
+
+  void FilteredRows(uint32_t begin, uint32_t end) const {
+    /* Horizontally filtered input rows are kept in ring buffer, vertical
+     * window only moves forward;
+     */
+    auto const row_size = dst.width * channels;
+    vector<int16_t> ring((size_t)v.taps * row_size);
+    vector<const int16_t *> rows(v.taps);
+    vector<int16_t> weights(v.taps);
+
+    auto next_row = 0;
+    for (auto y = begin; y < end; y++) {
+      auto const first = v.start[y];
+      for (auto r = max(next_row, first); r < first + (int32_t)v.taps; r++) {
+        f->horizontal_row(src.ptr + (size_t)r * src.pitch,
+                          ring.data() + (size_t)(r % v.taps) * row_size, h,
+                          channels, src.width * channels);
+      }
+      next_row = first + (int32_t)v.taps;
+
+      for (auto k = 0U; k < v.taps; k++) {
+        rows[k] = ring.data() + (size_t)((first + k) % v.taps) * row_size;
+        weights[k] = (int16_t)v.weights[(size_t)k * v.size + y];
+      }
+      f->vertical_row(rows.data(), weights.data(), v.taps,
+                      dst.ptr + (size_t)y * dst.pitch, row_size);
+    }
+  }
+
+  void Rows(uint32_t begin, uint32_t end) const {
+    if (is_copy) {
+      CopyRows(begin, end);
+    } else if (RESIZE_NEAREST != filter) {
+      FilteredRows(begin, end);
+    } else if (1U == channels) {
+      NearestRows<1U>(begin, end);
+    } else if (2U == channels) {
+      NearestRows<2U>(begin, end);
+    } else {
+      NearestRows<3U>(begin, end);
+    }
+  }
+};
+
+static uint32_t GetNumChannels(Pixel_Format format, uint32_t plane) {
+  switch (format) {
+  case RGB:
+  case BGR:
+    return 3U;
+  case NV12:
+    return plane ? 2U : 1U;
+  default:
+    return 1U;
+  }
+}
+
+static PlaneView GetPlaneView(Surface *pSurface, uint32_t plane,
+                              uint32_t channels) {
+  PlaneView view;
+  view.ptr = (uint8_t *)pSurface->PlanePtr(plane);
+  view.pitch = pSurface->Pitch(plane);
+  view.width = pSurface->WidthInBytes(plane) / channels;
+  view.height = pSurface->Height(plane);
+  return view;
+}
+
+/* Rectangle is scaled to every plane size, so 4:2:0 chroma of crop which
+ * starts at odd pixel starts between chroma samples;
+ * Taps are clamped to rectangle, so pixels around it don't leak in;
+ */
+static void AddPlaneResizers(const ResizeRowFuncs &f, ResizeFilter filter,
+                             Surface *pSrc, const SurfaceRect &rect,
+                             Surface *pDst, vector<PlaneResizer> &resizers) {
+  auto const format = pSrc->PixelFormat();
+  for (auto plane = 0U; plane < pSrc->NumPlanes(); plane++) {
+    PlaneResizer r;
+    r.f = &f;
+    r.filter = filter;
+    r.channels = GetNumChannels(format, plane);
+    r.src = GetPlaneView(pSrc, plane, r.channels);
+    r.dst = GetPlaneView(pDst, plane, r.channels);
+    if (!r.src.width || !r.src.height || !r.dst.width || !r.dst.height) {
+      continue;
+    }
+
+    auto const scale_x = (double)r.src.width / pSrc->Width();
+    auto const scale_y = (double)r.src.height / pSrc->Height();
+    auto const x = rect.x * scale_x, width = rect.width * scale_x;
+    auto const y = rect.y * scale_y, height = rect.height * scale_y;
+    auto const lo_x = (uint32_t)floor(x), lo_y = (uint32_t)floor(y);
+    auto const hi_x = max(min((uint32_t)ceil(x + width), r.src.width),
+                          lo_x + 1U);
+    auto const hi_y = max(min((uint32_t)ceil(y + height), r.src.height),
+                          lo_y + 1U);
+
+    r.is_copy = width == r.dst.width && height == r.dst.height &&
+                x == lo_x && y == lo_y;
+    auto const table_filter = r.is_copy ? RESIZE_NEAREST : filter;
+    r.h = MakeFilterTable(table_filter, x, width, lo_x, hi_x, r.dst.width);
+    r.v = MakeFilterTable(table_filter, y, height, lo_y, hi_y, r.dst.height);
+    resizers.push_back(move(r));
+  }
+}
+
+/* Every plane is split into bands of rows, bands of all planes run as one
+ * batch;
+ */
+static void RunResizers(const vector<PlaneResizer> &resizers,
+                        uint32_t numThreads) {
+  struct Band {
+    const PlaneResizer *resizer;
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  vector<Band> bands;
+  for (auto const &r : resizers) {
+    auto const size = (size_t)r.dst.width * r.channels * r.dst.height;
+    auto const num_bands = (uint32_t)min<size_t>(
+        min(numThreads, r.dst.height), max<size_t>(size / min_band_size, 1U));
+    auto const band_height = (r.dst.height + num_bands - 1U) / num_bands;
+    for (auto begin = 0U; begin < r.dst.height; begin += band_height) {
+      const Band band = {&r, begin, min(begin + band_height, r.dst.height)};
+      bands.push_back(band);
+    }
+  }
+
+  RunBands((uint32_t)bands.size(), numThreads, [&](uint32_t i) {
+    bands[i].resizer->Rows(bands[i].begin, bands[i].end);
+  });
+}
+
+// Executor workers plus calling thread;
+static uint32_t GetDefaultNumThreads() {
+  return TaskExecutor::Instance().GetNumThreads() + 1U;
+}
+
+static bool IsHostSurface(Surface *pSurface) {
+  return pSurface && !pSurface->Empty() && MEM_HOST == pSurface->MemType();
+}
+
+// NV12 chroma plane doesn't cover odd sizes;
+static bool HasValidSize(Surface *pSurface) {
+  return NV12 != pSurface->PixelFormat() ||
+         !((pSurface->Width() | pSurface->Height()) & 1U);
+}
+
+static bool IsInside(const SurfaceRect &rect, Surface *pSurface) {
+  return rect.width && rect.height && rect.x < pSurface->Width() &&
+         rect.y < pSurface->Height() &&
+         rect.width <= pSurface->Width() - rect.x &&
+         rect.height <= pSurface->Height() - rect.y;
+}
+
+namespace VPF {
+const char *GetResizeFilterName(ResizeFilter filter) {
+  switch (filter) {
+  case RESIZE_NEAREST:
+    return "nearest";
+  case RESIZE_BILINEAR:
+    return "bilinear";
+  case RESIZE_AREA:
+    return "area";
+  case RESIZE_LANCZOS:
+    return "lanczos";
+  default:
+    return "unknown";
+  }
+}
+
+bool CropResizeSurfaceHost(Surface *pSrc, const SurfaceRect *pRects,
+                           Surface *const *ppDst, size_t numCrops,
+                           ResizeFilter filter, uint32_t numThreads,
+                           HostCvtKernel kernel) {
+  if (!IsHostSurface(pSrc) || !HasValidSize(pSrc) || !pRects || !ppDst) {
+    return false;
+  }
+
+  for (size_t i = 0U; i < numCrops; i++) {
+    auto const pDst = ppDst[i];
+    if (!IsHostSurface(pDst) || !HasValidSize(pDst) ||
+        pSrc->PixelFormat() != pDst->PixelFormat() ||
+        pSrc->NumPlanes() != pDst->NumPlanes() ||
+        !IsInside(pRects[i], pSrc)) {
+      return false;
+    }
+  }
+
+  if (GetHostCvtKernel() != kernel) {
+    kernel = HOST_CVT_SCALAR;
+  }
+  if (!numThreads) {
+    numThreads = GetDefaultNumThreads();
+  }
+  auto const &f = GetRowFuncs(kernel);
+
+  vector<PlaneResizer> resizers;
+  resizers.reserve(numCrops * pSrc->NumPlanes());
+  for (size_t i = 0U; i < numCrops; i++) {
+    AddPlaneResizers(f, filter, pSrc, pRects[i], ppDst[i], resizers);
+  }
+  RunResizers(resizers, numThreads);
+
+  return true;
+}
+
+bool CropResizeSurfaceHost(Surface *pSrc, const SurfaceRect *pRects,
+                           Surface *const *ppDst, size_t numCrops,
+                           ResizeFilter filter) {
+  return CropResizeSurfaceHost(pSrc, pRects, ppDst, numCrops, filter, 0U,
+                               GetHostCvtKernel());
+}
+
+bool ResizeSurfaceHost(Surface *pSrc, Surface *pDst, ResizeFilter filter,
+                       uint32_t numThreads, HostCvtKernel kernel) {
+  if (!pSrc || pSrc->Empty()) {
+    return false;
+  }
+
+  const SurfaceRect rect = {0U, 0U, pSrc->Width(), pSrc->Height()};
+  return CropResizeSurfaceHost(pSrc, &rect, &pDst, 1U, filter, numThreads,
+                               kernel);
+}
+
+bool ResizeSurfaceHost(Surface *pSrc, Surface *pDst, ResizeFilter filter) {
+  return ResizeSurfaceHost(pSrc, pDst, filter, 0U, GetHostCvtKernel());
+}
+} // namespace VPF
@@ -0,0 +1,815 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostTensorCvt.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||          \
+    defined(_M_IX86)
+#define VPF_HOST_TENSOR_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VPF_HOST_TENSOR_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+#else
+#define TARGET_AVX2_F16C
+#endif
+
+using namespace VPF;
+using namespace std;
+
+/* Tensors bigger than this are unlikely to stay in cache anyway,
+ * so they are written with non-temporal stores;
+ */
+static const size_t non_temporal_threshold = 4U * 1024U * 1024U;
+
+/* Whole conversion is done in single precision floats;
+ * Every kernel does the same operations in the same order, so results
+ * only differ if compiler fuses multiplications and additions;
+ */
+struct TensorCoeffs {
+  // Luma in [0;255] range is y * y_gain + y_bias;
+  float y_gain;
+  float y_bias;
+  // Chroma gains applied to (c - 128), green ones are subtracted;
+  float r_cr;
+  float g_cb;
+  float g_cr;
+  float b_cb;
+  // Output value is clamped channel * gain + bias, in R, G, B order;
+  float gain[3];
+  float bias[3];
+};
+
+// Output row, channel pointers are in R, G, B order;
+struct TensorRow {
+  void *ch[3];
+  bool is_half;
+  bool non_temporal;
+};
+
+// Horizontally resampled rows and vertical weights for one output row;
+struct ResampledRows {
+  const float *y[2];
+  const float *u[2];
+  const float *v[2];
+  float y_weight;
+  float c_weight;
+};
+
+static TensorCoeffs MakeTensorCoeffs(const TensorParams &params,
+                                     const ColorspaceConversionContext *pCtx) {
+  double kr = 0.299, kb = 0.114;
+  if (pCtx && BT_709 == pCtx->color_space) {
+    kr = 0.2126;
+    kb = 0.0722;
+  }
+  auto const kg = 1.0 - kr - kb;
+
+  auto const is_full = pCtx && JPEG == pCtx->color_range;
+  auto const y_scale = is_full ? 1.0 : 255.0 / 219.0;
+  auto const c_scale = is_full ? 1.0 : 255.0 / 224.0;
+  auto const y_offset = is_full ? 0.0 : 16.0;
+
+  TensorCoeffs c;
+  c.y_gain = (float)y_scale;
+  c.y_bias = (float)(-y_offset * y_scale);
+  c.r_cr = (float)(2.0 * (1.0 - kr) * c_scale);
+  c.g_cb = (float)(2.0 * kb * (1.0 - kb) / kg * c_scale);
+  c.g_cr = (float)(2.0 * kr * (1.0 - kr) / kg * c_scale);
+  c.b_cb = (float)(2.0 * (1.0 - kb) * c_scale);
+
+  for (int i = 0; i < 3; i++) {
+    auto const ch = params.is_bgr ? 2 - i : i;
+    c.gain[i] = params.scale / params.std[ch];
+    c.bias[i] = -params.mean[ch] / params.std[ch];
+  }
+  return c;
+}
+
+static inline uint32_t FloatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static inline float BitsToFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* Rounds to nearest even like vcvtps2ph and fcvtn do;
+ * Denormals, infinities and NaN are handled as well;
+ */
+static inline uint16_t FloatToHalf(float value) {
+  // 2^112 and 2^-110;
+  const float scale_to_inf = 5.192296858534828e+33f;
+  const float scale_to_zero = 7.703719777548943e-34f;
+  auto base = (fabsf(value) * scale_to_inf) * scale_to_zero;
+
+  auto const w = FloatBits(value);
+  auto const shl1_w = w + w;
+  auto const sign = w & 0x80000000U;
+  auto bias = shl1_w & 0xFF000000U;
+  if (bias < 0x71000000U) {
+    bias = 0x71000000U;
+  }
+
+  base = BitsToFloat((bias >> 1) + 0x07800000U) + base;
+  auto const bits = FloatBits(base);
+  auto const exp_bits = (bits >> 13) & 0x00007C00U;
+  auto const mantissa_bits = bits & 0x00000FFFU;
+  auto const nonsign = exp_bits + mantissa_bits;
+  return (uint16_t)((sign >> 16) |
+                    (shl1_w > 0xFF000000U ? 0x7E00U : nonsign));
+}
+
+static inline float Lerp(float a, float b, float weight) {
+  return a + (b - a) * weight;
+}
+
+static inline void StorePixel(const TensorRow &dst, uint32_t x, float y,
+                              float u, float v, const TensorCoeffs &c) {
+  auto const luma = y * c.y_gain + c.y_bias;
+  auto const cb = u - 128.0f;
+  auto const cr = v - 128.0f;
+
+  float rgb[3];
+  rgb[0] = luma + cr * c.r_cr;
+  rgb[1] = (luma - cb * c.g_cb) - cr * c.g_cr;
+  rgb[2] = luma + cb * c.b_cb;
+
+  for (int i = 0; i < 3; i++) {
+    auto const value = min(max(rgb[i], 0.0f), 255.0f) * c.gain[i] + c.bias[i];
+    if (dst.is_half) {
+      ((uint16_t *)dst.ch[i])[x] = FloatToHalf(value);
+    } else {
+      ((float *)dst.ch[i])[x] = value;
+    }
+  }
+}
+
+static void Nv12RowScalar(const uint8_t *y, const uint8_t *uv,
+                          const TensorRow &dst, uint32_t width,
+                          const TensorCoeffs &c) {
+  for (uint32_t x = 0; x < width; x++) {
+    auto const pair = uv + (x & ~1U);
+    StorePixel(dst, x, y[x], pair[0], pair[1], c);
+  }
+}
+
+static void I420RowScalar(const uint8_t *y, const uint8_t *u,
+                          const uint8_t *v, const TensorRow &dst,
+                          uint32_t width, const TensorCoeffs &c) {
+  for (uint32_t x = 0; x < width; x++) {
+    StorePixel(dst, x, y[x], u[x / 2], v[x / 2], c);
+  }
+}
+
+static void ResampledRowScalar(const ResampledRows &src, const TensorRow &dst,
+                               uint32_t width, const TensorCoeffs &c) {
+  for (uint32_t x = 0; x < width; x++) {
+    StorePixel(dst, x, Lerp(src.y[0][x], src.y[1][x], src.y_weight),
+               Lerp(src.u[0][x], src.u[1][x], src.c_weight),
+               Lerp(src.v[0][x], src.v[1][x], src.c_weight), c);
+  }
+}
+
+#if defined(VPF_HOST_TENSOR_X86)
+struct TensorCoeffsAvx2 {
+  __m256 y_gain;
+  __m256 y_bias;
+  __m256 c_offset;
+  __m256 r_cr;
+  __m256 g_cb;
+  __m256 g_cr;
+  __m256 b_cb;
+  __m256 zero;
+  __m256 max;
+  __m256 gain[3];
+  __m256 bias[3];
+};
+
+TARGET_AVX2_F16C static inline void
+InitTensorCoeffsAvx2(const TensorCoeffs &c, TensorCoeffsAvx2 &k) {
+  k.y_gain = _mm256_set1_ps(c.y_gain);
+  k.y_bias = _mm256_set1_ps(c.y_bias);
+  k.c_offset = _mm256_set1_ps(128.0f);
+  k.r_cr = _mm256_set1_ps(c.r_cr);
+  k.g_cb = _mm256_set1_ps(c.g_cb);
+  k.g_cr = _mm256_set1_ps(c.g_cr);
+  k.b_cb = _mm256_set1_ps(c.b_cb);
+  k.zero = _mm256_setzero_ps();
+  k.max = _mm256_set1_ps(255.0f);
+  for (int i = 0; i < 3; i++) {
+    k.gain[i] = _mm256_set1_ps(c.gain[i]);
+    k.bias[i] = _mm256_set1_ps(c.bias[i]);
+  }
+}
+
+// Streaming stores need aligned destination;
+static bool IsStreamable(const TensorRow &dst) {
+  auto const align = dst.is_half ? sizeof(__m128i) : sizeof(__m256);
+  auto const addr =
+      (uintptr_t)dst.ch[0] | (uintptr_t)dst.ch[1] | (uintptr_t)dst.ch[2];
+  return dst.non_temporal && !(addr & (align - 1));
+}
+
+TARGET_AVX2_F16C static inline __m256 BytesToFloat(__m128i value) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(value));
+}
+
+TARGET_AVX2_F16C static inline __m256 Lerp8(const float *a, const float *b,
+                                            __m256 weight) {
+  auto const va = _mm256_loadu_ps(a);
+  auto const vb = _mm256_loadu_ps(b);
+  return _mm256_add_ps(va, _mm256_mul_ps(_mm256_sub_ps(vb, va), weight));
+}
+
+TARGET_AVX2_F16C static inline void
+StorePixels8(const TensorRow &dst, uint32_t x, bool stream, __m256 y,
+             __m256 u, __m256 v, const TensorCoeffsAvx2 &k) {
+  auto const luma = _mm256_add_ps(_mm256_mul_ps(y, k.y_gain), k.y_bias);
+  auto const cb = _mm256_sub_ps(u, k.c_offset);
+  auto const cr = _mm256_sub_ps(v, k.c_offset);
+
+  __m256 rgb[3];
+  rgb[0] = _mm256_add_ps(luma, _mm256_mul_ps(cr, k.r_cr));
+  rgb[1] = _mm256_sub_ps(_mm256_sub_ps(luma, _mm256_mul_ps(cb, k.g_cb)),
+                         _mm256_mul_ps(cr, k.g_cr));
+  rgb[2] = _mm256_add_ps(luma, _mm256_mul_ps(cb, k.b_cb));
+
+  for (int i = 0; i < 3; i++) {
+    auto value = _mm256_min_ps(_mm256_max_ps(rgb[i], k.zero), k.max);
+    value = _mm256_add_ps(_mm256_mul_ps(value, k.gain[i]), k.bias[i]);
+
+    if (dst.is_half) {
+      auto const half = _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT);
+      auto const ptr = (__m128i *)((uint16_t *)dst.ch[i] + x);
+      if (stream) {
+        _mm_stream_si128(ptr, half);
+      } else {
+        _mm_storeu_si128(ptr, half);
+      }
+    } else {
+      auto const ptr = (float *)dst.ch[i] + x;
+      if (stream) {
+        _mm256_stream_ps(ptr, value);
+      } else {
+        _mm256_storeu_ps(ptr, value);
+      }
+    }
+  }
+}
+
+TARGET_AVX2_F16C static void Nv12RowAvx2(const uint8_t *y, const uint8_t *uv,
+                                         const TensorRow &dst,
+                                         uint32_t width,
+                                         const TensorCoeffs &c) {
+  TensorCoeffsAvx2 k;
+  InitTensorCoeffsAvx2(c, k);
+  auto const stream = IsStreamable(dst);
+
+  // Replicate every chroma sample for 2 neighbour pixels;
+  auto const u_mask = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1,
+                                    -1, -1, -1, -1);
+  auto const v_mask = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1,
+                                    -1, -1, -1, -1);
+
+  uint32_t x = 0;
+  for (; x + 8 <= width; x += 8) {
+    auto const luma = _mm_loadl_epi64((const __m128i *)(y + x));
+    auto const chroma = _mm_loadl_epi64((const __m128i *)(uv + x));
+    StorePixels8(dst, x, stream, BytesToFloat(luma),
+                 BytesToFloat(_mm_shuffle_epi8(chroma, u_mask)),
+                 BytesToFloat(_mm_shuffle_epi8(chroma, v_mask)), k);
+  }
+
+  for (; x < width; x++) {
+    auto const pair = uv + (x & ~1U);
+    StorePixel(dst, x, y[x], pair[0], pair[1], c);
+  }
+
+  if (stream) {
+    _mm_sfence();
+  }
+}
+
+TARGET_AVX2_F16C static void I420RowAvx2(const uint8_t *y, const uint8_t *u,
+                                         const uint8_t *v,
+                                         const TensorRow &dst,
+                                         uint32_t width,
+                                         const TensorCoeffs &c) {
+  TensorCoeffsAvx2 k;
+  InitTensorCoeffsAvx2(c, k);
+  auto const stream = IsStreamable(dst);
+
+  auto const mask = _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, -1, -1, -1, -1, -1,
+                                  -1, -1, -1);
+
+  uint32_t x = 0;
+  for (; x + 8 <= width; x += 8) {
+    int32_t u4, v4;
+    memcpy(&u4, u + x / 2, sizeof(u4));
+    memcpy(&v4, v + x / 2, sizeof(v4));
+
+    auto const luma = _mm_loadl_epi64((const __m128i *)(y + x));
+    StorePixels8(dst, x, stream, BytesToFloat(luma),
+                 BytesToFloat(_mm_shuffle_epi8(_mm_cvtsi32_si128(u4), mask)),
+                 BytesToFloat(_mm_shuffle_epi8(_mm_cvtsi32_si128(v4), mask)),
+                 k);
+  }
+
+  for (; x < width; x++) {
+    StorePixel(dst, x, y[x], u[x / 2], v[x / 2], c);
+  }
+
+  if (stream) {
+    _mm_sfence();
+  }
+}
+
+TARGET_AVX2_F16C static void ResampledRowAvx2(const ResampledRows &src,
+                                              const TensorRow &dst,
+                                              uint32_t width,
+                                              const TensorCoeffs &c) {
+  TensorCoeffsAvx2 k;
+  InitTensorCoeffsAvx2(c, k);
+  auto const stream = IsStreamable(dst);
+  auto const y_weight = _mm256_set1_ps(src.y_weight);
+  auto const c_weight = _mm256_set1_ps(src.c_weight);
+
+  uint32_t x = 0;
+  for (; x + 8 <= width; x += 8) {
+    StorePixels8(dst, x, stream, Lerp8(src.y[0] + x, src.y[1] + x, y_weight),
+                 Lerp8(src.u[0] + x, src.u[1] + x, c_weight),
+                 Lerp8(src.v[0] + x, src.v[1] + x, c_weight), k);
+  }
+
+  for (; x < width; x++) {
+    StorePixel(dst, x, Lerp(src.y[0][x], src.y[1][x], src.y_weight),
+               Lerp(src.u[0][x], src.u[1][x], src.c_weight),
+               Lerp(src.v[0][x], src.v[1][x], src.c_weight), c);
+  }
+
+  if (stream) {
+    _mm_sfence();
+  }
+}
+#endif
+
+#if defined(VPF_HOST_TENSOR_NEON)
+struct TensorCoeffsNeon {
+  float32x4_t y_gain;
+  float32x4_t y_bias;
+  float32x4_t c_offset;
+  float32x4_t r_cr;
+  float32x4_t g_cb;
+  float32x4_t g_cr;
+  float32x4_t b_cb;
+  float32x4_t zero;
+  float32x4_t max;
+  float32x4_t gain[3];
+  float32x4_t bias[3];
+
+  explicit TensorCoeffsNeon(const TensorCoeffs &c) {
+    y_gain = vdupq_n_f32(c.y_gain);
+    y_bias = vdupq_n_f32(c.y_bias);
+    c_offset = vdupq_n_f32(128.0f);
+    r_cr = vdupq_n_f32(c.r_cr);
+    g_cb = vdupq_n_f32(c.g_cb);
+    g_cr = vdupq_n_f32(c.g_cr);
+    b_cb = vdupq_n_f32(c.b_cb);
+    zero = vdupq_n_f32(0.0f);
+    max = vdupq_n_f32(255.0f);
+    for (int i = 0; i < 3; i++) {
+      gain[i] = vdupq_n_f32(c.gain[i]);
+      bias[i] = vdupq_n_f32(c.bias[i]);
+    }
+  }
+};
+
+static inline float32x4_t Lerp4(const float *a, const float *b,
+                                float32x4_t weight) {
+  auto const va = vld1q_f32(a);
+  auto const vb = vld1q_f32(b);
+  return vaddq_f32(va, vmulq_f32(vsubq_f32(vb, va), weight));
+}
+
+static inline void StorePixels4(const TensorRow &dst, uint32_t x,
+                                float32x4_t y, float32x4_t u, float32x4_t v,
+                                const TensorCoeffsNeon &k) {
+  auto const luma = vaddq_f32(vmulq_f32(y, k.y_gain), k.y_bias);
+  auto const cb = vsubq_f32(u, k.c_offset);
+  auto const cr = vsubq_f32(v, k.c_offset);
+
+  float32x4_t rgb[3];
+  rgb[0] = vaddq_f32(luma, vmulq_f32(cr, k.r_cr));
+  rgb[1] = vsubq_f32(vsubq_f32(luma, vmulq_f32(cb, k.g_cb)),
+                     vmulq_f32(cr, k.g_cr));
+  rgb[2] = vaddq_f32(luma, vmulq_f32(cb, k.b_cb));
+
+  for (int i = 0; i < 3; i++) {
+    auto value = vminq_f32(vmaxq_f32(rgb[i], k.zero), k.max);
+    value = vaddq_f32(vmulq_f32(value, k.gain[i]), k.bias[i]);
+
+    if (dst.is_half) {
+      vst1_u16((uint16_t *)dst.ch[i] + x,
+               vreinterpret_u16_f16(vcvt_f16_f32(value)));
+    } else {
+      vst1q_f32((float *)dst.ch[i] + x, value);
+    }
+  }
+}
+
+// Converts 16 bytes to 4 vectors of floats;
+static inline void BytesToFloat(uint8x16_t value, float32x4_t (&out)[4]) {
+  auto const lo = vmovl_u8(vget_low_u8(value));
+  auto const hi = vmovl_u8(vget_high_u8(value));
+  out[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo)));
+  out[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo)));
+  out[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi)));
+  out[3] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi)));
+}
+
+static inline void StorePixels16(const TensorRow &dst, uint32_t x,
+                                 uint8x16_t y, uint8x8_t u, uint8x8_t v,
+                                 const TensorCoeffsNeon &k) {
+  // Replicate every chroma sample for 2 neighbour pixels;
+  auto const uu = vzip_u8(u, u);
+  auto const vv = vzip_u8(v, v);
+
+  float32x4_t fy[4], fu[4], fv[4];
+  BytesToFloat(y, fy);
+  BytesToFloat(vcombine_u8(uu.val[0], uu.val[1]), fu);
+  BytesToFloat(vcombine_u8(vv.val[0], vv.val[1]), fv);
+
+  for (int i = 0; i < 4; i++) {
+    StorePixels4(dst, x + 4 * i, fy[i], fu[i], fv[i], k);
+  }
+}
+
+static void Nv12RowNeon(const uint8_t *y, const uint8_t *uv,
+                        const TensorRow &dst, uint32_t width,
+                        const TensorCoeffs &c) {
+  const TensorCoeffsNeon k(c);
+
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    auto const chroma = vld2_u8(uv + x);
+    StorePixels16(dst, x, vld1q_u8(y + x), chroma.val[0], chroma.val[1], k);
+  }
+
+  for (; x < width; x++) {
+    auto const pair = uv + (x & ~1U);
+    StorePixel(dst, x, y[x], pair[0], pair[1], c);
+  }
+}
+
+static void I420RowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                        const TensorRow &dst, uint32_t width,
+                        const TensorCoeffs &c) {
+  const TensorCoeffsNeon k(c);
+
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    StorePixels16(dst, x, vld1q_u8(y + x), vld1_u8(u + x / 2),
+                  vld1_u8(v + x / 2), k);
+  }
+
+  for (; x < width; x++) {
+    StorePixel(dst, x, y[x], u[x / 2], v[x / 2], c);
+  }
+}
+
+static void ResampledRowNeon(const ResampledRows &src, const TensorRow &dst,
+                             uint32_t width, const TensorCoeffs &c) {
+  const TensorCoeffsNeon k(c);
+  auto const y_weight = vdupq_n_f32(src.y_weight);
+  auto const c_weight = vdupq_n_f32(src.c_weight);
+
+  uint32_t x = 0;
+  for (; x + 4 <= width; x += 4) {
+    StorePixels4(dst, x, Lerp4(src.y[0] + x, src.y[1] + x, y_weight),
+                 Lerp4(src.u[0] + x, src.u[1] + x, c_weight),
+                 Lerp4(src.v[0] + x, src.v[1] + x, c_weight), k);
+  }
+
+  for (; x < width; x++) {
+    StorePixel(dst, x, Lerp(src.y[0][x], src.y[1][x], src.y_weight),
+               Lerp(src.u[0][x], src.u[1][x], src.c_weight),
+               Lerp(src.v[0][x], src.v[1][x], src.c_weight), c);
+  }
+}
+#endif
+
+struct TensorRowFuncs {
+  void (*nv12_row)(const uint8_t *y, const uint8_t *uv, const TensorRow &dst,
+                   uint32_t width, const TensorCoeffs &c);
+  void (*i420_row)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                   const TensorRow &dst, uint32_t width,
+                   const TensorCoeffs &c);
+  void (*resampled_row)(const ResampledRows &src, const TensorRow &dst,
+                        uint32_t width, const TensorCoeffs &c);
+};
+
+static const TensorRowFuncs scalar_funcs = {Nv12RowScalar, I420RowScalar,
+                                            ResampledRowScalar};
+
+#if defined(VPF_HOST_TENSOR_X86)
+static const TensorRowFuncs avx2_funcs = {Nv12RowAvx2, I420RowAvx2,
+                                          ResampledRowAvx2};
+#endif
+
+#if defined(VPF_HOST_TENSOR_NEON)
+static const TensorRowFuncs neon_funcs = {Nv12RowNeon, I420RowNeon,
+                                          ResampledRowNeon};
+#endif
+
+static const TensorRowFuncs &GetRowFuncs(HostCvtKernel kernel) {
+  switch (kernel) {
+#if defined(VPF_HOST_TENSOR_X86)
+  case HOST_CVT_AVX2:
+    return avx2_funcs;
+#endif
+#if defined(VPF_HOST_TENSOR_NEON)
+  case HOST_CVT_NEON:
+    return neon_funcs;
+#endif
+  default:
+    return scalar_funcs;
+  }
+}
+
+static HostCvtKernel DetectHostTensorCvtKernel() {
+  auto const kernel = GetHostCvtKernel();
+
+#if defined(VPF_HOST_TENSOR_X86)
+  // Half precision conversion needs F16C on top of AVX2;
+  if (HOST_CVT_AVX2 == kernel) {
+    return GetHostCpuFeatures().f16c ? HOST_CVT_AVX2 : HOST_CVT_SCALAR;
+  }
+#elif defined(VPF_HOST_TENSOR_NEON)
+  if (HOST_CVT_NEON == kernel) {
+    return HOST_CVT_NEON;
+  }
+#endif
+
+  return HOST_CVT_SCALAR;
+}
+
+/* Bilinear filter taps for every output column or row;
+ * Pixel centers are aligned, so chroma is sampled between luma samples;
+ */
+struct ResampleTable {
+  // Taps are next to each other except for the last input sample;
+  vector<uint32_t> first;
+  vector<uint32_t> second;
+  vector<float> weight;
+
+  ResampleTable(uint32_t in_size, uint32_t out_size)
+      : first(out_size), second(out_size), weight(out_size) {
+    auto const ratio = (double)in_size / (double)out_size;
+    for (uint32_t i = 0U; i < out_size; i++) {
+      auto pos = (i + 0.5) * ratio - 0.5;
+      pos = min(max(pos, 0.0), (double)(in_size - 1U));
+
+      first[i] = min((uint32_t)pos, in_size - 1U);
+      second[i] = min(first[i] + 1U, in_size - 1U);
+      weight[i] = (float)(pos - first[i]);
+    }
+  }
+};
+
+/* Keeps last 2 horizontally resampled rows of single plane;
+ * Output rows mostly share input rows with previous output row, so every
+ * input row is resampled only once;
+ */
+class ResampledRowCache {
+  const uint8_t *plane;
+  size_t pitch;
+  // Distance between samples, 2 for interleaved chroma;
+  uint32_t step;
+  const ResampleTable &table;
+
+  vector<float> rows[2];
+  uint32_t index[2];
+  bool is_filled[2];
+
+  void Resample(uint32_t row, float *dst) const {
+    auto const src = plane + row * pitch;
+    auto const first = table.first.data();
+    auto const second = table.second.data();
+    auto const weight = table.weight.data();
+    auto const width = table.weight.size();
+
+    for (size_t x = 0U; x < width; x++) {
+      dst[x] = Lerp(src[first[x] * step], src[second[x] * step], weight[x]);
+    }
+  }
+
+  const float *Find(uint32_t row, uint32_t keep) {
+    for (int slot = 0; slot < 2; slot++) {
+      if (is_filled[slot] && row == index[slot]) {
+        return rows[slot].data();
+      }
+    }
+
+    auto const slot = (is_filled[0] && keep == index[0]) ? 1 : 0;
+    Resample(row, rows[slot].data());
+    index[slot] = row;
+    is_filled[slot] = true;
+    return rows[slot].data();
+  }
+
+public:
+  ResampledRowCache(const uint8_t *plane, size_t pitch, uint32_t step,
+                    const ResampleTable &table)
+      : plane(plane), pitch(pitch), step(step), table(table), index{0U, 0U},
+        is_filled{false, false} {
+    rows[0].resize(table.weight.size());
+    rows[1].resize(table.weight.size());
+  }
+
+  void Get(uint32_t row0, uint32_t row1, const float *(&out)[2]) {
+    out[0] = Find(row0, row1);
+    out[1] = Find(row1, row0);
+  }
+};
+
+struct TensorLayout {
+  uint8_t *base;
+  size_t plane_size;
+  size_t elem_size;
+  uint32_t width;
+  const TensorParams &params;
+
+  TensorRow Row(uint32_t row, bool non_temporal) const {
+    TensorRow dst;
+    for (int i = 0; i < 3; i++) {
+      auto const plane = params.is_bgr ? 2 - i : i;
+      dst.ch[i] =
+          base + (plane * plane_size + (size_t)row * width) * elem_size;
+    }
+    dst.is_half = TENSOR_FLOAT16 == params.type;
+    dst.non_temporal = non_temporal;
+    return dst;
+  }
+};
+
+static void ConvertFullSize(const TensorRowFuncs &f, Surface *pSrc,
+                            const TensorLayout &layout, bool non_temporal,
+                            const TensorCoeffs &c) {
+  auto const width = pSrc->Width(), height = pSrc->Height();
+  auto const y = (const uint8_t *)pSrc->PlanePtr(0U);
+  auto const y_pitch = pSrc->Pitch(0U);
+
+  if (NV12 == pSrc->PixelFormat()) {
+    auto const uv = (const uint8_t *)pSrc->PlanePtr(1U);
+    auto const uv_pitch = pSrc->Pitch(1U);
+    for (uint32_t row = 0U; row < height; row++) {
+      f.nv12_row(y + row * y_pitch, uv + (row / 2) * uv_pitch,
+                 layout.Row(row, non_temporal), width, c);
+    }
+  } else {
+    auto const u = (const uint8_t *)pSrc->PlanePtr(1U);
+    auto const v = (const uint8_t *)pSrc->PlanePtr(2U);
+    auto const c_pitch = pSrc->Pitch(1U);
+    for (uint32_t row = 0U; row < height; row++) {
+      f.i420_row(y + row * y_pitch, u + (row / 2) * c_pitch,
+                 v + (row / 2) * c_pitch, layout.Row(row, non_temporal),
+                 width, c);
+    }
+  }
+}
+
+static void ConvertResampled(const TensorRowFuncs &f, Surface *pSrc,
+                             const TensorLayout &layout, uint32_t out_height,
+                             bool non_temporal, const TensorCoeffs &c) {
+  auto const in_width = pSrc->Width(), in_height = pSrc->Height();
+  auto const out_width = layout.width;
+
+  const ResampleTable luma_cols(in_width, out_width);
+  const ResampleTable luma_rows(in_height, out_height);
+  const ResampleTable chroma_cols(in_width / 2, out_width);
+  const ResampleTable chroma_rows(in_height / 2, out_height);
+
+  auto const y_plane = (const uint8_t *)pSrc->PlanePtr(0U);
+  auto const u_plane = (const uint8_t *)pSrc->PlanePtr(1U);
+  auto const is_nv12 = NV12 == pSrc->PixelFormat();
+  auto const v_plane =
+      is_nv12 ? u_plane + 1 : (const uint8_t *)pSrc->PlanePtr(2U);
+  auto const c_step = is_nv12 ? 2U : 1U;
+
+  ResampledRowCache y_cache(y_plane, pSrc->Pitch(0U), 1U, luma_cols);
+  ResampledRowCache u_cache(u_plane, pSrc->Pitch(1U), c_step, chroma_cols);
+  ResampledRowCache v_cache(v_plane, pSrc->Pitch(1U), c_step, chroma_cols);
+
+  for (uint32_t row = 0U; row < out_height; row++) {
+    ResampledRows src;
+    y_cache.Get(luma_rows.first[row], luma_rows.second[row], src.y);
+    u_cache.Get(chroma_rows.first[row], chroma_rows.second[row], src.u);
+    v_cache.Get(chroma_rows.first[row], chroma_rows.second[row], src.v);
+    src.y_weight = luma_rows.weight[row];
+    src.c_weight = chroma_rows.weight[row];
+
+    f.resampled_row(src, layout.Row(row, non_temporal), out_width, c);
+  }
+}
+
+namespace VPF {
+HostCvtKernel GetHostTensorCvtKernel() {
+  static const HostCvtKernel kernel = DetectHostTensorCvtKernel();
+  return kernel;
+}
+
+bool IsHostTensorCvtSupported(Pixel_Format inFormat) {
+  return NV12 == inFormat || YUV420 == inFormat || YCBCR == inFormat;
+}
+
+size_t GetTensorSize(const TensorParams &params, uint32_t inWidth,
+                     uint32_t inHeight) {
+  auto const width = params.width ? params.width : inWidth;
+  auto const height = params.height ? params.height : inHeight;
+  auto const elem_size =
+      TENSOR_FLOAT16 == params.type ? sizeof(uint16_t) : sizeof(float);
+  return 3U * (size_t)width * height * elem_size;
+}
+
+bool ConvertSurfaceToTensorHost(Surface *pSrc, void *pDst, size_t dstSize,
+                                const TensorParams &params,
+                                const ColorspaceConversionContext *pCtx,
+                                HostCvtKernel kernel) {
+  if (!pSrc || !pDst || pSrc->Empty() || MEM_HOST != pSrc->MemType()) {
+    return false;
+  }
+
+  if (!IsHostTensorCvtSupported(pSrc->PixelFormat())) {
+    return false;
+  }
+
+  auto const in_width = pSrc->Width(), in_height = pSrc->Height();
+  if ((in_width | in_height) & 1U) {
+    return false;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    if (0.0f == params.std[i]) {
+      return false;
+    }
+  }
+
+  auto const tensor_size = GetTensorSize(params, in_width, in_height);
+  if (!tensor_size || dstSize < tensor_size) {
+    return false;
+  }
+
+  if (GetHostTensorCvtKernel() != kernel) {
+    kernel = HOST_CVT_SCALAR;
+  }
+  auto const &f = GetRowFuncs(kernel);
+  auto const c = MakeTensorCoeffs(params, pCtx);
+
+  auto const out_width = params.width ? params.width : in_width;
+  auto const out_height = params.height ? params.height : in_height;
+  auto const non_temporal = tensor_size >= non_temporal_threshold;
+
+  const TensorLayout layout = {
+      (uint8_t *)pDst, (size_t)out_width * out_height,
+      TENSOR_FLOAT16 == params.type ? sizeof(uint16_t) : sizeof(float),
+      out_width, params};
+
+  if (out_width == in_width && out_height == in_height) {
+    ConvertFullSize(f, pSrc, layout, non_temporal, c);
+  } else {
+    ConvertResampled(f, pSrc, layout, out_height, non_temporal, c);
+  }
+
+  return true;
+}
+
+bool ConvertSurfaceToTensorHost(Surface *pSrc, void *pDst, size_t dstSize,
+                                const TensorParams &params,
+                                const ColorspaceConversionContext *pCtx) {
+  return ConvertSurfaceToTensorHost(pSrc, pDst, dstSize, params, pCtx,
+                                    GetHostTensorCvtKernel());
+}
+} // namespace VPF
@@ -12,6 +12,9 @@
  */
 
 #include "MemoryInterfaces.hpp"
+#include "BufferPool.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <cuda_runtime.h>
 #include <new>
@@ -119,6 +122,13 @@ Buffer::Buffer(size_t bufferSize, bool ownMemory, CUcontext ctx)
     if (!Allocate()) {
       throw bad_alloc();
     }
+
+    /* Pool blocks are reused, so zero-fill them like calloc used to do;
+     * Pinned memory was never zero-filled;
+     */
+    if (!context && pRawData) {
+      memset(pRawData, 0, mem_size);
+    }
   }
 #ifdef TRACK_TOKEN_ALLOCATIONS
   id = BuffersRegister.AddNote(mem_size);
@@ -164,6 +174,10 @@ Buffer::~Buffer() {
 
 size_t Buffer::GetRawMemSize() const { return mem_size; }
 
+size_t Buffer::GetByteSize() const { return mem_size; }
+
+size_t Buffer::GetCapacity() const { return own_memory ? capacity : mem_size; }
+
 static void ThrowOnCudaError(CUresult res, int lineNum = -1) {
   if (CUDA_SUCCESS != res) {
     stringstream ss;
@@ -198,14 +212,9 @@ static void ThrowOnCudaError(CUresult res, int lineNum = -1) {
 
 bool Buffer::Allocate() {
   if (GetRawMemSize()) {
-    if (context) {
-      CudaCtxPush lock(context);
-      auto res = cuMemAllocHost(&pRawData, GetRawMemSize());
-      ThrowOnCudaError(res, __LINE__);
-    } else {
-      pRawData = calloc(GetRawMemSize(), sizeof(uint8_t));
-    }
-
+    // Pinned memory is allocated if context is given;
+    pRawData =
+        BufferPool::Instance().Allocate(GetRawMemSize(), capacity, context);
     return (nullptr != pRawData);
   }
   return true;
@@ -213,12 +222,8 @@ bool Buffer::Allocate() {
 
 void Buffer::Deallocate() {
   if (own_memory) {
-    if (context) {
-      auto const res = cuMemFreeHost(pRawData);
-      ThrowOnCudaError(res, __LINE__);
-    } else {
-      free(pRawData);
-    }
+    BufferPool::Instance().Release(pRawData, capacity, context);
+    capacity = 0UL;
   }
   pRawData = nullptr;
 }
@@ -227,18 +232,108 @@ void *Buffer::GetRawMemPtr() { return pRawData; }
 
 const void *Buffer::GetRawMemPtr() const { return pRawData; }
 
-void Buffer::Update(size_t newSize, void *newPtr) {
-  Deallocate();
+// Shrink policy shared by all Buffers;
+static atomic<uint32_t> shrink_ratio(8U);
+static atomic<uint32_t> shrink_updates(64U);
 
-  mem_size = newSize;
-  if (own_memory) {
-    Allocate();
-    if (newPtr) {
-      memcpy(GetRawMemPtr(), newPtr, newSize);
+// Smaller Buffers aren't worth reallocation;
+static const size_t min_shrink_capacity = 64U * 1024U;
+
+void Buffer::SetShrinkPolicy(uint32_t ratio, uint32_t numUpdates) {
+  shrink_ratio = ratio;
+  shrink_updates = numUpdates;
+}
+
+void Buffer::GetShrinkPolicy(uint32_t &ratio, uint32_t &numUpdates) {
+  ratio = shrink_ratio;
+  numUpdates = shrink_updates;
+}
+
+bool Buffer::Reallocate(size_t newCapacity, bool keepContent) {
+  size_t newCap = 0U;
+  void *newData = nullptr;
+
+  if (newCapacity) {
+    newData = BufferPool::Instance().Allocate(newCapacity, newCap, context);
+    if (!newData) {
+      return false;
     }
-  } else {
+  }
+
+  if (keepContent && pRawData && newData) {
+    memcpy(newData, pRawData, min(mem_size, newCap));
+  }
+
+  BufferPool::Instance().Release(pRawData, capacity, context);
+  pRawData = newData;
+  capacity = newCap;
+  num_small_updates = 0U;
+
+  return true;
+}
+
+bool Buffer::IsShrinkNeeded(size_t newSize) {
+  /* Single small update doesn't mean much, e. g. with video packets
+   * every big IDR is followed by many small P frames. So shrink only
+   * if buffer stays oversized for a while;
+   */
+  uint64_t const ratio = shrink_ratio;
+  if (!ratio || capacity < min_shrink_capacity ||
+      capacity <= ratio * newSize) {
+    num_small_updates = 0U;
+    return false;
+  }
+
+  return ++num_small_updates >= shrink_updates;
+}
+
+void Buffer::Update(size_t newSize, void *newPtr) {
+  if (!own_memory) {
+    mem_size = newSize;
     pRawData = newPtr;
+    return;
+  }
+
+  if (newSize > capacity) {
+    // Grow geometrically so slowly growing Buffer isn't reallocated often;
+    auto const newCapacity = max(newSize, capacity + capacity / 2);
+    if (!Reallocate(newCapacity, false)) {
+      throw bad_alloc();
+    }
+  } else if (IsShrinkNeeded(newSize)) {
+    if (!Reallocate(newSize, false)) {
+      throw bad_alloc();
+    }
+  }
+
+  /* Memory isn't zero-filled, it's either overwritten right away or
+   * filled by the caller;
+   */
+  mem_size = newSize;
+  if (newPtr) {
+    memcpy(GetRawMemPtr(), newPtr, newSize);
+  }
+}
+
+bool Buffer::Reserve(size_t newCapacity) {
+  if (!own_memory || newCapacity <= capacity) {
+    return true;
+  }
+
+  return Reallocate(newCapacity, true);
+}
+
+bool Buffer::ShrinkToFit() {
+  if (!own_memory) {
+    return true;
   }
+
+  // Pool rounds sizes up, so smaller block may not exist;
+  if (BufferPool::Instance().GetAllocationSize(mem_size) >= capacity) {
+    return true;
+  }
+
+  return Reallocate(mem_size, true);
 }
 
 Buffer *Buffer::MakeOwnMem(size_t bufferSize, CUcontext ctx) {
@@ -270,6 +365,7 @@ SurfacePlane &SurfacePlane::operator=(const SurfacePlane &other) {
   Deallocate();
 
   ownMem = false;
+  memType = other.memType;
   gpuMem = other.gpuMem;
   width = other.width;
   height = other.height;
@@ -284,19 +380,21 @@ SurfacePlane &SurfacePlane::operator=(const SurfacePlane &other) {
 }
 
 SurfacePlane::SurfacePlane(const SurfacePlane &other)
-    : ownMem(false), gpuMem(other.gpuMem), width(other.width),
-      height(other.height), pitch(other.pitch), elemSize(other.elemSize) {}
+    : ownMem(false), memType(other.memType), gpuMem(other.gpuMem),
+      width(other.width), height(other.height), pitch(other.pitch),
+      elemSize(other.elemSize) {}
 
 SurfacePlane::SurfacePlane(uint32_t newWidth, uint32_t newHeight,
                            uint32_t newPitch, uint32_t newElemSize,
-                           CUdeviceptr pNewPtr)
-    : ownMem(false), gpuMem(pNewPtr), width(newWidth), height(newHeight),
-      pitch(newPitch), elemSize(newElemSize) {}
+                           CUdeviceptr pNewPtr, MemoryType newMemType)
+    : ownMem(false), memType(newMemType), gpuMem(pNewPtr), width(newWidth),
+      height(newHeight), pitch(newPitch), elemSize(newElemSize) {}
 
 SurfacePlane::SurfacePlane(uint32_t newWidth, uint32_t newHeight,
-                           uint32_t newElemSize, CUcontext context)
-    : ownMem(true), width(newWidth), height(newHeight), elemSize(newElemSize),
-      ctx(context) {
+                           uint32_t newElemSize, CUcontext context,
+                           MemoryType newMemType)
+    : ownMem(true), memType(newMemType), width(newWidth), height(newHeight),
+      elemSize(newElemSize), ctx(context) {
   Allocate();
 }
 
@@ -312,7 +410,11 @@ void SurfacePlane::Import(SurfacePlane &src, CUcontext ctx, CUstream str){
     return;
   }
 
-  Import(src.GpuMem(), src.Pitch(), ctx, str);
+  CopyMem2D(src.GpuMem(), src.MemType(), src.Pitch(), GpuMem(), MemType(),
+            Pitch(), Width() * ElemSize(), Height(), ctx, str);
+  if (MEM_HOST != src.MemType() || MEM_HOST != MemType()) {
+    ThrowOnCudaError(cuStreamSynchronize(str), __LINE__);
+  }
 }
 
 void SurfacePlane::Export(SurfacePlane &dst, CUcontext ctx, CUstream str){
@@ -325,58 +427,75 @@ void SurfacePlane::Export(SurfacePlane &dst, CUcontext ctx, CUstream str){
     return;
   }
 
-  Export(dst.GpuMem(), dst.Pitch(), ctx, str);
+  CopyMem2D(GpuMem(), MemType(), Pitch(), dst.GpuMem(), dst.MemType(),
+            dst.Pitch(), Width() * ElemSize(), Height(), ctx, str);
+  if (MEM_HOST != MemType() || MEM_HOST != dst.MemType()) {
+    ThrowOnCudaError(cuStreamSynchronize(str), __LINE__);
+  }
 }
 
-void SurfacePlane::Import(CUdeviceptr src, uint32_t src_pitch, CUcontext ctx,
-                          CUstream str)
-{
-  auto srcPlanePtr = src;
-  auto dstPlanePtr = GpuMem();
+void VPF::CopyMem2D(CUdeviceptr src, MemoryType srcType, uint32_t srcPitch,
+                    CUdeviceptr dst, MemoryType dstType, uint32_t dstPitch,
+                    uint32_t widthInBytes, uint32_t height, CUcontext ctx,
+                    CUstream str) {
+  if (!src || !dst) {
+    return;
+  }
 
-  if (!srcPlanePtr || !dstPlanePtr) {
+  if (MEM_HOST == srcType && MEM_HOST == dstType) {
+    for (uint32_t y = 0U; y < height; y++) {
+      memcpy((uint8_t *)dst + (size_t)y * dstPitch,
+             (const uint8_t *)src + (size_t)y * srcPitch, widthInBytes);
+    }
     return;
   }
 
   CudaCtxPush ctxPush(ctx);
 
   CUDA_MEMCPY2D m = {0};
-  m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
-  m.dstMemoryType = CU_MEMORYTYPE_DEVICE;
-  m.srcDevice = srcPlanePtr;
-  m.dstDevice = dstPlanePtr;
-  m.srcPitch = src_pitch;
-  m.dstPitch = Pitch();
-  m.Height = Height();
-  m.WidthInBytes = Width() * ElemSize();
+  if (MEM_HOST == srcType) {
+    m.srcMemoryType = CU_MEMORYTYPE_HOST;
+    m.srcHost = (const void *)src;
+  } else {
+    m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+    m.srcDevice = src;
+  }
+  if (MEM_HOST == dstType) {
+    m.dstMemoryType = CU_MEMORYTYPE_HOST;
+    m.dstHost = (void *)dst;
+  } else {
+    m.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+    m.dstDevice = dst;
+  }
+  m.srcPitch = srcPitch;
+  m.dstPitch = dstPitch;
+  m.Height = height;
+  m.WidthInBytes = widthInBytes;
 
   ThrowOnCudaError(cuMemcpy2DAsync(&m, str), __LINE__);
-  ThrowOnCudaError(cuStreamSynchronize(str), __LINE__);
 }
 
-void SurfacePlane::Export(CUdeviceptr dst, uint32_t dst_pitch, CUcontext ctx,
+void SurfacePlane::Import(CUdeviceptr src, uint32_t src_pitch, CUcontext ctx,
                           CUstream str)
 {
-  auto srcPlanePtr = GpuMem();
-  auto dstPlanePtr = dst;
-
-  if (!srcPlanePtr || !dstPlanePtr) {
+  if (!src || !GpuMem()) {
     return;
   }
 
-  CudaCtxPush ctxPush(ctx);
+  CopyMem2D(src, MEM_DEVICE, src_pitch, GpuMem(), MemType(), Pitch(),
+            Width() * ElemSize(), Height(), ctx, str);
+  ThrowOnCudaError(cuStreamSynchronize(str), __LINE__);
+}
 
-  CUDA_MEMCPY2D m = {0};
-  m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
-  m.dstMemoryType = CU_MEMORYTYPE_DEVICE;
-  m.srcDevice = srcPlanePtr;
-  m.dstDevice = dstPlanePtr;
-  m.srcPitch = Pitch();
-  m.dstPitch = dst_pitch;
-  m.Height = Height();
-  m.WidthInBytes = Width() * ElemSize();
+void SurfacePlane::Export(CUdeviceptr dst, uint32_t dst_pitch, CUcontext ctx,
+                          CUstream str)
+{
+  if (!dst || !GpuMem()) {
+    return;
+  }
 
-  ThrowOnCudaError(cuMemcpy2DAsync(&m, str), __LINE__);
+  CopyMem2D(GpuMem(), MemType(), Pitch(), dst, MEM_DEVICE, dst_pitch,
+            Width() * ElemSize(), Height(), ctx, str);
   ThrowOnCudaError(cuStreamSynchronize(str), __LINE__);
 }
 
@@ -387,11 +506,32 @@ SurfacePlane::SurfacePlane(uint32_t newWidth, uint32_t newHeight,
   Import(src, srcPitch, context, str);
 }
 
+static size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1U) / alignment * alignment;
+}
+
 void SurfacePlane::Allocate() {
   if (!OwnMemory()) {
     return;
   }
 
+  if (MEM_HOST == memType) {
+    pitch = (uint32_t)AlignUp(width * elemSize, hostAlignment);
+
+    // Pool blocks are only malloc-aligned, so take a bit more;
+    auto const size = (size_t)pitch * height + hostAlignment - 1U;
+    hostBlock = BufferPool::Instance().Allocate(size, hostCapacity, ctx);
+    if (!hostBlock) {
+      throw bad_alloc();
+    }
+    gpuMem = (CUdeviceptr)AlignUp((uintptr_t)hostBlock, hostAlignment);
+
+#ifdef TRACK_TOKEN_ALLOCATIONS
+    id = HWSurfaceRegister.AddNote(GpuMem());
+#endif
+    return;
+  }
+
   size_t newPitch;
   CudaCtxPush ctxPush(ctx);
   auto res = cuMemAllocPitch(&gpuMem, &newPitch, width * elemSize, height, 16);
@@ -413,6 +553,13 @@ void SurfacePlane::Deallocate() {
   HWSurfaceRegister.DeleteNote(info);
 #endif
 
+  if (MEM_HOST == memType) {
+    BufferPool::Instance().Release(hostBlock, hostCapacity, ctx);
+    hostBlock = nullptr;
+    hostCapacity = 0U;
+    return;
+  }
+
   CudaCtxPush ctxPush(ctx);
   cuMemFree(gpuMem);
 }
@@ -421,6 +568,13 @@ Surface::Surface() = default;
 
 Surface::~Surface() = default;
 
+size_t Surface::GetByteSize() const { return HostMemSize(); }
+
+MemoryType Surface::MemType() {
+  auto pPlane = GetSurfacePlane(0U);
+  return pPlane ? pPlane->MemType() : MEM_DEVICE;
+}
+
 Surface *Surface::Make(Pixel_Format format) {
   switch (format) {
   case Y:
@@ -444,28 +598,47 @@ Surface *Surface::Make(Pixel_Format format) {
 
 Surface *Surface::Make(Pixel_Format format, uint32_t newWidth,
                        uint32_t newHeight, CUcontext context) {
+  return Make(format, newWidth, newHeight, MEM_DEVICE, context);
+}
+
+Surface *Surface::Make(Pixel_Format format, uint32_t newWidth,
+                       uint32_t newHeight, MemoryType memType,
+                       CUcontext context) {
   switch (format) {
   case Y:
-    return new SurfaceY(newWidth, newHeight, context);
+    return new SurfaceY(newWidth, newHeight, context, memType);
   case NV12:
-    return new SurfaceNV12(newWidth, newHeight, context);
+    return new SurfaceNV12(newWidth, newHeight, context, memType);
   case YUV420:
-    return new SurfaceYUV420(newWidth, newHeight, context);
+    return new SurfaceYUV420(newWidth, newHeight, context, memType);
   case RGB:
-    return new SurfaceRGB(newWidth, newHeight, context);
+    return new SurfaceRGB(newWidth, newHeight, context, memType);
   case BGR:
-    return new SurfaceBGR(newWidth, newHeight, context);
+    return new SurfaceBGR(newWidth, newHeight, context, memType);
   case RGB_PLANAR:
-    return new SurfaceRGBPlanar(newWidth, newHeight, context);
+    return new SurfaceRGBPlanar(newWidth, newHeight, context, memType);
   case YCBCR:
-    return new SurfaceYCbCr(newWidth, newHeight, context);
+    return new SurfaceYCbCr(newWidth, newHeight, context, memType);
   case YUV444:
-    return new SurfaceYUV444(newWidth, newHeight, context);
+    return new SurfaceYUV444(newWidth, newHeight, context, memType);
   default:
     return nullptr;
   }
 }
 
+Surface *Surface::MakeOrReuse(Surface *pSurface, Pixel_Format format,
+                              uint32_t newWidth, uint32_t newHeight,
+                              MemoryType memType, CUcontext context) {
+  if (pSurface && !pSurface->Empty() && format == pSurface->PixelFormat() &&
+      newWidth == pSurface->Width() && newHeight == pSurface->Height() &&
+      memType == pSurface->MemType()) {
+    return pSurface;
+  }
+
+  delete pSurface;
+  return Make(format, newWidth, newHeight, memType, context);
+}
+
 SurfaceY::~SurfaceY() = default;
 
 SurfaceY::SurfaceY() = default;
@@ -476,8 +649,9 @@ Surface *SurfaceY::Create() { return new SurfaceY; }
 
 SurfaceY::SurfaceY(const SurfaceY &other) : plane(other.plane) {}
 
-SurfaceY::SurfaceY(uint32_t width, uint32_t height, CUcontext context)
-    : plane(width, height, ElemSize(), context) {}
+SurfaceY::SurfaceY(uint32_t width, uint32_t height, CUcontext context,
+                   MemoryType memType)
+    : plane(width, height, ElemSize(), context, memType) {}
 
 SurfaceY &SurfaceY::operator=(const SurfaceY &other) {
   plane = other.plane;
@@ -547,8 +721,9 @@ SurfaceNV12::SurfaceNV12() = default;
 
 SurfaceNV12::SurfaceNV12(const SurfaceNV12 &other) : plane(other.plane) {}
 
-SurfaceNV12::SurfaceNV12(uint32_t width, uint32_t height, CUcontext context)
-    : plane(width, height * 3 / 2, ElemSize(), context) {}
+SurfaceNV12::SurfaceNV12(uint32_t width, uint32_t height, CUcontext context,
+                         MemoryType memType)
+    : plane(width, height * 3 / 2, ElemSize(), context, memType) {}
 
 SurfaceNV12 &SurfaceNV12::operator=(const SurfaceNV12 &other) {
   plane = other.plane;
@@ -636,10 +811,11 @@ SurfaceYUV420::SurfaceYUV420() = default;
 SurfaceYUV420::SurfaceYUV420(const SurfaceYUV420 &other)
     : planeY(other.planeY), planeU(other.planeU), planeV(other.planeV) {}
 
-SurfaceYUV420::SurfaceYUV420(uint32_t width, uint32_t height, CUcontext context)
-    : planeY(width, height, ElemSize(), context),
-      planeU(width / 2, height / 2, ElemSize(), context),
-      planeV(width / 2, height / 2, ElemSize(), context) {}
+SurfaceYUV420::SurfaceYUV420(uint32_t width, uint32_t height, CUcontext context,
+                             MemoryType memType)
+    : planeY(width, height, ElemSize(), context, memType),
+      planeU(width / 2, height / 2, ElemSize(), context, memType),
+      planeV(width / 2, height / 2, ElemSize(), context, memType) {}
 
 SurfaceYUV420 &SurfaceYUV420::operator=(const SurfaceYUV420 &other) {
   planeY = other.planeY;
@@ -768,8 +944,9 @@ SurfaceYCbCr::SurfaceYCbCr() : SurfaceYUV420() {}
 
 SurfaceYCbCr::SurfaceYCbCr(const SurfaceYCbCr &other) : SurfaceYUV420(other) {}
 
-SurfaceYCbCr::SurfaceYCbCr(uint32_t width, uint32_t height, CUcontext context)
-    : SurfaceYUV420(width, height, context) {}
+SurfaceYCbCr::SurfaceYCbCr(uint32_t width, uint32_t height, CUcontext context,
+                           MemoryType memType)
+    : SurfaceYUV420(width, height, context, memType) {}
 
 Surface *VPF::SurfaceYCbCr::Clone() { return new SurfaceYCbCr(*this); }
 
@@ -781,8 +958,9 @@ SurfaceRGB::SurfaceRGB() = default;
 
 SurfaceRGB::SurfaceRGB(const SurfaceRGB &other) : plane(other.plane) {}
 
-SurfaceRGB::SurfaceRGB(uint32_t width, uint32_t height, CUcontext context)
-    : plane(width * 3, height, ElemSize(), context) {}
+SurfaceRGB::SurfaceRGB(uint32_t width, uint32_t height, CUcontext context,
+                       MemoryType memType)
+    : plane(width * 3, height, ElemSize(), context, memType) {}
 
 SurfaceRGB &SurfaceRGB::operator=(const SurfaceRGB &other) {
   plane = other.plane;
@@ -856,8 +1034,9 @@ SurfaceBGR::SurfaceBGR() = default;
 
 SurfaceBGR::SurfaceBGR(const SurfaceBGR &other) : plane(other.plane) {}
 
-SurfaceBGR::SurfaceBGR(uint32_t width, uint32_t height, CUcontext context)
-    : plane(width * 3, height, ElemSize(), context) {}
+SurfaceBGR::SurfaceBGR(uint32_t width, uint32_t height, CUcontext context,
+                       MemoryType memType)
+    : plane(width * 3, height, ElemSize(), context, memType) {}
 
 SurfaceBGR &SurfaceBGR::operator=(const SurfaceBGR &other) {
   plane = other.plane;
@@ -924,8 +1103,8 @@ SurfaceRGBPlanar::SurfaceRGBPlanar(const SurfaceRGBPlanar &other)
     : plane(other.plane) {}
 
 SurfaceRGBPlanar::SurfaceRGBPlanar(uint32_t width, uint32_t height,
-                                   CUcontext context)
-    : plane(width, height * 3, ElemSize(), context) {}
+                                   CUcontext context, MemoryType memType)
+    : plane(width, height * 3, ElemSize(), context, memType) {}
 
 SurfaceRGBPlanar &SurfaceRGBPlanar::operator=(const SurfaceRGBPlanar &other) {
   plane = other.plane;
@@ -1002,8 +1181,9 @@ SurfaceYUV444::SurfaceYUV444() : SurfaceRGBPlanar() {}
 SurfaceYUV444::SurfaceYUV444(const SurfaceYUV444 &other)
     : SurfaceRGBPlanar(other) {}
 
-SurfaceYUV444::SurfaceYUV444(uint32_t width, uint32_t height, CUcontext context)
-    : SurfaceRGBPlanar(width, height, context) {}
+SurfaceYUV444::SurfaceYUV444(uint32_t width, uint32_t height, CUcontext context,
+                             MemoryType memType)
+    : SurfaceRGBPlanar(width, height, context, memType) {}
 
 Surface *VPF::SurfaceYUV444::Clone() { return new SurfaceYUV444(*this); }
 
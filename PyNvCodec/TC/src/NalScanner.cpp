@@ -0,0 +1,247 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NalScanner.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VPF_NAL_SCAN_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VPF_NAL_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace VPF;
+using namespace std;
+
+static const uint8_t start_code[] = {0U, 0U, 0U, 1U};
+
+static const uint8_t *FindStartCodeScalar(const uint8_t *p,
+                                          const uint8_t *end) {
+  for (; p + 2 < end; p++) {
+    if (!p[0] && !p[1] && 1U == p[2]) {
+      return p;
+    }
+  }
+  return end;
+}
+
+#if defined(VPF_NAL_SCAN_SSE2)
+static inline int CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long idx = 0;
+  _BitScanForward(&idx, mask);
+  return (int)idx;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+static const uint8_t *FindStartCodeSse2(const uint8_t *p, const uint8_t *end) {
+  const size_t vec = sizeof(__m128i);
+
+  /* Every byte is checked for being 1st byte of start code, so two more
+   * bytes past the vector are read;
+   */
+  if ((size_t)(end - p) >= vec + 2) {
+    auto const last = end - (vec + 2);
+    auto const zero = _mm_setzero_si128();
+    auto const one = _mm_set1_epi8(1);
+
+    for (; p <= last; p += vec) {
+      auto a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), zero);
+      auto b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 1)), zero);
+      auto c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 2)), one);
+      auto mask =
+          (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(a, b), c));
+      if (mask) {
+        return p + CountTrailingZeros(mask);
+      }
+    }
+  }
+
+  return FindStartCodeScalar(p, end);
+}
+#endif
+
+#if defined(VPF_NAL_SCAN_NEON)
+static const uint8_t *FindStartCodeNeon(const uint8_t *p, const uint8_t *end) {
+  const size_t vec = sizeof(uint8x16_t);
+
+  if ((size_t)(end - p) >= vec + 2) {
+    auto const last = end - (vec + 2);
+    auto const zero = vdupq_n_u8(0U);
+    auto const one = vdupq_n_u8(1U);
+
+    for (; p <= last; p += vec) {
+      auto a = vceqq_u8(vld1q_u8(p), zero);
+      auto b = vceqq_u8(vld1q_u8(p + 1), zero);
+      auto c = vceqq_u8(vld1q_u8(p + 2), one);
+      if (vmaxvq_u8(vandq_u8(vandq_u8(a, b), c))) {
+        // Start code is within this vector for sure;
+        return FindStartCodeScalar(p, p + vec + 2);
+      }
+    }
+  }
+
+  return FindStartCodeScalar(p, end);
+}
+#endif
+
+static bool IsSeiNalUnit(uint8_t nal_header, bool is_hevc) {
+  if (is_hevc) {
+    // PREFIX_SEI_NUT & SUFFIX_SEI_NUT;
+    auto const nal_type = (nal_header >> 1) & 0x3F;
+    return 39 == nal_type || 40 == nal_type;
+  }
+
+  return 6 == (nal_header & 0x1F);
+}
+
+static void AppendNalUnit(vector<uint8_t> &sei, const uint8_t *nal,
+                          size_t size) {
+  sei.insert(sei.end(), start_code, start_code + sizeof(start_code));
+  sei.insert(sei.end(), nal, nal + size);
+}
+
+static bool ExtractAnnexB(const uint8_t *data, size_t size, bool is_hevc,
+                          vector<uint8_t> &sei) {
+  auto const end = data + size;
+  auto p = FindStartCode(data, end);
+  if (end == p) {
+    return false;
+  }
+
+  while (p < end) {
+    auto const nal = p + 3;
+    auto const next = FindStartCode(nal, end);
+
+    /* Zero byte of 4-byte start code and trailing zero bytes belong
+     * to neither of NAL units;
+     */
+    auto nal_end = next;
+    while (nal_end > nal && !nal_end[-1]) {
+      nal_end--;
+    }
+
+    if (nal_end > nal && IsSeiNalUnit(nal[0], is_hevc)) {
+      AppendNalUnit(sei, nal, nal_end - nal);
+    }
+
+    p = next;
+  }
+
+  return true;
+}
+
+static bool ExtractLengthPrefixed(const uint8_t *data, size_t size,
+                                  uint32_t nal_length_size, bool is_hevc,
+                                  vector<uint8_t> &sei) {
+  if (!nal_length_size || nal_length_size > 4U) {
+    return false;
+  }
+
+  auto const end = data + size;
+  auto p = data;
+
+  while (p < end) {
+    if ((size_t)(end - p) < nal_length_size) {
+      return false;
+    }
+
+    size_t nal_size = 0U;
+    for (uint32_t i = 0U; i < nal_length_size; i++) {
+      nal_size = (nal_size << 8) | p[i];
+    }
+    p += nal_length_size;
+
+    if (nal_size > (size_t)(end - p)) {
+      return false;
+    }
+
+    if (nal_size && IsSeiNalUnit(p[0], is_hevc)) {
+      AppendNalUnit(sei, p, nal_size);
+    }
+    p += nal_size;
+  }
+
+  return true;
+}
+
+namespace VPF {
+NalScanParams GetNalScanParams(const uint8_t *extradata,
+                               size_t extradata_size, bool is_hevc) {
+  NalScanParams params;
+  params.is_hevc = is_hevc;
+
+  if (!extradata) {
+    return params;
+  }
+
+  if (is_hevc) {
+    // Same check as libavcodec does to tell hvcC from Annex.B;
+    auto const is_hvcc =
+        extradata_size >= 23U &&
+        (extradata[0] || extradata[1] || extradata[2] > 1U);
+    if (is_hvcc) {
+      params.format = NAL_FORMAT_LENGTH_PREFIXED;
+      params.nal_length_size = (extradata[21] & 3U) + 1U;
+    }
+  } else if (extradata_size >= 7U && 1U == extradata[0]) {
+    params.format = NAL_FORMAT_LENGTH_PREFIXED;
+    params.nal_length_size = (extradata[4] & 3U) + 1U;
+  }
+
+  return params;
+}
+
+const uint8_t *FindStartCode(const uint8_t *begin, const uint8_t *end,
+                             bool use_simd) {
+  if (!begin || begin >= end) {
+    return end;
+  }
+
+  if (use_simd) {
+#if defined(VPF_NAL_SCAN_SSE2)
+    return FindStartCodeSse2(begin, end);
+#elif defined(VPF_NAL_SCAN_NEON)
+    return FindStartCodeNeon(begin, end);
+#endif
+  }
+
+  return FindStartCodeScalar(begin, end);
+}
+
+bool ExtractSeiNalUnits(const uint8_t *data, size_t size,
+                        const NalScanParams &params, vector<uint8_t> &sei) {
+  if (!data || !size) {
+    return true;
+  }
+
+  auto const old_size = sei.size();
+  auto const res =
+      (NAL_FORMAT_LENGTH_PREFIXED == params.format)
+          ? ExtractLengthPrefixed(data, size, params.nal_length_size,
+                                  params.is_hevc, sei)
+          : ExtractAnnexB(data, size, params.is_hevc, sei);
+
+  if (!res) {
+    sei.resize(old_size);
+  }
+  return res;
+}
+} // namespace VPF
@@ -23,6 +23,7 @@
 #include "MemoryInterfaces.hpp"
 #include "NvCodecUtils.h"
 #include "NvDecoder.h"
+#include "Tasks.hpp"
 #include "nvcuvid.h"
 
 using namespace std;
@@ -445,6 +446,7 @@ int NvDecoder::ReconfigureDecoder(CUVIDEOFORMAT *pVideoFormat) {
  *   >=1: suceeded
  */
 int NvDecoder::HandlePictureDecode(CUVIDPICPARAMS *pPicParams) noexcept {
+  NvtxMark tick(__FUNCTION__);
   try {
     CudaCtxPush ctxPush(p_impl->m_cuContext);
     CudaStrSync strSync(p_impl->m_cuvidStream);
@@ -471,6 +473,7 @@ int NvDecoder::HandlePictureDecode(CUVIDPICPARAMS *pPicParams) noexcept {
  *   >=1: suceeded
  */
 int NvDecoder::HandlePictureDisplay(CUVIDPARSERDISPINFO *pDispInfo) noexcept {
+  NvtxMark tick(__FUNCTION__);
   try {
     CudaCtxPush ctxPush(p_impl->m_cuContext);
     CudaStrSync strSync(p_impl->m_cuvidStream);
@@ -660,6 +663,7 @@ int NvDecoder::GetBitDepth() { return p_impl->m_nBitDepthMinus8 + 8; }
 bool NvDecoder::DecodeLockSurface(Buffer const *encFrame,
                                   uint64_t const &timestamp,
                                   DecodedFrameContext &decCtx) {
+  NvtxMark tick(__FUNCTION__);
   if (!p_impl->m_hParser) {
     throw runtime_error("Parser not initialized.");
   }
@@ -683,7 +687,11 @@ bool NvDecoder::DecodeLockSurface(Buffer const *encFrame,
   }
 
   // Kick off HW decoding;
-  ThrowOnCudaError(cuvidParseVideoData(p_impl->m_hParser, &packet), __LINE__);
+  {
+    NvtxMark parse_tick("cuvidParseVideoData");
+    ThrowOnCudaError(cuvidParseVideoData(p_impl->m_hParser, &packet),
+                     __LINE__);
+  }
 
   lock_guard<mutex> lock(p_impl->m_mtxVPFrame);
   /* Move all decoded surfaces from decoder-owned pool to queue of frames ready
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2021 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SeekIndex.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+using namespace VPF;
+using namespace std;
+
+// Index file layout version, bump it upon any change;
+static const char index_magic[8] = {'V', 'P', 'F', 'I', 'D', 'X', '0', '1'};
+
+template <typename T> static void WriteValue(ofstream &out, const T &value) {
+  out.write((const char *)&value, sizeof(value));
+}
+
+template <typename T> static bool ReadValue(ifstream &in, T &value) {
+  in.read((char *)&value, sizeof(value));
+  return in.good();
+}
+
+void SeekIndex::Add(const SeekIndexEntry &entry) { frames.push_back(entry); }
+
+void SeekIndex::Finalize() {
+  stable_sort(frames.begin(), frames.end(),
+              [](const SeekIndexEntry &a, const SeekIndexEntry &b) {
+                return a.pts < b.pts;
+              });
+
+  key_frames.clear();
+  for (size_t i = 0U; i < frames.size(); i++) {
+    if (frames[i].is_key) {
+      key_frames.push_back((int64_t)i);
+    }
+  }
+}
+
+size_t SeekIndex::GetNumFrames() const { return frames.size(); }
+
+bool SeekIndex::GetFrame(int64_t frame_num, SeekIndexEntry &entry) const {
+  if (frame_num < 0 || frame_num >= (int64_t)frames.size()) {
+    return false;
+  }
+
+  entry = frames[frame_num];
+  return true;
+}
+
+bool SeekIndex::GetPrevKeyFrame(int64_t frame_num,
+                                SeekIndexEntry &entry) const {
+  if (frame_num < 0 || frame_num >= (int64_t)frames.size()) {
+    return false;
+  }
+
+  auto it = upper_bound(key_frames.begin(), key_frames.end(), frame_num);
+  if (key_frames.begin() == it) {
+    return false;
+  }
+
+  entry = frames[*(--it)];
+  return true;
+}
+
+int64_t SeekIndex::GetFrameNum(int64_t pts) const {
+  auto it = lower_bound(frames.begin(), frames.end(), pts,
+                        [](const SeekIndexEntry &entry, int64_t value) {
+                          return entry.pts < value;
+                        });
+
+  if (frames.end() == it || it->pts != pts) {
+    return -1;
+  }
+  return it - frames.begin();
+}
+
+bool SeekIndex::Save(const string &index_path, uint64_t file_size,
+                     int64_t file_mtime, int32_t stream_idx) const {
+  // Write to temporary file first so that readers never see partial index;
+  auto const tmp_path = index_path + ".tmp";
+  {
+    ofstream out(tmp_path, ios::binary | ios::trunc);
+    if (!out) {
+      return false;
+    }
+
+    out.write(index_magic, sizeof(index_magic));
+    WriteValue(out, file_size);
+    WriteValue(out, file_mtime);
+    WriteValue(out, stream_idx);
+    WriteValue(out, (uint64_t)frames.size());
+
+    for (auto const &frame : frames) {
+      WriteValue(out, frame.pts);
+      WriteValue(out, frame.dts);
+      WriteValue(out, frame.pos);
+      WriteValue(out, (uint8_t)frame.is_key);
+    }
+
+    if (!out.good()) {
+      out.close();
+      remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  // Rename doesn't overwrite existing files on Windows;
+  remove(index_path.c_str());
+  if (0 != rename(tmp_path.c_str(), index_path.c_str())) {
+    remove(tmp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool SeekIndex::Load(const string &index_path, uint64_t file_size,
+                     int64_t file_mtime, int32_t stream_idx) {
+  ifstream in(index_path, ios::binary);
+  if (!in) {
+    return false;
+  }
+
+  char magic[sizeof(index_magic)] = {0};
+  in.read(magic, sizeof(magic));
+  if (!in.good() || 0 != memcmp(magic, index_magic, sizeof(magic))) {
+    return false;
+  }
+
+  uint64_t idx_file_size = 0U, num_frames = 0U;
+  int64_t idx_file_mtime = 0;
+  int32_t idx_stream = -1;
+  if (!ReadValue(in, idx_file_size) || !ReadValue(in, idx_file_mtime) ||
+      !ReadValue(in, idx_stream) || !ReadValue(in, num_frames)) {
+    return false;
+  }
+
+  auto const is_stale = (idx_file_size != file_size) ||
+                        (idx_file_mtime != file_mtime) ||
+                        (idx_stream != stream_idx);
+  if (is_stale) {
+    return false;
+  }
+
+  vector<SeekIndexEntry> entries;
+  entries.reserve(min<uint64_t>(num_frames, 1U << 24));
+  for (uint64_t i = 0U; i < num_frames; i++) {
+    SeekIndexEntry entry;
+    uint8_t is_key = 0U;
+    if (!ReadValue(in, entry.pts) || !ReadValue(in, entry.dts) ||
+        !ReadValue(in, entry.pos) || !ReadValue(in, is_key)) {
+      return false;
+    }
+    entry.is_key = (0U != is_key);
+    entries.push_back(entry);
+  }
+
+  frames.swap(entries);
+  Finalize();
+  return true;
+}
+
+string SeekIndex::GetIndexPath(const string &video_path) {
+  return video_path + ".vpfidx";
+}
+
+shared_ptr<SeekIndex> SeekIndex::LoadForFile(const string &video_path,
+                                             int32_t stream_idx) {
+  uint64_t file_size = 0U;
+  int64_t file_mtime = 0;
+  if (!GetFileStats(video_path, file_size, file_mtime)) {
+    return nullptr;
+  }
+
+  auto index = make_shared<SeekIndex>();
+  auto const is_loaded = index->Load(GetIndexPath(video_path), file_size,
+                                     file_mtime, stream_idx);
+  return is_loaded ? index : nullptr;
+}
+
+bool SeekIndex::SaveForFile(const string &video_path,
+                            int32_t stream_idx) const {
+  uint64_t file_size = 0U;
+  int64_t file_mtime = 0;
+  if (!GetFileStats(video_path, file_size, file_mtime)) {
+    return false;
+  }
+
+  return Save(GetIndexPath(video_path), file_size, file_mtime, stream_idx);
+}
+
+shared_ptr<SeekIndex> SeekIndex::Scan(AVFormatContext *fmt_ctx,
+                                      int32_t stream_idx,
+                                      const atomic<bool> *stop) {
+  if (!fmt_ctx || stream_idx < 0 ||
+      stream_idx >= (int32_t)fmt_ctx->nb_streams) {
+    return nullptr;
+  }
+
+  auto index = make_shared<SeekIndex>();
+  AVPacket pkt;
+  av_init_packet(&pkt);
+  pkt.data = nullptr;
+  pkt.size = 0;
+
+  int ret = 0;
+  bool is_valid = true;
+  while (is_valid && !(stop && *stop)) {
+    ret = av_read_frame(fmt_ctx, &pkt);
+    if (ret < 0) {
+      break;
+    }
+
+    if (pkt.stream_index == stream_idx) {
+      // Raw bitstreams have no timestamps to index;
+      is_valid = (AV_NOPTS_VALUE != pkt.pts);
+
+      SeekIndexEntry entry;
+      entry.pts = pkt.pts;
+      entry.dts = (AV_NOPTS_VALUE != pkt.dts) ? pkt.dts : pkt.pts;
+      entry.pos = pkt.pos;
+      entry.is_key = (0 != (pkt.flags & AV_PKT_FLAG_KEY));
+      index->Add(entry);
+    }
+    av_packet_unref(&pkt);
+  }
+
+  auto const is_complete = (AVERROR_EOF == ret) && !(stop && *stop);
+  if (!is_valid || !is_complete || !index->GetNumFrames()) {
+    return nullptr;
+  }
+
+  index->Finalize();
+  return index;
+}
+
+shared_ptr<SeekIndex> SeekIndex::ScanFile(const string &url,
+                                          const AVDictionary *options,
+                                          int32_t stream_idx,
+                                          const atomic<bool> *stop) {
+  AVFormatContext *ctx = nullptr;
+  // Open consumes options;
+  AVDictionary *ctx_options = nullptr;
+  av_dict_copy(&ctx_options, options, 0);
+  auto res = avformat_open_input(&ctx, url.c_str(), nullptr, &ctx_options);
+  av_dict_free(&ctx_options);
+  if (res < 0) {
+    cerr << "Can't open " << url << " to scan frame index." << endl;
+    return nullptr;
+  }
+
+  if (avformat_find_stream_info(ctx, nullptr) < 0 ||
+      stream_idx >= (int32_t)ctx->nb_streams) {
+    avformat_close_input(&ctx);
+    return nullptr;
+  }
+
+  // Packets of other streams aren't needed;
+  for (unsigned i = 0U; i < ctx->nb_streams; i++) {
+    if ((int32_t)i != stream_idx) {
+      ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+  }
+
+  auto index = Scan(ctx, stream_idx, stop);
+  avformat_close_input(&ctx);
+  return index;
+}
+
+bool SeekIndex::GetFileStats(const string &path, uint64_t &file_size,
+                             int64_t &file_mtime) {
+  struct stat st;
+  if (0 != stat(path.c_str(), &st)) {
+    return false;
+  }
+
+  file_size = (uint64_t)st.st_size;
+  file_mtime = (int64_t)st.st_mtime;
+  return true;
+}
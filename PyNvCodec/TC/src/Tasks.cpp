@@ -13,6 +13,7 @@
  */
 
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <map>
 #include <queue>
@@ -21,10 +22,12 @@
 #include <string>
 #include <vector>
 
+#include "BufferPool.hpp"
 #include "CodecsSupport.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NppCommon.hpp"
 #include "Tasks.hpp"
+#include "TokenPool.hpp"
 
 #include "NvCodecCLIOptions.h"
 #include "NvCodecUtils.h"
@@ -520,7 +523,13 @@ struct CudaDownloadSurface_Impl {
     pHostFrame = Buffer::MakeOwnMem(bufferSize, context);
   }
 
-  ~CudaDownloadSurface_Impl() { delete pHostFrame; }
+  ~CudaDownloadSurface_Impl() {
+    delete pHostFrame;
+    // Context may belong to caller, don't keep its pinned blocks cached;
+    if (cuContext) {
+      BufferPool::Instance().Trim(cuContext);
+    }
+  }
 };
 } // namespace VPF
 
@@ -560,14 +569,21 @@ TaskExecStatus CudaDownloadSurface::Run() {
   auto pSurface = (Surface *)GetInput();
   auto pDstHost = ((Buffer *)pImpl->pHostFrame)->GetDataAs<uint8_t>();
 
+  // Host Surfaces are copied as well, so they can be exported the same way;
+  auto const is_host_src = (MEM_HOST == pSurface->MemType());
+
   CUDA_MEMCPY2D m = {0};
-  m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+  m.srcMemoryType = is_host_src ? CU_MEMORYTYPE_HOST : CU_MEMORYTYPE_DEVICE;
   m.dstMemoryType = CU_MEMORYTYPE_HOST;
 
   for (auto plane = 0; plane < pSurface->NumPlanes(); plane++) {
     CudaCtxPush lock(context);
 
-    m.srcDevice = pSurface->PlanePtr(plane);
+    if (is_host_src) {
+      m.srcHost = (const void *)pSurface->PlanePtr(plane);
+    } else {
+      m.srcDevice = pSurface->PlanePtr(plane);
+    }
     m.srcPitch = pSurface->Pitch(plane);
     m.dstHost = pDstHost;
     m.dstPitch = pSurface->WidthInBytes(plane);
@@ -590,9 +606,15 @@ struct DemuxFrame_Impl {
   size_t videoBytes = 0U;
   FFmpegDemuxer demuxer;
   Buffer *pElementaryVideo;
+  // Doesn't own memory, points to demuxed packet data;
+  Buffer *pPacketRef;
   Buffer *pMuxingParams;
   Buffer *pSei;
   Buffer *pPktData;
+  bool packet_by_ref = false;
+  // Ref-counted packets, see DemuxFrame::SetPacketPooling;
+  TokenPool *pPacketPool = nullptr;
+  TokenRef<Buffer> pooledPacket;
 
   DemuxFrame_Impl() = delete;
   DemuxFrame_Impl(const DemuxFrame_Impl &other) = delete;
@@ -602,6 +624,7 @@ struct DemuxFrame_Impl {
                            const map<string, string> &ffmpeg_options)
       : demuxer(url.c_str(), ffmpeg_options) {
     pElementaryVideo = Buffer::MakeOwnMem(0U);
+    pPacketRef = Buffer::Make(0U);
     pMuxingParams = Buffer::MakeOwnMem(sizeof(MuxingParams));
     pSei = Buffer::MakeOwnMem(0U);
     pPktData = Buffer::MakeOwnMem(0U);
@@ -609,9 +632,12 @@ struct DemuxFrame_Impl {
 
   ~DemuxFrame_Impl() {
     delete pElementaryVideo;
+    delete pPacketRef;
     delete pMuxingParams;
     delete pSei;
     delete pPktData;
+    pooledPacket.Reset();
+    delete pPacketPool;
   }
 };
 } // namespace VPF
@@ -642,6 +668,52 @@ DemuxFrame::~DemuxFrame() { delete pImpl; }
 
 void DemuxFrame::Flush() { pImpl->demuxer.Flush(); }
 
+bool DemuxFrame::ReservePacketBuffer(size_t size) {
+  return pImpl->pElementaryVideo->Reserve(size);
+}
+
+bool DemuxFrame::ShrinkPacketBuffer() {
+  return pImpl->pElementaryVideo->ShrinkToFit();
+}
+
+size_t DemuxFrame::GetPacketBufferCapacity() const {
+  return pImpl->pElementaryVideo->GetCapacity();
+}
+
+void DemuxFrame::SetPacketByReference(bool by_reference) {
+  pImpl->packet_by_ref = by_reference;
+}
+
+bool DemuxFrame::IsPacketByReference() const { return pImpl->packet_by_ref; }
+
+void DemuxFrame::SetPacketPooling(bool use_pool) {
+  if (use_pool && !pImpl->pPacketPool) {
+    pImpl->pPacketPool =
+        TokenPool::Make([]() { return (Token *)Buffer::MakeOwnMem(0U); });
+  } else if (!use_pool && pImpl->pPacketPool) {
+    pImpl->pooledPacket.Reset();
+    delete pImpl->pPacketPool;
+    pImpl->pPacketPool = nullptr;
+  }
+}
+
+bool DemuxFrame::IsPacketPooling() const {
+  return nullptr != pImpl->pPacketPool;
+}
+
+AVPacket *DemuxFrame::GetPacketRef() {
+  auto pkt = pImpl->demuxer.GetLastPacket();
+  return (pkt && pkt->data) ? av_packet_clone(pkt) : nullptr;
+}
+
+bool DemuxFrame::BuildSeekIndex(bool in_background) {
+  return pImpl->demuxer.BuildSeekIndex(in_background);
+}
+
+bool DemuxFrame::IsSeekIndexReady() const {
+  return pImpl->demuxer.IsSeekIndexReady();
+}
+
 TaskExecStatus DemuxFrame::Run() {
   NvtxMark tick(__FUNCTION__);
   ClearOutputs();
@@ -665,14 +737,37 @@ TaskExecStatus DemuxFrame::Run() {
     if (!ret) {
       return TASK_EXEC_FAIL;
     }
-  } else if (!demuxer.Demux(pVideo, videoBytes, pkt_data,
-                            needSEI ? &pSEI : nullptr, &seiBytes)) {
-    return TASK_EXEC_FAIL;
+  } else {
+    /* Bitstream filter may give nothing for some packets; Pooled packets
+     * feed pipelines which expect one with every PacketData, so those are
+     * skipped;
+     */
+    bool const skip_empty = pImpl->pPacketPool && !pImpl->packet_by_ref;
+    do {
+      if (!demuxer.Demux(pVideo, videoBytes, pkt_data,
+                         needSEI ? &pSEI : nullptr, &seiBytes)) {
+        return TASK_EXEC_FAIL;
+      }
+    } while (skip_empty && !videoBytes);
   }
 
   if (videoBytes) {
-    pImpl->pElementaryVideo->Update(videoBytes, pVideo);
-    SetOutput(pImpl->pElementaryVideo, 0U);
+    if (pImpl->packet_by_ref) {
+      pImpl->pPacketRef->Update(videoBytes, pVideo);
+      SetOutput(pImpl->pPacketRef, 0U);
+    } else if (pImpl->pPacketPool) {
+      // Previous packet goes back to pool once consumers release it;
+      auto &pooledPacket = pImpl->pooledPacket;
+      pooledPacket = pImpl->pPacketPool->Acquire<Buffer>();
+      if (!pooledPacket) {
+        return TASK_EXEC_FAIL;
+      }
+      pooledPacket->Update(videoBytes, pVideo);
+      SetOutput(pooledPacket.Get(), 0U);
+    } else {
+      pImpl->pElementaryVideo->Update(videoBytes, pVideo);
+      SetOutput(pImpl->pElementaryVideo, 0U);
+    }
 
     GetParams(params);
     pImpl->pMuxingParams->Update(sizeof(MuxingParams), &params);
@@ -745,15 +840,35 @@ void DemuxFrame::GetParams(MuxingParams &params) const {
 }
 
 namespace VPF {
+/* Supersampling is the closest NPP counterpart of area filter, but it
+ * only works for downscaling;
+ */
+static int GetNppInterpolation(ResizeFilter filter, const NppiSize &src,
+                               const NppiSize &dst) {
+  switch (filter) {
+  case RESIZE_NEAREST:
+    return NPPI_INTER_NN;
+  case RESIZE_BILINEAR:
+    return NPPI_INTER_LINEAR;
+  case RESIZE_AREA:
+    return dst.width <= src.width && dst.height <= src.height
+               ? NPPI_INTER_SUPER
+               : NPPI_INTER_LINEAR;
+  default:
+    return NPPI_INTER_LANCZOS;
+  }
+}
+
 struct ResizeSurface_Impl {
   Surface *pSurface = nullptr;
   CUcontext cu_ctx;
   CUstream cu_str;
   NppStreamContext nppCtx;
+  ResizeFilter filter;
 
   ResizeSurface_Impl(uint32_t width, uint32_t height, Pixel_Format format,
-                     CUcontext ctx, CUstream str)
-      : cu_ctx(ctx), cu_str(str) {
+                     CUcontext ctx, CUstream str, ResizeFilter resizeFilter)
+      : cu_ctx(ctx), cu_str(str), filter(resizeFilter) {
     SetupNppContext(cu_ctx, cu_str, nppCtx);
   }
 
@@ -764,8 +879,9 @@ struct ResizeSurface_Impl {
 
 struct NppResizeSurfacePacked3C_Impl final : ResizeSurface_Impl {
   NppResizeSurfacePacked3C_Impl(uint32_t width, uint32_t height, CUcontext ctx,
-                                CUstream str, Pixel_Format format)
-      : ResizeSurface_Impl(width, height, format, ctx, str) {
+                                CUstream str, Pixel_Format format,
+                                ResizeFilter filter)
+      : ResizeSurface_Impl(width, height, format, ctx, str, filter) {
     pSurface = Surface::Make(format, width, height, ctx);
   }
 
@@ -798,7 +914,7 @@ struct NppResizeSurfacePacked3C_Impl final : ResizeSurface_Impl {
     NppiRect oDstRectROI = {0};
     oDstRectROI.width = oDstSize.width;
     oDstRectROI.height = oDstSize.height;
-    int eInterpolation = NPPI_INTER_LANCZOS;
+    int eInterpolation = GetNppInterpolation(filter, oSrcSize, oDstSize);
 
     CudaCtxPush ctxPush(cu_ctx);
     auto ret = nppiResize_8u_C3R_Ctx(pSrc, nSrcStep, oSrcSize, oSrcRectROI,
@@ -814,15 +930,19 @@ struct NppResizeSurfacePacked3C_Impl final : ResizeSurface_Impl {
   }
 };
 
-// Resize planar 8 bit surface (YUV420, YCbCr420);
-struct NppResizeSurfacePlanar420_Impl final : ResizeSurface_Impl {
-  NppResizeSurfacePlanar420_Impl(uint32_t width, uint32_t height, CUcontext ctx,
-                                 CUstream str, Pixel_Format format)
-      : ResizeSurface_Impl(width, height, format, ctx, str) {
+/* Resize planar 8 bit surface (Y, YUV420, YCbCr420, RGB planar, YUV444);
+ * Planes are addressed through Surface as planar RGB keeps all of them
+ * in single SurfacePlane;
+ */
+struct NppResizeSurfacePlanar_Impl final : ResizeSurface_Impl {
+  NppResizeSurfacePlanar_Impl(uint32_t width, uint32_t height, CUcontext ctx,
+                              CUstream str, Pixel_Format format,
+                              ResizeFilter filter)
+      : ResizeSurface_Impl(width, height, format, ctx, str, filter) {
     pSurface = Surface::Make(format, width, height, ctx);
   }
 
-  ~NppResizeSurfacePlanar420_Impl() { delete pSurface; }
+  ~NppResizeSurfacePlanar_Impl() { delete pSurface; }
 
   TaskExecStatus Run(Surface &source) {
     NvtxMark tick(__FUNCTION__);
@@ -833,28 +953,25 @@ struct NppResizeSurfacePlanar420_Impl final : ResizeSurface_Impl {
       return TaskExecStatus::TASK_EXEC_FAIL;
     }
 
-    for (auto plane = 0; plane < pSurface->NumPlanes(); plane++) {
-      auto srcPlane = source.GetSurfacePlane(plane);
-      auto dstPlane = pSurface->GetSurfacePlane(plane);
-
-      const Npp8u *pSrc = (const Npp8u *)srcPlane->GpuMem();
-      int nSrcStep = (int)srcPlane->Pitch();
+    for (auto plane = 0U; plane < pSurface->NumPlanes(); plane++) {
+      const Npp8u *pSrc = (const Npp8u *)source.PlanePtr(plane);
+      int nSrcStep = (int)source.Pitch(plane);
       NppiSize oSrcSize = {0};
-      oSrcSize.width = srcPlane->Width();
-      oSrcSize.height = srcPlane->Height();
+      oSrcSize.width = source.Width(plane);
+      oSrcSize.height = source.Height(plane);
       NppiRect oSrcRectROI = {0};
       oSrcRectROI.width = oSrcSize.width;
       oSrcRectROI.height = oSrcSize.height;
 
-      Npp8u *pDst = (Npp8u *)dstPlane->GpuMem();
-      int nDstStep = (int)dstPlane->Pitch();
+      Npp8u *pDst = (Npp8u *)pSurface->PlanePtr(plane);
+      int nDstStep = (int)pSurface->Pitch(plane);
       NppiSize oDstSize = {0};
-      oDstSize.width = dstPlane->Width();
-      oDstSize.height = dstPlane->Height();
+      oDstSize.width = pSurface->Width(plane);
+      oDstSize.height = pSurface->Height(plane);
       NppiRect oDstRectROI = {0};
       oDstRectROI.width = oDstSize.width;
       oDstRectROI.height = oDstSize.height;
-      int eInterpolation = NPPI_INTER_LANCZOS;
+      int eInterpolation = GetNppInterpolation(filter, oSrcSize, oDstSize);
 
       CudaCtxPush ctxPush(cu_ctx);
       auto ret = nppiResize_8u_C1R_Ctx(pSrc, nSrcStep, oSrcSize, oSrcRectROI,
@@ -870,6 +987,44 @@ struct NppResizeSurfacePlanar420_Impl final : ResizeSurface_Impl {
   }
 };
 
+// Resizes host memory Surfaces on CPU, see ResizeSurfaceHost();
+struct HostResizeSurface_Impl final {
+  HostResizeSurface_Impl(uint32_t width, uint32_t height, Pixel_Format format,
+                         CUcontext context, ResizeFilter resizeFilter)
+      : outFormat(format), outWidth(width), outHeight(height),
+        cu_ctx(context), filter(resizeFilter) {}
+
+  ~HostResizeSurface_Impl() {
+    delete pSurface;
+    // Same as for download, caller may destroy context right after;
+    if (cu_ctx) {
+      BufferPool::Instance().Trim(cu_ctx);
+    }
+  }
+
+  Surface *Execute(Surface *pInput) {
+    NvtxMark tick(__FUNCTION__);
+    if (!pInput) {
+      return nullptr;
+    }
+
+    pSurface = Surface::MakeOrReuse(pSurface, outFormat, outWidth, outHeight,
+                                    MEM_HOST, cu_ctx);
+    if (!ResizeSurfaceHost(pInput, pSurface, filter)) {
+      cerr << "Failed to resize host surface." << endl;
+      return nullptr;
+    }
+
+    return pSurface;
+  }
+
+  Pixel_Format outFormat;
+  uint32_t outWidth;
+  uint32_t outHeight;
+  CUcontext cu_ctx;
+  ResizeFilter filter;
+  Surface *pSurface = nullptr;
+};
 }; // namespace VPF
 
 auto const cuda_stream_sync = [](void *stream) {
@@ -877,22 +1032,33 @@ auto const cuda_stream_sync = [](void *stream) {
 };
 
 ResizeSurface::ResizeSurface(uint32_t width, uint32_t height,
-                             Pixel_Format format, CUcontext ctx, CUstream str)
+                             Pixel_Format format, CUcontext ctx, CUstream str,
+                             ResizeFilter filter)
     : Task("NppResizeSurface", ResizeSurface::numInputs,
            ResizeSurface::numOutputs, cuda_stream_sync, (void *)str) {
-  if (RGB == format || BGR == format) {
-    pImpl = new NppResizeSurfacePacked3C_Impl(width, height, ctx, str, format);
-  } else if (YUV420 == format || YCBCR == format) {
-    pImpl = new NppResizeSurfacePlanar420_Impl(width, height, ctx, str, format);
+  if (!ctx || NV12 == format) {
+    // Host memory only resizer;
+  } else if (RGB == format || BGR == format) {
+    pImpl = new NppResizeSurfacePacked3C_Impl(width, height, ctx, str, format,
+                                              filter);
+  } else if (Y == format || YUV420 == format || YCBCR == format ||
+             RGB_PLANAR == format || YUV444 == format) {
+    pImpl = new NppResizeSurfacePlanar_Impl(width, height, ctx, str, format,
+                                            filter);
   } else {
     stringstream ss;
     ss << __FUNCTION__;
     ss << ": pixel format not supported";
     throw runtime_error(ss.str());
   }
+
+  pHostImpl = new HostResizeSurface_Impl(width, height, format, ctx, filter);
 }
 
-ResizeSurface::~ResizeSurface() { delete pImpl; }
+ResizeSurface::~ResizeSurface() {
+  delete pImpl;
+  delete pHostImpl;
+}
 
 TaskExecStatus ResizeSurface::Run() {
   NvtxMark tick(__FUNCTION__);
@@ -903,6 +1069,22 @@ TaskExecStatus ResizeSurface::Run() {
     return TASK_EXEC_FAIL;
   }
 
+  if (MEM_HOST == pInputSurface->MemType()) {
+    auto pOutput = pHostImpl->Execute(pInputSurface);
+    if (!pOutput) {
+      return TASK_EXEC_FAIL;
+    }
+
+    SetOutput(pOutput, 0U);
+    return TASK_EXEC_SUCCESS;
+  }
+
+  if (!pImpl) {
+    cerr << __FUNCTION__ << ": device Surfaces need CUDA context and "
+         << "can't be NV12" << endl;
+    return TASK_EXEC_FAIL;
+  }
+
   if (TASK_EXEC_SUCCESS != pImpl->Run(*pInputSurface)) {
     return TASK_EXEC_FAIL;
   }
@@ -913,6 +1095,140 @@ TaskExecStatus ResizeSurface::Run() {
 
 ResizeSurface *ResizeSurface::Make(uint32_t width, uint32_t height,
                                    Pixel_Format format, CUcontext ctx,
-                                   CUstream str) {
-  return new ResizeSurface(width, height, format, ctx, str);
+                                   CUstream str, ResizeFilter filter) {
+  return new ResizeSurface(width, height, format, ctx, str, filter);
+}
+
+namespace VPF {
+struct HostCropResizeSurface_Impl final {
+  HostCropResizeSurface_Impl(Pixel_Format pixelFormat,
+                             ResizeFilter resizeFilter)
+      : format(pixelFormat), filter(resizeFilter) {}
+
+  ~HostCropResizeSurface_Impl() {
+    for (auto pSurface : surfaces) {
+      delete pSurface;
+    }
+    delete pBuffer;
+  }
+
+  Buffer *Execute(Surface *pInput, const CropResizeParams *pParams,
+                  size_t numCrops, Buffer *pDst) {
+    NvtxMark tick(__FUNCTION__);
+    if (!pInput || !numCrops) {
+      return nullptr;
+    }
+
+    rects.resize(numCrops);
+    for (size_t i = 0U; i < numCrops; i++) {
+      rects[i] = pParams[i].rect;
+    }
+
+    if (pDst) {
+      return ResizeInto(pInput, pParams, numCrops, pDst);
+    }
+
+    // Surfaces of previous run are kept for the next ones;
+    if (surfaces.size() < numCrops) {
+      surfaces.resize(numCrops, nullptr);
+    }
+
+    for (size_t i = 0U; i < numCrops; i++) {
+      surfaces[i] = Surface::MakeOrReuse(surfaces[i], format, pParams[i].width,
+                                         pParams[i].height, MEM_HOST);
+    }
+
+    if (!CropResizeSurfaceHost(pInput, rects.data(), surfaces.data(),
+                               numCrops, filter)) {
+      cerr << "Failed to crop and resize host surface." << endl;
+      return nullptr;
+    }
+
+    auto const size = numCrops * sizeof(Surface *);
+    if (!pBuffer) {
+      pBuffer = Buffer::MakeOwnMem(size);
+    } else if (size != pBuffer->GetRawMemSize()) {
+      pBuffer->Update(size);
+    }
+    memcpy(pBuffer->GetRawMemPtr(), surfaces.data(), size);
+
+    return pBuffer;
+  }
+
+  // Caller-owned Surfaces are checked, never reallocated;
+  Buffer *ResizeInto(Surface *pInput, const CropResizeParams *pParams,
+                     size_t numCrops, Buffer *pDst) {
+    if (pDst->GetRawMemSize() != numCrops * sizeof(Surface *)) {
+      cerr << "Number of destination surfaces doesn't match number of crops."
+           << endl;
+      return nullptr;
+    }
+
+    auto ppDst = pDst->GetDataAs<Surface *>();
+    for (size_t i = 0U; i < numCrops; i++) {
+      if (!ppDst[i] || ppDst[i]->PixelFormat() != format ||
+          ppDst[i]->Width() != pParams[i].width ||
+          ppDst[i]->Height() != pParams[i].height) {
+        cerr << "Destination surface " << i
+             << " doesn't match crop size or format." << endl;
+        return nullptr;
+      }
+    }
+
+    if (!CropResizeSurfaceHost(pInput, rects.data(), ppDst, numCrops,
+                               filter)) {
+      cerr << "Failed to crop and resize host surface." << endl;
+      return nullptr;
+    }
+
+    return pDst;
+  }
+
+  Pixel_Format format;
+  ResizeFilter filter;
+  vector<Surface *> surfaces;
+  vector<SurfaceRect> rects;
+  Buffer *pBuffer = nullptr;
+};
+} // namespace VPF
+
+CropResizeSurface::CropResizeSurface(Pixel_Format format, ResizeFilter filter)
+    : Task("HostCropResizeSurface", CropResizeSurface::numInputs,
+           CropResizeSurface::numOutputs) {
+  pImpl = new HostCropResizeSurface_Impl(format, filter);
+}
+
+CropResizeSurface::~CropResizeSurface() { delete pImpl; }
+
+CropResizeSurface *CropResizeSurface::Make(Pixel_Format format,
+                                           ResizeFilter filter) {
+  return new CropResizeSurface(format, filter);
+}
+
+TaskExecStatus CropResizeSurface::Run() {
+  NvtxMark tick(__FUNCTION__);
+  ClearOutputs();
+
+  auto pInput = (Surface *)GetInput(0U);
+  auto pParams = (Buffer *)GetInput(1U);
+  if (!pInput || !pParams) {
+    return TASK_EXEC_FAIL;
+  }
+
+  if (MEM_HOST != pInput->MemType()) {
+    cerr << __FUNCTION__ << ": device memory Surfaces aren't supported"
+         << endl;
+    return TASK_EXEC_FAIL;
+  }
+
+  auto const numCrops = pParams->GetRawMemSize() / sizeof(CropResizeParams);
+  auto pOutput =
+      pImpl->Execute(pInput, pParams->GetDataAs<CropResizeParams>(),
+                     numCrops, (Buffer *)GetInput(2U));
+  if (!pOutput) {
+    return TASK_EXEC_FAIL;
+  }
+
+  SetOutput(pOutput, 0U);
+  return TASK_EXEC_SUCCESS;
 }
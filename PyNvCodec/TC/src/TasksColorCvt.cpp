@@ -11,7 +11,10 @@
  * limitations under the License.
  */
 
+#include "BufferPool.hpp"
 #include "CodecsSupport.hpp"
+#include "HostColorCvt.hpp"
+#include "HostTensorCvt.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NppCommon.hpp"
 #include "Tasks.hpp"
@@ -484,6 +487,85 @@ struct rbg8_swapchannel final : public NppConvertSurface_Impl {
   }
   Surface *pSurface = nullptr;
 };
+
+/* Converts host memory Surfaces on CPU;
+ * Output Surface is allocated upon first use, so converters which only
+ * get device Surfaces don't waste host memory;
+ */
+struct HostConvertSurface_Impl final {
+  HostConvertSurface_Impl(uint32_t width, uint32_t height,
+                          Pixel_Format format, CUcontext context)
+      : outFormat(format), outWidth(width), outHeight(height),
+        cu_ctx(context) {}
+
+  ~HostConvertSurface_Impl() {
+    delete pSurface;
+    // Pinned blocks of caller context can't stay cached after it's gone;
+    if (cu_ctx) {
+      BufferPool::Instance().Trim(cu_ctx);
+    }
+  }
+
+  Token *Execute(Token *pInput, ColorspaceConversionContext *pCtx) {
+    NvtxMark tick(__FUNCTION__);
+    if (!pInput) {
+      return nullptr;
+    }
+
+    // Pinned memory if there's CUDA context, converted frames go to GPU;
+    pSurface = Surface::MakeOrReuse(pSurface, outFormat, outWidth, outHeight,
+                                    MEM_HOST, cu_ctx);
+    if (!ConvertSurfaceHost((Surface *)pInput, pSurface, pCtx)) {
+      cerr << "Failed to convert host surface." << endl;
+      return nullptr;
+    }
+
+    return pSurface;
+  }
+
+  Pixel_Format outFormat;
+  uint32_t outWidth;
+  uint32_t outHeight;
+  CUcontext cu_ctx;
+  Surface *pSurface = nullptr;
+};
+
+struct HostSurfaceToTensor_Impl final {
+  explicit HostSurfaceToTensor_Impl(const TensorParams &tensorParams)
+      : params(tensorParams) {}
+
+  ~HostSurfaceToTensor_Impl() { delete pBuffer; }
+
+  Buffer *Execute(Surface *pInput, ColorspaceConversionContext *pCtx,
+                  Buffer *pDst) {
+    NvtxMark tick(__FUNCTION__);
+    if (!pInput) {
+      return nullptr;
+    }
+
+    auto const size =
+        GetTensorSize(params, pInput->Width(), pInput->Height());
+    if (!pDst) {
+      if (!pBuffer) {
+        pBuffer = Buffer::MakeOwnMem(size);
+      } else if (size != pBuffer->GetRawMemSize()) {
+        pBuffer->Update(size);
+      }
+      pDst = pBuffer;
+    }
+
+    if (!ConvertSurfaceToTensorHost(pInput, pDst->GetRawMemPtr(),
+                                    pDst->GetRawMemSize(), params, pCtx)) {
+      cerr << "Failed to convert host surface to tensor." << endl;
+      return nullptr;
+    }
+
+    return pDst;
+  }
+
+  TensorParams params;
+  Buffer *pBuffer = nullptr;
+};
 } // namespace VPF
 
 auto const cuda_stream_sync = [](void *stream) {
@@ -495,7 +577,16 @@ ConvertSurface::ConvertSurface(uint32_t width, uint32_t height,
                                CUcontext ctx, CUstream str)
     : Task("NppConvertSurface", ConvertSurface::numInputs,
            ConvertSurface::numOutputs, cuda_stream_sync, (void *)str) {
-  if (NV12 == inFormat && YUV420 == outFormat) {
+  if (!IsHostCvtSupported(inFormat, outFormat)) {
+    stringstream ss;
+    ss << "Unsupported pixel format conversion: " << inFormat << " to "
+       << outFormat;
+    throw invalid_argument(ss.str());
+  }
+
+  if (!ctx) {
+    // Host memory only converter;
+  } else if (NV12 == inFormat && YUV420 == outFormat) {
     pImpl = new nv12_yuv420(width, height, ctx, str);
   } else if (YUV420 == inFormat && NV12 == outFormat) {
     pImpl = new yuv420_nv12(width, height, ctx, str);
@@ -513,15 +604,15 @@ ConvertSurface::ConvertSurface(uint32_t width, uint32_t height,
     pImpl = new bgr_ycbcr(width, height, ctx, str);
   } else if (RGB == inFormat && BGR == outFormat) {
     pImpl = new rbg8_swapchannel(width, height, ctx, str);
-  } else {
-    stringstream ss;
-    ss << "Unsupported pixel format conversion: " << inFormat << " to "
-       << outFormat;
-    throw invalid_argument(ss.str());
   }
+
+  pHostImpl = new HostConvertSurface_Impl(width, height, outFormat, ctx);
 }
 
-ConvertSurface::~ConvertSurface() { delete pImpl; }
+ConvertSurface::~ConvertSurface() {
+  delete pImpl;
+  delete pHostImpl;
+}
 
 ConvertSurface *ConvertSurface::Make(uint32_t width, uint32_t height,
                                      Pixel_Format inFormat,
@@ -539,7 +630,63 @@ TaskExecStatus ConvertSurface::Run() {
     pCtx = ctx_buf->GetDataAs<ColorspaceConversionContext>();
   }
 
-  auto pOutput = pImpl->Execute(GetInput(0), pCtx);
+  auto pInput = (Surface *)GetInput(0U);
+  Token *pOutput = nullptr;
+  if (pInput && MEM_DEVICE == pInput->MemType()) {
+    if (!pImpl) {
+      cerr << __FUNCTION__ << ": device Surfaces need CUDA context" << endl;
+      return TASK_EXEC_FAIL;
+    }
+    pOutput = pImpl->Execute(pInput, pCtx);
+  } else {
+    pOutput = pHostImpl->Execute(pInput, pCtx);
+  }
+
+  SetOutput(pOutput, 0U);
+  return TASK_EXEC_SUCCESS;
+}
+
+ConvertSurfaceToTensor::ConvertSurfaceToTensor(Pixel_Format inFormat,
+                                               const TensorParams &params)
+    : Task("HostSurfaceToTensor", ConvertSurfaceToTensor::numInputs,
+           ConvertSurfaceToTensor::numOutputs) {
+  if (!IsHostTensorCvtSupported(inFormat)) {
+    stringstream ss;
+    ss << "Unsupported pixel format for tensor conversion: " << inFormat;
+    throw invalid_argument(ss.str());
+  }
+
+  for (auto value : params.std) {
+    if (0.0f == value) {
+      throw invalid_argument("Tensor std values can't be zero.");
+    }
+  }
+
+  pImpl = new HostSurfaceToTensor_Impl(params);
+}
+
+ConvertSurfaceToTensor::~ConvertSurfaceToTensor() { delete pImpl; }
+
+ConvertSurfaceToTensor *
+ConvertSurfaceToTensor::Make(Pixel_Format inFormat,
+                             const TensorParams &params) {
+  return new ConvertSurfaceToTensor(inFormat, params);
+}
+
+TaskExecStatus ConvertSurfaceToTensor::Run() {
+  ClearOutputs();
+
+  ColorspaceConversionContext *pCtx = nullptr;
+  auto ctx_buf = (Buffer *)GetInput(1U);
+  if (ctx_buf) {
+    pCtx = ctx_buf->GetDataAs<ColorspaceConversionContext>();
+  }
+
+  auto pOutput =
+      pImpl->Execute((Surface *)GetInput(0U), pCtx, (Buffer *)GetInput(2U));
+  if (!pOutput) {
+    return TASK_EXEC_FAIL;
+  }
 
   SetOutput(pOutput, 0U);
   return TASK_EXEC_SUCCESS;
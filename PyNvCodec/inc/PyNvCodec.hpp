@@ -14,25 +14,40 @@
 
 #pragma once
 
+#include "BufferPool.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NvCodecCLIOptions.h"
 #include "FFmpegDemuxer.h"
 #include "NvDecoder.h"
 #include "TC_CORE.hpp"
+#include "TaskExecutor.hpp"
+#include "TaskGraph.hpp"
+#include "TaskMetrics.hpp"
+#include "TaskTracer.hpp"
 #include "Tasks.hpp"
+#include "TokenPool.hpp"
+#include "TokenQueue.hpp"
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cuda.h>
 #include <cuda_runtime.h>
+#include <exception>
+#include <functional>
 #include <mutex>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <sstream>
+#include <thread>
 
 extern "C" {
 #include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
 #include <libavutil/motion_vector.h>
+#include <libavutil/pixdesc.h>
 }
 
 using namespace VPF;
@@ -111,6 +126,10 @@ public:
   PySurfaceConverter(uint32_t width, uint32_t height, Pixel_Format inFormat,
                      Pixel_Format outFormat, uint32_t gpuID);
 
+  // Converts host memory Surfaces only, doesn't need GPU;
+  PySurfaceConverter(uint32_t width, uint32_t height, Pixel_Format inFormat,
+                     Pixel_Format outFormat);
+
   PySurfaceConverter(uint32_t width, uint32_t height, Pixel_Format inFormat,
                      Pixel_Format outFormat, CUcontext ctx, CUstream str);
 
@@ -125,40 +144,203 @@ public:
   Pixel_Format GetFormat();
 };
 
+/* Converts host memory YUV Surface to normalized CHW float tensor in one
+ * pass; Tensor is written into given numpy array or into new one;
+ */
+class PySurfaceTensorConverter {
+  std::unique_ptr<ConvertSurfaceToTensor> upConverter;
+  std::unique_ptr<Buffer> upCtxBuffer;
+  std::unique_ptr<Buffer> upTensorBuffer;
+  TensorParams params;
+
+  py::dtype GetDtype() const;
+
+  bool Convert(std::shared_ptr<Surface> surface,
+               std::shared_ptr<ColorspaceConversionContext> context,
+               void *pTensor, size_t tensorSize);
+
+public:
+  PySurfaceTensorConverter(Pixel_Format inFormat, uint32_t tensorWidth,
+                           uint32_t tensorHeight, TensorDataType type,
+                           const std::vector<float> &mean,
+                           const std::vector<float> &std, float scale,
+                           bool is_bgr);
+
+  bool Execute(std::shared_ptr<Surface> surface,
+               std::shared_ptr<ColorspaceConversionContext> context,
+               py::array &tensor);
+
+  py::array Execute(std::shared_ptr<Surface> surface,
+                    std::shared_ptr<ColorspaceConversionContext> context);
+};
+
 class PySurfaceResizer {
   std::unique_ptr<ResizeSurface> upResizer;
   Pixel_Format outputFormat;
 
 public:
   PySurfaceResizer(uint32_t width, uint32_t height, Pixel_Format format,
-                   uint32_t gpuID);
+                   uint32_t gpuID, ResizeFilter filter);
+
+  // Resizes host memory Surfaces only, doesn't need GPU;
+  PySurfaceResizer(uint32_t width, uint32_t height, Pixel_Format format,
+                   ResizeFilter filter);
 
   PySurfaceResizer(uint32_t width, uint32_t height, Pixel_Format format,
-                   CUcontext ctx, CUstream str);
+                   CUcontext ctx, CUstream str, ResizeFilter filter);
 
   PySurfaceResizer(uint32_t width, uint32_t height, Pixel_Format format,
-                   size_t ctx, size_t str):
-    PySurfaceResizer(width, height, format, (CUcontext)ctx, (CUstream)str){}
+                   size_t ctx, size_t str, ResizeFilter filter):
+    PySurfaceResizer(width, height, format, (CUcontext)ctx, (CUstream)str,
+                     filter){}
 
   Pixel_Format GetFormat();
 
   std::shared_ptr<Surface> Execute(std::shared_ptr<Surface> surface);
 };
 
+/* Crops and resizes many rectangles of host memory Surface at once;
+ * Every call returns new Surfaces owned by Python;
+ */
+class PySurfaceCropResizer {
+  std::unique_ptr<CropResizeSurface> upResizer;
+  std::unique_ptr<Buffer> upParamsBuffer;
+  std::unique_ptr<Buffer> upDstBuffer;
+  Pixel_Format format;
+
+public:
+  PySurfaceCropResizer(Pixel_Format format, ResizeFilter filter);
+
+  Pixel_Format GetFormat();
+
+  /* Rectangles are (x, y, width, height), every one is resized to the size
+   * of the same index; Returns empty list if any crop fails;
+   * Returned Surfaces are allocated on every call and owned by caller;
+   */
+  std::vector<std::shared_ptr<Surface>>
+  Execute(std::shared_ptr<Surface> surface,
+          const std::vector<std::array<uint32_t, 4>> &rects,
+          const std::vector<std::array<uint32_t, 2>> &sizes);
+};
+
+/* Chunk of frames or packets packed one after another;
+ * Chunks are recycled once Python releases all arrays which refer to them,
+ * so their memory is allocated only for first few chunks;
+ */
+struct StreamChunk final : public Token {
+  std::vector<uint8_t> data;
+  // Offset of every item in data plus end of the last one;
+  std::vector<size_t> offsets = {0U};
+  // Size of first frame row, 0 for packets;
+  size_t row_size = 0U;
+
+  size_t GetNumItems() const;
+  size_t GetItemSize(size_t item) const;
+  void Append(const void *ptr, size_t size);
+  void Clear();
+  size_t GetByteSize() const override;
+};
+
+/* Python iterator which runs demuxer or decoder ahead of consumption on
+ * background thread; Every step returns chunk of up to chunk_size items,
+ * up to prefetch_chunks more chunks are prepared meanwhile;
+ * Object which made iterator is marked as in use until iterator is closed
+ * or exhausted, its other methods throw meanwhile;
+ */
+class PyStreamIterator {
+public:
+  // Appends next item to chunk, returns false at the end of stream;
+  typedef std::function<bool(StreamChunk &chunk)> Producer;
+
+  /* Makes Python object out of chunk, capsule keeps chunk alive;
+   * Called with GIL held;
+   */
+  typedef std::function<py::object(StreamChunk &chunk, py::capsule chunk_ref)>
+      Converter;
+
+  // Throws if owner is already in use by another iterator;
+  PyStreamIterator(py::object owner, std::atomic<bool> &owner_in_use,
+                   Producer producer, Converter converter,
+                   uint32_t chunk_size, uint32_t prefetch_chunks);
+  ~PyStreamIterator();
+
+  // Raises StopIteration at the end of stream;
+  py::object Next();
+
+  // Stops background thread, drops chunks which weren't returned yet;
+  void Close();
+
+  uint32_t ChunkSize() const;
+
+private:
+  void Run();
+
+  py::object owner;
+  std::atomic<bool> &owner_in_use;
+  Producer producer;
+  Converter converter;
+  uint32_t chunk_size;
+
+  std::unique_ptr<TokenPool> upPool;
+  std::unique_ptr<SpscTokenQueue> upQueue;
+  std::atomic<bool> is_stopped;
+  std::mutex error_lock;
+  std::exception_ptr error;
+  std::thread worker;
+};
+
 class PyFFmpegDemuxer {
   std::unique_ptr<DemuxFrame> upDemuxer;
+  /* Per-object exclusion flag, held by every GIL-free call, stream iterator
+   * and pending async call; Other calls raise instead of racing them;
+   */
+  std::atomic<bool> in_use{false};
+
+  /* Runs demuxer until it outputs video packet, seeks first if seek
+   * context is given; Releases GIL, so other Python threads run meanwhile;
+   * Returns nullptr at the end of stream;
+   */
+  Buffer *DemuxUntilPacket(Buffer *pSeekCtxBuf);
 
 public:
   PyFFmpegDemuxer(const std::string &pathToFile);
   PyFFmpegDemuxer(const std::string &pathToFile,
                   const std::map<std::string, std::string> &ffmpeg_options);
 
+  /* GIL is only held while packet is copied to numpy array, so demuxers
+   * of different streams run in parallel in Python threads; Call throws
+   * if same demuxer is used by another thread at the moment;
+   */
   bool DemuxSinglePacket(py::array_t<uint8_t> &packet);
 
+  /* Demuxes single packet for every demuxer on process-wide TaskExecutor
+   * instead of one thread per stream; Demuxers must be distinct;
+   */
+  static std::vector<bool>
+  DemuxSinglePackets(const std::vector<PyFFmpegDemuxer *> &demuxers,
+                     std::vector<py::array_t<uint8_t>> &packets,
+                     TaskPriority priority, uint32_t timeout_ms);
+
+  py::object DemuxSinglePacketNoCopy();
+
+  /* Returns asyncio future which gets packet or None at the end of stream;
+   * Demuxing is done on process-wide TaskExecutor, so event loop isn't
+   * blocked; Must be called with running event loop; Other calls raise
+   * until packet is demuxed;
+   */
+  py::object DemuxSinglePacketAsync();
+
   void GetLastPacketData(PacketData &pkt_data);
 
   bool Seek(SeekContext &ctx, py::array_t<uint8_t> &packet);
 
+  /* Returns iterator over lists of up to chunk_size packets;
+   * Packets are demuxed on background thread, so binding is crossed once
+   * per chunk instead of once per packet;
+   */
+  std::unique_ptr<PyStreamIterator> Stream(uint32_t chunk_size,
+                                           uint32_t prefetch_chunks);
+
   uint32_t Width() const;
 
   uint32_t Height() const;
@@ -177,19 +359,77 @@ public:
 
   double Timebase() const;
 
+  bool ReservePacketBuffer(size_t size);
+
+  bool ShrinkPacketBuffer();
+
+  size_t PacketBufferCapacity() const;
+
+  bool BuildSeekIndex(bool in_background);
+
+  bool IsSeekIndexReady() const;
 };
 
 class PyFfmpegDecoder {
   std::unique_ptr<FfmpegDecodeFrame> upDecoder = nullptr;
+  // Per-object exclusion flag, same as PyFFmpegDemuxer::in_use;
+  std::atomic<bool> in_use{false};
 
   void *GetSideData(AVFrameSideDataType data_type, size_t &raw_size);
 
 public:
   PyFfmpegDecoder(const std::string &pathToFile,
-                  const std::map<std::string, std::string> &ffmpeg_options);
+                  const std::map<std::string, std::string> &ffmpeg_options,
+                  uint32_t num_threads = 0U,
+                  SwDecodeThreadType thread_type = THREAD_FRAME_SLICE);
 
+  /* GIL is only held while frame is copied to numpy array, see
+   * PyFFmpegDemuxer::DemuxSinglePacket;
+   */
   bool DecodeSingleFrame(py::array_t<uint8_t> &frame);
 
+  /* Decodes single frame for every decoder on process-wide TaskExecutor
+   * instead of one thread per stream; Decoders must be distinct;
+   */
+  static std::vector<bool>
+  DecodeSingleFrames(const std::vector<PyFfmpegDecoder *> &decoders,
+                     std::vector<py::array_t<uint8_t>> &frames,
+                     TaskPriority priority, uint32_t timeout_ms);
+
+  py::list DecodeSingleFrameNoCopy();
+
+  /* Returns asyncio future which gets decoded frame or None;
+   * Decoding is done on process-wide TaskExecutor, so event loop isn't
+   * blocked; Must be called with running event loop; Other calls raise
+   * until frame is decoded;
+   */
+  py::object DecodeSingleFrameAsync();
+
+  py::array_t<uint8_t> GetFrames(const std::vector<int64_t> &frame_nums);
+
+  /* Returns iterator over arrays of up to chunk_size frames, decoded on
+   * background thread; Arrays are shaped like in GetFrames; Chunk which
+   * spans resolution change is returned as list of single frames;
+   */
+  std::unique_ptr<PyStreamIterator> Stream(uint32_t chunk_size,
+                                           uint32_t prefetch_chunks);
+
+  /* Container frame count, 0 if it's unknown, until frame index is built;
+   * exact=True builds index first, which reads whole file and writes
+   * .vpfidx file next to it, so it's as slow as demuxing the input once;
+   */
+  uint32_t NumFrames(bool exact);
+
+  uint32_t Width() const;
+
+  uint32_t Height() const;
+
+  std::string Format() const;
+
+  uint32_t NumThreads() const;
+
+  SwDecodeThreadType ThreadType() const;
+
   py::array_t<MotionVector> GetMotionVectors();
 };
 
@@ -254,6 +494,16 @@ public:
 
   uint32_t Framesize() const;
 
+  bool ReservePacketBuffer(size_t size);
+
+  bool ShrinkPacketBuffer();
+
+  size_t PacketBufferCapacity() const;
+
+  bool BuildSeekIndex(bool in_background);
+
+  bool IsSeekIndexReady() const;
+
   Pixel_Format GetPixelFormat() const;
 
   std::shared_ptr<Surface> DecodeSurfaceFromPacket(py::array_t<uint8_t> &packet,
@@ -322,9 +572,20 @@ public:
 
   std::shared_ptr<Surface> FlushSingleSurface();
 
+  /* Decodes whole stream with built-in demuxer, demuxer and decoder run
+   * on their own threads as TaskGraph pipeline; Callback is given every
+   * decoded Surface and its PacketData on decoder thread and must not use
+   * this decoder; Its false return value stops decoding;
+   * Returns number of Surfaces given to callback;
+   */
+  uint32_t DecodeStream(py::function callback);
+
 private:
   bool DecodeSurface(struct DecodeContext &ctx);
 
+  // Makes new HW decoder after decoding error;
+  void ResetHwDecoder();
+
   Surface *getDecodedSurfaceFromPacket(py::array_t<uint8_t> *pPacket);
 };
 
@@ -87,9 +87,8 @@ public:
     
     auto &ctx = g_Contexts[idx];
     if (!ctx.second) {
-      CUdevice cuDevice = 0;
-      ThrowOnCudaError(cuDeviceGet(&cuDevice, idx), __LINE__);
-      ThrowOnCudaError(cuDevicePrimaryCtxRetain(&ctx.second, cuDevice), __LINE__);
+      ThrowOnCudaError(cuDeviceGet(&ctx.first, idx), __LINE__);
+      ThrowOnCudaError(cuDevicePrimaryCtxRetain(&ctx.second, ctx.first), __LINE__);
     }
 
     return g_Contexts[idx].second;
@@ -131,6 +130,10 @@ public:
       {
         for (int i=0;i<g_Contexts.size();i++) {
           if (g_Contexts[i].second) {
+            /* Pinned blocks cached for context are invalid once it's gone,
+             * so return them while context is still alive;
+             */
+            BufferPool::Instance().Trim(g_Contexts[i].second);
             ThrowOnCudaError(cuDevicePrimaryCtxRelease(g_Contexts[i].first), __LINE__);
           }
         }
@@ -274,6 +277,15 @@ PySurfaceConverter::PySurfaceConverter(uint32_t width, uint32_t height,
   upCtxBuffer.reset(Buffer::MakeOwnMem(sizeof(ColorspaceConversionContext)));
 }
 
+PySurfaceConverter::PySurfaceConverter(uint32_t width, uint32_t height,
+                                       Pixel_Format inFormat,
+                                       Pixel_Format outFormat)
+    : outputFormat(outFormat) {
+  upConverter.reset(ConvertSurface::Make(width, height, inFormat, outFormat,
+                                         nullptr, nullptr));
+  upCtxBuffer.reset(Buffer::MakeOwnMem(sizeof(ColorspaceConversionContext)));
+}
+
 PySurfaceConverter::PySurfaceConverter(uint32_t width, uint32_t height,
                                        Pixel_Format inFormat,
                                        Pixel_Format outFormat, CUcontext ctx, 
@@ -311,19 +323,131 @@ PySurfaceConverter::Execute(shared_ptr<Surface> surface,
 
 Pixel_Format PySurfaceConverter::GetFormat() { return outputFormat; }
 
+PySurfaceTensorConverter::PySurfaceTensorConverter(
+    Pixel_Format inFormat, uint32_t tensorWidth, uint32_t tensorHeight,
+    TensorDataType type, const vector<float> &mean, const vector<float> &std,
+    float scale, bool is_bgr) {
+  if (3U != mean.size() || 3U != std.size()) {
+    throw invalid_argument("Mean and std must have 3 values each.");
+  }
+
+  params.width = tensorWidth;
+  params.height = tensorHeight;
+  params.type = type;
+  params.scale = scale;
+  params.is_bgr = is_bgr;
+  for (auto i = 0U; i < 3U; i++) {
+    params.mean[i] = mean[i];
+    params.std[i] = std[i];
+  }
+
+  upConverter.reset(ConvertSurfaceToTensor::Make(inFormat, params));
+  upCtxBuffer.reset(Buffer::MakeOwnMem(sizeof(ColorspaceConversionContext)));
+  upTensorBuffer.reset(Buffer::Make(0U, nullptr));
+}
+
+py::dtype PySurfaceTensorConverter::GetDtype() const {
+  return TENSOR_FLOAT16 == params.type ? py::dtype("float16")
+                                       : py::dtype::of<float>();
+}
+
+bool PySurfaceTensorConverter::Convert(
+    shared_ptr<Surface> surface,
+    shared_ptr<ColorspaceConversionContext> context, void *pTensor,
+    size_t tensorSize) {
+  // Conversion doesn't touch Python objects;
+  py::gil_scoped_release gil_release;
+
+  upConverter->ClearInputs();
+  upConverter->SetInput(surface.get(), 0U);
+
+  if (context) {
+    upCtxBuffer->CopyFrom(sizeof(ColorspaceConversionContext), context.get());
+    upConverter->SetInput((Token *)upCtxBuffer.get(), 1U);
+  }
+
+  upTensorBuffer->Update(tensorSize, pTensor);
+  upConverter->SetInput((Token *)upTensorBuffer.get(), 2U);
+
+  return TASK_EXEC_SUCCESS == upConverter->Execute();
+}
+
+bool PySurfaceTensorConverter::Execute(
+    shared_ptr<Surface> surface,
+    shared_ptr<ColorspaceConversionContext> context, py::array &tensor) {
+  if (!surface) {
+    return false;
+  }
+
+  if (!tensor.dtype().equal(GetDtype())) {
+    throw invalid_argument("Tensor dtype doesn't match converter data type.");
+  }
+
+  if (!(tensor.flags() & py::array::c_style)) {
+    throw invalid_argument("Tensor must be C-contiguous.");
+  }
+
+  auto const item_size =
+      TENSOR_FLOAT16 == params.type ? sizeof(uint16_t) : sizeof(float);
+  auto const tensor_size = (size_t)tensor.size() * item_size;
+  auto const size = GetTensorSize(params, surface->Width(), surface->Height());
+  if (tensor_size < size) {
+    stringstream ss;
+    ss << "Tensor is too small: " << tensor_size << " bytes given, " << size
+       << " bytes needed.";
+    throw invalid_argument(ss.str());
+  }
+
+  return Convert(surface, context, tensor.mutable_data(), tensor_size);
+}
+
+py::array PySurfaceTensorConverter::Execute(
+    shared_ptr<Surface> surface,
+    shared_ptr<ColorspaceConversionContext> context) {
+  auto const dtype = GetDtype();
+  if (!surface) {
+    return py::array(dtype, vector<ssize_t>({0}));
+  }
+
+  // Strides are given explicitly to get C-contiguous array;
+  auto const item_size =
+      TENSOR_FLOAT16 == params.type ? sizeof(uint16_t) : sizeof(float);
+  auto const width = params.width ? params.width : surface->Width();
+  auto const height = params.height ? params.height : surface->Height();
+  py::array tensor(dtype, vector<ssize_t>({3, height, width}),
+                   vector<ssize_t>({(ssize_t)(item_size * height * width),
+                                    (ssize_t)(item_size * width),
+                                    (ssize_t)item_size}));
+
+  if (!Execute(surface, context, tensor)) {
+    return py::array(dtype, vector<ssize_t>({0}));
+  }
+  return tensor;
+}
+
 PySurfaceResizer::PySurfaceResizer(uint32_t width, uint32_t height,
-                                   Pixel_Format format, uint32_t gpuID)
+                                   Pixel_Format format, uint32_t gpuID,
+                                   ResizeFilter filter)
     : outputFormat(format) {
   upResizer.reset(ResizeSurface::Make(width, height, format,
                                       CudaResMgr::Instance().GetCtx(gpuID),
-                                      CudaResMgr::Instance().GetStream(gpuID)));
+                                      CudaResMgr::Instance().GetStream(gpuID),
+                                      filter));
+}
+
+PySurfaceResizer::PySurfaceResizer(uint32_t width, uint32_t height,
+                                   Pixel_Format format, ResizeFilter filter)
+    : outputFormat(format) {
+  upResizer.reset(
+      ResizeSurface::Make(width, height, format, nullptr, nullptr, filter));
 }
 
 PySurfaceResizer::PySurfaceResizer(uint32_t width, uint32_t height,
                                    Pixel_Format format, CUcontext ctx, 
-                                   CUstream str)
+                                   CUstream str, ResizeFilter filter)
     : outputFormat(format) {
-  upResizer.reset(ResizeSurface::Make(width, height, format, ctx, str));
+  upResizer.reset(
+      ResizeSurface::Make(width, height, format, ctx, str, filter));
 }
 
 Pixel_Format PySurfaceResizer::GetFormat() { return outputFormat; }
@@ -344,28 +468,657 @@ shared_ptr<Surface> PySurfaceResizer::Execute(shared_ptr<Surface> surface) {
                                       : Surface::Make(outputFormat));
 }
 
+PySurfaceCropResizer::PySurfaceCropResizer(Pixel_Format pixelFormat,
+                                           ResizeFilter filter)
+    : format(pixelFormat) {
+  upResizer.reset(CropResizeSurface::Make(format, filter));
+  upParamsBuffer.reset(Buffer::Make(0U, nullptr));
+  upDstBuffer.reset(Buffer::Make(0U, nullptr));
+}
+
+Pixel_Format PySurfaceCropResizer::GetFormat() { return format; }
+
+vector<shared_ptr<Surface>>
+PySurfaceCropResizer::Execute(shared_ptr<Surface> surface,
+                              const vector<array<uint32_t, 4>> &rects,
+                              const vector<array<uint32_t, 2>> &sizes) {
+  if (rects.size() != sizes.size()) {
+    throw invalid_argument("Every rectangle needs output size.");
+  }
+
+  vector<shared_ptr<Surface>> crops;
+  if (!surface || rects.empty()) {
+    return crops;
+  }
+
+  vector<CropResizeParams> params(rects.size());
+  for (size_t i = 0U; i < rects.size(); i++) {
+    params[i].rect.x = rects[i][0];
+    params[i].rect.y = rects[i][1];
+    params[i].rect.width = rects[i][2];
+    params[i].rect.height = rects[i][3];
+    params[i].width = sizes[i][0];
+    params[i].height = sizes[i][1];
+  }
+
+  /* Every call resizes into new Surfaces owned by Python, so returned crops
+   * outlive this object and aren't overwritten by next call;
+   */
+  vector<shared_ptr<Surface>> dst(rects.size());
+  vector<Surface *> ppDst(rects.size());
+  for (size_t i = 0U; i < rects.size(); i++) {
+    dst[i].reset(Surface::Make(format, sizes[i][0], sizes[i][1], MEM_HOST));
+    ppDst[i] = dst[i].get();
+  }
+
+  upParamsBuffer->Update(params.size() * sizeof(CropResizeParams),
+                         params.data());
+  upDstBuffer->Update(ppDst.size() * sizeof(Surface *), ppDst.data());
+  upResizer->SetInput(surface.get(), 0U);
+  upResizer->SetInput(upParamsBuffer.get(), 1U);
+  upResizer->SetInput(upDstBuffer.get(), 2U);
+  if (TASK_EXEC_SUCCESS != upResizer->Execute()) {
+    return crops;
+  }
+
+  crops.swap(dst);
+  return crops;
+}
+
+static const char *in_use_error =
+    "Object is used by another thread, stream iterator or async call.";
+
+// Stream iterator drives object on its own thread, see PyStreamIterator;
+static void ThrowIfInUse(const atomic<bool> &in_use) {
+  if (in_use) {
+    throw runtime_error(in_use_error);
+  }
+}
+
+/* Marks object as used till the end of scope;
+ * Calls release GIL, so it doesn't keep Python threads from driving the
+ * same object at once anymore;
+ */
+class ScopedUse final {
+public:
+  explicit ScopedUse(atomic<bool> &in_use) : in_use(in_use) {
+    if (in_use.exchange(true)) {
+      throw runtime_error(in_use_error);
+    }
+  }
+  ~ScopedUse() { in_use = false; }
+
+private:
+  atomic<bool> &in_use;
+};
+
 PyFfmpegDecoder::PyFfmpegDecoder(const string &pathToFile,
-                                 const map<string, string> &ffmpeg_options) {
+                                 const map<string, string> &ffmpeg_options,
+                                 uint32_t num_threads,
+                                 SwDecodeThreadType thread_type) {
   NvDecoderClInterface cli_iface(ffmpeg_options);
-  upDecoder.reset(FfmpegDecodeFrame::Make(pathToFile.c_str(), cli_iface));
+  upDecoder.reset(FfmpegDecodeFrame::Make(pathToFile.c_str(), cli_iface,
+                                          num_threads, thread_type));
 }
 
-bool PyFfmpegDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame) {
-  if (TASK_EXEC_SUCCESS == upDecoder->Execute()) {
-    auto pRawFrame = (Buffer *)upDecoder->GetOutput(0U);
-    if (pRawFrame) {
-      auto const frame_size = pRawFrame->GetRawMemSize();
-      if (frame_size != frame.size()) {
-        frame.resize({frame_size}, false);
+uint32_t PyFfmpegDecoder::Width() const {
+  ThrowIfInUse(in_use);
+  return upDecoder->GetWidth();
+}
+
+uint32_t PyFfmpegDecoder::Height() const {
+  ThrowIfInUse(in_use);
+  return upDecoder->GetHeight();
+}
+
+string PyFfmpegDecoder::Format() const {
+  ThrowIfInUse(in_use);
+  auto name = av_get_pix_fmt_name(upDecoder->GetPixelFormat());
+  return name ? string(name) : string("none");
+}
+
+uint32_t PyFfmpegDecoder::NumThreads() const {
+  return upDecoder->GetNumThreads();
+}
+
+SwDecodeThreadType PyFfmpegDecoder::ThreadType() const {
+  return upDecoder->GetThreadType();
+}
+
+/* Runs single job for every task on process-wide executor and waits for
+ * all of them; With retry_empty set job is run again while it succeeds
+ * without output, that's how demuxer skips packets of other streams;
+ */
+static vector<TaskJobStatus> ExecuteOnPool(const vector<Task *> &tasks,
+                                           TaskPriority priority,
+                                           uint32_t timeout_ms,
+                                           bool retry_empty) {
+  TaskJobParams params;
+  params.priority = priority;
+  if (timeout_ms) {
+    params.deadline = steady_clock::now() + milliseconds(timeout_ms);
+  }
+
+  auto &executor = TaskExecutor::Instance();
+  vector<TaskJobStatus> results(tasks.size(), TaskJobStatus::JOB_FAIL);
+  vector<TaskJobCallback> callbacks(tasks.size());
+  mutex done_lock;
+  condition_variable done_cv;
+  size_t num_done = 0U;
+
+  for (size_t i = 0U; i < tasks.size(); i++) {
+    callbacks[i] = [&, i](Task *task, TaskJobStatus status) {
+      auto const is_empty = !task->GetOutput(0U);
+      if (retry_empty && TaskJobStatus::JOB_SUCCESS == status && is_empty) {
+        executor.Submit(task, callbacks[i], params);
+        return;
       }
 
-      memcpy(frame.mutable_data(), pRawFrame->GetRawMemPtr(), frame_size);
-      return true;
+      lock_guard<mutex> lock(done_lock);
+      results[i] = status;
+      num_done++;
+      done_cv.notify_all();
+    };
+  }
+
+  for (size_t i = 0U; i < tasks.size(); i++) {
+    executor.Submit(tasks[i], callbacks[i], params);
+  }
+
+  unique_lock<mutex> lock(done_lock);
+  done_cv.wait(lock, [&]() { return tasks.size() == num_done; });
+  return results;
+}
+
+/* Asyncio future which is completed from executor worker thread;
+ * Python objects are released with GIL held no matter which thread drops
+ * last reference;
+ */
+struct AsyncCompletion {
+  // Keeps Python object which owns the task alive;
+  py::object owner;
+  py::object loop;
+  py::object future;
+  // Owner's in use flag, held from submit till task output is taken;
+  atomic<bool> *owner_in_use = nullptr;
+
+  ~AsyncCompletion() {
+    py::gil_scoped_acquire gil;
+    ReleaseOwner();
+    owner = py::object();
+    loop = py::object();
+    future = py::object();
+  }
+
+  void ReleaseOwner() {
+    if (owner_in_use) {
+      *owner_in_use = false;
+      owner_in_use = nullptr;
+    }
+  }
+
+  // Future may be cancelled while task is running;
+  static void SetResult(py::object future, py::object result) {
+    if (!future.attr("done")().cast<bool>()) {
+      future.attr("set_result")(result);
+    }
+  }
+
+  static void SetException(py::object future, py::object exception) {
+    if (!future.attr("done")().cast<bool>()) {
+      future.attr("set_exception")(exception);
+    }
+  }
+
+  // Must be called with GIL held;
+  void Complete(py::object result, bool is_exception) {
+    auto setter = is_exception ? py::cpp_function(&SetException)
+                               : py::cpp_function(&SetResult);
+    try {
+      loop.attr("call_soon_threadsafe")(setter, future, result);
+    } catch (py::error_already_set &e) {
+      // Event loop is closed already, nobody waits for result;
+    }
+  }
+};
+
+typedef function<py::object(Task *)> AsyncResultMaker;
+
+/* Runs task on process-wide executor and passes result made under GIL to
+ * asyncio future; With retry_empty set task is run again while it
+ * succeeds without output; Owner is released once result is made, so
+ * it's free again by the time future is done;
+ */
+static void SubmitAsync(Task *pTask, shared_ptr<AsyncCompletion> completion,
+                        AsyncResultMaker make_result, bool retry_empty) {
+  pTask->ExecuteAsync([=](TaskExecStatus status) {
+    auto const is_success = (TASK_EXEC_SUCCESS == status);
+    if (retry_empty && is_success && !pTask->GetOutput(0U)) {
+      SubmitAsync(pTask, completion, make_result, retry_empty);
+      return;
     }
+
+    py::gil_scoped_acquire gil;
+    auto error = py::reinterpret_borrow<py::object>(PyExc_RuntimeError);
+    py::object result;
+    auto is_exception = false;
+    try {
+      auto error_ptr = TaskExecutor::GetJobException();
+      if (error_ptr) {
+        rethrow_exception(error_ptr);
+      }
+
+      result = is_success ? make_result(pTask) : py::none();
+    } catch (exception &e) {
+      // Worker thread would terminate otherwise;
+      result = error(e.what());
+      is_exception = true;
+    } catch (...) {
+      result = error("Unknown task error.");
+      is_exception = true;
+    }
+
+    completion->ReleaseOwner();
+    completion->Complete(result, is_exception);
+  });
+}
+
+/* Must be called from coroutine or callback of running event loop, raises
+ * RuntimeError otherwise; Marks owner as used till task result is made;
+ */
+static shared_ptr<AsyncCompletion> MakeAsyncCompletion(py::object owner,
+                                                       atomic<bool> &in_use) {
+  auto completion = make_shared<AsyncCompletion>();
+  completion->owner = owner;
+  completion->loop = py::module::import("asyncio").attr("get_running_loop")();
+  completion->future = completion->loop.attr("create_future")();
+
+  if (in_use.exchange(true)) {
+    throw runtime_error(in_use_error);
+  }
+  completion->owner_in_use = &in_use;
+  return completion;
+}
+
+static py::object CopyToArray(Buffer *pBuffer) {
+  if (!pBuffer) {
+    return py::none();
+  }
+
+  py::array_t<uint8_t> array(pBuffer->GetRawMemSize());
+  memcpy(array.mutable_data(), pBuffer->GetRawMemPtr(),
+         pBuffer->GetRawMemSize());
+  return array;
+}
+
+static bool CopyRawFrame(Task *pTask, py::array_t<uint8_t> &frame) {
+  auto pRawFrame = (Buffer *)pTask->GetOutput(0U);
+  if (!pRawFrame) {
+    return false;
+  }
+
+  auto const frame_size = pRawFrame->GetRawMemSize();
+  if (frame_size != frame.size()) {
+    frame.resize({frame_size}, false);
+  }
+
+  memcpy(frame.mutable_data(), pRawFrame->GetRawMemPtr(), frame_size);
+  return true;
+}
+
+size_t StreamChunk::GetNumItems() const { return offsets.size() - 1U; }
+
+size_t StreamChunk::GetItemSize(size_t item) const {
+  return offsets.at(item + 1U) - offsets.at(item);
+}
+
+void StreamChunk::Append(const void *ptr, size_t size) {
+  auto src = (const uint8_t *)ptr;
+  data.insert(data.end(), src, src + size);
+  offsets.push_back(data.size());
+}
+
+void StreamChunk::Clear() {
+  // Capacity is kept, so recycled chunk doesn't allocate again;
+  data.clear();
+  offsets.resize(1U);
+  row_size = 0U;
+}
+
+size_t StreamChunk::GetByteSize() const { return data.size(); }
+
+static void ReleaseChunkRef(void *ptr) { ((StreamChunk *)ptr)->Release(); }
+
+PyStreamIterator::PyStreamIterator(py::object owner,
+                                   atomic<bool> &owner_in_use,
+                                   Producer producer, Converter converter,
+                                   uint32_t chunk_size,
+                                   uint32_t prefetch_chunks)
+    : owner(owner), owner_in_use(owner_in_use), producer(producer),
+      converter(converter), chunk_size(max(chunk_size, 1U)),
+      is_stopped(false) {
+  if (owner_in_use.exchange(true)) {
+    throw runtime_error(in_use_error);
+  }
+
+  prefetch_chunks = max(prefetch_chunks, 1U);
+
+  try {
+    /* Queued chunks, one being filled and few held by Python are reused;
+     * Chunks Python holds on to for longer are made anew;
+     */
+    upPool.reset(TokenPool::Make([]() { return new StreamChunk(); },
+                                 prefetch_chunks + 2U));
+    upQueue.reset(SpscTokenQueue::Make(prefetch_chunks));
+    worker = thread(&PyStreamIterator::Run, this);
+  } catch (...) {
+    owner_in_use = false;
+    throw;
+  }
+}
+
+PyStreamIterator::~PyStreamIterator() { Close(); }
+
+uint32_t PyStreamIterator::ChunkSize() const { return chunk_size; }
+
+void PyStreamIterator::Run() {
+  try {
+    auto is_eos = false;
+    while (!is_eos && !is_stopped) {
+      auto chunk = upPool->Acquire<StreamChunk>();
+      if (!chunk) {
+        throw runtime_error("Can't allocate stream chunk.");
+      }
+
+      chunk->Clear();
+      while (chunk->GetNumItems() < chunk_size && !is_stopped) {
+        if (!producer(*chunk.Get())) {
+          is_eos = true;
+          break;
+        }
+      }
+
+      if (!chunk->GetNumItems()) {
+        break;
+      }
+
+      // Queue holds its own reference until chunk is popped;
+      chunk->AddRef();
+      if (!upQueue->Push(chunk.Get())) {
+        chunk->Release();
+        break;
+      }
+    }
+  } catch (...) {
+    lock_guard<mutex> guard(error_lock);
+    error = current_exception();
+  }
+
+  /* Producer won't run anymore, so owner is released before consumer
+   * sees end of stream and may use owner again;
+   */
+  owner_in_use = false;
+  upQueue->Close();
+}
+
+py::object PyStreamIterator::Next() {
+  Token *token = nullptr;
+  bool res = false;
+  {
+    py::gil_scoped_release gil_release;
+    res = upQueue->Pop(token);
+  }
+
+  if (!res) {
+    exception_ptr e = nullptr;
+    {
+      lock_guard<mutex> guard(error_lock);
+      swap(e, error);
+    }
+
+    if (e) {
+      rethrow_exception(e);
+    }
+    throw py::stop_iteration();
+  }
+
+  // Capsule takes over reference which queue had;
+  auto chunk = (StreamChunk *)token;
+  py::capsule chunk_ref(chunk, ReleaseChunkRef);
+  return converter(*chunk, chunk_ref);
+}
+
+void PyStreamIterator::Close() {
+  is_stopped = true;
+  if (upQueue) {
+    upQueue->Close();
+  }
+
+  if (worker.joinable()) {
+    py::gil_scoped_release gil_release;
+    worker.join();
+  }
+
+  Token *token = nullptr;
+  while (upQueue && upQueue->TryPop(token)) {
+    token->Release();
+  }
+}
+
+bool PyFfmpegDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame) {
+  ScopedUse use(in_use);
+  // Only copy to numpy array needs GIL;
+  TaskExecStatus status = TASK_EXEC_FAIL;
+  {
+    py::gil_scoped_release gil_release;
+    status = upDecoder->Execute();
+  }
+
+  if (TASK_EXEC_SUCCESS == status) {
+    return CopyRawFrame(upDecoder.get(), frame);
   }
   return false;
 }
 
+py::object PyFfmpegDecoder::DecodeSingleFrameAsync() {
+  auto completion = MakeAsyncCompletion(py::cast(this), in_use);
+  auto make_result = [](Task *pTask) {
+    return CopyToArray((Buffer *)pTask->GetOutput(0U));
+  };
+
+  SubmitAsync(upDecoder.get(), completion, make_result, false);
+  return completion->future;
+}
+
+vector<bool>
+PyFfmpegDecoder::DecodeSingleFrames(const vector<PyFfmpegDecoder *> &decoders,
+                                    vector<py::array_t<uint8_t>> &frames,
+                                    TaskPriority priority,
+                                    uint32_t timeout_ms) {
+  if (decoders.size() != frames.size()) {
+    throw invalid_argument("Number of decoders and frames doesn't match.");
+  }
+
+  vector<Task *> tasks;
+  // Same decoder given twice is rejected as well;
+  vector<unique_ptr<ScopedUse>> uses;
+  for (auto decoder : decoders) {
+    if (!decoder) {
+      throw invalid_argument("Decoder can't be None.");
+    }
+    uses.emplace_back(new ScopedUse(decoder->in_use));
+    tasks.push_back(decoder->upDecoder.get());
+  }
+
+  vector<TaskJobStatus> results;
+  {
+    py::gil_scoped_release gil_release;
+    results = ExecuteOnPool(tasks, priority, timeout_ms, false);
+  }
+
+  vector<bool> is_decoded(tasks.size(), false);
+  for (size_t i = 0U; i < tasks.size(); i++) {
+    if (TaskJobStatus::JOB_SUCCESS == results[i]) {
+      is_decoded[i] = CopyRawFrame(tasks[i], frames[i]);
+    }
+  }
+  return is_decoded;
+}
+
+py::array_t<uint8_t>
+PyFfmpegDecoder::GetFrames(const vector<int64_t> &frame_nums) {
+  ScopedUse use(in_use);
+  auto const frame_size = upDecoder->GetFrameSize();
+  auto const row_size = upDecoder->GetFrameRowSize();
+  if (!frame_size || !row_size) {
+    throw runtime_error("Can't determine decoded frame size.");
+  }
+
+  /* Frames are shaped as (rows, row_size) when they fit, e.g. YUV420 frame
+   * is height * 3 / 2 rows of width bytes; (N, frame_size) otherwise;
+   */
+  vector<ssize_t> shape = {(ssize_t)frame_nums.size()};
+  if (0U == frame_size % row_size) {
+    shape.push_back((ssize_t)(frame_size / row_size));
+    shape.push_back((ssize_t)row_size);
+  } else {
+    shape.push_back((ssize_t)frame_size);
+  }
+
+  py::array_t<uint8_t> frames(shape);
+  auto const dst = frames.mutable_data();
+
+  bool res = false;
+  {
+    py::gil_scoped_release release;
+    res = upDecoder->DecodeFrames(frame_nums, dst, frame_size);
+  }
+
+  if (!res) {
+    throw runtime_error("Failed to decode requested frames.");
+  }
+  return frames;
+}
+
+unique_ptr<PyStreamIterator>
+PyFfmpegDecoder::Stream(uint32_t chunk_size, uint32_t prefetch_chunks) {
+  auto pDecoder = upDecoder.get();
+  auto producer = [pDecoder](StreamChunk &chunk) {
+    if (TASK_EXEC_SUCCESS != pDecoder->Execute()) {
+      return false;
+    }
+
+    auto pRawFrame = (Buffer *)pDecoder->GetOutput(0U);
+    if (!pRawFrame) {
+      return false;
+    }
+
+    if (!chunk.GetNumItems()) {
+      chunk.row_size = pDecoder->GetFrameRowSize();
+    }
+    chunk.Append(pRawFrame->GetRawMemPtr(), pRawFrame->GetRawMemSize());
+    return true;
+  };
+
+  auto converter = [](StreamChunk &chunk, py::capsule chunk_ref) {
+    auto const num_frames = chunk.GetNumItems();
+    auto const frame_size = chunk.GetItemSize(0U);
+
+    auto is_uniform = true;
+    for (size_t i = 1U; i < num_frames; i++) {
+      is_uniform = is_uniform && chunk.GetItemSize(i) == frame_size;
+    }
+
+    if (!is_uniform) {
+      py::list frames;
+      for (size_t i = 0U; i < num_frames; i++) {
+        frames.append(py::array_t<uint8_t>({(ssize_t)chunk.GetItemSize(i)},
+                                           {(ssize_t)1},
+                                           chunk.data.data() + chunk.offsets[i],
+                                           chunk_ref));
+      }
+      return py::object(frames);
+    }
+
+    // Same layout as GetFrames output;
+    vector<ssize_t> shape = {(ssize_t)num_frames};
+    auto const row_size = chunk.row_size;
+    if (row_size && 0U == frame_size % row_size) {
+      shape.push_back((ssize_t)(frame_size / row_size));
+      shape.push_back((ssize_t)row_size);
+    } else {
+      shape.push_back((ssize_t)frame_size);
+    }
+
+    return py::object(
+        py::array_t<uint8_t>(shape, chunk.data.data(), chunk_ref));
+  };
+
+  return unique_ptr<PyStreamIterator>(new PyStreamIterator(
+      py::cast(this), in_use, producer, converter, chunk_size,
+      prefetch_chunks));
+}
+
+uint32_t PyFfmpegDecoder::NumFrames(bool exact) {
+  ScopedUse use(in_use);
+  return upDecoder->GetNumFrames(exact);
+}
+
+static void ReleaseFrameRef(void *ptr) {
+  auto pFrame = (AVFrame *)ptr;
+  av_frame_free(&pFrame);
+}
+
+py::list PyFfmpegDecoder::DecodeSingleFrameNoCopy() {
+  ScopedUse use(in_use);
+  py::list planes;
+
+  AVFrame *pFrame = nullptr;
+  {
+    py::gil_scoped_release gil_release;
+    pFrame = upDecoder->DecodeFrameRef();
+  }
+  if (!pFrame) {
+    return planes;
+  }
+
+  /* Capsule owns frame reference. Every plane view keeps it alive, frame is
+   * released after last of them is garbage collected;
+   */
+  py::capsule frame_ref(pFrame, ReleaseFrameRef);
+
+  auto format = (AVPixelFormat)pFrame->format;
+  auto desc = av_pix_fmt_desc_get(format);
+  auto num_planes = av_pix_fmt_count_planes(format);
+  if (!desc || num_planes <= 0) {
+    return planes;
+  }
+
+  // High bit depth formats are exposed as 16 bit words;
+  auto const elem_size = desc->comp[0].depth > 8 ? 2U : 1U;
+  auto const dtype = (2U == elem_size) ? py::dtype::of<uint16_t>()
+                                       : py::dtype::of<uint8_t>();
+
+  for (auto plane = 0; plane < num_planes; plane++) {
+    auto width = av_image_get_linesize(format, pFrame->width, plane);
+    auto height = pFrame->height;
+    // Alpha plane is never subsampled;
+    if (1 == plane || 2 == plane) {
+      height = AV_CEIL_RSHIFT(height, desc->log2_chroma_h);
+    }
+
+    py::array view(dtype, {(ssize_t)height, (ssize_t)(width / elem_size)},
+                   {(ssize_t)pFrame->linesize[plane], (ssize_t)elem_size},
+                   pFrame->data[plane], frame_ref);
+
+    // Decoder may still use frame as reference;
+    view.attr("flags").attr("writeable") = false;
+    planes.append(view);
+  }
+
+  return planes;
+}
+
 void *PyFfmpegDecoder::GetSideData(AVFrameSideDataType data_type,
                                    size_t &raw_size) {
   if (TASK_EXEC_SUCCESS == upDecoder->GetSideData(data_type)) {
@@ -379,6 +1132,7 @@ void *PyFfmpegDecoder::GetSideData(AVFrameSideDataType data_type,
 }
 
 py::array_t<MotionVector> PyFfmpegDecoder::GetMotionVectors() {
+  ThrowIfInUse(in_use);
   size_t size = 0U;
   auto ptr = (AVMotionVector *)GetSideData(AV_FRAME_DATA_MOTION_VECTORS, size);
   size /= sizeof(*ptr);
@@ -421,16 +1175,31 @@ PyFFmpegDemuxer::PyFFmpegDemuxer(const string &pathToFile,
       DemuxFrame::Make(pathToFile.c_str(), options.data(), options.size()));
 }
 
-bool PyFFmpegDemuxer::DemuxSinglePacket(py::array_t<uint8_t> &packet) {
+Buffer *PyFFmpegDemuxer::DemuxUntilPacket(Buffer *pSeekCtxBuf) {
+  py::gil_scoped_release gil_release;
+
   Buffer *elementaryVideo = nullptr;
   do {
+    if (pSeekCtxBuf) {
+      upDemuxer->SetInput((Token *)pSeekCtxBuf, 1U);
+    }
     if (TASK_EXEC_FAIL == upDemuxer->Execute()) {
       upDemuxer->ClearInputs();
-      return false;
+      return nullptr;
     }
     elementaryVideo = (Buffer *)upDemuxer->GetOutput(0U);
   } while (!elementaryVideo);
 
+  return elementaryVideo;
+}
+
+bool PyFFmpegDemuxer::DemuxSinglePacket(py::array_t<uint8_t> &packet) {
+  ScopedUse use(in_use);
+  auto elementaryVideo = DemuxUntilPacket(nullptr);
+  if (!elementaryVideo) {
+    return false;
+  }
+
   packet.resize({elementaryVideo->GetRawMemSize()}, false);
   memcpy(packet.mutable_data(), elementaryVideo->GetDataAs<void>(),
          elementaryVideo->GetRawMemSize());
@@ -439,7 +1208,109 @@ bool PyFFmpegDemuxer::DemuxSinglePacket(py::array_t<uint8_t> &packet) {
   return true;
 }
 
+vector<bool>
+PyFFmpegDemuxer::DemuxSinglePackets(const vector<PyFFmpegDemuxer *> &demuxers,
+                                    vector<py::array_t<uint8_t>> &packets,
+                                    TaskPriority priority,
+                                    uint32_t timeout_ms) {
+  if (demuxers.size() != packets.size()) {
+    throw invalid_argument("Number of demuxers and packets doesn't match.");
+  }
+
+  vector<Task *> tasks;
+  // Same demuxer given twice is rejected as well;
+  vector<unique_ptr<ScopedUse>> uses;
+  for (auto demuxer : demuxers) {
+    if (!demuxer) {
+      throw invalid_argument("Demuxer can't be None.");
+    }
+    uses.emplace_back(new ScopedUse(demuxer->in_use));
+    tasks.push_back(demuxer->upDemuxer.get());
+  }
+
+  vector<TaskJobStatus> results;
+  {
+    py::gil_scoped_release gil_release;
+    results = ExecuteOnPool(tasks, priority, timeout_ms, true);
+  }
+
+  vector<bool> is_demuxed(tasks.size(), false);
+  for (size_t i = 0U; i < tasks.size(); i++) {
+    auto elementaryVideo = (Buffer *)tasks[i]->GetOutput(0U);
+    if (TaskJobStatus::JOB_SUCCESS == results[i] && elementaryVideo) {
+      packets[i].resize({elementaryVideo->GetRawMemSize()}, false);
+      memcpy(packets[i].mutable_data(), elementaryVideo->GetDataAs<void>(),
+             elementaryVideo->GetRawMemSize());
+      is_demuxed[i] = true;
+    }
+    tasks[i]->ClearInputs();
+  }
+  return is_demuxed;
+}
+
+py::object PyFFmpegDemuxer::DemuxSinglePacketAsync() {
+  auto completion = MakeAsyncCompletion(py::cast(this), in_use);
+  auto make_result = [](Task *pTask) {
+    auto packet = CopyToArray((Buffer *)pTask->GetOutput(0U));
+    pTask->ClearInputs();
+    return packet;
+  };
+
+  SubmitAsync(upDemuxer.get(), completion, make_result, true);
+  return completion->future;
+}
+
+static void ReleasePacketRef(void *ptr) {
+  auto pPacket = (AVPacket *)ptr;
+  av_packet_free(&pPacket);
+}
+
+/* RAII-style switch of demuxer to by-reference packets;
+ * Previous mode is restored on every exit path, so pooling and packet
+ * Buffer settings keep working for DemuxSinglePacket;
+ */
+class PacketByReferenceGuard final {
+public:
+  explicit PacketByReferenceGuard(DemuxFrame *demuxer)
+      : pDemuxer(demuxer), was_by_ref(demuxer->IsPacketByReference()) {
+    pDemuxer->SetPacketByReference(true);
+  }
+  ~PacketByReferenceGuard() { pDemuxer->SetPacketByReference(was_by_ref); }
+
+private:
+  DemuxFrame *pDemuxer;
+  bool was_by_ref;
+};
+
+py::object PyFFmpegDemuxer::DemuxSinglePacketNoCopy() {
+  ScopedUse use(in_use);
+  // Don't copy packet to demuxer output Buffer as well;
+  PacketByReferenceGuard by_ref(upDemuxer.get());
+
+  if (!DemuxUntilPacket(nullptr)) {
+    return py::none();
+  }
+  upDemuxer->ClearInputs();
+
+  auto pPacket = upDemuxer->GetPacketRef();
+  if (!pPacket) {
+    return py::none();
+  }
+
+  /* Capsule owns packet reference which is released when numpy array is
+   * garbage collected;
+   */
+  py::capsule packet_ref(pPacket, ReleasePacketRef);
+  py::array view(py::dtype::of<uint8_t>(), {(ssize_t)pPacket->size},
+                 {(ssize_t)1}, pPacket->data, packet_ref);
+
+  // Packet buffer may be shared with other references;
+  view.attr("flags").attr("writeable") = false;
+  return view;
+}
+
 void PyFFmpegDemuxer::GetLastPacketData(PacketData &pkt_data) {
+  ThrowIfInUse(in_use);
   auto pkt_data_buf = (Buffer*)upDemuxer->GetOutput(3U);
   if (pkt_data_buf) {
     auto pkt_data_ptr = pkt_data_buf->GetDataAs<PacketData>();
@@ -501,17 +1372,38 @@ uint32_t PyFFmpegDemuxer::Numframes() const {
   return params.videoContext.num_frames;
 }
 
+bool PyFFmpegDemuxer::ReservePacketBuffer(size_t size) {
+  ThrowIfInUse(in_use);
+  return upDemuxer->ReservePacketBuffer(size);
+}
+
+bool PyFFmpegDemuxer::ShrinkPacketBuffer() {
+  ThrowIfInUse(in_use);
+  return upDemuxer->ShrinkPacketBuffer();
+}
+
+size_t PyFFmpegDemuxer::PacketBufferCapacity() const {
+  ThrowIfInUse(in_use);
+  return upDemuxer->GetPacketBufferCapacity();
+}
+
+bool PyFFmpegDemuxer::BuildSeekIndex(bool in_background) {
+  // Background scan has own format context, only its start is guarded;
+  ScopedUse use(in_use);
+  return upDemuxer->BuildSeekIndex(in_background);
+}
+
+bool PyFFmpegDemuxer::IsSeekIndexReady() const {
+  return upDemuxer->IsSeekIndexReady();
+}
+
 bool PyFFmpegDemuxer::Seek(SeekContext &ctx, py::array_t<uint8_t> &packet) {
-  Buffer *elementaryVideo = nullptr;
+  ScopedUse use(in_use);
   auto pSeekCtxBuf = shared_ptr<Buffer>(Buffer::MakeOwnMem(sizeof(ctx), &ctx));
-  do {
-    upDemuxer->SetInput((Token *)pSeekCtxBuf.get(), 1U);
-    if (TASK_EXEC_FAIL == upDemuxer->Execute()) {
-      upDemuxer->ClearInputs();
-      return false;
-    }
-    elementaryVideo = (Buffer *)upDemuxer->GetOutput(0U);
-  } while (!elementaryVideo);
+  auto elementaryVideo = DemuxUntilPacket(pSeekCtxBuf.get());
+  if (!elementaryVideo) {
+    return false;
+  }
 
   packet.resize({elementaryVideo->GetRawMemSize()}, false);
   memcpy(packet.mutable_data(), elementaryVideo->GetDataAs<void>(),
@@ -528,6 +1420,41 @@ bool PyFFmpegDemuxer::Seek(SeekContext &ctx, py::array_t<uint8_t> &packet) {
   return true;
 }
 
+unique_ptr<PyStreamIterator>
+PyFFmpegDemuxer::Stream(uint32_t chunk_size, uint32_t prefetch_chunks) {
+  auto pDemuxer = upDemuxer.get();
+  auto producer = [pDemuxer](StreamChunk &chunk) {
+    Buffer *elementaryVideo = nullptr;
+    do {
+      if (TASK_EXEC_FAIL == pDemuxer->Execute()) {
+        pDemuxer->ClearInputs();
+        return false;
+      }
+      elementaryVideo = (Buffer *)pDemuxer->GetOutput(0U);
+    } while (!elementaryVideo);
+
+    chunk.Append(elementaryVideo->GetDataAs<void>(),
+                 elementaryVideo->GetRawMemSize());
+    pDemuxer->ClearInputs();
+    return true;
+  };
+
+  auto converter = [](StreamChunk &chunk, py::capsule chunk_ref) {
+    py::list packets;
+    for (size_t i = 0U; i < chunk.GetNumItems(); i++) {
+      packets.append(py::array_t<uint8_t>({(ssize_t)chunk.GetItemSize(i)},
+                                          {(ssize_t)1},
+                                          chunk.data.data() + chunk.offsets[i],
+                                          chunk_ref));
+    }
+    return py::object(packets);
+  };
+
+  return unique_ptr<PyStreamIterator>(new PyStreamIterator(
+      py::cast(this), in_use, producer, converter, chunk_size,
+      prefetch_chunks));
+}
+
 PyNvDecoder::PyNvDecoder(const string &pathToFile, int gpuOrdinal)
     : PyNvDecoder(pathToFile, gpuOrdinal, map<string, string>()) {}
 
@@ -768,6 +1695,41 @@ double PyNvDecoder::Timebase() const {
   }
 }
 
+bool PyNvDecoder::ReservePacketBuffer(size_t size) {
+  if (!upDemuxer) {
+    throw runtime_error("Decoder was created without built-in demuxer support.");
+  }
+  return upDemuxer->ReservePacketBuffer(size);
+}
+
+bool PyNvDecoder::ShrinkPacketBuffer() {
+  if (!upDemuxer) {
+    throw runtime_error("Decoder was created without built-in demuxer support.");
+  }
+  return upDemuxer->ShrinkPacketBuffer();
+}
+
+size_t PyNvDecoder::PacketBufferCapacity() const {
+  if (!upDemuxer) {
+    throw runtime_error("Decoder was created without built-in demuxer support.");
+  }
+  return upDemuxer->GetPacketBufferCapacity();
+}
+
+bool PyNvDecoder::BuildSeekIndex(bool in_background) {
+  if (!upDemuxer) {
+    throw runtime_error("Decoder was created without built-in demuxer support.");
+  }
+  return upDemuxer->BuildSeekIndex(in_background);
+}
+
+bool PyNvDecoder::IsSeekIndexReady() const {
+  if (!upDemuxer) {
+    throw runtime_error("Decoder was created without built-in demuxer support.");
+  }
+  return upDemuxer->IsSeekIndexReady();
+}
+
 uint32_t PyNvDecoder::Framesize() const {
   if (upDemuxer) {
     auto pSurface = Surface::Make(GetPixelFormat(), Width(), Height(),
@@ -831,6 +1793,23 @@ struct DecodeContext {
         usePacket(false) {}
 };
 
+void PyNvDecoder::ResetHwDecoder() {
+  time_point<system_clock> then = system_clock::now();
+
+  MuxingParams params;
+  upDemuxer->GetParams(params);
+
+  upDecoder.reset(NvdecDecodeFrame::Make(
+      CudaResMgr::Instance().GetStream(gpuID),
+      CudaResMgr::Instance().GetCtx(gpuID), params.videoContext.codec,
+      poolFrameSize, params.videoContext.width, params.videoContext.height,
+      format));
+
+  time_point<system_clock> now = system_clock::now();
+  auto duration = duration_cast<milliseconds>(now - then).count();
+  cerr << "HW decoder reset time: " << duration << " milliseconds" << endl;
+}
+
 bool PyNvDecoder::DecodeSurface(struct DecodeContext &ctx) {
   bool loop_end = false;
   // If we feed decoder with Annex.B from outside we can't seek;
@@ -911,21 +1890,7 @@ bool PyNvDecoder::DecodeSurface(struct DecodeContext &ctx) {
     }
 
     if (dec_error && upDemuxer) {
-      time_point<system_clock> then = system_clock::now();
-
-      MuxingParams params;
-      upDemuxer->GetParams(params);
-
-      upDecoder.reset(NvdecDecodeFrame::Make(
-          CudaResMgr::Instance().GetStream(gpuID),
-          CudaResMgr::Instance().GetCtx(gpuID), params.videoContext.codec,
-          poolFrameSize, params.videoContext.width, params.videoContext.height,
-          format));
-
-      time_point<system_clock> now = system_clock::now();
-      auto duration = duration_cast<milliseconds>(now - then).count();
-      cerr << "HW decoder reset time: " << duration << " milliseconds" << endl;
-
+      ResetHwDecoder();
       throw HwResetException();
     } else if (dec_error) {
       cerr << "HW exception happened. Please reset class instance" << endl;
@@ -1089,6 +2054,82 @@ shared_ptr<Surface> PyNvDecoder::FlushSingleSurface() {
   }
 }
 
+uint32_t PyNvDecoder::DecodeStream(py::function callback) {
+  if (!upDemuxer) {
+    throw runtime_error("Decoder was created without built-in demuxer.");
+  }
+
+  /* Pooled packets are ref-counted and PacketData is copied, so demuxer
+   * runs ahead of decoder instead of waiting for it to release outputs;
+   * SEI and seek inputs aren't used;
+   */
+  auto const was_pooling = upDemuxer->IsPacketPooling();
+  upDemuxer->SetPacketPooling(true);
+  upDemuxer->ClearInputs();
+
+  unique_ptr<TaskGraph> graph(TaskGraph::Make());
+  auto const dmx = graph->AddTask(upDemuxer.get());
+  // Decoder gives away buffered frames after the last packet;
+  auto const dec = graph->AddTask(upDecoder.get(), true);
+  graph->Connect(dmx, 0U, dec, 0U);
+  graph->Connect(dmx, 3U, dec, 1U, [](Token *token) {
+    auto pBuffer = (Buffer *)token;
+    return (Token *)Buffer::MakeOwnMem(pBuffer->GetRawMemSize(),
+                                       pBuffer->GetRawMemPtr());
+  });
+
+  uint32_t num_frames = 0U;
+  exception_ptr cb_error;
+  graph->SetSink(dec, [&](Task *task) {
+    auto pRawSurf = (Surface *)task->GetOutput(0U);
+    if (!pRawSurf) {
+      return true;
+    }
+
+    PacketData pkt_data = {0};
+    auto pktDataBuf = (Buffer *)task->GetOutput(1U);
+    if (pktDataBuf) {
+      pkt_data = *pktDataBuf->GetDataAs<PacketData>();
+    }
+    num_frames++;
+
+    // Errors can't leave worker thread, they are rethrown after Run;
+    try {
+      // Decoder reuses its output, callback is given a copy;
+      auto spSurface = shared_ptr<Surface>(pRawSurf->Clone());
+      py::gil_scoped_acquire gil;
+      auto res = callback(spSurface, pkt_data);
+      return res.is_none() || res.cast<bool>();
+    } catch (...) {
+      cb_error = current_exception();
+      return false;
+    }
+  });
+
+  TaskExecStatus ret;
+  {
+    py::gil_scoped_release release;
+    ret = graph->Run();
+  }
+  auto const failed_node = graph->GetFailedNode();
+  graph.reset();
+  upDemuxer->SetPacketPooling(was_pooling);
+
+  if (cb_error) {
+    rethrow_exception(cb_error);
+  }
+
+  if (TASK_EXEC_FAIL == ret) {
+    if ((int64_t)dec == failed_node) {
+      ResetHwDecoder();
+      throw HwResetException();
+    }
+    throw runtime_error("Failed to demux video stream.");
+  }
+
+  return num_frames;
+}
+
 bool PyNvDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame,
                                     py::array_t<uint8_t> &sei) {
   SeekContext seek_ctx;
@@ -1510,7 +2551,8 @@ bool PyNvEncoder::Flush(py::array_t<uint8_t> &packets) {
 auto CopySurfaceStrCtx = [](shared_ptr<Surface> self, shared_ptr<Surface> other,
                             CUcontext cudaCtx, CUstream cudaStream)
 {
-  CudaCtxPush ctxPush(cudaCtx);
+  auto const srcType = self->MemType();
+  auto const dstType = other->MemType();
 
   for (auto plane = 0U; plane < self->NumPlanes(); plane++) {
     auto srcPlanePtr = self->PlanePtr(plane);
@@ -1520,20 +2562,16 @@ auto CopySurfaceStrCtx = [](shared_ptr<Surface> self, shared_ptr<Surface> other,
       break;
     }
 
-    CUDA_MEMCPY2D m = {0};
-    m.srcMemoryType = CU_MEMORYTYPE_DEVICE;
-    m.dstMemoryType = CU_MEMORYTYPE_DEVICE;
-    m.srcDevice = srcPlanePtr;
-    m.dstDevice = dstPlanePtr;
-    m.srcPitch = self->Pitch(plane);
-    m.dstPitch = other->Pitch(plane);
-    m.Height = self->Height(plane);
-    m.WidthInBytes = self->WidthInBytes(plane);
-
-    ThrowOnCudaError(cuMemcpy2DAsync(&m, cudaStream), __LINE__);
+    CopyMem2D(srcPlanePtr, srcType, self->Pitch(plane), dstPlanePtr, dstType,
+              other->Pitch(plane), self->WidthInBytes(plane),
+              self->Height(plane), cudaCtx, cudaStream);
   }
 
-  ThrowOnCudaError(cuStreamSynchronize(cudaStream), __LINE__);
+  // Host to host copies are done already;
+  if (MEM_HOST != srcType || MEM_HOST != dstType) {
+    CudaCtxPush ctxPush(cudaCtx);
+    ThrowOnCudaError(cuStreamSynchronize(cudaStream), __LINE__);
+  }
 };
 
 auto CopySurface = [](shared_ptr<Surface> self, shared_ptr<Surface> other,
@@ -1578,6 +2616,12 @@ PYBIND11_MODULE(PyNvCodec, m)
       .value("UNSPEC", ColorSpace::UNSPEC)
       .export_values();
 
+    py::enum_<TaskPriority>(m, "TaskPriority")
+        .value("LOW", TaskPriority::TASK_PRIORITY_LOW)
+        .value("NORMAL", TaskPriority::TASK_PRIORITY_NORMAL)
+        .value("HIGH", TaskPriority::TASK_PRIORITY_HIGH)
+        .export_values();
+
     py::enum_<ColorRange>(m, "ColorRange")
         .value("MPEG", ColorRange::MPEG)
         .value("JPEG", ColorRange::JPEG)
@@ -1595,6 +2639,13 @@ PYBIND11_MODULE(PyNvCodec, m)
       .value("PREV_KEY_FRAME", SeekMode::PREV_KEY_FRAME)
       .export_values();
 
+  py::enum_<SwDecodeThreadType>(m, "SwDecodeThreadType")
+      .value("THREAD_NONE", SwDecodeThreadType::THREAD_NONE)
+      .value("THREAD_FRAME", SwDecodeThreadType::THREAD_FRAME)
+      .value("THREAD_SLICE", SwDecodeThreadType::THREAD_SLICE)
+      .value("THREAD_FRAME_SLICE", SwDecodeThreadType::THREAD_FRAME_SLICE)
+      .export_values();
+
   py::class_<SeekContext, shared_ptr<SeekContext>>(m, "SeekContext")
       .def(py::init<int64_t>(), py::arg("seek_frame"))
       .def(py::init<int64_t, SeekMode>(), py::arg("seek_frame"), py::arg("mode"))
@@ -1620,12 +2671,38 @@ PYBIND11_MODULE(PyNvCodec, m)
       .def_readwrite("color_space", &ColorspaceConversionContext::color_space)
       .def_readwrite("color_range", &ColorspaceConversionContext::color_range);
 
+    py::class_<BufferPoolStats>(m, "BufferPoolStats")
+      .def_readonly("num_allocs", &BufferPoolStats::num_allocs)
+      .def_readonly("num_hits", &BufferPoolStats::num_hits)
+      .def_readonly("num_sys_allocs", &BufferPoolStats::num_sys_allocs)
+      .def_readonly("num_sys_frees", &BufferPoolStats::num_sys_frees)
+      .def_readonly("bytes_in_use", &BufferPoolStats::bytes_in_use)
+      .def_readonly("bytes_cached", &BufferPoolStats::bytes_cached)
+      .def_readonly("bytes_pinned", &BufferPoolStats::bytes_pinned);
+
+    py::class_<TaskStats>(m, "TaskStats")
+      .def_readonly("name", &TaskStats::name)
+      .def_readonly("id", &TaskStats::id)
+      .def_readonly("num_runs", &TaskStats::num_runs)
+      .def_readonly("num_failures", &TaskStats::num_failures)
+      .def_readonly("total_run_ns", &TaskStats::total_run_ns)
+      .def_readonly("max_run_ns", &TaskStats::max_run_ns)
+      .def_readonly("latency_buckets", &TaskStats::latency_buckets)
+      .def_readonly("bytes_in", &TaskStats::bytes_in)
+      .def_readonly("bytes_out", &TaskStats::bytes_out);
+
+    py::enum_<MemoryType>(m, "MemoryType")
+        .value("MEM_DEVICE", MemoryType::MEM_DEVICE)
+        .value("MEM_HOST", MemoryType::MEM_HOST)
+        .export_values();
+
     py::class_<SurfacePlane, shared_ptr<SurfacePlane>>(m, "SurfacePlane")
         .def("Width", &SurfacePlane::Width)
         .def("Height", &SurfacePlane::Height)
         .def("Pitch", &SurfacePlane::Pitch)
         .def("GpuMem", &SurfacePlane::GpuMem)
         .def("ElemSize", &SurfacePlane::ElemSize)
+        .def("MemType", &SurfacePlane::MemType)
         .def("HostFrameSize", &SurfacePlane::GetHostMemSize)
         .def("Import",
              [](shared_ptr<SurfacePlane> self, CUdeviceptr src, uint32_t src_pitch,
@@ -1660,6 +2737,19 @@ PYBIND11_MODULE(PyNvCodec, m)
         .def("Empty", &Surface::Empty)
         .def("NumPlanes", &Surface::NumPlanes)
         .def("HostSize", &Surface::HostMemSize)
+        .def("MemType", &Surface::MemType)
+        .def_static(
+            "Make",
+            [](Pixel_Format format, uint32_t newWidth, uint32_t newHeight,
+               MemoryType memType)
+            {
+              // Host Surfaces don't need GPU, memory isn't pinned then;
+              auto pNewSurf = shared_ptr<Surface>(
+                  Surface::Make(format, newWidth, newHeight, memType));
+              return pNewSurf;
+            },
+            py::arg("format"), py::arg("width"), py::arg("height"),
+            py::arg("mem_type"), py::return_value_policy::take_ownership)
         .def_static(
             "Make",
             [](Pixel_Format format, uint32_t newWidth, uint32_t newHeight,
@@ -1729,7 +2819,7 @@ PYBIND11_MODULE(PyNvCodec, m)
             {
               auto pNewSurf = shared_ptr<Surface>(Surface::Make(
                   self->PixelFormat(), self->Width(), self->Height(),
-                  CudaResMgr::Instance().GetCtx(gpuID)));
+                  self->MemType(), CudaResMgr::Instance().GetCtx(gpuID)));
 
               CopySurface(self, pNewSurf, gpuID);
               return pNewSurf;
@@ -1743,7 +2833,7 @@ PYBIND11_MODULE(PyNvCodec, m)
             {
               auto pNewSurf = shared_ptr<Surface>(Surface::Make(
                   self->PixelFormat(), self->Width(), self->Height(),
-                  (CUcontext)ctx));
+                  self->MemType(), (CUcontext)ctx));
 
               CopySurfaceStrCtx(self, pNewSurf, (CUcontext)ctx, (CUstream)str);
               return pNewSurf;
@@ -1831,16 +2921,61 @@ PYBIND11_MODULE(PyNvCodec, m)
              py::arg("packets"),
              py::call_guard<py::gil_scoped_release>());
 
+    py::class_<PyStreamIterator>(m, "PyStreamIterator")
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", &PyStreamIterator::Next)
+        .def("Close", &PyStreamIterator::Close)
+        .def("ChunkSize", &PyStreamIterator::ChunkSize);
+
     py::class_<PyFfmpegDecoder>(m, "PyFfmpegDecoder")
-        .def(py::init<const string &, const map<string, string> &>())
+        .def(py::init<const string &, const map<string, string> &>(),
+             py::call_guard<py::gil_scoped_release>())
+        .def(py::init<const string &, const map<string, string> &, uint32_t>(),
+             py::arg("input"), py::arg("opts"), py::arg("num_threads"),
+             py::call_guard<py::gil_scoped_release>())
+        .def(py::init<const string &, const map<string, string> &, uint32_t,
+                      SwDecodeThreadType>(),
+             py::arg("input"), py::arg("opts"), py::arg("num_threads"),
+             py::arg("thread_type"), py::call_guard<py::gil_scoped_release>())
         .def("DecodeSingleFrame", &PyFfmpegDecoder::DecodeSingleFrame)
+        .def("DecodeSingleFrameNoCopy",
+             &PyFfmpegDecoder::DecodeSingleFrameNoCopy)
+        .def("DecodeSingleFrameAsync",
+             &PyFfmpegDecoder::DecodeSingleFrameAsync)
+        .def("GetFrames", &PyFfmpegDecoder::GetFrames, py::arg("frame_nums"))
+        .def("Stream", &PyFfmpegDecoder::Stream, py::arg("chunk_size") = 8U,
+             py::arg("prefetch_chunks") = 2U)
+        .def_static("DecodeSingleFrames", &PyFfmpegDecoder::DecodeSingleFrames,
+                    py::arg("decoders"), py::arg("frames"),
+                    py::arg("priority") = TaskPriority::TASK_PRIORITY_NORMAL,
+                    py::arg("timeout_ms") = 0U)
+        .def("NumFrames", &PyFfmpegDecoder::NumFrames,
+             py::arg("exact") = false,
+             py::call_guard<py::gil_scoped_release>())
+        .def("Width", &PyFfmpegDecoder::Width)
+        .def("Height", &PyFfmpegDecoder::Height)
+        .def("Format", &PyFfmpegDecoder::Format)
+        .def("NumThreads", &PyFfmpegDecoder::NumThreads)
+        .def("ThreadType", &PyFfmpegDecoder::ThreadType)
         .def("GetMotionVectors", &PyFfmpegDecoder::GetMotionVectors,
              py::return_value_policy::move);
 
     py::class_<PyFFmpegDemuxer>(m, "PyFFmpegDemuxer")
-        .def(py::init<const string &>())
-        .def(py::init<const string &, const map<string, string> &>())
+        .def(py::init<const string &>(),
+             py::call_guard<py::gil_scoped_release>())
+        .def(py::init<const string &, const map<string, string> &>(),
+             py::call_guard<py::gil_scoped_release>())
         .def("DemuxSinglePacket", &PyFFmpegDemuxer::DemuxSinglePacket)
+        .def_static("DemuxSinglePackets", &PyFFmpegDemuxer::DemuxSinglePackets,
+                    py::arg("demuxers"), py::arg("packets"),
+                    py::arg("priority") = TaskPriority::TASK_PRIORITY_NORMAL,
+                    py::arg("timeout_ms") = 0U)
+        .def("DemuxSinglePacketNoCopy",
+             &PyFFmpegDemuxer::DemuxSinglePacketNoCopy)
+        .def("DemuxSinglePacketAsync",
+             &PyFFmpegDemuxer::DemuxSinglePacketAsync)
+        .def("Stream", &PyFFmpegDemuxer::Stream, py::arg("chunk_size") = 32U,
+             py::arg("prefetch_chunks") = 2U)
         .def("Width", &PyFFmpegDemuxer::Width)
         .def("Height", &PyFFmpegDemuxer::Height)
         .def("Format", &PyFFmpegDemuxer::Format)
@@ -1851,7 +2986,15 @@ PYBIND11_MODULE(PyNvCodec, m)
         .def("LastPacketData", &PyFFmpegDemuxer::GetLastPacketData)
         .def("Seek", &PyFFmpegDemuxer::Seek)
         .def("ColorSpace", &PyFFmpegDemuxer::GetColorSpace)
-        .def("ColorRange", &PyFFmpegDemuxer::GetColorRange);
+        .def("ColorRange", &PyFFmpegDemuxer::GetColorRange)
+        .def("ReservePacketBuffer", &PyFFmpegDemuxer::ReservePacketBuffer,
+             py::arg("size"))
+        .def("ShrinkPacketBuffer", &PyFFmpegDemuxer::ShrinkPacketBuffer)
+        .def("PacketBufferCapacity", &PyFFmpegDemuxer::PacketBufferCapacity)
+        .def("BuildSeekIndex", &PyFFmpegDemuxer::BuildSeekIndex,
+             py::arg("in_background") = true,
+             py::call_guard<py::gil_scoped_release>())
+        .def("IsSeekIndexReady", &PyFFmpegDemuxer::IsSeekIndexReady);
 
     py::class_<PyNvDecoder>(m, "PyNvDecoder")
         .def(py::init<uint32_t, uint32_t, Pixel_Format, cudaVideoCodec,
@@ -1871,6 +3014,14 @@ PYBIND11_MODULE(PyNvCodec, m)
         .def("Framerate", &PyNvDecoder::Framerate)
         .def("Timebase", &PyNvDecoder::Timebase)
         .def("Framesize", &PyNvDecoder::Framesize)
+        .def("ReservePacketBuffer", &PyNvDecoder::ReservePacketBuffer,
+             py::arg("size"))
+        .def("ShrinkPacketBuffer", &PyNvDecoder::ShrinkPacketBuffer)
+        .def("PacketBufferCapacity", &PyNvDecoder::PacketBufferCapacity)
+        .def("BuildSeekIndex", &PyNvDecoder::BuildSeekIndex,
+             py::arg("in_background") = true,
+             py::call_guard<py::gil_scoped_release>())
+        .def("IsSeekIndexReady", &PyNvDecoder::IsSeekIndexReady)
         .def("Numframes", &PyNvDecoder::Numframes)
         .def("Format", &PyNvDecoder::GetPixelFormat)
         .def("DecodeSingleSurface",
@@ -1987,6 +3138,8 @@ PYBIND11_MODULE(PyNvCodec, m)
         .def("FlushSingleSurface", &PyNvDecoder::FlushSingleSurface,
              py::return_value_policy::take_ownership,
              py::call_guard<py::gil_scoped_release>())
+        .def("DecodeStream", &PyNvDecoder::DecodeStream,
+             py::arg("callback"))
         .def("FlushSingleFrame", &PyNvDecoder::FlushSingleFrame,
              py::arg("frame"),
              py::call_guard<py::gil_scoped_release>());
@@ -2009,19 +3162,121 @@ PYBIND11_MODULE(PyNvCodec, m)
 
     py::class_<PySurfaceConverter>(m, "PySurfaceConverter")
         .def(py::init<uint32_t, uint32_t, Pixel_Format, Pixel_Format, uint32_t>())
+        .def(py::init<uint32_t, uint32_t, Pixel_Format, Pixel_Format>())
         .def(py::init<uint32_t, uint32_t, Pixel_Format, Pixel_Format, size_t , size_t >())        
         .def("Format", &PySurfaceConverter::GetFormat)
         .def("Execute", &PySurfaceConverter::Execute,
              py::return_value_policy::take_ownership,
              py::call_guard<py::gil_scoped_release>());
 
+    py::enum_<TensorDataType>(m, "TensorDataType")
+        .value("TENSOR_FLOAT32", TensorDataType::TENSOR_FLOAT32)
+        .value("TENSOR_FLOAT16", TensorDataType::TENSOR_FLOAT16)
+        .export_values();
+
+    py::class_<PySurfaceTensorConverter>(m, "PySurfaceTensorConverter")
+        .def(py::init<Pixel_Format, uint32_t, uint32_t, TensorDataType,
+                      const vector<float> &, const vector<float> &, float,
+                      bool>(),
+             py::arg("format"), py::arg("width") = 0U,
+             py::arg("height") = 0U, py::arg("dtype") = TENSOR_FLOAT32,
+             py::arg("mean") = vector<float>({0.0f, 0.0f, 0.0f}),
+             py::arg("std") = vector<float>({1.0f, 1.0f, 1.0f}),
+             py::arg("scale") = 1.0f / 255.0f, py::arg("bgr") = false)
+        .def("Execute",
+             py::overload_cast<shared_ptr<Surface>,
+                               shared_ptr<ColorspaceConversionContext>,
+                               py::array &>(
+                 &PySurfaceTensorConverter::Execute),
+             py::arg("surface"), py::arg("context"), py::arg("tensor"))
+        .def("Execute",
+             py::overload_cast<shared_ptr<Surface>,
+                               shared_ptr<ColorspaceConversionContext>>(
+                 &PySurfaceTensorConverter::Execute),
+             py::arg("surface"), py::arg("context"));
+
+    py::enum_<ResizeFilter>(m, "ResizeFilter")
+        .value("RESIZE_NEAREST", ResizeFilter::RESIZE_NEAREST)
+        .value("RESIZE_BILINEAR", ResizeFilter::RESIZE_BILINEAR)
+        .value("RESIZE_AREA", ResizeFilter::RESIZE_AREA)
+        .value("RESIZE_LANCZOS", ResizeFilter::RESIZE_LANCZOS)
+        .export_values();
+
+    // Host only constructor goes first, filter could pass for GPU ID;
     py::class_<PySurfaceResizer>(m, "PySurfaceResizer")
-        .def(py::init<uint32_t, uint32_t, Pixel_Format, uint32_t>())
-        .def(py::init<uint32_t, uint32_t, Pixel_Format, size_t , size_t >())
+        .def(py::init<uint32_t, uint32_t, Pixel_Format, ResizeFilter>(),
+             py::arg("width"), py::arg("height"), py::arg("format"),
+             py::arg("filter") = RESIZE_LANCZOS)
+        .def(py::init<uint32_t, uint32_t, Pixel_Format, uint32_t,
+                      ResizeFilter>(),
+             py::arg("width"), py::arg("height"), py::arg("format"),
+             py::arg("gpu_id"), py::arg("filter") = RESIZE_LANCZOS)
+        .def(py::init<uint32_t, uint32_t, Pixel_Format, size_t, size_t,
+                      ResizeFilter>(),
+             py::arg("width"), py::arg("height"), py::arg("format"),
+             py::arg("context"), py::arg("stream"),
+             py::arg("filter") = RESIZE_LANCZOS)
         .def("Format", &PySurfaceResizer::GetFormat)
         .def("Execute", &PySurfaceResizer::Execute,
              py::return_value_policy::take_ownership,
              py::call_guard<py::gil_scoped_release>());
 
+    py::class_<PySurfaceCropResizer>(m, "PySurfaceCropResizer")
+        .def(py::init<Pixel_Format, ResizeFilter>(), py::arg("format"),
+             py::arg("filter") = RESIZE_BILINEAR)
+        .def("Format", &PySurfaceCropResizer::GetFormat)
+        .def("Execute", &PySurfaceCropResizer::Execute, py::arg("surface"),
+             py::arg("rects"), py::arg("sizes"),
+             py::call_guard<py::gil_scoped_release>());
+
     m.def("GetNumGpus", &CudaResMgr::GetNumGpus);
+
+    m.def("GetBufferPoolStats",
+          []() { return BufferPool::Instance().GetStats(); });
+    m.def("TrimBufferPool", []() { BufferPool::Instance().Trim(); },
+          py::call_guard<py::gil_scoped_release>());
+    // Caller must do this before destroying own CUDA context;
+    m.def("TrimBufferPool", [](size_t context) {
+      BufferPool::Instance().Trim((CUcontext)context);
+    }, py::arg("context"), py::call_guard<py::gil_scoped_release>());
+    m.def("SetBufferPoolMaxCachedBytes", [](size_t max_bytes) {
+      BufferPool::Instance().SetMaxCachedBytes(max_bytes);
+    }, py::arg("max_bytes"));
+    m.def("SetBufferShrinkPolicy", &Buffer::SetShrinkPolicy, py::arg("ratio"),
+          py::arg("num_updates"));
+    m.def("SetTaskExecutorThreads", [](uint32_t num_threads) {
+      TaskExecutor::Instance().SetNumThreads(num_threads);
+    }, py::arg("num_threads"), py::call_guard<py::gil_scoped_release>());
+    m.def("GetTaskExecutorThreads",
+          []() { return TaskExecutor::Instance().GetNumThreads(); });
+    m.def("SetTaskMetricsEnabled", &TaskMetrics::SetEnabled,
+          py::arg("enabled"));
+    m.def("IsTaskMetricsEnabled", &TaskMetrics::IsEnabled);
+    m.def("GetTaskMetrics", &TaskMetrics::GetAll);
+    m.def("GetTaskLatencyBounds", []() {
+      vector<uint64_t> bounds;
+      for (auto i = 0U; i + 1U < TaskMetrics::GetNumLatencyBuckets(); i++) {
+        bounds.push_back(TaskMetrics::GetLatencyBound(i));
+      }
+      return bounds;
+    });
+    m.def("ResetTaskMetrics", &TaskMetrics::ResetAll);
+    m.def("ExportTaskMetrics", [](const string &format) {
+      if ("prometheus" == format) {
+        return TaskMetrics::ExportPrometheus();
+      } else if ("json" == format) {
+        return TaskMetrics::ExportJson();
+      }
+      throw invalid_argument("Unknown format, use prometheus or json.");
+    }, py::arg("format") = "prometheus");
+    m.def("SetTracingEnabled", &TaskTracer::SetEnabled, py::arg("enabled"));
+    m.def("IsTracingEnabled", &TaskTracer::IsEnabled);
+    m.def("SetTraceBufferSize", &TaskTracer::SetBufferSize,
+          py::arg("num_events"));
+    m.def("ClearTrace", &TaskTracer::Clear);
+    m.def("ExportChromeTrace", &TaskTracer::ExportChromeTrace,
+          py::call_guard<py::gil_scoped_release>());
+    m.def("DumpChromeTrace", [](const string &path) {
+      return TaskTracer::DumpChromeTrace(path.c_str());
+    }, py::arg("path"), py::call_guard<py::gil_scoped_release>());
 }
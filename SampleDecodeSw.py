@@ -62,7 +62,7 @@ def decode(encFilePath, decFilePath, mvcFilePath):
         if not (success):
             print("Frame not decoded")
         else:
-            print("Frame decoded") 
+            print("Frame decoded", nvDec.Width(), "x", nvDec.Height(), nvDec.Format())
             bits = bytearray(rawFrameYUV)
             decFile.write(bits)
             dump_motion_vectors(mvcFile, nvDec)
@@ -71,12 +71,12 @@ def decode(encFilePath, decFilePath, mvcFilePath):
 
 if __name__ == "__main__":
 
-    print("This sample decodes first ", total_num_frames, " frames from input video to raw YUV420 file using FFmpeg CPU-based decoder.")
+    print("This sample decodes first ", total_num_frames, " frames from input video to raw file in its native pixel format using FFmpeg CPU-based decoder.")
     print("It also extracts motion vectors using ffmpeg AVDictionary export_mvs entry")
     print("Usage: SampleDecode.py $input_file $output_file $motion_vectors_file")
 
     if(len(sys.argv) < 4):
-        print("Provide path to input and output files (YUV420 frames and motion vectos)")
+        print("Provide path to input and output files (raw frames and motion vectos)")
         exit(1)
 
     encFilePath = sys.argv[1]
@@ -0,0 +1,95 @@
+#
+# Copyright 2021 NVIDIA Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Starting from Python 3.8 DLL search policy has changed.
+# We need to add path to CUDA DLLs explicitly.
+import sys
+import os
+
+if os.name == 'nt':
+    # Add CUDA_PATH env variable
+    cuda_path = os.environ["CUDA_PATH"]
+    if cuda_path:
+        os.add_dll_directory(cuda_path)
+    else:
+        print("CUDA_PATH environment variable is not set.", file = sys.stderr)
+        print("Can't set CUDA DLLs search path.", file = sys.stderr)
+        exit(1)
+
+    # Add PATH as well for minor CUDA releases
+    sys_path = os.environ["PATH"]
+    if sys_path:
+        paths = sys_path.split(';')
+        for path in paths:
+            if os.path.isdir(path):
+                os.add_dll_directory(path)
+    else:
+        print("PATH environment variable is not set.", file = sys.stderr)
+        exit(1)
+
+import PyNvCodec as nvc
+import numpy as np
+import random
+import time
+
+def fetch_one_by_one(nvDec, frame_nums):
+    # Every call seeks to closest key frame and decodes till requested frame;
+    return [nvDec.GetFrames([n]) for n in frame_nums]
+
+def fetch_batch(nvDec, frame_nums):
+    # Requests are grouped by GOP, so every GOP is decoded only once;
+    return nvDec.GetFrames(frame_nums)
+
+def measure(encFilePath, frame_nums, fetch):
+    nvDec = nvc.PyFfmpegDecoder(encFilePath, {})
+    # Frame index is built upon first call and saved next to input file;
+    nvDec.NumFrames(exact=True)
+
+    start = time.perf_counter()
+    fetch(nvDec, frame_nums)
+    return time.perf_counter() - start
+
+if __name__ == "__main__":
+
+    print("This sample compares batch random access with per-frame random access for CPU-based decoder.")
+    print("Usage: SampleDecodeSwBatch.py $input_file $num_clips $clip_len")
+
+    if(len(sys.argv) < 2):
+        print("Provide path to input file")
+        exit(1)
+
+    encFilePath = sys.argv[1]
+    num_clips = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+    clip_len = int(sys.argv[3]) if len(sys.argv) > 3 else 4
+
+    nvDec = nvc.PyFfmpegDecoder(encFilePath, {})
+    num_frames = nvDec.NumFrames(exact=True)
+    if num_frames < clip_len:
+        print("Input is too short")
+        exit(1)
+
+    # Sample short clips at random positions, like video data loaders do;
+    frame_nums = []
+    for start in sorted(random.sample(range(num_frames - clip_len + 1), num_clips)):
+        frame_nums.extend(range(start, start + clip_len))
+
+    frames = nvDec.GetFrames(frame_nums)
+    print("Fetched frames batch of shape", frames.shape)
+
+    single = measure(encFilePath, frame_nums, fetch_one_by_one)
+    batch = measure(encFilePath, frame_nums, fetch_batch)
+    print("per-frame: {:8.3f} s batch: {:8.3f} s speedup: {:5.2f}x".format(
+        single, batch, single / batch if batch > 0 else 0.0))
@@ -0,0 +1,85 @@
+#
+# Copyright 2021 NVIDIA Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Starting from Python 3.8 DLL search policy has changed.
+# We need to add path to CUDA DLLs explicitly.
+import sys
+import os
+
+if os.name == 'nt':
+    # Add CUDA_PATH env variable
+    cuda_path = os.environ["CUDA_PATH"]
+    if cuda_path:
+        os.add_dll_directory(cuda_path)
+    else:
+        print("CUDA_PATH environment variable is not set.", file = sys.stderr)
+        print("Can't set CUDA DLLs search path.", file = sys.stderr)
+        exit(1)
+
+    # Add PATH as well for minor CUDA releases
+    sys_path = os.environ["PATH"]
+    if sys_path:
+        paths = sys_path.split(';')
+        for path in paths:
+            if os.path.isdir(path):
+                os.add_dll_directory(path)
+    else:
+        print("PATH environment variable is not set.", file = sys.stderr)
+        exit(1)
+
+import PyNvCodec as nvc
+import numpy as np
+import time
+
+def decode(encFilePath, num_threads, num_frames):
+    nvDec = nvc.PyFfmpegDecoder(encFilePath, {}, num_threads)
+    rawFrameYUV = np.ndarray(shape=(0), dtype=np.uint8)
+
+    dec_frame = 0
+    start = time.perf_counter()
+    while (dec_frame < num_frames):
+        success = nvDec.DecodeSingleFrame(rawFrameYUV)
+        if not (success):
+            break
+        dec_frame += 1
+    elapsed = time.perf_counter() - start
+
+    fps = dec_frame / elapsed if elapsed > 0 else 0.0
+    return dec_frame, fps, nvDec.NumThreads(), nvDec.ThreadType()
+
+if __name__ == "__main__":
+
+    print("This sample measures FFmpeg CPU-based decoder throughput depending on number of threads.")
+    print("Usage: SampleDecodeSwThreads.py $input_file $max_threads $num_frames")
+
+    if(len(sys.argv) < 2):
+        print("Provide path to input file")
+        exit(1)
+
+    encFilePath = sys.argv[1]
+    max_threads = int(sys.argv[2]) if len(sys.argv) > 2 else os.cpu_count()
+    num_frames = int(sys.argv[3]) if len(sys.argv) > 3 else 1000
+
+    num_threads = 1
+    base_fps = 0.0
+    while (num_threads <= max_threads):
+        dec_frames, fps, used_threads, thread_type = decode(encFilePath, num_threads, num_frames)
+        if 1 == num_threads:
+            base_fps = fps
+        scaling = fps / base_fps if base_fps > 0 else 0.0
+        print("threads: {:3d} ({}) frames: {:6d} fps: {:9.2f} scaling: {:5.2f}x".format(
+            used_threads, thread_type, dec_frames, fps, scaling))
+        num_threads *= 2
@@ -43,8 +43,149 @@ if os.name == 'nt':
 import SampleDecode as dec
 import SampleEncode as enc
 import PyNvCodec as nvc
+import numpy as np
+import shutil
+import tempfile
 import time
- 
+
+def seek_packets(path, frame_nums, mode, use_index):
+    nvDmx = nvc.PyFFmpegDemuxer(path)
+    if use_index and not nvDmx.BuildSeekIndex(in_background=False):
+        return None
+
+    packets = []
+    for frame_num in frame_nums:
+        seek_ctx = nvc.SeekContext(frame_num, mode)
+        packet = np.ndarray(shape=(0), dtype=np.uint8)
+        if not nvDmx.Seek(seek_ctx, packet):
+            return None
+        packets.append((seek_ctx.out_frame_pts, packet.tobytes()))
+    return packets
+
+def test_seek_index(input):
+    # Index is saved next to video, so work on a copy;
+    tmp_dir = tempfile.mkdtemp()
+    try:
+        clip = os.path.join(tmp_dir, os.path.basename(input))
+        shutil.copyfile(input, clip)
+        index_path = clip + '.vpfidx'
+
+        num_frames = nvc.PyFFmpegDemuxer(clip).Numframes()
+        if num_frames < 2:
+            print('SeekIndex: input needs known number of frames.')
+            return False
+        frame_nums = [0, num_frames // 7, num_frames // 3, 1, num_frames - 1,
+                      num_frames // 2]
+
+        # Seek with index must land on the same packet as without it;
+        for mode in [nvc.SeekMode.EXACT_FRAME, nvc.SeekMode.PREV_KEY_FRAME]:
+            ref = seek_packets(clip, frame_nums, mode, False)
+            res = seek_packets(clip, frame_nums, mode, True)
+            if ref is None or ref != res:
+                print('SeekIndex: seek with index differs in', mode)
+                return False
+        # Checks below use PREV_KEY_FRAME, it's the last mode above;
+        ref = res
+
+        # Up to date index is loaded, not scanned and saved again;
+        with open(index_path, 'rb') as f:
+            index_data = f.read()
+        index_mtime = os.stat(index_path).st_mtime_ns
+        time.sleep(1)
+        if seek_packets(clip, frame_nums, nvc.SeekMode.PREV_KEY_FRAME,
+                        True) != ref:
+            print('SeekIndex: seek with loaded index differs.')
+            return False
+        if os.stat(index_path).st_mtime_ns != index_mtime:
+            print('SeekIndex: up to date index was rebuilt.')
+            return False
+
+        # Index of file with other size is stale;
+        stale_data = bytearray(index_data)
+        stale_data[8] ^= 0xFF
+        with open(index_path, 'wb') as f:
+            f.write(stale_data)
+        if seek_packets(clip, frame_nums, nvc.SeekMode.PREV_KEY_FRAME,
+                        True) != ref:
+            print('SeekIndex: seek after stale index differs.')
+            return False
+        with open(index_path, 'rb') as f:
+            if f.read() != index_data:
+                print('SeekIndex: index with wrong file size was used.')
+                return False
+
+        # So is index of file modified after it was saved;
+        clip_mtime = os.stat(clip).st_mtime - 100
+        os.utime(clip, (clip_mtime, clip_mtime))
+        if seek_packets(clip, frame_nums, nvc.SeekMode.PREV_KEY_FRAME,
+                        True) != ref:
+            print('SeekIndex: seek after video change differs.')
+            return False
+        with open(index_path, 'rb') as f:
+            if f.read() == index_data:
+                print('SeekIndex: index of modified video was used.')
+                return False
+    finally:
+        shutil.rmtree(tmp_dir)
+
+    print('SeekIndex: seeks with and without index match.')
+    return True
+
+def test_sw_get_frames(input, num_frames = 64):
+    # Reference frames are decoded one by one in presentation order;
+    nvDec = nvc.PyFfmpegDecoder(input, {})
+    ref_frames = []
+    frame = np.ndarray(shape=(0), dtype=np.uint8)
+    while len(ref_frames) < num_frames and nvDec.DecodeSingleFrame(frame):
+        ref_frames.append(frame.copy())
+
+    # Out of order, repeated and across GOP boundaries;
+    num_frames = len(ref_frames)
+    frame_nums = [num_frames - 1, 0, num_frames // 2, 0, 1, num_frames - 1,
+                  num_frames // 3, num_frames // 2]
+
+    nvDec = nvc.PyFfmpegDecoder(input, {})
+    if nvDec.NumFrames(exact=True) < num_frames:
+        print('GetFrames: frame index is shorter than decoded stream.')
+        return False
+
+    frames = nvDec.GetFrames(frame_nums)
+    for i, frame_num in enumerate(frame_nums):
+        if not np.array_equal(frames[i].reshape(-1), ref_frames[frame_num]):
+            print('GetFrames: frame', frame_num, 'differs from sequential.')
+            return False
+
+    print('GetFrames: ', len(frame_nums), ' frames match sequential decode.')
+    return True
+
+def test_decode_stream(gpu_id, input, num_frames = 64):
+    # Reference timestamps come from frame by frame decode;
+    nvDec = nvc.PyNvDecoder(input, gpu_id)
+    ref_pts = []
+    while len(ref_pts) < num_frames:
+        pkt_data = nvc.PacketData()
+        surface = nvDec.DecodeSingleSurface(pkt_data)
+        if surface.Empty():
+            break
+        ref_pts.append(pkt_data.pts)
+
+    # Pipeline must give the same frames and stop once callback says so;
+    num_frames = len(ref_pts)
+    pts = []
+    def on_frame(surface, pkt_data):
+        if surface.Empty():
+            return False
+        pts.append(pkt_data.pts)
+        return len(pts) < num_frames
+
+    nvDec = nvc.PyNvDecoder(input, gpu_id)
+    if nvDec.DecodeStream(on_frame) != num_frames or pts != ref_pts:
+        print('DecodeStream: frames differ from frame by frame decode.')
+        return False
+
+    print('DecodeStream: ', num_frames, ' frames match frame by frame decode.')
+    return True
+
 if __name__ == "__main__":
 
     gpu_id = int(sys.argv[1])
@@ -67,6 +208,15 @@ if __name__ == "__main__":
     num_frames = decoder.dec_frames()
     print (str(num_frames), ' frames decoded.')
 
+    if not test_seek_index(input):
+        exit(1)
+
+    if not test_sw_get_frames(input):
+        exit(1)
+
+    if not test_decode_stream(gpu_id, input):
+        exit(1)
+
     enc.encode(gpu_id, dec_file, output, 1920, 1080)
 
     exit(0)
\ No newline at end of file